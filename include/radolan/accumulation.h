@@ -0,0 +1,167 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_ACCUMULATION_H
+#define RADOLAN_ACCUMULATION_H
+
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** How RDAccumulator treats cells without a usable value */
+    typedef enum {
+        /// the cell counts as dry (0 mm)
+        RD_INVALID_AS_ZERO,
+        /// the total of the cell becomes missing
+        RD_INVALID_AS_MISSING,
+        /// the cell is ignored and the total is scaled up to the full period,
+        /// i.e. the mean of the valid scans is filled in
+        RD_INVALID_SCALED
+    } RDInvalidPolicy;
+
+    /** Type of the running sums of RDAccumulator */
+    typedef enum {
+        /// sums of the raw integer values. Exact, but all scans need the same precision
+        RD_SUM_INTEGER,
+        /// single precision float sums
+        RD_SUM_FLOAT
+    } RDSumType;
+
+    /**
+     * Sums precipitation products (RY, RZ, RW, ...) over time, for example
+     * 5 minute scans into hourly, daily or event totals. Scans are ingested
+     * one at a time in chronological order, so arbitrarily long periods can
+     * be summed while holding only one scan in memory.
+     *
+     * All scans must have the same product, grid and interval. Timestamps
+     * must increase and lie on the interval grid. Scans that are absent
+     * between the first and the last one (or within the period, if set)
+     * count as missing for all cells.
+     *
+     * Missing cells (RDMissingValue) and clutter (RDClutterValue) are
+     * handled according to their RDInvalidPolicy. This requires scans
+     * read with ommitOutside = <code>false</code> (as ingestFile does);
+     * otherwise these cells are indistinguishable from dry ones.
+     */
+    class RDAccumulator {
+    public:
+
+        /**
+         * @param sumType type of the running sums
+         * @param missingPolicy treatment of missing cells and scans
+         * @param clutterPolicy treatment of clutter cells
+         */
+        RDAccumulator(RDSumType sumType = RD_SUM_INTEGER,
+                      RDInvalidPolicy missingPolicy = RD_INVALID_AS_MISSING,
+                      RDInvalidPolicy clutterPolicy = RD_INVALID_AS_ZERO);
+
+        /**
+         * Sets the accumulation period. Scans are time stamped at the end of
+         * their interval, so the period accepts timestamps in (begin, end].
+         * Scans of the period that are never ingested count as missing.
+         *
+         * @param begin start of the period (seconds since epoch, UTC)
+         * @param end end of the period (seconds since epoch, UTC)
+         */
+        void setPeriod(time_t begin, time_t end);
+
+        /**
+         * Minimum fraction of valid scans a cell needs for RD_INVALID_SCALED.
+         * Cells below it are missing in the totals. Defaults to 0.5.
+         */
+        void setMinimumCoverage(double fraction);
+
+        /**
+         * Adds a scan to the running sums.
+         *
+         * @param scan scan to add. It is not kept.
+         * @throws RDConversionException if the scan does not fit the ones
+         *         ingested before or is out of order
+         */
+        void ingest(RDScan *scan);
+
+        /**
+         * Reads a radolan file and adds it to the running sums.
+         *
+         * @param filename path to the file
+         * @throws RDConversionException
+         */
+        void ingestFile(const char *filename);
+
+        /** @return number of scans ingested */
+        size_t scanCount() const { return m_scans; }
+
+        /** @return number of scans expected for the period (or between the first and last scan) */
+        size_t expectedScanCount() const;
+
+        /**
+         * Computes the totals in mm. The header is the one of the first scan,
+         * with the timestamp of the end of the period and the interval set to
+         * its length in minutes (clamped to 65535). Cells whose total is
+         * missing hold RDMissingValue.
+         *
+         * @return newly allocated scan. Release with RDFreeScan.
+         * @throws RDConversionException if no scan was ingested
+         */
+        RDScan *totals() const;
+
+        /** Discards all sums. Period and policies are kept. */
+        void reset();
+
+    private:
+
+        RDSumType m_sumType;
+        RDInvalidPolicy m_missingPolicy;
+        RDInvalidPolicy m_clutterPolicy;
+        double m_minimumCoverage;
+        time_t m_periodBegin;
+        time_t m_periodEnd;
+
+        // taken from the first scan
+        bool m_initialized;
+        RDRadolanHeader m_header;
+        int m_dimLon;
+        int m_dimLat;
+        time_t m_interval;
+
+        time_t m_firstTime;
+        time_t m_lastTime;
+        size_t m_scans;
+
+        std::vector<uint64_t> m_rawSums;
+        std::vector<float> m_floatSums;
+
+        // number of scans that count for the cell (valid or dry by policy)
+        std::vector<uint32_t> m_valid;
+
+        // set if the cell's total is missing by policy
+        std::vector<uint8_t> m_poisoned;
+    };
+}
+
+#endif /* Header Guard */
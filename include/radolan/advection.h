@@ -0,0 +1,142 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_ADVECTION_H
+#define RADOLAN_ADVECTION_H
+
+#include <time.h>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/motion.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** Options for RDAdvectionCorrect */
+    typedef struct {
+
+        /// Length of the intermediate steps in minutes
+        int stepMinutes;
+
+        /// Options for estimating the motion if none is given
+        RDMotionOptions motion;
+
+        /// Number of threads. 0 uses all available cores.
+        unsigned int threads;
+
+    } RDAdvectionOptions;
+
+    /** @return options with 1 minute steps and default motion estimation on all cores */
+    inline RDAdvectionOptions rdAdvectionOptions() {
+        RDAdvectionOptions o;
+        o.stepMinutes = 1;
+        o.motion = rdMotionOptions();
+        o.threads = 0;
+        return o;
+    }
+
+    /**
+     * Advection corrected version of the current scan. The intermediate
+     * fields between the two scans are synthesized by semi-Lagrangian
+     * advection: at time fraction a of the interval, a cell holds
+     * (1 - a) times the previous scan traced back along the motion by a,
+     * plus a times the current scan traced forward by 1 - a, both sampled
+     * bilinearly. The result is the mean of the intermediate fields at the
+     * middle of each step, accumulated cell by cell without keeping the
+     * intermediate grids, so it has the unit of the scans and can be
+     * ingested in place of the current scan, for example by RDAccumulator.
+     *
+     * A cell is missing (or clutter) if any sample it draws on is.
+     * Positions traced beyond the grid are clamped to its border. Rows are
+     * distributed over the threads.
+     *
+     * @param previous earlier scan
+     * @param current later scan of the same product and grid
+     * @param motion motion between the scans. If NULL, it is estimated
+     *        with RDEstimateMotion.
+     * @param options @see RDAdvectionOptions
+     * @return newly allocated scan with the header of the current one.
+     *         Release with RDFreeScan.
+     * @throws RDConversionException if the scans don't match or are not in order
+     */
+    RDScan *RDAdvectionCorrect(const RDScan *previous,
+                               const RDScan *current,
+                               const RDMotionField *motion,
+                               const RDAdvectionOptions &options = rdAdvectionOptions());
+
+    /**
+     * Advection correction of a series of scans. Each scan is corrected
+     * with its predecessor; the first scan, and the first one after a gap
+     * longer than the interval, are passed on unchanged. The output can be
+     * fed scan by scan into RDAccumulator or RDSlidingWindow:
+     *
+     * <pre>
+     * RDScan *corrected = corrector.ingest(scan);
+     * accumulator.ingest(corrected);
+     * RDFreeScan(corrected);
+     * </pre>
+     */
+    class RDAdvectionCorrector {
+    public:
+
+        RDAdvectionCorrector(const RDAdvectionOptions &options = rdAdvectionOptions());
+
+        ~RDAdvectionCorrector();
+
+        /**
+         * @param scan next scan. A copy is kept for the next call.
+         * @param motion motion since the previous scan. If NULL, it is estimated.
+         * @return newly allocated corrected scan. Release with RDFreeScan.
+         * @throws RDConversionException if the scan does not fit the previous one
+         */
+        RDScan *ingest(const RDScan *scan, const RDMotionField *motion = NULL);
+
+        /**
+         * Reads a radolan file and ingests it.
+         *
+         * @param filename path to the file
+         * @return newly allocated corrected scan. Release with RDFreeScan.
+         * @throws RDConversionException
+         */
+        RDScan *ingestFile(const char *filename);
+
+        /** @return motion used for the last scan. Empty if it was passed on unchanged or supplied. */
+        const RDMotionField &lastMotion() const { return m_motion; }
+
+        /** Forgets the previous scan */
+        void reset();
+
+    private:
+
+        RDAdvectionCorrector(const RDAdvectionCorrector &);
+
+        RDAdvectionCorrector &operator=(const RDAdvectionCorrector &);
+
+        RDAdvectionOptions m_options;
+        RDScan *m_previous;
+        time_t m_previousTime;
+        RDMotionField m_motion;
+    };
+}
+
+#endif /* Header Guard */
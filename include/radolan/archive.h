@@ -0,0 +1,248 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_ARCHIVE_H
+#define RADOLAN_ARCHIVE_H
+
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** Options for RDArchiveWriter */
+    typedef struct {
+        /// edge length of the square tiles in cells
+        int tileSize;
+        /// every keyframeInterval-th scan of a product is stored without
+        /// reference to the one before (12 = hourly for 5 minute scans)
+        int keyframeInterval;
+        /// zlib compression level 1-9
+        int compressionLevel;
+    } RDArchiveOptions;
+
+    inline RDArchiveOptions rdArchiveOptions() {
+        RDArchiveOptions options;
+        options.tileSize = 128;
+        options.keyframeInterval = 12;
+        options.compressionLevel = 6;
+        return options;
+    }
+
+    /** Position of a scan within an archive */
+    typedef struct {
+        uint64_t offset;
+        time_t time;
+        bool keyframe;
+    } RDArchiveEntry;
+
+    /** Scans of one product within an archive */
+    typedef struct {
+        RDScanType scanType;
+        int dimLon;
+        int dimLat;
+        int tileSize;
+        float precision;
+        std::vector<RDArchiveEntry> entries;
+    } RDArchiveProduct;
+
+    /**
+     * Appends scans to an archive file, creating it if necessary.
+     *
+     * An archive is a sequence of records, one per scan. The scan is
+     * stored in the compact form of RDEncodeCompact and split into square
+     * tiles, which are compressed separately with zlib. Tiles of a
+     * keyframe hold the difference to the cell on the left, the other
+     * tiles the difference to the same tile of the previous scan of the
+     * product. The differences are zigzag coded and their low and high
+     * bytes stored apart, which leaves long runs of zeros for zlib.
+     *
+     * Scans of several products may be mixed. The scans of each product
+     * must be appended in chronological order. The first scan of each
+     * product after opening is a keyframe. A record that was not written
+     * completely is cut off when the archive is opened again.
+     *
+     * Archives are written in the byte order of the machine.
+     */
+    class RDArchiveWriter {
+    public:
+
+        /**
+         * @param path path of the archive
+         * @param options see RDArchiveOptions
+         * @throws RDConversionException if the file can not be opened or
+         *         is not an archive
+         */
+        explicit RDArchiveWriter(const char *path, const RDArchiveOptions &options = rdArchiveOptions());
+
+        ~RDArchiveWriter();
+
+        /**
+         * Appends a scan.
+         *
+         * @param scan next scan of its product. It is not kept.
+         * @throws RDConversionException if the scan does not fit the
+         *         earlier scans of the product or is not later than them
+         */
+        void append(const RDScan *scan);
+
+        /**
+         * Reads a radolan file and appends it.
+         *
+         * @param filename path to the file
+         * @throws RDConversionException
+         */
+        void appendFile(const char *filename);
+
+    private:
+
+        RDArchiveWriter(const RDArchiveWriter &);
+
+        RDArchiveWriter &operator=(const RDArchiveWriter &);
+
+        /** What the writer needs to know about the last scan of a product */
+        typedef struct {
+            RDArchiveProduct geometry;
+            time_t lastTime;
+            int sinceKeyframe;
+            std::vector<uint16_t> values;
+        } State;
+
+        RDArchiveOptions m_options;
+        int m_file;
+        std::map<RDScanType, State> m_states;
+    };
+
+    /**
+     * Reads an archive written by RDArchiveWriter. The file is mapped
+     * into memory and the records are indexed by product and time when
+     * the archive is opened. Records appended later are not seen.
+     *
+     * A scan is decoded from the last keyframe before it on, so reading
+     * consecutive scans with scans() or tiles() is cheaper than reading
+     * them one by one.
+     */
+    class RDArchiveReader {
+    public:
+
+        /**
+         * @param path path of the archive
+         * @throws RDConversionException if the file is not an archive
+         */
+        explicit RDArchiveReader(const char *path);
+
+        ~RDArchiveReader();
+
+        /** @return end of the last complete record in bytes */
+        uint64_t endOfRecords() const { return m_end; }
+
+        /** @return products in the archive */
+        std::vector<RDScanType> products() const;
+
+        /**
+         * @return scans of a product, ordered by time
+         * @throws RDConversionException if the product is not in the archive
+         */
+        const RDArchiveProduct &product(RDScanType scanType) const;
+
+        /** @return index of the product's scan with the given time or -1 */
+        long find(RDScanType scanType, time_t time) const;
+
+        /**
+         * Scans of a product within a period.
+         *
+         * @param begin first timestamp, inclusive
+         * @param end last timestamp, exclusive
+         * @param first index of the first scan in the period
+         * @param last index after the last scan in the period
+         */
+        void range(RDScanType scanType, time_t begin, time_t end, size_t &first, size_t &last) const;
+
+        /**
+         * Decodes a scan.
+         *
+         * @param scanType product
+         * @param index index of the scan within the product
+         * @return newly allocated scan. Release with RDFreeScan. The list of
+         *         radar stations is not kept in archives.
+         * @throws RDConversionException
+         */
+        RDScan *scan(RDScanType scanType, size_t index) const;
+
+        /**
+         * Decodes consecutive scans.
+         *
+         * @param scanType product
+         * @param first,last scans [first, last) of the product
+         * @return newly allocated scans. Release each with RDFreeScan.
+         * @throws RDConversionException
+         */
+        std::vector<RDScan *> scans(RDScanType scanType, size_t first, size_t last) const;
+
+        /**
+         * Compact values of one tile over consecutive scans.
+         *
+         * @param scanType product
+         * @param first,last scans [first, last) of the product
+         * @param tileX,tileY column and row of the tile
+         * @param values the values of the tile for each scan, row by row.
+         *        Decode them with RDDecodeCompact and the product's precision.
+         * @param width,height size of the tile, smaller at the grid's edges
+         * @throws RDConversionException
+         */
+        void tiles(RDScanType scanType, size_t first, size_t last, int tileX, int tileY,
+                   std::vector<uint16_t> &values, int &width, int &height) const;
+
+    private:
+
+        RDArchiveReader(const RDArchiveReader &);
+
+        RDArchiveReader &operator=(const RDArchiveReader &);
+
+        // decodes one tile of a scan. values holds the tile of the scan
+        // before and receives the tile of this one.
+        void decodeTile(const RDArchiveEntry &entry, int tile, size_t cells, int width,
+                        uint16_t *values, std::vector<unsigned char> &buffer) const;
+
+        // decodes all tiles of scans [first, last), calling back after each scan
+        template<typename Callback>
+        void decode(const RDArchiveProduct &product, size_t first, size_t last, Callback callback) const;
+
+        RDScan *allocateScan(const RDArchiveProduct &product, const RDArchiveEntry &entry,
+                             const std::vector<uint16_t> &values) const;
+
+        int m_file;
+        const unsigned char *m_data;
+        size_t m_size;
+        uint64_t m_end;
+        std::map<RDScanType, RDArchiveProduct> m_products;
+    };
+}
+
+#endif /* Header Guard */
@@ -0,0 +1,235 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_CELLS_H
+#define RADOLAN_CELLS_H
+
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** Options for RDLabelCells */
+    typedef struct {
+
+        /// Cells with clean values at or above belong to a rain cell, in the unit of the scan
+        RDDataType threshold;
+
+        /// 4 or 8 connected neighbourhood
+        int connectivity;
+
+        /// Rain cells with fewer grid cells are dropped
+        int minimumArea;
+
+    } RDCellOptions;
+
+    /** @return options for convective cells in reflectivity products:
+     *  46 dBZ, 8-connected, at least 4 grid cells */
+    inline RDCellOptions rdCellOptions() {
+        RDCellOptions o;
+        o.threshold = 46.0f;
+        o.connectivity = 8;
+        o.minimumArea = 4;
+        return o;
+    }
+
+    /** Statistics of one rain cell. Positions are grid indices (ix,iy). */
+    typedef struct {
+
+        /// Number of grid cells
+        int area;
+
+        /// Centroid of the grid cells
+        double centroidX;
+        double centroidY;
+
+        /// Largest value and its position
+        RDDataType maximum;
+        int maximumX;
+        int maximumY;
+
+        /// Sum of the values
+        double sum;
+
+        /// Bounding box, inclusive
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+
+    } RDRainCell;
+
+    /** Rain cells of a scan, as produced by RDLabelCells */
+    typedef struct {
+
+        /// Number of longitudinal vertices
+        int dimLon;
+
+        /// Number of latitudinal vertices
+        int dimLat;
+
+        /// Index into cells per grid cell (row major). -1 outside of rain cells.
+        std::vector<int> labels;
+
+        /// Rain cells, numbered in scan order
+        std::vector<RDRainCell> cells;
+
+    } RDRainCells;
+
+    /**
+     * Labels the connected areas at or above the threshold with a two pass
+     * scanline algorithm with union-find. The statistics are gathered per
+     * provisional label during the first pass and merged along the
+     * union-find tree, so the grid is only traversed twice.
+     *
+     * @param scan the scan
+     * @param options threshold, connectivity and minimum area
+     * @param result labels and statistics. Its buffers are reused.
+     * @return number of rain cells
+     * @throw RDConversionException if the connectivity is not 4 or 8
+     */
+    int RDLabelCells(const RDScan *scan, const RDCellOptions &options, RDRainCells &result);
+
+    /** Options for RDCellTracker */
+    typedef struct {
+
+        /// Largest distance in km between a cell's predicted and actual centroid
+        /// for matching cells without overlap
+        double maximumDistance;
+
+        /// Smallest overlap, as fraction of the smaller cell, for matching by overlap
+        double minimumOverlap;
+
+        /// Larger gaps between scans in minutes end all tracks
+        int maximumGapMinutes;
+
+    } RDTrackerOptions;
+
+    /** @return options with 20 km distance, 10% overlap and 15 minutes gap */
+    inline RDTrackerOptions rdTrackerOptions() {
+        RDTrackerOptions o;
+        o.maximumDistance = 20.0;
+        o.minimumOverlap = 0.1;
+        o.maximumGapMinutes = 15;
+        return o;
+    }
+
+    /** One position of a track */
+    typedef struct {
+        time_t time;
+        RDRainCell cell;
+    } RDTrackPoint;
+
+    /** A rain cell followed over consecutive scans */
+    typedef struct {
+
+        /// Unique id, counting from 1
+        uint64_t id;
+
+        /// Positions, one per scan
+        std::vector<RDTrackPoint> points;
+
+        /// Current velocity along ix and iy in km/h. 0 for new tracks.
+        double u;
+        double v;
+
+    } RDCellTrack;
+
+    /**
+     * Tracks rain cells across consecutive scans. The cells of a new scan
+     * are matched against the tracks of the previous one, first by overlap
+     * (largest overlap first, one-to-one), then the remaining ones by the
+     * distance to the centroid predicted from the track's velocity. Cells
+     * without a match start a new track. Splits continue the track with
+     * the largest part, merges continue the track with the largest overlap.
+     */
+    class RDCellTracker {
+    public:
+
+        RDCellTracker(const RDCellOptions &cellOptions = rdCellOptions(),
+                      const RDTrackerOptions &trackerOptions = rdTrackerOptions());
+
+        /**
+         * Labels the scan and updates the tracks.
+         *
+         * @param scan next scan, later than the previous one. It is not kept.
+         * @return tracks alive after this scan, in the order of the scan's cells
+         * @throws RDConversionException if the scan does not fit the ones
+         *         ingested before or is out of order
+         */
+        const std::vector<RDCellTrack> &ingest(const RDScan *scan);
+
+        /**
+         * Reads a radolan file and ingests it.
+         *
+         * @param filename path to the file
+         * @throws RDConversionException
+         */
+        const std::vector<RDCellTrack> &ingestFile(const char *filename);
+
+        /** @return tracks alive after the last scan */
+        const std::vector<RDCellTrack> &activeTracks() const { return m_active; }
+
+        /** @return rain cells of the last scan */
+        const RDRainCells &lastCells() const { return m_cells; }
+
+        /**
+         * Returns the tracks that ended since the last call and forgets them.
+         *
+         * @param finishActive if <code>true</code>, the active tracks are
+         *        ended first (at the end of a feed)
+         */
+        std::vector<RDCellTrack> takeFinishedTracks(bool finishActive = false);
+
+    private:
+
+        // ends all active tracks, so the next scan starts new ones
+        void finishActiveTracks();
+
+        RDCellOptions m_cellOptions;
+        RDTrackerOptions m_trackerOptions;
+
+        bool m_initialized;
+        RDScanType m_scanType;
+        int m_dimLon;
+        int m_dimLat;
+        double m_cellSizeX;
+        double m_cellSizeY;
+        time_t m_lastTime;
+        uint64_t m_nextId;
+
+        RDRainCells m_cells;
+        RDRainCells m_previousCells;
+        std::vector<RDCellTrack> m_active;
+        std::vector<RDCellTrack> m_finished;
+
+        // scratch space reused between scans
+        std::vector<uint64_t> m_pairs;
+    };
+}
+
+#endif /* Header Guard */
@@ -0,0 +1,192 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_CLIMATOLOGY_H
+#define RADOLAN_CLIMATOLOGY_H
+
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /**
+     * Per-cell climatology of a product over an arbitrary number of scans:
+     * number of valid scans, mean, maximum, fraction of wet scans and the
+     * number of scans exceeding each of a set of thresholds.
+     *
+     * Memory use depends on the grid and the number of thresholds only.
+     * The grid is split into bands of rows (tiles), each guarded by a
+     * mutex of its own, so several threads can ingest scans at the same
+     * time. Each scan must be ingested once, in any order.
+     *
+     * The state can be saved as a checkpoint and merged into another
+     * climatology, so long runs can be split up and resumed. Checkpoints
+     * are written in the byte order of the machine.
+     */
+    class RDClimatology {
+    public:
+
+        /**
+         * @param thresholds values to count exceedances of (strictly above),
+         *        in the unit of the product
+         * @param wetThreshold valid values above count as wet
+         * @param tileRows number of grid rows per tile
+         */
+        RDClimatology(const std::vector<double> &thresholds,
+                      double wetThreshold = 0.0,
+                      int tileRows = 32);
+
+        /**
+         * Adds a scan. Safe to call from several threads.
+         *
+         * @param scan scan to add. It is not kept.
+         * @throws RDConversionException if the scan does not fit the ones
+         *         ingested before
+         */
+        void ingest(RDScan *scan);
+
+        /**
+         * Reads a radolan file and ingests it.
+         *
+         * @param filename path to the file
+         * @throws RDConversionException
+         */
+        void ingestFile(const char *filename);
+
+        /**
+         * Reads and ingests files with a number of worker threads.
+         * Files that can not be read are skipped.
+         *
+         * @param filenames paths to the files
+         * @param threads number of worker threads. 0 uses all available cores.
+         * @return number of files skipped
+         * @throws RDConversionException if a scan does not fit the others
+         */
+        size_t ingestFiles(const std::vector<std::string> &filenames, unsigned int threads = 0);
+
+        /**
+         * Adds the state of another climatology of the same product,
+         * grid and thresholds. The tile sizes may differ. Both may merge
+         * into each other concurrently.
+         *
+         * @throws RDConversionException if the climatologies don't match
+         */
+        void merge(const RDClimatology &other);
+
+        /**
+         * Writes the state to a checkpoint file. The file is written
+         * under a temporary name and renamed when complete.
+         *
+         * @param path path to the checkpoint
+         * @throws RDConversionException
+         */
+        void save(const char *path) const;
+
+        /**
+         * Reads a checkpoint written by save and merges it.
+         *
+         * @param path path to the checkpoint
+         * @throws RDConversionException if the file can not be read, is
+         *         truncated or does not match
+         */
+        void load(const char *path);
+
+        /** @return number of scans ingested (including merged ones) */
+        uint64_t scanCount() const;
+
+        /** @return time of the first and the last scan (seconds since epoch) */
+        time_t firstTime() const;
+        time_t lastTime() const;
+
+        /** @return the thresholds exceedances are counted for */
+        const std::vector<double> &thresholds() const { return m_thresholds; }
+
+        /** @return the wet threshold */
+        double wetThreshold() const { return m_wetThreshold; }
+
+        /**
+         * The results are returned as scans of the ingested product with the
+         * timestamp of the last scan. Cells without valid scans hold
+         * RDMissingValue. Release them with RDFreeScan.
+         *
+         * @throws RDConversionException if no scan was ingested
+         */
+        RDScan *mean() const;
+        RDScan *maximum() const;
+        RDScan *wetFraction() const;
+        RDScan *validCount() const;
+        RDScan *exceedanceCount(size_t threshold) const;
+
+    private:
+
+        RDClimatology(const RDClimatology &);
+        RDClimatology &operator=(const RDClimatology &);
+
+        // sets up the grid from the first scan. Expects m_stateMutex to be held.
+        void initialize(const RDRadolanHeader &header, int dimLon, int dimLat);
+
+        // checks product and grid. Expects m_stateMutex to be held.
+        void checkCompatible(RDScanType type, int dimLon, int dimLat, float precision) const;
+
+        void ingestTile(size_t tile, const RDDataType *data);
+
+        // locks all tiles, in order
+        std::vector<std::unique_lock<std::mutex> > lockTiles() const;
+
+        RDScan *allocateResult() const;
+
+        std::vector<double> m_thresholds;
+        double m_wetThreshold;
+        int m_tileRows;
+
+        // header, counters and grid set up
+        mutable std::mutex m_stateMutex;
+        bool m_initialized;
+        RDRadolanHeader m_header;
+        int m_dimLon;
+        int m_dimLat;
+        size_t m_cells;
+        uint64_t m_scans;
+        time_t m_firstTime;
+        time_t m_lastTime;
+        float m_lower;       // smallest valid value
+        float m_upper;       // values at or above are markers
+
+        // per cell accumulators, guarded by the mutex of their tile
+        size_t m_tiles;
+        mutable std::vector<std::mutex> m_tileMutexes;
+        std::vector<uint32_t> m_count;
+        std::vector<double> m_sum;
+        std::vector<float> m_max;
+        std::vector<uint32_t> m_wet;
+        std::vector<uint32_t> m_exceedances;     // threshold major
+    };
+}
+
+#endif /* Header Guard */
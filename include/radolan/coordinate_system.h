@@ -192,12 +192,35 @@ namespace Radolan {
 
         /**
          * Calculate the polar stereographic coordinate from the given grid point.
+         * This is the cell corner facing away from the origin (see RDQuadrant),
+         * the inverse of gridPoint. Cell centres, as written by the
+         * exporters, are given by cartesianCentreCoordinate.
          *
          * @param gridpoint grid point
          * @return cartesian coordinate in the polar stereographic coordinate system
          */
         RDCartesianPoint cartesianCoordinate(RDGridPoint gridpoint);
 
+        /**
+         * Calculate the polar stereographic coordinate of a grid cell corner.
+         * Corner (ix,iy) is the lower left corner of grid cell (ix,iy), so
+         * corners range from (0,0) to (dimLon,dimLat).
+         *
+         * @param corner corner indexes
+         * @return cartesian coordinate in the polar stereographic coordinate system
+         */
+        RDCartesianPoint cartesianCornerCoordinate(RDGridPoint corner);
+
+        /**
+         * Calculate the polar stereographic coordinate of the centre of a
+         * grid cell, midway between its corners. All exporters use this
+         * for the coordinate axes and point features.
+         *
+         * @param cell cell indexes
+         * @return cartesian coordinate in the polar stereographic coordinate system
+         */
+        RDCartesianPoint cartesianCentreCoordinate(RDGridPoint cell);
+
         /**
          * Calculate geographical coordinate from the given polar stereographic coordinate.
          *
@@ -0,0 +1,122 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_FILTERS_H
+#define RADOLAN_FILTERS_H
+
+#include <functional>
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /**
+     * Spatial filters on the scan grid. Only clean values
+     * (@see RDIsCleanMeasurement) take part in the filters; missing and
+     * clutter cells keep their marker and don't bleed into their
+     * neighbours. Near the border, the windows are clipped to the grid.
+     *
+     * Gaussian and maximum filters are separable: a pass along the rows
+     * is followed by a pass along the columns, both written so that the
+     * compiler vectorizes them. The grid is processed in bands of rows
+     * distributed over the threads.
+     *
+     * Each filter works in place, or from a source scan into a target
+     * scan of the same grid, so scans can be filtered back and forth
+     * (ping-pong) without allocating. The scratch buffers are kept by the
+     * filter and reused as long as the grid size does not change.
+     */
+    class RDScanFilter {
+    public:
+
+        /**
+         * @param threads number of threads. 0 uses all available cores.
+         * @param tileRows number of rows per band of work
+         */
+        RDScanFilter(unsigned int threads = 0, int tileRows = 32);
+
+        /**
+         * Gaussian smoothing by normalized convolution: the weights of
+         * the cells without clean values are left out.
+         *
+         * @param scan scan to filter in place
+         * @param sigma standard deviation in cells. The kernel reaches to 3 sigma.
+         */
+        void gaussian(RDScan *scan, float sigma);
+
+        /**
+         * @param source scan to filter
+         * @param target scan of the same grid with allocated data. May be the source.
+         * @param sigma standard deviation in cells
+         * @throws RDConversionException if the grids differ
+         */
+        void gaussian(const RDScan *source, RDScan *target, float sigma);
+
+        /**
+         * Maximum over the window x window cells around each cell.
+         *
+         * @param scan scan to filter in place
+         * @param window odd edge length of the window in cells
+         */
+        void maximum(RDScan *scan, int window);
+
+        /** @see maximum. target may be the source. */
+        void maximum(const RDScan *source, RDScan *target, int window);
+
+        /**
+         * Median over the window x window cells around each cell, for
+         * removing speckle. The median is not separable, so each window
+         * is evaluated on its own; use small windows (3 or 5).
+         *
+         * @param scan scan to filter in place
+         * @param window odd edge length of the window in cells
+         */
+        void median(RDScan *scan, int window);
+
+        /** @see median. target may be the source. */
+        void median(const RDScan *source, RDScan *target, int window);
+
+    private:
+
+        // clean values and their weights (1 clean, 0 otherwise) of the source
+        void prepare(const RDScan *source, RDScan *target, float invalidValue);
+
+        // runs work(firstRow, endRow) on all bands of rows
+        void forEachBand(int dimLat, const std::function<void(int, int)> &work) const;
+
+        // min_value and max_value of the target from its clean values
+        void updateRange(RDScan *target) const;
+
+        unsigned int m_threads;
+        int m_tileRows;
+
+        std::vector<float> m_values;
+        std::vector<float> m_weights;
+        std::vector<float> m_rowValues;
+        std::vector<float> m_rowWeights;
+    };
+}
+
+#endif /* Header Guard */
@@ -0,0 +1,80 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_FLATGEOBUF_CONVERTER_H
+#define RADOLAN_FLATGEOBUF_CONVERTER_H
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /**
+     * This class contains facilities for converting a RADOLAN scan into
+     * FlatGeobuf files (https://flatgeobuf.org). Each radar pixel becomes a
+     * feature with the properties <code>value</code> and <code>time</code>.
+     * The features are sorted along a Hilbert curve and the file contains a
+     * packed R-tree, so clients can fetch the features of an area with a
+     * few range reads. Unlike shapefiles, the format has no size limit.
+     */
+    class Radolan2FlatGeobuf {
+    public:
+
+        /**
+         * Writes out the centres of the individual radar pixels as points.
+         *
+         * @param scan radolan scan
+         * @param filename output filename
+         * @param geographic if <code>true</code> the coordinates are transformed to lat/lon.
+         *        If <code>false</code> they are polar-stereographic (cartesian).
+         *
+         * @throws RDConversionException
+         */
+        static void convertToPoints(RDScan *scan,
+                                    const char *filename,
+                                    bool geographic = false);
+
+        /**
+         * Writes out the individual radar pixels as polygons.
+         *
+         * @param scan radolan scan
+         * @param filename output filename
+         * @param geographic if <code>true</code> the coordinates are transformed to lat/lon.
+         *        If <code>false</code> they are polar-stereographic (cartesian).
+         *
+         * @throws RDConversionException
+         */
+        static void convertToPolygons(RDScan *scan,
+                                      const char *filename,
+                                      bool geographic = false);
+
+    private:
+
+        static void convert(RDScan *scan,
+                            const char *filename,
+                            bool polygons,
+                            bool geographic);
+    };
+}
+
+#endif /* Header Guard */
@@ -0,0 +1,159 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_GAUGE_ADJUSTMENT_H
+#define RADOLAN_GAUGE_ADJUSTMENT_H
+
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** A rain gauge */
+    typedef struct {
+
+        /// Geographical position in degrees
+        double longitude;
+        double latitude;
+
+        /// Precipitation over the interval of the scan, in the unit of the scan (mm).
+        /// Negative or NaN values are skipped.
+        float value;
+
+    } RDGauge;
+
+    /** Spatial interpolation of the residuals */
+    typedef enum {
+        /// inverse distance weighting
+        RD_INTERPOLATION_IDW,
+        /// ordinary kriging with an exponential variogram. Falls back to
+        /// inverse distance weighting where the system is singular, for
+        /// example for gauges at the same position.
+        RD_INTERPOLATION_KRIGING
+    } RDInterpolation;
+
+    /** How the radar is corrected */
+    typedef enum {
+        /// the interpolated difference gauge - radar is added
+        RD_ADJUST_ADDITIVE,
+        /// the radar is multiplied by the interpolated ratio gauge / radar
+        RD_ADJUST_MULTIPLICATIVE
+    } RDAdjustment;
+
+    /** Options for RDAdjustWithGauges */
+    typedef struct {
+
+        RDInterpolation interpolation;
+
+        RDAdjustment adjustment;
+
+        /// Number of nearest gauges used per grid cell
+        int neighbours;
+
+        /// Gauges further away than this (km) are not used. Cells without
+        /// gauges in reach are not adjusted.
+        double maximumDistance;
+
+        /// Exponent of the inverse distance weights
+        double idwPower;
+
+        /// Exponential variogram nugget + (sill - nugget) (1 - exp(-h / range)).
+        /// A sill <= 0 is replaced by the variance of the residuals.
+        double nugget;
+        double sill;
+        double range;
+
+        /// Added to gauge and radar before taking their ratio
+        float ratioOffset;
+
+        /// Ratios are limited to [1 / maximumRatio, maximumRatio]
+        float maximumRatio;
+
+        /// Number of threads. 0 uses all available cores.
+        unsigned int threads;
+
+    } RDGaugeAdjustmentOptions;
+
+    /** @return options for additive IDW adjustment with 12 gauges within 100 km */
+    inline RDGaugeAdjustmentOptions rdGaugeAdjustmentOptions() {
+        RDGaugeAdjustmentOptions o;
+        o.interpolation = RD_INTERPOLATION_IDW;
+        o.adjustment = RD_ADJUST_ADDITIVE;
+        o.neighbours = 12;
+        o.maximumDistance = 100.0;
+        o.idwPower = 2.0;
+        o.nugget = 0.0;
+        o.sill = 0.0;
+        o.range = 50.0;
+        o.ratioOffset = 0.1f;
+        o.maximumRatio = 10.0f;
+        o.threads = 0;
+        return o;
+    }
+
+    /** Residual at a gauge */
+    typedef struct {
+
+        /// Index into the gauges
+        size_t gauge;
+
+        /// Grid cell of the gauge
+        int ix;
+        int iy;
+
+        float gaugeValue;
+        float radarValue;
+
+        /// gauge - radar, or the limited ratio gauge / radar
+        double residual;
+
+    } RDGaugeResidual;
+
+    /**
+     * Adjusts a radar scan to rain gauges. The residuals between the
+     * gauges and the radar value of the grid cell each gauge lies in are
+     * interpolated to all grid cells from the nearest gauges, found with
+     * a KD-tree, and applied to the radar. Gauges outside the grid, on
+     * cells without a clean radar value or without a valid measurement
+     * are skipped. Cells without a clean radar value keep their marker.
+     *
+     * For kriging, consecutive cells with the same set of neighbours share
+     * the factorized kriging system. Rows are distributed over the threads.
+     *
+     * @param radar precipitation scan, for example RY or an hourly total
+     * @param gauges gauge measurements for the same interval
+     * @param options @see RDGaugeAdjustmentOptions
+     * @param residuals if not NULL, receives the residuals of the used gauges
+     * @return newly allocated adjusted scan with the header of the radar.
+     *         Release with RDFreeScan.
+     * @throws RDConversionException if the options are invalid
+     */
+    RDScan *RDAdjustWithGauges(const RDScan *radar,
+                               const std::vector<RDGauge> &gauges,
+                               const RDGaugeAdjustmentOptions &options = rdGaugeAdjustmentOptions(),
+                               std::vector<RDGaugeResidual> *residuals = NULL);
+}
+
+#endif /* Header Guard */
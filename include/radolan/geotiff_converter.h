@@ -0,0 +1,107 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_GEOTIFF_CONVERTER_H
+#define RADOLAN_GEOTIFF_CONVERTER_H
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** Options for Radolan2GeoTIFF */
+    typedef struct {
+        /// edge length of the tiles in pixels, a multiple of 16
+        int tileSize;
+        /// number of overviews, each half the size of the one before (3 = 2x, 4x and 8x)
+        int overviews;
+        /// deflate compression level 1-9
+        int compressionLevel;
+        /// use the floating point predictor. It pays off for smooth fields,
+        /// the quantized products compress better without it.
+        bool predictor;
+        /// number of threads compressing tiles, 0 for one per core
+        unsigned int threads;
+    } RDGeoTIFFOptions;
+
+    inline RDGeoTIFFOptions rdGeoTIFFOptions() {
+        RDGeoTIFFOptions options;
+        options.tileSize = 256;
+        options.overviews = 3;
+        options.compressionLevel = 6;
+        options.predictor = false;
+        options.threads = 0;
+        return options;
+    }
+
+    /**
+     * This class contains facilities for converting a RADOLAN scan into
+     * a Cloud Optimized GeoTIFF (https://www.cogeo.org).
+     *
+     * The scan is written as a single band of 32 bit floats, north up,
+     * with the product's missing value as GDAL_NODATA. The image is cut
+     * into deflate compressed tiles, which are compressed in parallel.
+     * The overviews average the valid pixels of the scan directly, so
+     * the scan is decoded only once.
+     *
+     * The GeoKeys describe the RADOLAN polar stereographic projection
+     * (sphere of 6370.04 km, true scale at 60N, central meridian 10E)
+     * in kilometres, the same as in the NetCDF and FlatGeobuf output.
+     *
+     * As the COG layout asks, all IFDs come first, full resolution
+     * before the overviews, followed by the tiles from the smallest
+     * overview to the full resolution image. A client reads the IFDs
+     * with the first request and any tile with one more.
+     */
+    class Radolan2GeoTIFF {
+    public:
+
+        /**
+         * Writes the scan as Cloud Optimized GeoTIFF.
+         *
+         * @param scan radolan scan
+         * @param filename output filename
+         * @param options see RDGeoTIFFOptions
+         *
+         * @throws RDConversionException
+         */
+        static void convertScan(RDScan *scan,
+                                const char *filename,
+                                const RDGeoTIFFOptions &options = rdGeoTIFFOptions());
+
+        /**
+         * Reads a radolan file and writes it as Cloud Optimized GeoTIFF.
+         *
+         * @param radolanPath full path to the radolan file
+         * @param filename output filename
+         * @param options see RDGeoTIFFOptions
+         *
+         * @throws RDConversionException
+         */
+        static void convertFile(const char *radolanPath,
+                                const char *filename,
+                                const RDGeoTIFFOptions &options = rdGeoTIFFOptions());
+    };
+}
+
+#endif /* Header Guard */
@@ -0,0 +1,118 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_GRID_GEOMETRY_H
+#define RADOLAN_GRID_GEOMETRY_H
+
+#include <mutex>
+#include <vector>
+
+#include <radolan/types.h>
+#include <radolan/coordinate_system.h>
+
+namespace Radolan {
+
+    /**
+     * Cache of the cell corner and centre coordinates of a RADOLAN grid.
+     * There is one shared, immutable instance per grid, so exporters don't
+     * need to recompute the projection for every scan. The cartesian
+     * coordinates are separable (one array per axis). The geographical
+     * coordinates are stored per point and computed on first use.
+     * All methods are thread safe.
+     */
+    class RDGridGeometry
+    {
+    public:
+
+        /**
+         * Returns the geometry of the scan's grid, given by its size and
+         * the coordinate system of its product. It is created on first use
+         * and never released.
+         *
+         * @param scan scan
+         * @return shared instance
+         */
+        static const RDGridGeometry *forScan(const RDScan *scan);
+
+        /** @return number of longitudinal vertices */
+        int dimLon() const { return m_dimLon; }
+
+        /** @return number of latitudinal vertices */
+        int dimLat() const { return m_dimLat; }
+
+        /** @return the coordinate system of the grid */
+        const RDCoordinateSystem &coordinateSystem() const { return m_coordinateSystem; }
+
+        /** @return cartesian x coordinates of the cell corners (dimLon + 1 values) */
+        const double *cornerX() const { return &m_cornerX[0]; }
+
+        /** @return cartesian y coordinates of the cell corners (dimLat + 1 values) */
+        const double *cornerY() const { return &m_cornerY[0]; }
+
+        /** @return cartesian x coordinates of the cell centres (dimLon values) */
+        const double *centreX() const { return &m_centreX[0]; }
+
+        /** @return cartesian y coordinates of the cell centres (dimLat values) */
+        const double *centreY() const { return &m_centreY[0]; }
+
+        /**
+         * @return longitudes of the cell corners ((dimLon + 1) * (dimLat + 1)
+         *         values, row major). Corner (ix,iy) is the lower left corner of cell (ix,iy).
+         */
+        const double *cornerLongitudes() const;
+
+        /** @return latitudes of the cell corners. @see cornerLongitudes */
+        const double *cornerLatitudes() const;
+
+        /** @return longitudes of the cell centres (dimLon * dimLat values, row major) */
+        const double *centreLongitudes() const;
+
+        /** @return latitudes of the cell centres. @see centreLongitudes */
+        const double *centreLatitudes() const;
+
+    private:
+
+        RDGridGeometry(RDScanType type, int dimLon, int dimLat);
+
+        // fills the geographical arrays once
+        void computeGeographical() const;
+
+        int m_dimLon;
+        int m_dimLat;
+        RDCoordinateSystem m_coordinateSystem;
+
+        std::vector<double> m_cornerX;
+        std::vector<double> m_cornerY;
+        std::vector<double> m_centreX;
+        std::vector<double> m_centreY;
+
+        mutable std::mutex m_mutex;
+        mutable bool m_hasGeographical;
+        mutable std::vector<double> m_cornerLon;
+        mutable std::vector<double> m_cornerLat;
+        mutable std::vector<double> m_centreLon;
+        mutable std::vector<double> m_centreLat;
+    };
+}
+
+#endif /* Header Guard */
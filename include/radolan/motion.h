@@ -0,0 +1,137 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_MOTION_H
+#define RADOLAN_MOTION_H
+
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** Options for RDEstimateMotion */
+    typedef struct {
+
+        /// Edge length of the blocks in cells. Must be a power of two.
+        int blockSize;
+
+        /// Distance between the block origins in cells (overlap if smaller than blockSize)
+        int blockStep;
+
+        /// Values at or below count as no rain, in the unit of the scan
+        float threshold;
+
+        /// Minimum fraction of rain cells in both blocks for a vector to be estimated
+        float minimumRainFraction;
+
+        /// Number of threads. 0 uses all available cores.
+        unsigned int threads;
+
+    } RDMotionOptions;
+
+    /** @return options with 64x64 blocks overlapping by half, 5% rain
+     *  cells required, threshold 0 and all cores */
+    inline RDMotionOptions rdMotionOptions() {
+        RDMotionOptions o;
+        o.blockSize = 64;
+        o.blockStep = 32;
+        o.threshold = 0.0f;
+        o.minimumRainFraction = 0.05f;
+        o.threads = 0;
+        return o;
+    }
+
+    /** Motion of one block */
+    typedef struct {
+
+        /// Velocity along the grid's x axis (ix) in km/h
+        float u;
+
+        /// Velocity along the grid's y axis (iy) in km/h
+        float v;
+
+        /// Height of the correlation peak (0..1). 0 for vectors filled in from neighbours.
+        float quality;
+
+        /// true if estimated from the block, false if filled in from neighbours
+        bool estimated;
+
+    } RDMotionVector;
+
+    /**
+     * Motion vectors on a regular grid of blocks. Vector (column,row)
+     * belongs to the block centred on cell
+     * (originX + column * step, originY + row * step).
+     */
+    typedef struct {
+        int columns;
+        int rows;
+        double originX;
+        double originY;
+        double step;
+
+        /// size of a grid cell in km
+        double cellSizeX;
+        double cellSizeY;
+
+        /// row major, columns * rows vectors
+        std::vector<RDMotionVector> vectors;
+    } RDMotionField;
+
+    /**
+     * Estimates the motion between two scans of the same grid by phase
+     * correlation of overlapping blocks. Each block pair is windowed,
+     * transformed with a radix-2 FFT and the sub-cell position of the peak
+     * of the normalized cross-power spectrum gives the displacement.
+     * Correlating again with the current block moved by that displacement,
+     * until its whole cells no longer change, removes the bias of the
+     * window towards small shifts.
+     * Blocks with too little rain get the mean of their estimated
+     * neighbours. Blocks are distributed over the threads.
+     *
+     * @param previous earlier scan
+     * @param current later scan of the same product and grid
+     * @param options @see RDMotionOptions
+     * @return motion field
+     * @throws RDConversionException if the scans don't match, are not in
+     *         order or the options are invalid
+     */
+    RDMotionField RDEstimateMotion(const RDScan *previous,
+                                   const RDScan *current,
+                                   const RDMotionOptions &options);
+
+    /**
+     * Velocity at a position on the scan grid, bilinearly interpolated
+     * between the block centres.
+     *
+     * @param field motion field
+     * @param x position along the grid's x axis in cells (ix)
+     * @param y position along the grid's y axis in cells (iy)
+     * @return velocity in km/h
+     */
+    RDMotionVector RDMotionAt(const RDMotionField &field, double x, double y);
+}
+
+#endif /* Header Guard */
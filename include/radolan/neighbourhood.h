@@ -0,0 +1,172 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_NEIGHBOURHOOD_H
+#define RADOLAN_NEIGHBOURHOOD_H
+
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /**
+     * Summed-area table (integral image) of a grid. Entry (x,y) holds the
+     * sum of all cells with ix < x and iy < y, so the sum over any box
+     * costs four lookups, independent of its size.
+     */
+    class RDSummedAreaTable {
+    public:
+
+        RDSummedAreaTable();
+
+        /**
+         * Builds the table from the clean values of the scan
+         * (@see RDIsCleanMeasurement). Other cells count as 0.
+         */
+        void build(const RDScan *scan);
+
+        /**
+         * Builds the table from a threshold mask: 1 for clean values at or
+         * above the threshold, 0 for all other cells.
+         */
+        void buildMask(const RDScan *scan, RDDataType threshold);
+
+        /** Builds the table from a mask of the clean values */
+        void buildValidMask(const RDScan *scan);
+
+        /** Builds the table from dimLon * dimLat values, row major */
+        void build(const float *values, int dimLon, int dimLat);
+
+        int dimLon() const { return m_dimLon; }
+
+        int dimLat() const { return m_dimLat; }
+
+        /**
+         * Sum over the cells x0 <= ix <= x1, y0 <= iy <= y1. The box is
+         * clipped to the grid.
+         */
+        double boxSum(int x0, int y0, int x1, int y1) const;
+
+        /**
+         * Sums over the window of window x window cells centred on each
+         * cell, clipped to the grid.
+         *
+         * @param window odd edge length of the window in cells
+         * @param out dimLon * dimLat sums, row major
+         */
+        void windowSums(int window, double *out) const;
+
+        /**
+         * Window sums of a single row. @see windowSums
+         *
+         * @param iy the row
+         * @param window odd edge length of the window in cells
+         * @param out dimLon sums
+         */
+        void windowSumsOfRow(int iy, int window, double *out) const;
+
+    private:
+
+        int m_dimLon;
+        int m_dimLat;
+
+        // (dimLon + 1) * (dimLat + 1) entries, row major
+        std::vector<double> m_table;
+    };
+
+    /** Fractions skill score for one threshold and window */
+    typedef struct {
+
+        RDDataType threshold;
+
+        /// Edge length of the window in cells
+        int window;
+
+        /// Fractions skill score (0..1, 1 is perfect)
+        double fss;
+
+        /// Score of a uniform forecast of the observed base rate, 0.5 + base rate / 2.
+        /// Forecasts above it are considered useful.
+        double fssUniform;
+
+        /// Fraction of the valid cells in which the observation exceeds the threshold
+        double observedFraction;
+
+        /// Fraction of the valid cells in which the forecast exceeds the threshold
+        double forecastFraction;
+
+    } RDFractionsSkillScore;
+
+    /**
+     * Fractions skill score of a forecast against an observation on the
+     * same grid, for all combinations of thresholds and windows. Only
+     * cells with clean values in both scans count. The fractions are the
+     * share of exceeding cells among the valid cells of each window, so
+     * every window costs O(N) via summed-area tables. The thresholds and
+     * windows are distributed over the threads; the results don't depend
+     * on the number of threads.
+     *
+     * @param forecast forecast scan, for example RV
+     * @param observed observed scan, for example RY, in the same unit
+     * @param thresholds exceedance thresholds in the unit of the scans
+     * @param windows odd window edge lengths in cells
+     * @param threads number of threads. 0 uses all available cores.
+     * @return scores, threshold by threshold, with the windows in the given order
+     * @throws RDConversionException if the grids differ or a window is not odd and positive
+     */
+    std::vector<RDFractionsSkillScore> RDComputeFSS(const RDScan *forecast,
+                                                    const RDScan *observed,
+                                                    const std::vector<RDDataType> &thresholds,
+                                                    const std::vector<int> &windows,
+                                                    unsigned int threads = 0);
+
+    /**
+     * Neighbourhood exceedance probabilities: the share of clean cells in
+     * the window around each cell at or above the threshold, for all
+     * combinations of thresholds and windows. Cells without clean
+     * neighbours hold RDMissingValue.
+     *
+     * @param scan the scan
+     * @param thresholds exceedance thresholds in the unit of the scan
+     * @param windows odd window edge lengths in cells
+     * @param threads number of threads. 0 uses all available cores.
+     * @return newly allocated scans (0..1) with the header of the scan,
+     *         threshold by threshold, with the windows in the given order.
+     *         Release with RDFreeScan.
+     * @throws RDConversionException if a window is not odd and positive
+     */
+    std::vector<RDScan *> RDNeighbourhoodProbabilities(const RDScan *scan,
+                                                       const std::vector<RDDataType> &thresholds,
+                                                       const std::vector<int> &windows,
+                                                       unsigned int threads = 0);
+
+    /**
+     * Neighbourhood exceedance probability for a single threshold and window.
+     * @see RDNeighbourhoodProbabilities
+     */
+    RDScan *RDNeighbourhoodProbability(const RDScan *scan, RDDataType threshold, int window);
+}
+
+#endif /* Header Guard */
@@ -25,6 +25,7 @@
 #define RADOLAN_NETCDF_CONVERTER_H
 
 #include <string>
+#include <vector>
 #include <netcdf>
 #include <radolan/radolan.h>
 
@@ -49,6 +50,7 @@ namespace Radolan {
          * @param threshold minimum treshold for values to make it in the NetCDF file
          * @param mode NcFile::Mode for opening the netcdf file with
          * @param omitOutside @see RDReadScan
+         * @param quantize @see convertScan
          *
          * @return NCFile* NetCDF-Filehandler
          *
@@ -60,7 +62,8 @@ namespace Radolan {
                                     bool write_one_bytes_as_byte = false,
                                     const RDDataType *threshold = NULL,
                                     netCDF::NcFile::FileMode mode = netCDF::NcFile::replace,
-                                    bool omitOutside = true);
+                                    bool omitOutside = true,
+                                    bool quantize = false);
 
         /**
          * Converts a radolan scan.
@@ -71,6 +74,11 @@ namespace Radolan {
          *        such as RX are written out as BYTE instead of FLOAT.
          * @param threshold minimum treshold for values to make it in the NetCDF file
          * @param mode NcFile::Mode for opening the netcdf file with
+         * @param quantize if <code>true</code>, FLOAT data is bit rounded to the
+         *        product's precision (header.precision, see RDBitRound) before
+         *        it is compressed. The kept precision is recorded in the
+         *        CF attributes <code>least_significant_digit</code> and
+         *        <code>quantization</code>.
          *
          * @return NCFile* NetCDF-Filehandler
          *
@@ -81,7 +89,117 @@ namespace Radolan {
                                     const char *netcdfPath,
                                     bool write_one_bytes_as_byte,
                                     const RDDataType *threshold = NULL,
-                                    netCDF::NcFile::FileMode mode = netCDF::NcFile::write);
+                                    netCDF::NcFile::FileMode mode = netCDF::NcFile::write,
+                                    bool quantize = false);
+
+        /**
+         * Converts a number of radolan scans taken at the same time into
+         * a single NetCDF file. Each product becomes a data variable of its
+         * own. Products on the same grid share the dimensions, the coordinate
+         * variables and the grid mapping. If the scans come from different
+         * grids, each grid is written into a group of its own, named after
+         * the grid size (for example <code>grid_900x900</code>).
+         *
+         * @param scans scans to convert. All scans must have the same timestamp.
+         * @param netcdfPath full path to the netcdf file to be created
+         * @param write_one_bytes_as_byte if <code>true</code> one byte products
+         *        such as RX are written out as BYTE instead of FLOAT.
+         * @param threshold minimum treshold for values to make it in the NetCDF file
+         * @param mode NcFile::Mode for opening the netcdf file with
+         * @param quantize @see convertScan
+         *
+         * @return NCFile* NetCDF-Filehandler
+         *
+         * @throw RDConversionException if the timestamps differ or a product
+         *        appears more than once on the same grid
+         */
+        static
+        netCDF::NcFile *convertScans(const std::vector<RDScan *> &scans,
+                                     const char *netcdfPath,
+                                     bool write_one_bytes_as_byte,
+                                     const RDDataType *threshold = NULL,
+                                     netCDF::NcFile::FileMode mode = netCDF::NcFile::replace,
+                                     bool quantize = false);
+
+        /**
+         * Groups radolan files by their timestamp and converts each group
+         * into one NetCDF file using convertScans. Only the headers are read
+         * for grouping, so at most one group of scans is held in memory.
+         * The files are named <code>radolan-YYMMDDhhmm.nc</code>.
+         *
+         * @param radolanPaths full paths to the radolan files
+         * @param outputDirectory directory to write the NetCDF files to
+         * @param write_one_bytes_as_byte if <code>true</code> one byte products
+         *        such as RX are written out as BYTE instead of FLOAT
+         * @param threshold minimum treshold for values to make it in the NetCDF file
+         * @param omitOutside @see RDReadScan
+         * @param quantize @see convertScan
+         *
+         * @return paths of the NetCDF files written
+         *
+         * @throw RDConversionException
+         */
+        static
+        std::vector<std::string> convertFilesByTimestamp(const std::vector<std::string> &radolanPaths,
+                                                         const char *outputDirectory,
+                                                         bool write_one_bytes_as_byte = false,
+                                                         const RDDataType *threshold = NULL,
+                                                         bool omitOutside = true,
+                                                         bool quantize = false);
+
+        /**
+         * Converts each radolan file into a NetCDF file of its own, as
+         * convertFile does, named after the radolan file with
+         * <code>.nc</code> appended.
+         *
+         * The files are read and prepared by the given number of worker
+         * threads, largest files first. All netCDF calls are made by the
+         * calling thread, as HDF5 is not thread-safe. Workers wait while
+         * as many converted scans as there are workers are queued for
+         * writing, so memory use does not grow with the number of files.
+         *
+         * @param radolanPaths full paths to the radolan files
+         * @param outputDirectory directory to write the NetCDF files to
+         * @param write_one_bytes_as_byte if <code>true</code> one byte products
+         *        such as RX are written out as BYTE instead of FLOAT
+         * @param threshold minimum treshold for values to make it in the NetCDF file
+         * @param omitOutside @see RDReadScan
+         * @param quantize @see convertScan
+         * @param threads number of worker threads, 0 for one per core. With 1,
+         *        the files are converted one after the other by the calling thread.
+         *
+         * @return paths of the NetCDF files written, in the order of radolanPaths.
+         *         Files that could not be converted are reported on stderr
+         *         and left out.
+         */
+        static
+        std::vector<std::string> convertFiles(const std::vector<std::string> &radolanPaths,
+                                              const char *outputDirectory,
+                                              bool write_one_bytes_as_byte = false,
+                                              const RDDataType *threshold = NULL,
+                                              bool omitOutside = true,
+                                              bool quantize = false,
+                                              unsigned int threads = 1);
+
+        /**
+         * Writes a per-cell climatology as CF-Metadata compliant NetCDF file.
+         * The variables are mean, maximum, wet_fraction, valid_count and
+         * exceedance_count (one layer per threshold). The time coordinate
+         * is the last scan, with climatology_bounds from the first to the
+         * last scan.
+         *
+         * @param climatology climatology to write
+         * @param netcdfPath full path to the netcdf file to be created
+         * @param mode NcFile::Mode for opening the netcdf file with
+         *
+         * @return NCFile* NetCDF-Filehandler
+         *
+         * @throw RDConversionException
+         */
+        static
+        netCDF::NcFile *convertClimatology(const RDClimatology &climatology,
+                                           const char *netcdfPath,
+                                           netCDF::NcFile::FileMode mode = netCDF::NcFile::replace);
 
         /**
          * Simple function to get a visual rep of the file with ascii characters
@@ -0,0 +1,94 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_PRECIPITATION_H
+#define RADOLAN_PRECIPITATION_H
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** Coefficients of a Z-R relationship Z = a * R^b,
+     * with Z in mm^6/m^3 and R in mm/h */
+    typedef struct {
+        float a;
+        float b;
+    } RDZRRelation;
+
+    /** Helper for creating a Z-R relationship. The defaults are the
+     * ones used by the DWD (Z = 256 R^1.42). */
+    RDZRRelation rdZRRelation(float a = 256.0f, float b = 1.42f);
+
+    /** Unit to convert precipitation products to */
+    typedef enum {
+        /// rain rate in mm/h
+        RD_MM_PER_HOUR,
+        /// precipitation height in mm over the product's interval
+        RD_MM
+    } RDPrecipitationUnit;
+
+    /**
+     * Fills a lookup table with the rain rates in mm/h for all byte values
+     * of reflectivity products (dBZ = -32.5 + byte / 2). The bytes marking
+     * clutter and missing values map to RD_CLUTTER_VALUE and RD_ERROR_VALUE.
+     *
+     * @param zr Z-R relationship
+     * @param lut table of 256 entries
+     */
+    void RDRainrateLookupTable(RDZRRelation zr, RDDataType *lut);
+
+    /**
+     * Converts reflectivities in dBZ into rain rates in mm/h. Values are
+     * rounded to the half dBZ steps of the byte products and looked up in
+     * a table. Clutter (92.0) and missing values (92.5) become RD_CLUTTER_VALUE
+     * and RD_ERROR_VALUE.
+     *
+     * @param dbz reflectivities
+     * @param count number of values
+     * @param zr Z-R relationship
+     * @param out converted values. May be the same as dbz.
+     */
+    void RDRainrateFromReflectivity(const RDDataType *dbz, size_t count, RDZRRelation zr, RDDataType *out);
+
+    /**
+     * Converts the data of a scan into mm/h or mm. Precipitation products
+     * are normalized with the interval duration from the header,
+     * reflectivity products (RX, EX) are converted with the given
+     * Z-R relationship. Missing and clutter markers are kept as they are,
+     * negative values of signed products are scaled like all others.
+     *
+     * @param scan scan to convert. The header is not changed.
+     * @param unit unit to convert to
+     * @param out converted values (dimLon * dimLat). May be scan->data.
+     * @param zr Z-R relationship for reflectivity products
+     *
+     * @throws RDConversionException if the scan has no interval duration
+     */
+    void RDConvertPrecipitation(const RDScan *scan,
+                                RDPrecipitationUnit unit,
+                                RDDataType *out,
+                                RDZRRelation zr = rdZRRelation());
+}
+
+#endif /* Header Guard */
@@ -0,0 +1,155 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_QUANTILE_SKETCH_H
+#define RADOLAN_QUANTILE_SKETCH_H
+
+#include <functional>
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** Centroid of a t-digest: mean of a number of values */
+    typedef struct {
+        float mean;
+        uint32_t weight;
+    } RDCentroid;
+
+    /**
+     * Per-cell quantiles over any number of scans in bounded memory.
+     *
+     * Each cell keeps a small t-digest of its valid values
+     * (@see RDIsCleanMeasurement) with at most compression + 1 centroids,
+     * which resolves the tails of the distribution best. Values at the
+     * product's minimum (no rain) are only counted, so the digests
+     * describe the wet part of the distribution.
+     *
+     * Scans are collected in a buffer of 16 bit steps of the product's
+     * precision and merged into the digests in batches. Batches are split
+     * over the cells, so several threads can merge at the same time.
+     * Memory use is about 8 * (compression + 1) bytes per cell for the
+     * digests, plus 2 bytes per cell and buffered scan.
+     *
+     * Sketches of partial runs can be merged. For the same scans in the
+     * same order, settings and merge order, the results are the same
+     * regardless of the number of threads.
+     */
+    class RDQuantileSketch {
+    public:
+
+        /**
+         * @param compression t-digest compression. Higher values are more
+         *        accurate and take more memory.
+         * @param batchScans number of scans buffered before merging
+         * @param threads number of threads for merging. 0 uses all available cores.
+         */
+        RDQuantileSketch(double compression = 50.0, size_t batchScans = 64, unsigned int threads = 1);
+
+        /**
+         * Adds a scan.
+         *
+         * @param scan scan to add. It is not kept.
+         * @throws RDConversionException if the scan does not fit the ones
+         *         ingested before
+         */
+        void ingest(RDScan *scan);
+
+        /**
+         * Reads a radolan file and ingests it.
+         *
+         * @param filename path to the file
+         * @throws RDConversionException
+         */
+        void ingestFile(const char *filename);
+
+        /** Merges the buffered scans into the digests. */
+        void flush();
+
+        /**
+         * Merges the sketches of another run over the same product and grid
+         * into this one. Both are flushed first.
+         *
+         * @throws RDConversionException if the sketches don't match
+         */
+        void merge(RDQuantileSketch &other);
+
+        /** @return number of scans ingested (including merged ones) */
+        uint64_t scanCount() const { return m_scans; }
+
+        /**
+         * Map of a quantile of the valid values of each cell, interpolated
+         * between the centroids of the digests. Flushes first.
+         *
+         * @param level quantile level in [0,1], e.g. 0.99
+         * @return newly allocated scan with the timestamp of the last scan.
+         *         Cells without valid values hold RDMissingValue.
+         *         Release with RDFreeScan.
+         * @throws RDConversionException if no scan was ingested or the
+         *         level is out of range
+         */
+        RDScan *quantile(double level);
+
+    private:
+
+        RDQuantileSketch(const RDQuantileSketch &);
+        RDQuantileSketch &operator=(const RDQuantileSketch &);
+
+        // runs work over ranges of cells on the configured threads
+        void forEachRange(const std::function<void(size_t, size_t)> &work) const;
+
+        void mergeBatch(size_t begin, size_t end);
+
+        double m_compression;
+        size_t m_capacity;       // centroids per cell
+        size_t m_batchScans;
+        unsigned int m_threads;
+
+        bool m_initialized;
+        RDRadolanHeader m_header;
+        int m_dimLon;
+        int m_dimLat;
+        size_t m_cells;
+        uint64_t m_scans;
+        time_t m_lastTime;
+        float m_lower;           // value of step 0
+        float m_resolution;      // value of one step
+
+        // scans not yet merged, in steps, scan major
+        size_t m_buffered;
+        std::vector<uint16_t> m_buffer;
+
+        // per cell: values at the minimum, digest size, range and centroids
+        std::vector<uint32_t> m_minimumCount;
+        std::vector<uint16_t> m_size;
+        std::vector<float> m_min;
+        std::vector<float> m_max;
+        std::vector<RDCentroid> m_centroids;
+    };
+}
+
+#endif /* Header Guard */
@@ -24,14 +24,38 @@
 #ifndef RADOLAN
 #define RADOLAN
 
+#include <radolan/accumulation.h>
+#include <radolan/advection.h>
+#include <radolan/archive.h>
+#include <radolan/cells.h>
+#include <radolan/climatology.h>
 #include <radolan/conversion_exeption.h>
 #include <radolan/coordinate_system.h>
 #include <radolan/endianess.h>
+#include <radolan/filters.h>
+#include <radolan/flatgeobuf_converter.h>
+#include <radolan/gauge_adjustment.h>
+#include <radolan/geotiff_converter.h>
+#include <radolan/grid_geometry.h>
+#include <radolan/motion.h>
+#include <radolan/neighbourhood.h>
 #include <radolan/netcdf_converter.h>
+#include <radolan/precipitation.h>
+#include <radolan/quantile_sketch.h>
 #include <radolan/radolan_utils.h>
 #include <radolan/read.h>
+#include <radolan/regions.h>
+#include <radolan/scan_cube.h>
+#include <radolan/scan_utils.h>
 #include <radolan/shapefile_converter.h>
+#include <radolan/sliding_window.h>
+#include <radolan/statistics.h>
+#include <radolan/synthetic.h>
+#include <radolan/text_converter.h>
+#include <radolan/transpose_store.h>
 #include <radolan/types.h>
 #include <radolan/version.h>
+#include <radolan/write.h>
+#include <radolan/zarr_converter.h>
 
 #endif /* Header Guard */
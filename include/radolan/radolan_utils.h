@@ -71,6 +71,15 @@ namespace Radolan {
     /** Returns the maximum value for the given scan type */
     RDDataType RDMaxValue(RDScanType t);
 
+    /** Checks if values of the given scan type can be negative (negative
+     * sign bit set in the data words). This is the case for RD only. */
+    bool RDIsSigned(RDScanType t);
+
+    /** Returns the smallest valid value for the given scan type at the given
+     * precision: RDMinValue, or 4095 steps (the largest 12 bit magnitude)
+     * below zero for signed scan types. */
+    RDDataType RDLowestValue(RDScanType t, float precision);
+
     /** Returns the value marking a missing value for the given scan type */
     RDDataType RDMissingValue(RDScanType t);
 
@@ -83,6 +92,12 @@ namespace Radolan {
      */
     const char *RDUnits(RDScanType type);
 
+    /** Returns the CF-Metadata 'standard_name' for the given scan type
+     * @param scan type
+     * @return standard_name (reflectivity, rainrate)
+     */
+    const char *RDStandardName(RDScanType type);
+
     /** Converts RVP6 units (reflectivity) to byte values. */
     RDByteType RDRVP6ToByteValue(float rvp6);
 
@@ -98,7 +113,11 @@ namespace Radolan {
     /** Returns the number of bytes per pixel in the original data set */
     size_t RDBytesPerPixel(RDScanType type);
 
-    /** Standard Z/R relationship as used by the DWD */
+    /** Standard Z/R relationship as used by the DWD (Z = 256 R^1.42).
+     * For whole grids and other coefficients see RDRainrateFromReflectivity.
+     * @param dezibels reflectivity in dBZ
+     * @return rain rate in mm/h
+     */
     float RDRainrateFromDezibels(RDDataType dezibels);
 
     /** Returns the grid dimensions for the scan type
@@ -122,16 +141,39 @@ namespace Radolan {
      */
     time_t RDScanTimeInSecondsSinceEpoch(RDScan *scan);
 
-    /** Some scan types deliver values in 1/100 mm / 5 mins and so on.
-     * This method allows calculation in values of mm/hour, as is usual.
-     * Formats, which give values in 1/100 mm / 5 mins will be calculated
-     * in mm/h, summative formats will be corrected in quantity but not time.
-     * This method does not apply to reflectivity based scans, RX, DX etc.
+    /** Sets the timestamp of the header (year, month, day, hour and
+     * minute) to the given time. The reverse of RDScanTimeInSecondsSinceEpoch.
+     * @param header header to change
+     * @param time seconds since epoch (UTC)
+     */
+    void RDSetScanTime(RDRadolanHeader *header, time_t time);
+
+    /** Writes the scan time as ISO 8601 string in UTC
+     * (for example 2014-06-01T12:50:00Z) into the given buffer.
+     * @param scan
+     * @param buffer output buffer, at least 21 characters
+     * @param size size of the buffer
+     */
+    void RDScanTimeString(RDScan *scan, char *buffer, size_t size);
+
+    /** Returns the nominal interval of a precipitation product in minutes
+     * (5 for RY, 60 for RW, 1440 for SF and so on).
+     * @param scan type
+     * @return interval in minutes, 0 for reflectivity and unknown products
+     */
+    unsigned short RDIntervalDuration(RDScanType t);
+
+    /** Converts a value of a precipitation product (mm over the product's
+     * interval, as read) into mm/h, using the nominal interval of the
+     * product (see RDIntervalDuration). This is the same factor
+     * RDConvertPrecipitation applies to whole scans. Missing and clutter
+     * values, as well as values of products without a known interval,
+     * are returned as they are.
+     * This method does not apply to reflectivity based scans, RX, EX
      * and will return -INFINITY for those.
      * @param scan type
      * @param value
      * @return the converted value or -inf if not applicable
-     * set according to the scan's header
      */
     float RDMMPerHour(RDScanType t, RDDataType value);
 
@@ -144,6 +186,22 @@ namespace Radolan {
      */
     char *RDGuessFilename(RDScanType type, time_t timestamp);
 
+    /** Lossy compression aid (bit rounding). Rounds each value to the
+     * fewest mantissa bits that still resolve the given absolute precision,
+     * and zeroes the remaining bits, so the data compresses much better.
+     * The rounding error is at most a quarter of the precision, so values
+     * on the product's precision grid (header.precision) can be restored
+     * exactly. Values equal to skipValue, NaN and infinity are not touched.
+     *
+     * @param data values to quantize in place
+     * @param count number of values
+     * @param precision absolute precision to keep, e.g. 0.01 for PR E-02
+     * @param skipValue value to leave alone (typically the missing value)
+     * @return number of mantissa bits kept for the largest value, or -1
+     *         if precision is not positive
+     */
+    int RDBitRound(RDDataType *data, size_t count, float precision, RDDataType skipValue);
+
 
 #ifdef __cplusplus
 }
@@ -63,12 +63,30 @@ extern "C"
 
 int RDReadScan(const char *filename, RDScan *scan, bool ommitOutside);
 
+/** The grid of the given product, as RDReadScan reads it.
+ * @param type scan type
+ * @param dimLon pointer to the number of longitudinal vertices
+ * @param dimLat pointer to the number of latitudinal vertices
+ */
+void RDScanDimensions(RDScanType type, int *dimLon, int *dimLat);
+
 /** Reads only the header data from the given FILE*
  * @param FILE*
  * @param RDHeader*
  */
 void RDReadRadolanHeader(gzFile *f, RDRadolanHeader *header);
 
+/** Reads only the header of the given radolan file, without decoding
+ * the payload. Useful for sorting or grouping large numbers of files.
+ * The list of radar stations is allocated and must be released by the
+ * caller with free(header->radarStations).
+ *
+ * @param filename path to file
+ * @param header header to fill
+ * @return 1 if the header was read, 0 otherwise
+ */
+int RDReadScanHeader(const char *filename, RDRadolanHeader *header);
+
 /** Allocates a new instance of RDScan and sets its up correctly. Please
  * use this method for allocating fresh scans in order to avoid problems
  * when deallocating.
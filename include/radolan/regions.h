@@ -0,0 +1,105 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_REGIONS_H
+#define RADOLAN_REGIONS_H
+
+#include <vector>
+
+#include <radolan/types.h>
+#include <radolan/coordinate_system.h>
+
+namespace Radolan {
+
+    /**
+     * Connected regions of a classified grid, as produced by RDLabelRegions.
+     */
+    typedef struct
+    {
+        /// Number of longitudinal vertices
+        int dimLon;
+
+        /// Number of latitudinal vertices
+        int dimLat;
+
+        /// Region label per grid cell (row major). -1 for unclassified cells.
+        std::vector<int> labels;
+
+        /// Class index per region
+        std::vector<int> regionClass;
+
+        /// Number of cells per region
+        std::vector<int> regionSize;
+    } RDRegions;
+
+    /**
+     * A closed ring on the lattice of grid cell corners. Corner (ix,iy) is
+     * the lower left corner of cell (ix,iy). The first vertex is repeated
+     * at the end. Only corners where the direction changes are contained.
+     */
+    typedef std::vector<RDGridPoint> RDRing;
+
+    /**
+     * Assigns a class to every grid cell of the scan. The class of a value
+     * is the index of the largest break not exceeding it. Values below the
+     * first break or which are no clean measurements (@see RDIsCleanMeasurement)
+     * get class -1.
+     *
+     * @param scan the scan
+     * @param classBreaks lower bounds of the classes in ascending order
+     * @param classes output, dimLon * dimLat class indexes
+     */
+    void RDClassifyScan(RDScan *scan, const std::vector<RDDataType> &classBreaks, int *classes);
+
+    /**
+     * Labels the 4-connected regions of cells with equal class, using
+     * a two pass scanline algorithm with union-find.
+     *
+     * @param classes class per cell (row major). Negative classes are not labelled.
+     * @param dimLon number of longitudinal vertices
+     * @param dimLat number of latitudinal vertices
+     * @param regions result. Labels are numbered in scan order.
+     * @return number of regions
+     */
+    int RDLabelRegions(const int *classes, int dimLon, int dimLat, RDRegions &regions);
+
+    /**
+     * Traces the boundaries of all regions. The work is proportional to
+     * the length of the boundaries, not to the number of cells. Outer rings
+     * are clockwise, holes counter-clockwise (as required by the Shapefile
+     * format). Where two cells of a region only touch at a corner, the
+     * rings are split at that corner, since they are not 4-connected.
+     *
+     * @param regions labelled regions
+     * @param rings output. rings[label] contains the rings of the region.
+     */
+    void RDTraceRegionBoundaries(const RDRegions &regions, std::vector<std::vector<RDRing> > &rings);
+
+    /**
+     * @param ring closed ring
+     * @return <code>true</code> if the ring is a hole (counter-clockwise)
+     */
+    bool RDIsHole(const RDRing &ring);
+}
+
+#endif /* Header Guard */
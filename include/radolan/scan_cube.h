@@ -0,0 +1,259 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_SCAN_CUBE_H
+#define RADOLAN_SCAN_CUBE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** Compact value of missing cells in a RDCompactCube */
+    static const uint16_t RD_CUBE_MISSING = 0xFFFF;
+
+    /** Compact value of clutter cells in a RDCompactCube */
+    static const uint16_t RD_CUBE_CLUTTER = 0xFFFE;
+
+    /** Largest compact value of a measurement. Larger values are clipped. */
+    static const uint16_t RD_CUBE_MAXIMUM = 0xFFFD;
+
+    /**
+     * @return step of the compact values of a product: the header's
+     *         precision, or 0.5 dBZ for reflectivities
+     * @throws RDConversionException if the product has no precision
+     */
+    float RDCompactPrecision(const RDRadolanHeader &header);
+
+    /**
+     * Encodes values as 16 bit steps of the precision above the smallest
+     * value of the product (see RDLowestValue, so negative values of signed
+     * products are kept), with RD_CUBE_MISSING and RD_CUBE_CLUTTER for
+     * invalid cells.
+     *
+     * @param type product
+     * @param precision see RDCompactPrecision
+     * @param values values to encode
+     * @param count number of values
+     * @param target encoded values
+     */
+    void RDEncodeCompact(RDScanType type, float precision, const RDDataType *values, size_t count,
+                         uint16_t *target);
+
+    /**
+     * Decodes values written by RDEncodeCompact. Invalid cells become
+     * RDMissingValue or RDClutterValue.
+     */
+    void RDDecodeCompact(RDScanType type, float precision, const uint16_t *values, size_t count,
+                         RDDataType *target);
+
+    /**
+     * View of a block of a scan cube, without a copy of its own. Element
+     * (t, y, x) lies at data[t * timeStride + y * rowStride + x]. Views are
+     * invalidated when scans are appended to the cube.
+     */
+    template<typename T>
+    struct RDCubeView {
+        const T *data;
+        size_t times;
+        int rows;
+        int columns;
+        size_t timeStride;
+        size_t rowStride;
+
+        const T &at(size_t t, int y, int x) const {
+            return data[t * timeStride + (size_t) y * rowStride + x];
+        }
+    };
+
+    /**
+     * A series of scans of the same product and grid in one contiguous
+     * (time, y, x) block of memory, for analyses that work on many scans
+     * at once.
+     *
+     * Each scan takes a slice whose size is rounded up to 64 bytes, so
+     * every slice starts on a cache line. The block grows by doubling.
+     * Scans are appended in chronological order, which keeps the
+     * timestamps sorted for binary search.
+     *
+     * T is float (RDFloatCube) or uint16_t (RDCompactCube). The compact
+     * cube stores the values as RDEncodeCompact does and needs half the
+     * memory of the scans.
+     */
+    template<typename T>
+    class RDScanCube {
+    public:
+
+        RDScanCube();
+
+        ~RDScanCube();
+
+        /**
+         * Appends a copy of the scan's data.
+         *
+         * @param scan next scan. It is not kept.
+         * @throws RDConversionException if the scan does not fit the ones
+         *         appended before or is not later than the last one
+         */
+        void append(const RDScan *scan);
+
+        /**
+         * Reads a radolan file and appends it.
+         *
+         * @param filename path to the file
+         * @throws RDConversionException
+         */
+        void appendFile(const char *filename);
+
+        /**
+         * Makes room for the given number of scans, so appending them
+         * does not move the data.
+         */
+        void reserve(size_t scans);
+
+        /** Removes all scans and releases the memory */
+        void clear();
+
+        /** @return number of scans */
+        size_t size() const { return m_times.size(); }
+
+        int dimLon() const { return m_dimLon; }
+
+        int dimLat() const { return m_dimLat; }
+
+        /** @return header of the first scan, without radar stations */
+        const RDRadolanHeader &header() const { return m_header; }
+
+        /** @return timestamp of scan t in seconds since epoch */
+        time_t time(size_t t) const { return m_times[t]; }
+
+        /** @return timestamps of all scans */
+        const std::vector<time_t> &times() const { return m_times; }
+
+        /** @return index of the scan with the given timestamp or -1 */
+        long find(time_t time) const;
+
+        /**
+         * Scans within a period.
+         *
+         * @param begin first timestamp, inclusive
+         * @param end last timestamp, exclusive
+         * @param first index of the first scan in the period
+         * @param last index after the last scan in the period
+         */
+        void range(time_t begin, time_t end, size_t &first, size_t &last) const;
+
+        /** @return elements between the beginnings of two scans */
+        size_t timeStride() const { return m_stride; }
+
+        /** @return the whole block */
+        const T *data() const { return m_data; }
+
+        /** @return values of scan t, row by row */
+        const T *scan(size_t t) const { return m_data + t * m_stride; }
+
+        /** @return view of scan t */
+        RDCubeView<T> scanView(size_t t) const;
+
+        /**
+         * View of a box of scans and cells.
+         *
+         * @param t0,t1 scans [t0, t1)
+         * @param x0,x1 columns [x0, x1)
+         * @param y0,y1 rows [y0, y1)
+         * @throws RDConversionException if the box is not within the cube
+         */
+        RDCubeView<T> window(size_t t0, size_t t1, int x0, int x1, int y0, int y1) const;
+
+        /**
+         * View of the values of one cell over time. The elements are
+         * timeStride() apart.
+         *
+         * @throws RDConversionException if the cell is not within the grid
+         */
+        RDCubeView<T> series(int x, int y, size_t t0 = 0, size_t t1 = (size_t) -1) const;
+
+        /** @return stored value as RDDataType, invalid cells as RDMissingValue or RDClutterValue */
+        RDDataType value(size_t t, int x, int y) const {
+            return decode(m_data[t * m_stride + (size_t) y * m_dimLon + x]);
+        }
+
+        /** @return value of a stored element */
+        RDDataType decode(T stored) const;
+
+        /** @return precision of the compact values (1 for RDFloatCube) */
+        float precision() const { return m_precision; }
+
+        /** @return offset of the compact values (0 for RDFloatCube) */
+        float offset() const { return m_offset; }
+
+        /**
+         * Copies a scan out of the cube.
+         *
+         * @return newly allocated scan. Release with RDFreeScan.
+         */
+        RDScan *scanAt(size_t t) const;
+
+    private:
+
+        RDScanCube(const RDScanCube &);
+
+        RDScanCube &operator=(const RDScanCube &);
+
+        void grow(size_t capacity);
+
+        void encode(const RDDataType *values, T *target) const;
+
+        RDRadolanHeader m_header;
+        int m_dimLon;
+        int m_dimLat;
+        size_t m_stride;
+        float m_precision;
+        float m_offset;
+        RDDataType m_missing;
+        RDDataType m_clutter;
+
+        T *m_data;
+        size_t m_capacity;
+        std::vector<time_t> m_times;
+    };
+
+    template<>
+    RDDataType RDScanCube<float>::decode(float stored) const;
+
+    template<>
+    RDDataType RDScanCube<uint16_t>::decode(uint16_t stored) const;
+
+    /** Cube of the scan values as they are */
+    typedef RDScanCube<float> RDFloatCube;
+
+    /** Cube of 16 bit values in units of the product's precision */
+    typedef RDScanCube<uint16_t> RDCompactCube;
+}
+
+#endif /* Header Guard */
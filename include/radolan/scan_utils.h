@@ -0,0 +1,81 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_SCAN_UTILS_H
+#define RADOLAN_SCAN_UTILS_H
+
+#include <time.h>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /**
+     * Allocates a scan for a product derived from others (totals,
+     * climatologies, quantiles ...). The header is a copy of the given
+     * one without the list of radar stations, timestamped with the given
+     * time. The data is allocated, but not initialised.
+     *
+     * @param header header to copy
+     * @param dimLon number of longitudinal vertices
+     * @param dimLat number of latitudinal vertices
+     * @param time timestamp of the result (seconds since epoch, UTC)
+     * @return newly allocated scan. Release with RDFreeScan.
+     * @throws RDConversionException if there is not enough memory
+     */
+    RDScan *RDAllocateResultScan(const RDRadolanHeader &header, int dimLon, int dimLat, time_t time);
+
+    /**
+     * Owns a scan read from a RADOLAN file for the duration of a scope,
+     * so that engines ingesting files free it on every path, including
+     * exceptions thrown while ingesting.
+     */
+    class RDScanFile {
+    public:
+        /**
+         * Reads the given file.
+         *
+         * @param filename RADOLAN file
+         * @param omitOutside omit the values outside of the radar range
+         * @throws RDConversionException if the file can not be read
+         */
+        RDScanFile(const char *filename, bool omitOutside);
+
+        ~RDScanFile();
+
+        /** @return the scan read. Owned by this object. */
+        RDScan *get() const {
+            return m_scan;
+        }
+
+    private:
+        RDScanFile(const RDScanFile &);
+
+        RDScanFile &operator=(const RDScanFile &);
+
+        RDScan *m_scan;
+    };
+}
+
+#endif /* Header Guard */
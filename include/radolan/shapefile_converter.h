@@ -28,10 +28,102 @@
 
 #include <radolan/conversion_exeption.h>
 #include <radolan/types.h>
+#include <shapefil.h>
+#include <string>
 #include <vector>
 
 namespace Radolan {
 
+    /**
+     * Writes one feature per radar cell into a shapefile. Features are
+     * collected in batches of bounded size and written out together with
+     * their attribute rows (VALUE, IX, IY and TIME), so memory use does not
+     * grow with the number of cells. Closing the writer builds a quadtree
+     * spatial index (.qix) next to the shapefile.
+     */
+    class RDShapefileWriter {
+    public:
+
+        /**
+         * @param filename shapefile output filename
+         * @param shapeType SHPT_POINT, SHPT_POINTM, SHPT_POLYGON or SHPT_POLYGONM
+         * @param timestamp value of the TIME attribute of all features
+         * @param batchSize number of features collected before they are written
+         *
+         * @throws RDConversionException
+         */
+        RDShapefileWriter(const char *filename,
+                          int shapeType,
+                          const char *timestamp,
+                          size_t batchSize = 4096);
+
+        /** Closes the files without writing the index if close() was not called. */
+        ~RDShapefileWriter();
+
+        /**
+         * Adds a point feature. Only valid for point shape types.
+         *
+         * @param x x (or lon) coordinate
+         * @param y y (or lat) coordinate
+         * @param value cell value
+         * @param ix grid index in x
+         * @param iy grid index in y
+         */
+        void addPoint(double x, double y, double value, int ix, int iy);
+
+        /**
+         * Adds a single ring polygon feature. Only valid for polygon shape types.
+         *
+         * @param px x (or lon) coordinates of the closed ring, clockwise
+         * @param py y (or lat) coordinates of the closed ring, clockwise
+         * @param count number of vertices
+         * @param value cell value
+         * @param ix grid index in x
+         * @param iy grid index in y
+         */
+        void addPolygon(const double *px, const double *py, int count, double value, int ix, int iy);
+
+        /** Writes the features collected so far. */
+        void flush();
+
+        /**
+         * Writes the remaining features and closes the files.
+         *
+         * @param writeIndex if <code>true</code>, a .qix spatial index is created
+         *
+         * @throws RDConversionException
+         */
+        void close(bool writeIndex = true);
+
+    private:
+
+        RDShapefileWriter(const RDShapefileWriter &);
+        RDShapefileWriter &operator=(const RDShapefileWriter &);
+
+        std::string m_filename;
+        int m_shapeType;
+        bool m_hasMeasure;
+        std::string m_timestamp;
+        size_t m_batchSize;
+
+        SHPHandle m_shapefile;
+        DBFHandle m_table;
+        int m_valueField;
+        int m_ixField;
+        int m_iyField;
+        int m_timeField;
+
+        // current batch. The vertices of feature i are
+        // m_x/m_y[m_vertexStart[i] .. m_vertexStart[i+1])
+        std::vector<double> m_x;
+        std::vector<double> m_y;
+        std::vector<int> m_vertexStart;
+        std::vector<double> m_value;
+        std::vector<int> m_ix;
+        std::vector<int> m_iy;
+        std::vector<double> m_measure;
+    };
+
     /**
      * This class contains facilities for converting a RADOLAN
      * file into 2 different Shapefile formats. One is based on
@@ -41,14 +133,16 @@ namespace Radolan {
     public:
 
         /**
-         * Writes out a shapefile with the individual radar pixels as points
+         * Writes out a shapefile with the centres of the individual radar pixels
+         * as points. The attribute table holds the value, the grid indexes and
+         * the scan time of each point.
          *
          * @param scan radolan scan
          * @param filename shapefile output filename
          * @param geographic if <code>true</code> the coordinates are transformed to lat/lon.
          *        If <code>false</code> they are polar-stereographic (cartesian).
-         * @param withValues If <code>true</code>, write out SHPT_MULTIPOINTM (with scan value).
-         *        If <code>false</code> writes out SHPT_MULTIPOINT.
+         * @param withValues If <code>true</code>, write out SHPT_POINTM (with scan value).
+         *        If <code>false</code> writes out SHPT_POINT.
          *
          * @throws RDConversionException
          *
@@ -58,7 +152,9 @@ namespace Radolan {
                                     bool geographic = false,
                                     bool withValues = true);
         /**
-         * Writes out a shapefile with the individual radar pixels as polygons
+         * Writes out a shapefile with the individual radar pixels as polygons.
+         * The attribute table holds the value, the grid indexes and the scan
+         * time of each cell.
          *
          * @param scan
          * @param filename shapefile output filename
@@ -73,6 +169,31 @@ namespace Radolan {
                                       bool geographic = false,
                                       bool withValues = true);
 
+        /**
+         * Writes out a shapefile with one polygon per region of 4-connected
+         * cells that fall into the same value class. Holes are written as
+         * inner rings. Only the region boundaries are transformed, so output
+         * size and run time grow with the boundary length of the rain areas
+         * rather than with the number of cells. The attribute table contains
+         * the class index (CLASS), its bounds (LOWER, UPPER) and the number
+         * of cells (CELLS).
+         *
+         * @param scan radolan scan
+         * @param filename shapefile output filename
+         * @param classBreaks lower bounds of the value classes in ascending order.
+         *        Values below the first break are not written.
+         * @param geographic If <code>true</code> the coordinates are transformed to lat/lon.
+         *        If <code>false</code> they are polar-stereographic (cartesian).
+         * @param withValues If <code>true</code>, write out SHPT_POLYGONM with the
+         *        lower class bound as measure. If <code>false</code> writes out SHPT_POLYGON.
+         * @throws RDConversionException
+         */
+        static void convertToRegions(RDScan *scan,
+                                     const char *filename,
+                                     const std::vector<RDDataType> &classBreaks,
+                                     bool geographic = false,
+                                     bool withValues = true);
+
         /**
          * Obtains the bounding box of the radolan scan.
          * TODO: this might be better off in utils or sth?
@@ -114,8 +235,8 @@ namespace Radolan {
                                      bool geographic = false);
 
         /**
-         * Prints the scan data in proj format to console.
-         * TODO: this might be better off in utils or sth?
+         * Prints the scan data in proj format (y, x and value per cell centre,
+         * separated by tabs) to console. @see Radolan2Text::writeXYZ
          *
          * @param scan
          * @param geographic if <code>true</code> the coordinates are transformed to lat/lon.
@@ -0,0 +1,160 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_SLIDING_WINDOW_H
+#define RADOLAN_SLIDING_WINDOW_H
+
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+
+#include <radolan/accumulation.h>
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /**
+     * Rolling totals and maxima of a precipitation product over several
+     * window lengths at once, for example 15 min, 1 h, 3 h, 6 h and 24 h
+     * of 5 minute scans, updated with every new scan.
+     *
+     * The last scans of the longest window are kept in a ring buffer as
+     * raw 16 bit values. Each new scan updates all window sums in one pass:
+     * it is added and the scan that drops out of each window is subtracted.
+     * Maxima are kept with one monotonic queue per cell, sized for the
+     * longest window, from which the maxima of all windows are read.
+     *
+     * Memory use is about 2 bytes per cell and scan of the longest window
+     * for the ring, and as much again for the maxima (900x900 cells and
+     * 288 scans for 24 h: 470 MB each).
+     *
+     * Until the longest window is filled, and for intervals without a scan,
+     * the missing scans count as missing cells.
+     */
+    class RDSlidingWindow {
+    public:
+
+        /**
+         * @param windowMinutes lengths of the windows in minutes, multiples of intervalMinutes
+         * @param intervalMinutes interval of the scans in minutes
+         * @param withMaxima if <code>true</code>, rolling maxima are kept
+         * @param invalidPolicy treatment of missing and clutter cells in the totals
+         *
+         * @throws RDConversionException if a window length is not a multiple of the interval
+         */
+        RDSlidingWindow(const std::vector<int> &windowMinutes,
+                        int intervalMinutes = 5,
+                        bool withMaxima = true,
+                        RDInvalidPolicy invalidPolicy = RD_INVALID_AS_MISSING);
+
+        /**
+         * Minimum fraction of valid scans a cell needs for RD_INVALID_SCALED.
+         * Cells below it are missing in the totals. Defaults to 0.5.
+         */
+        void setMinimumCoverage(double fraction);
+
+        /**
+         * Moves the windows forward to the scan's time and adds the scan.
+         *
+         * @param scan next scan. It is not kept.
+         * @throws RDConversionException if the scan does not fit the ones
+         *         ingested before or is out of order
+         */
+        void ingest(RDScan *scan);
+
+        /**
+         * Reads a radolan file and ingests it.
+         *
+         * @param filename path to the file
+         * @throws RDConversionException
+         */
+        void ingestFile(const char *filename);
+
+        /** @return number of windows */
+        size_t windowCount() const { return m_lengths.size(); }
+
+        /** @return length of the given window in minutes */
+        int windowMinutes(size_t window) const { return m_lengths[window] * m_intervalMinutes; }
+
+        /**
+         * Total of a window in mm, ending with the last scan. Cells whose
+         * total is missing hold RDMissingValue.
+         *
+         * @param window index of the window (order of the constructor)
+         * @return newly allocated scan. Release with RDFreeScan.
+         * @throws RDConversionException if no scan was ingested
+         */
+        RDScan *total(size_t window) const;
+
+        /**
+         * Maximum of the scan values within a window. Cells without valid
+         * values hold RDMissingValue.
+         *
+         * @param window index of the window (order of the constructor)
+         * @return newly allocated scan. Release with RDFreeScan.
+         * @throws RDConversionException if no scan was ingested or maxima are not kept
+         */
+        RDScan *maximum(size_t window) const;
+
+    private:
+
+        // adds one compact scan (NULL for a missing scan) to all windows
+        void push(const RDDataType *data);
+
+        RDScan *allocateResult(size_t window) const;
+
+        std::vector<int> m_lengths;          // window lengths in scans
+        std::vector<size_t> m_longestFirst;  // window indices by decreasing length
+        int m_intervalMinutes;
+        bool m_withMaxima;
+        RDInvalidPolicy m_invalidPolicy;
+        double m_minimumCoverage;
+
+        bool m_initialized;
+        RDRadolanHeader m_header;
+        int m_dimLon;
+        int m_dimLat;
+        size_t m_cells;
+        time_t m_lastTime;
+
+        // ring of the raw values of the last scans, scan major
+        size_t m_capacity;
+        size_t m_newest;
+        std::vector<uint16_t> m_ring;
+
+        // per window and cell: sum of raw values and number of invalid scans
+        std::vector<uint32_t> m_sums;
+        std::vector<uint16_t> m_invalid;
+
+        // per cell: monotonic queue of ring slots with decreasing values
+        std::vector<uint16_t> m_queue;
+        std::vector<uint16_t> m_queueFront;
+        std::vector<uint16_t> m_queueSize;
+
+        // per window and cell: maximum raw value
+        std::vector<uint16_t> m_maxima;
+    };
+}
+
+#endif /* Header Guard */
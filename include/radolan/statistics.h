@@ -0,0 +1,142 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_STATISTICS_H
+#define RADOLAN_STATISTICS_H
+
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** Options for RDComputeStatistics */
+    typedef struct {
+
+        /// Lower bound of the histogram, in the unit of the scan
+        double histogramMin;
+
+        /// Upper bound of the histogram
+        double histogramMax;
+
+        /// Number of equally wide histogram bins between min and max
+        int histogramBins;
+
+        /// Quantiles to compute, each in [0,1]
+        std::vector<double> quantileLevels;
+
+        /// Valid values above this count as wet (rain area, mean intensity)
+        double wetThreshold;
+
+        /// Resolution of the quantiles, min, max and mean. 0 uses the
+        /// product's precision (0.5 dBZ for RX and EX)
+        double resolution;
+
+        /// Optional region mask of dimLon * dimLat bytes. Only cells
+        /// with a non-zero entry are considered. NULL for all cells.
+        const unsigned char *mask;
+
+    } RDStatisticsOptions;
+
+    /** @return options with 100 bins from 0 to 100, the median, 90th and
+     *  99th percentile, wet above 0 and no mask */
+    inline RDStatisticsOptions rdStatisticsOptions() {
+        RDStatisticsOptions o;
+        o.histogramMin = 0.0;
+        o.histogramMax = 100.0;
+        o.histogramBins = 100;
+        o.quantileLevels.push_back(0.5);
+        o.quantileLevels.push_back(0.9);
+        o.quantileLevels.push_back(0.99);
+        o.wetThreshold = 0.0;
+        o.resolution = 0.0;
+        o.mask = NULL;
+        return o;
+    }
+
+    /** Statistics of a scan, as computed by RDComputeStatistics */
+    typedef struct {
+
+        /// Cells considered (all, or those inside the mask)
+        size_t cellCount;
+
+        /// Cells with a clean measurement
+        size_t validCount;
+
+        /// Cells marked as missing (or outside of the composite)
+        size_t missingCount;
+
+        /// Cells marked as clutter
+        size_t clutterCount;
+
+        /// Valid cells above the wet threshold
+        size_t wetCount;
+
+        /// wetCount / validCount
+        double rainAreaFraction;
+
+        /// Minimum, maximum and mean of the valid values
+        double min;
+        double max;
+        double mean;
+
+        /// Mean of the wet values
+        double meanIntensity;
+
+        /// Counts of the valid values per histogram bin
+        std::vector<size_t> histogram;
+
+        /// Valid values below histogramMin and at or above histogramMax
+        size_t belowHistogram;
+        size_t aboveHistogram;
+
+        /// Quantiles in the order of quantileLevels (nearest rank)
+        std::vector<double> quantiles;
+
+    } RDScanStatistics;
+
+    /**
+     * Computes counts, histogram, quantiles, rain area fraction and mean
+     * values of a scan in a single pass over the data.
+     *
+     * Values are mapped to integer steps of the resolution and counted in
+     * a fine histogram, from which everything else is derived. This keeps
+     * the loop over the cells free of reductions, so it is vectorized.
+     * Min, mean and quantiles are exact for values on the product's
+     * precision grid and rounded to the resolution otherwise. Quantiles
+     * beyond 65535 steps are reported as the maximum.
+     *
+     * @param scan scan to analyse
+     * @param options @see RDStatisticsOptions
+     * @param threads number of threads to split the grid over.
+     *        0 uses all available cores.
+     * @return statistics. Without valid cells min, max, mean and quantiles are NaN.
+     * @throws RDConversionException if the options are invalid
+     */
+    RDScanStatistics RDComputeStatistics(const RDScan *scan,
+                                         const RDStatisticsOptions &options,
+                                         unsigned int threads = 1);
+}
+
+#endif /* Header Guard */
@@ -0,0 +1,180 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_SYNTHETIC_H
+#define RADOLAN_SYNTHETIC_H
+
+#include <random>
+#include <stdint.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** Options for generating synthetic scans */
+    typedef struct {
+        /// product to generate
+        RDScanType scanType;
+        /// interval between scans in minutes, 0 for the product's interval
+        int intervalMinutes;
+        /// seed of the random numbers. The same seed gives the same scans.
+        unsigned int seed;
+        /// fraction of the cells with rain
+        double wetFraction;
+        /// size of the rain cells in grid cells (standard deviation)
+        double correlationLength;
+        /// correlation of the rain field with itself 5 minutes earlier
+        double persistence;
+        /// motion of the rain field in grid cells per hour
+        double motionX;
+        double motionY;
+        /// rain rate in mm/h, scales the rain field
+        double rainRateScale;
+        /// fraction of the cells with permanent clutter
+        double clutterFraction;
+        /// probability of a radar to fail at each scan
+        double outageProbability;
+        /// mean duration of radar outages in minutes
+        double outageMinutes;
+    } RDSyntheticOptions;
+
+    inline RDSyntheticOptions rdSyntheticOptions(RDScanType scanType = RD_RX) {
+        RDSyntheticOptions options;
+        options.scanType = scanType;
+        options.intervalMinutes = 0;
+        options.seed = 1;
+        options.wetFraction = 0.15;
+        options.correlationLength = 25.0;
+        options.persistence = 0.95;
+        options.motionX = 30.0;
+        options.motionY = 10.0;
+        options.rainRateScale = 2.0;
+        options.clutterFraction = 0.001;
+        options.outageProbability = 0.002;
+        options.outageMinutes = 60.0;
+        return options;
+    }
+
+    /**
+     * Generates realistic looking RADOLAN scans for testing and
+     * benchmarking without real data.
+     *
+     * The rain is a threshold of a gaussian random field with the given
+     * correlation length. Between scans the field moves with the given
+     * motion and evolves as an autoregressive process with the given
+     * persistence, so consecutive scans are correlated in space and time.
+     * The rain rate grows exponentially above the threshold, giving the
+     * skewed distribution of real rain rates. Reflectivity products are
+     * derived with the DWD's Z-R relationship, precipitation products
+     * hold the precipitation height of their interval.
+     *
+     * Cells farther than 150 km from the 17 radars of the DWD's composite
+     * are missing. Each radar fails now and then (a Markov chain with
+     * outageProbability and outageMinutes), and the cells covered by no
+     * working radar are missing for that time. A few cells are permanent
+     * clutter.
+     *
+     * Supported products are RX, EX, RZ, RY, RV, RH, RB, RW, RL, RU, RS,
+     * RQ, SQ, SH and SF.
+     */
+    class RDSyntheticGenerator {
+    public:
+
+        /**
+         * @param options see RDSyntheticOptions
+         * @throws RDConversionException if the product is not supported
+         */
+        RDSyntheticGenerator(const RDSyntheticOptions &options = rdSyntheticOptions());
+
+        /** @return interval between scans in minutes */
+        int intervalMinutes() const { return m_intervalMinutes; }
+
+        /**
+         * Moves the rain field forward to the given time and returns it
+         * as scan. The first call starts the field.
+         *
+         * @param time time of the scan, later than the one before
+         * @return newly allocated scan. Release with RDFreeScan.
+         * @throws RDConversionException if the time is not later than the last one
+         */
+        RDScan *generate(time_t time);
+
+        /**
+         * Generates scans at the multiples of the interval from begin to
+         * end (both included) and writes them into the given directory,
+         * named as the DWD names its files (@see RDGuessFilename).
+         *
+         * @param directory existing directory to write to
+         * @param begin time of the first scan, rounded up to the interval
+         * @param end time of the last scan
+         * @param compress if <code>true</code>, the files are gzip compressed
+         * @return paths of the files written
+         * @throws RDConversionException if a file could not be written
+         */
+        std::vector<std::string> writeFiles(const char *directory, time_t begin, time_t end, bool compress = false);
+
+    private:
+
+        // sets up the field at the first scan
+        void start();
+
+        // moves and evolves the field by the given number of seconds
+        void step(double seconds);
+
+        // fills m_noise with smoothed white noise of unit variance
+        void smoothNoise();
+
+        // fails and repairs radars
+        void updateRadars(double seconds);
+
+        RDSyntheticOptions m_options;
+        int m_intervalMinutes;
+        float m_precision;
+        std::mt19937 m_random;
+
+        int m_dimLon;
+        int m_dimLat;
+        int m_width;             // canvas including the margin
+        int m_height;
+        int m_margin;
+        double m_threshold;      // field value at the edge of rain
+        double m_carryX;         // part of the motion not moved yet
+        double m_carryY;
+        std::vector<float> m_field;
+        std::vector<float> m_noise;
+        std::vector<float> m_buffer;
+
+        std::vector<uint32_t> m_coverage;   // bit mask of the radars within reach of each cell
+        std::vector<bool> m_clutter;
+        uint32_t m_working;                 // bit mask of the working radars
+
+        bool m_started;
+        time_t m_lastTime;
+    };
+}
+
+#endif /* Header Guard */
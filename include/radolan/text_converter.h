@@ -0,0 +1,133 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_TEXT_CONVERTER_H
+#define RADOLAN_TEXT_CONVERTER_H
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** Options for the text exporters */
+    typedef struct {
+
+        /// Write lat/lon instead of polar-stereographic (cartesian) coordinates
+        bool geographic;
+
+        /// Omit cells without a clean measurement (@see RDIsCleanMeasurement)
+        bool skipMissing;
+
+        /// Omit cells at the product's minimum value (no rain)
+        bool skipZero;
+
+        /// Write y (lat) before x (lon) as the old proj output did
+        bool yFirst;
+
+        /// Column separator of the XYZ output
+        char separator;
+
+    } RDTextOptions;
+
+    /** @return options with coordinates in polar-stereographic x,y order,
+     *  all cells and blanks as separator */
+    inline RDTextOptions rdTextOptions() {
+        RDTextOptions o;
+        o.geographic = false;
+        o.skipMissing = false;
+        o.skipZero = false;
+        o.yFirst = false;
+        o.separator = ' ';
+        return o;
+    }
+
+    /**
+     * This class contains facilities for writing RADOLAN scans as text,
+     * for tools that can't read the binary or NetCDF formats. Coordinates
+     * are the cell centres from the cached grid geometry. Output is
+     * collected in large buffers and written with few system calls.
+     * Values are written with as many decimals as the product's precision
+     * requires.
+     */
+    class Radolan2Text {
+    public:
+
+        /**
+         * Writes one line "x y value" per cell (XYZ, as read by proj or GDAL).
+         *
+         * @param scan radolan scan
+         * @param fd file descriptor to write to
+         * @param options @see RDTextOptions
+         *
+         * @throws RDConversionException
+         */
+        static void writeXYZ(RDScan *scan, int fd, const RDTextOptions &options = rdTextOptions());
+
+        /**
+         * Writes a XYZ file. @see writeXYZ
+         *
+         * @throws RDConversionException
+         */
+        static void convertToXYZ(RDScan *scan, const char *filename, const RDTextOptions &options = rdTextOptions());
+
+        /**
+         * Writes a CSV table with the columns ix,iy,x,y,value (or
+         * ix,iy,lon,lat,value) and a header line. The separator option
+         * does not apply.
+         *
+         * @param scan radolan scan
+         * @param fd file descriptor to write to
+         * @param options @see RDTextOptions
+         *
+         * @throws RDConversionException
+         */
+        static void writeCSV(RDScan *scan, int fd, const RDTextOptions &options = rdTextOptions());
+
+        /**
+         * Writes a CSV file. @see writeCSV
+         *
+         * @throws RDConversionException
+         */
+        static void convertToCSV(RDScan *scan, const char *filename, const RDTextOptions &options = rdTextOptions());
+
+        /**
+         * Writes an ESRI ASCII grid in polar-stereographic coordinates (km).
+         * Cells without a clean measurement are written as NODATA_value.
+         *
+         * @param scan radolan scan
+         * @param fd file descriptor to write to
+         *
+         * @throws RDConversionException
+         */
+        static void writeASCIIGrid(RDScan *scan, int fd);
+
+        /**
+         * Writes an ESRI ASCII grid file. @see writeASCIIGrid
+         *
+         * @throws RDConversionException
+         */
+        static void convertToASCIIGrid(RDScan *scan, const char *filename);
+    };
+}
+
+#endif /* Header Guard */
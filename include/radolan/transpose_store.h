@@ -0,0 +1,181 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_TRANSPOSE_STORE_H
+#define RADOLAN_TRANSPOSE_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** Options for RDTransposeFiles */
+    typedef struct {
+        /// edge length of the square tiles in cells
+        int tileSize;
+        /// number of scans per chunk (2016 = one week of 5 minute scans)
+        int chunkLength;
+        /// memory for the transposed block of one pass in bytes
+        size_t memoryLimit;
+        /// number of threads reading scans, 0 for one per core
+        unsigned int threads;
+    } RDTransposeOptions;
+
+    inline RDTransposeOptions rdTransposeOptions() {
+        RDTransposeOptions options;
+        options.tileSize = 16;
+        options.chunkLength = 2016;
+        options.memoryLimit = (size_t) 1 << 30;
+        options.threads = 0;
+        return options;
+    }
+
+    /**
+     * Writes a series of radolan files into a pixel-major store, in which
+     * the time series of every cell lies in one piece per chunk.
+     *
+     * The scans are sorted by time and split into chunks of chunkLength
+     * scans. Within a chunk, the grid is split into square tiles, tiles
+     * are ordered row by row, the cells of a tile row by row, and each
+     * cell holds its chunkLength values in the compact form of
+     * RDEncodeCompact.
+     *
+     * A chunk is transposed in memory in bands of tile rows, as many as
+     * fit into memoryLimit. Every band beyond the first reads the chunk's
+     * files again. The threads each decode a group of scans and write
+     * them into the band one cache line per cell.
+     *
+     * @param radolanPaths radolan files of the same product, in any order
+     * @param storePath path of the store to create
+     * @param options see RDTransposeOptions
+     * @throws RDConversionException if a file can not be read, the files
+     *         are of different products or two have the same time
+     */
+    void RDTransposeFiles(const std::vector<std::string> &radolanPaths,
+                          const char *storePath,
+                          const RDTransposeOptions &options = rdTransposeOptions());
+
+    /**
+     * Reads time series from a store written by RDTransposeFiles. One
+     * read per chunk fetches the series of a cell, and one per chunk and
+     * tile row the series of a run of neighbouring cells.
+     *
+     * The store is written in the byte order of the machine and can only
+     * be read on machines with the same byte order.
+     */
+    class RDTransposeStore {
+    public:
+
+        /**
+         * @param storePath path of the store
+         * @throws RDConversionException if the file is not a store
+         */
+        explicit RDTransposeStore(const char *storePath);
+
+        ~RDTransposeStore();
+
+        /** @return number of scans */
+        size_t size() const { return m_times.size(); }
+
+        int dimLon() const { return m_dimLon; }
+
+        int dimLat() const { return m_dimLat; }
+
+        RDScanType scanType() const { return m_scanType; }
+
+        /** @return step of the stored values, see RDCompactPrecision */
+        float precision() const { return m_precision; }
+
+        /** @return interval of the scans in minutes */
+        int intervalDuration() const { return m_intervalDuration; }
+
+        /** @return timestamp of scan t in seconds since epoch */
+        time_t time(size_t t) const { return m_times[t]; }
+
+        /** @return timestamps of all scans */
+        const std::vector<time_t> &times() const { return m_times; }
+
+        /**
+         * Scans within a period.
+         *
+         * @param begin first timestamp, inclusive
+         * @param end last timestamp, exclusive
+         * @param first index of the first scan in the period
+         * @param last index after the last scan in the period
+         */
+        void range(time_t begin, time_t end, size_t &first, size_t &last) const;
+
+        /**
+         * Time series of one cell.
+         *
+         * @param x column
+         * @param y row
+         * @param t0,t1 scans [t0, t1)
+         * @param values the t1 - t0 values. Invalid cells hold RDMissingValue
+         *        or RDClutterValue.
+         * @throws RDConversionException if the cell or scans are not in the store
+         */
+        void series(int x, int y, size_t t0, size_t t1, std::vector<RDDataType> &values) const;
+
+        /**
+         * Time series of a block of cells.
+         *
+         * @param x0,x1 columns [x0, x1)
+         * @param y0,y1 rows [y0, y1)
+         * @param t0,t1 scans [t0, t1)
+         * @param values the series of the cells row by row, each t1 - t0 long
+         * @throws RDConversionException if the block is not in the store
+         */
+        void area(int x0, int x1, int y0, int y1, size_t t0, size_t t1,
+                  std::vector<RDDataType> &values) const;
+
+    private:
+
+        RDTransposeStore(const RDTransposeStore &);
+
+        RDTransposeStore &operator=(const RDTransposeStore &);
+
+        // reads the values of count neighbouring cells of one tile row
+        // starting at (x,y) within [t0, t1) into target, cell by cell
+        void readRun(int x, int y, int count, size_t t0, size_t t1, uint16_t *target) const;
+
+        int m_file;
+        RDScanType m_scanType;
+        int m_dimLon;
+        int m_dimLat;
+        int m_tileSize;
+        int m_chunkLength;
+        float m_precision;
+        int m_intervalDuration;
+        uint64_t m_dataOffset;
+        std::vector<time_t> m_times;
+    };
+}
+
+#endif /* Header Guard */
@@ -0,0 +1,66 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_WRITER_H
+#define RADOLAN_WRITER_H
+
+#include <stdbool.h>
+
+#include <radolan/types.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+    namespace Radolan {
+#endif
+
+/**
+ * Writes a scan in the RADOLAN binary format, so that RDReadScan reads
+ * it back unchanged.
+ *
+ * The header is built from scan->header: product, time, radarLocation and
+ * the tags BY, VS (if set), SW (if set), PR, INT, GP, VV (if set) and MS
+ * (if there are radar stations), terminated by ETX. The grid must be the
+ * one RDReadScan expects for the product (@see RDScanDimensions).
+ *
+ * RX and EX are written as RVP6 bytes (dBZ = -32.5 + byte / 2), with 249
+ * for clutter and 250 for missing values. All other products are written
+ * as little endian 16 bit words of 12 bit value (in units of the header's
+ * precision) and 4 flag bits: RD_ERROR_BIT for missing values,
+ * RD_CLUTTER_BIT for clutter and RD_NEGATIVE_SIGN_BIT for negative values.
+ * Values beyond the range of the encoding are clamped.
+ *
+ * @param filename path of the file to write
+ * @param scan scan to write
+ * @param compress if <code>true</code>, the file is gzip compressed (as
+ *        the DWD ships some products). RDReadScan reads both.
+ * @return 1 if the file was written, 0 otherwise
+ */
+int RDWriteScan(const char *filename, RDScan *scan, bool compress);
+
+#ifdef __cplusplus
+}
+}
+#endif
+
+#endif /* header guard */
@@ -0,0 +1,150 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RADOLAN_ZARR_CONVERTER_H
+#define RADOLAN_ZARR_CONVERTER_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include <radolan/conversion_exeption.h>
+#include <radolan/types.h>
+
+namespace Radolan {
+
+    /** Options for writing Zarr stores */
+    typedef struct {
+        /// edge lengths of the chunks in cells, only used when the store is created
+        int chunkLon;
+        int chunkLat;
+        /// zlib compression level 1-9
+        int compressionLevel;
+        /// number of threads writing scans in appendFiles, 0 for one per core
+        unsigned int threads;
+    } RDZarrOptions;
+
+    inline RDZarrOptions rdZarrOptions() {
+        RDZarrOptions options;
+        options.chunkLon = 450;
+        options.chunkLat = 450;
+        options.compressionLevel = 1;
+        options.threads = 0;
+        return options;
+    }
+
+    /**
+     * This class bundles functions for writing RADOLAN scans into Zarr
+     * (version 2) stores, which xarray and dask open directly.
+     *
+     * A store holds one product. The data variable is named after the
+     * product (for example <code>RX</code>) and has the dimensions
+     * time, y and x. Each scan is split into chunks of one time step
+     * and chunkLat x chunkLon cells, compressed with zlib and written
+     * to a file of its own. The coordinates x, y and time, the grid
+     * mapping crs and the CF attributes are the same as in the files
+     * of Radolan2NetCDF.
+     *
+     * Appending a scan only grows the shape in the metadata and adds
+     * new chunk files, existing chunks are never rewritten. The
+     * metadata is changed under an exclusive lock on the store's
+     * <code>.zgroup</code> file, and every file is written under a
+     * temporary name and renamed, so any number of threads and
+     * processes can write into the same store at once. The shape grows
+     * before the chunks are written, so readers may see missing values
+     * at the end of the time axis for a moment. Consolidated metadata
+     * is not written, as it would go stale with every append.
+     */
+    class Radolan2Zarr {
+    public:
+
+        /**
+         * Writes the scan behind the last time step of the store. The
+         * store is created if it does not exist yet.
+         *
+         * @param scan radolan scan
+         * @param storePath path of the store directory
+         * @param options see RDZarrOptions
+         *
+         * @return time index the scan was written to
+         *
+         * @throw RDConversionException if the store holds another
+         *        product or grid, or can not be written
+         */
+        static
+        size_t appendScan(RDScan *scan,
+                          const char *storePath,
+                          const RDZarrOptions &options = rdZarrOptions());
+
+        /**
+         * Writes the scan at the given time index, growing the store if
+         * the index is beyond its end. Steps skipped this way read as
+         * missing until they are written. Processes that agree on the
+         * indices beforehand (for example from a sorted list of files)
+         * can fill a store without any further coordination.
+         *
+         * @param scan radolan scan
+         * @param storePath path of the store directory
+         * @param index time index to write the scan to
+         * @param options see RDZarrOptions
+         *
+         * @throw RDConversionException
+         */
+        static
+        void writeScan(RDScan *scan,
+                       const char *storePath,
+                       size_t index,
+                       const RDZarrOptions &options = rdZarrOptions());
+
+        /**
+         * Appends radolan files to the store in chronological order.
+         * The time steps for all files are reserved at once, then the
+         * files are read and written by options.threads threads.
+         *
+         * @param radolanPaths radolan files of one product, in any order
+         * @param storePath path of the store directory
+         * @param options see RDZarrOptions
+         * @param omitOutside @see RDReadScan
+         *
+         * @return time index of the first file
+         *
+         * @throw RDConversionException if a file can not be read or
+         *        written. The other files are written nonetheless.
+         */
+        static
+        size_t appendFiles(const std::vector<std::string> &radolanPaths,
+                           const char *storePath,
+                           const RDZarrOptions &options = rdZarrOptions(),
+                           bool omitOutside = false);
+
+        /**
+         * @param storePath path of the store directory
+         * @return number of time steps in the store
+         * @throw RDConversionException if there is no store
+         */
+        static
+        size_t length(const char *storePath);
+    };
+}
+
+#endif /* Header Guard */
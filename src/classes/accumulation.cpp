@@ -0,0 +1,262 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <string.h>
+
+#include <radolan/accumulation.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+#include <radolan/scan_utils.h>
+
+namespace Radolan {
+
+    /**
+     * Per cell flags of one scan, computed without branches so the
+     * compiler can vectorize the kernels below.
+     */
+    typedef struct {
+        uint32_t countsAsZero;     // invalid cells that count as dry
+        uint32_t countsAsMissing;  // invalid cells that poison the total
+    } RDPolicyMasks;
+
+    static RDPolicyMasks rdPolicyMasks(RDInvalidPolicy missingPolicy, RDInvalidPolicy clutterPolicy) {
+        RDPolicyMasks m;
+        m.countsAsZero = (missingPolicy == RD_INVALID_AS_ZERO ? 1u : 0u)
+                         | (clutterPolicy == RD_INVALID_AS_ZERO ? 2u : 0u);
+        m.countsAsMissing = (missingPolicy == RD_INVALID_AS_MISSING ? 1u : 0u)
+                            | (clutterPolicy == RD_INVALID_AS_MISSING ? 2u : 0u);
+        return m;
+    }
+
+    // Kind of an invalid cell as used by RDPolicyMasks: 1 for missing
+    // cells, 2 for clutter and 0 for values. Bit operations only, as
+    // selects and variable shifts keep GCC from vectorizing.
+    static inline uint32_t invalidKind(uint32_t isValue, uint32_t isClutter) {
+        return ((1u - isValue) & (1u - isClutter)) | (isClutter << 1);
+    }
+
+    // Sums the raw integer values (value / precision). The sums are 64 bit,
+    // 32 bit ones overflow after about a million scans of the largest value.
+    // Raw values fit into 31 bits, so the conversion goes through int32_t,
+    // which SSE2 converts four at a time.
+    static void accumulateRaw(const RDDataType *data, size_t count, float precision, float clutterValue,
+                              RDPolicyMasks masks, uint64_t *sums, uint32_t *valid, uint8_t *poisoned) {
+        const float inverse = 1.0f / precision;
+        for (size_t i = 0; i < count; i++) {
+            float v = data[i];
+            uint32_t isValue = v >= 0.0f;
+            uint32_t isClutter = v == clutterValue;
+            // everything else (RDMissingValue or garbage) is missing
+            uint32_t kind = invalidKind(isValue, isClutter);
+            sums[i] += (uint32_t) (int32_t) ((isValue ? v : 0.0f) * inverse + 0.5f);
+            valid[i] += isValue | ((masks.countsAsZero & kind) != 0);
+            poisoned[i] |= (uint8_t) ((masks.countsAsMissing & kind) != 0);
+        }
+    }
+
+    // Sums the values as they are
+    static void accumulateFloat(const RDDataType *data, size_t count, float clutterValue,
+                                RDPolicyMasks masks, float *sums, uint32_t *valid, uint8_t *poisoned) {
+        for (size_t i = 0; i < count; i++) {
+            float v = data[i];
+            uint32_t isValue = v >= 0.0f;
+            uint32_t isClutter = v == clutterValue;
+            uint32_t kind = invalidKind(isValue, isClutter);
+            sums[i] += isValue ? v : 0.0f;
+            valid[i] += isValue | ((masks.countsAsZero & kind) != 0);
+            poisoned[i] |= (uint8_t) ((masks.countsAsMissing & kind) != 0);
+        }
+    }
+
+    RDAccumulator::RDAccumulator(RDSumType sumType,
+                                 RDInvalidPolicy missingPolicy,
+                                 RDInvalidPolicy clutterPolicy)
+            : m_sumType(sumType),
+              m_missingPolicy(missingPolicy),
+              m_clutterPolicy(clutterPolicy),
+              m_minimumCoverage(0.5),
+              m_periodBegin(0),
+              m_periodEnd(0) {
+        reset();
+    }
+
+    void RDAccumulator::setPeriod(time_t begin, time_t end) {
+        if (end <= begin) {
+            throw RDConversionException("Accumulation period ends before it begins");
+        }
+        if (m_initialized && (m_firstTime <= begin || m_lastTime > end)) {
+            throw RDConversionException("Scans were ingested outside of the accumulation period");
+        }
+        m_periodBegin = begin;
+        m_periodEnd = end;
+    }
+
+    void RDAccumulator::setMinimumCoverage(double fraction) {
+        m_minimumCoverage = fraction;
+    }
+
+    void RDAccumulator::reset() {
+        m_initialized = false;
+        memset(&m_header, 0, sizeof(m_header));
+        m_dimLon = m_dimLat = 0;
+        m_interval = 0;
+        m_firstTime = m_lastTime = 0;
+        m_scans = 0;
+        m_rawSums.clear();
+        m_floatSums.clear();
+        m_valid.clear();
+        m_poisoned.clear();
+    }
+
+    size_t RDAccumulator::expectedScanCount() const {
+        if (!m_initialized) return 0;
+        if (m_periodEnd > m_periodBegin) {
+            return (size_t) ((m_periodEnd - m_periodBegin) / m_interval);
+        }
+        return (size_t) ((m_lastTime - m_firstTime) / m_interval) + 1;
+    }
+
+    void RDAccumulator::ingest(RDScan *scan) {
+        RDScanType type = scan->header.scanType;
+        if (type == RD_RX || type == RD_EX) {
+            throw RDConversionException("Reflectivity products can not be accumulated");
+        }
+        if (scan->header.intervalDuration == 0) {
+            throw RDConversionException("Scan has no interval duration");
+        }
+
+        time_t time = RDScanTimeInSecondsSinceEpoch(scan);
+        if (m_periodEnd > m_periodBegin && (time <= m_periodBegin || time > m_periodEnd)) {
+            throw RDConversionException("Scan lies outside of the accumulation period");
+        }
+
+        size_t count = (size_t) scan->dimLon * scan->dimLat;
+        if (!m_initialized) {
+            if (scan->header.precision <= 0) {
+                throw RDConversionException("Scan has no precision");
+            }
+            m_header = scan->header;
+            m_header.radarStations = NULL;
+            m_header.numberOfRadarStations = 0;
+            m_dimLon = scan->dimLon;
+            m_dimLat = scan->dimLat;
+            m_interval = (time_t) scan->header.intervalDuration * 60;
+            if (m_periodEnd > m_periodBegin && (time - m_periodBegin) % m_interval != 0) {
+                throw RDConversionException("Scan does not lie on the interval grid of the period");
+            }
+
+            if (m_sumType == RD_SUM_INTEGER) {
+                m_rawSums.assign(count, 0);
+            } else {
+                m_floatSums.assign(count, 0.0f);
+            }
+            m_valid.assign(count, 0);
+            m_poisoned.assign(count, 0);
+            m_firstTime = time;
+            m_initialized = true;
+        } else {
+            if (type != m_header.scanType) {
+                throw RDConversionException("Scan is of a different product");
+            }
+            if (scan->dimLon != m_dimLon || scan->dimLat != m_dimLat) {
+                throw RDConversionException("Scan has a different grid");
+            }
+            if ((time_t) scan->header.intervalDuration * 60 != m_interval) {
+                throw RDConversionException("Scan has a different interval duration");
+            }
+            if (m_sumType == RD_SUM_INTEGER && scan->header.precision != m_header.precision) {
+                throw RDConversionException("Scan has a different precision. Use RD_SUM_FLOAT.");
+            }
+            if (time <= m_lastTime) {
+                throw RDConversionException("Scans must be ingested in chronological order without duplicates");
+            }
+            if ((time - m_lastTime) % m_interval != 0) {
+                throw RDConversionException("Scan does not lie on the interval grid");
+            }
+        }
+
+        RDPolicyMasks masks = rdPolicyMasks(m_missingPolicy, m_clutterPolicy);
+        float clutterValue = RDClutterValue(type);
+        if (m_sumType == RD_SUM_INTEGER) {
+            accumulateRaw(scan->data, count, m_header.precision, clutterValue, masks,
+                          &m_rawSums[0], &m_valid[0], &m_poisoned[0]);
+        } else {
+            accumulateFloat(scan->data, count, clutterValue, masks,
+                            &m_floatSums[0], &m_valid[0], &m_poisoned[0]);
+        }
+
+        m_lastTime = time;
+        m_scans++;
+    }
+
+    void RDAccumulator::ingestFile(const char *filename) {
+        RDScanFile scan(filename, false);
+        ingest(scan.get());
+    }
+
+    RDScan *RDAccumulator::totals() const {
+        if (!m_initialized) {
+            throw RDConversionException("No scans were accumulated");
+        }
+
+        size_t expected = expectedScanCount();
+        size_t absent = expected - m_scans;
+        bool scaled = m_missingPolicy == RD_INVALID_SCALED || m_clutterPolicy == RD_INVALID_SCALED;
+        uint32_t absentValid = m_missingPolicy == RD_INVALID_AS_ZERO ? (uint32_t) absent : 0;
+        bool absentPoisons = m_missingPolicy == RD_INVALID_AS_MISSING && absent > 0;
+        RDDataType missing = RDMissingValue(m_header.scanType);
+
+        // timestamp is the end of the period
+        size_t count = (size_t) m_dimLon * m_dimLat;
+        time_t end = m_periodEnd > m_periodBegin ? m_periodEnd : m_lastTime;
+        RDScan *result = RDAllocateResultScan(m_header, m_dimLon, m_dimLat, end);
+        size_t minutes = expected * (size_t) (m_interval / 60);
+        result->header.intervalDuration = (unsigned short) (minutes > 65535 ? 65535 : minutes);
+
+        for (size_t i = 0; i < count; i++) {
+            double total = m_sumType == RD_SUM_INTEGER
+                           ? (double) m_rawSums[i] * m_header.precision
+                           : (double) m_floatSums[i];
+            uint32_t valid = m_valid[i] + absentValid;
+
+            bool isMissing = m_poisoned[i] || absentPoisons;
+            if (!isMissing && scaled) {
+                if (valid == 0 || valid < m_minimumCoverage * expected) {
+                    isMissing = true;
+                } else {
+                    total *= (double) expected / valid;
+                }
+            }
+
+            if (isMissing) {
+                result->data[i] = missing;
+            } else {
+                result->data[i] = (RDDataType) total;
+                if (result->data[i] > result->max_value) result->max_value = result->data[i];
+            }
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,286 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include <radolan/advection.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+#include <radolan/scan_utils.h>
+
+namespace Radolan {
+
+    /** A scan with the limits of its product, for sampling at fractional positions */
+    typedef struct {
+        const RDDataType *data;
+        int dimLon;
+        int dimLat;
+        RDDataType minValue;
+        RDDataType maxValue;
+        RDDataType missingValue;
+        RDDataType clutterValue;
+    } RDSampler;
+
+    static RDSampler rdSampler(const RDScan *scan) {
+        RDScanType type = scan->header.scanType;
+        RDSampler s;
+        s.data = scan->data;
+        s.dimLon = scan->dimLon;
+        s.dimLat = scan->dimLat;
+        s.minValue = RDMinValue(type);
+        s.maxValue = RDMaxValue(type);
+        s.missingValue = RDMissingValue(type);
+        s.clutterValue = RDClutterValue(type);
+        return s;
+    }
+
+    static inline bool rdIsClean(const RDSampler &s, RDDataType v) {
+        return v >= s.minValue && v <= s.maxValue && v != s.missingValue && v != s.clutterValue;
+    }
+
+    /**
+     * Samples the scan bilinearly at (x,y), clamped to the grid. Next to
+     * invalid cells the nearest cell is taken instead.
+     * @return false if the sample is invalid. value is then the clutter
+     *         or missing value.
+     */
+    static inline bool rdSample(const RDSampler &s, double x, double y, RDDataType &value) {
+        x = std::max(0.0, std::min((double) (s.dimLon - 1), x));
+        y = std::max(0.0, std::min((double) (s.dimLat - 1), y));
+        int x0 = (int) x, y0 = (int) y;
+        int x1 = std::min(x0 + 1, s.dimLon - 1), y1 = std::min(y0 + 1, s.dimLat - 1);
+        float fx = (float) (x - x0), fy = (float) (y - y0);
+
+        const RDDataType *lower = s.data + (size_t) y0 * s.dimLon;
+        const RDDataType *upper = s.data + (size_t) y1 * s.dimLon;
+        RDDataType v00 = lower[x0], v10 = lower[x1], v01 = upper[x0], v11 = upper[x1];
+        if (rdIsClean(s, v00) && rdIsClean(s, v10) && rdIsClean(s, v01) && rdIsClean(s, v11)) {
+            value = (1.0f - fy) * ((1.0f - fx) * v00 + fx * v10) + fy * ((1.0f - fx) * v01 + fx * v11);
+            return true;
+        }
+
+        RDDataType nearest = fy < 0.5f ? (fx < 0.5f ? v00 : v10) : (fx < 0.5f ? v01 : v11);
+        if (rdIsClean(s, nearest)) {
+            value = nearest;
+            return true;
+        }
+        value = nearest == s.clutterValue ? s.clutterValue : s.missingValue;
+        return false;
+    }
+
+    /** Copy of the scan with the header of the original, without radar stations */
+    static RDScan *rdCopyScan(const RDScan *scan, bool withData) {
+        size_t count = (size_t) scan->dimLon * scan->dimLat;
+        RDScan *copy = RDAllocateScan();
+        if (copy == NULL) {
+            throw RDConversionException("Could not allocate scan");
+        }
+        copy->data = (RDDataType *) malloc(count * sizeof(RDDataType));
+        if (copy->data == NULL) {
+            RDFreeScan(copy);
+            throw RDConversionException("Could not allocate scan data");
+        }
+        if (withData) {
+            memcpy(copy->data, scan->data, count * sizeof(RDDataType));
+        }
+        copy->header = scan->header;
+        copy->header.radarStations = NULL;
+        copy->header.numberOfRadarStations = 0;
+        copy->dimLon = scan->dimLon;
+        copy->dimLat = scan->dimLat;
+        copy->dbZPerUnit = scan->dbZPerUnit;
+        copy->min_value = scan->min_value;
+        copy->max_value = scan->max_value;
+        memcpy(copy->filename, scan->filename, sizeof(copy->filename));
+        return copy;
+    }
+
+    /** Corrects the rows [begin, end) */
+    static void rdAdvectRows(const RDSampler &previous, const RDSampler &current,
+                             const RDMotionField &motion, double cellsX, double cellsY,
+                             int steps, int begin, int end, RDDataType *out) {
+        int dimLon = current.dimLon;
+        for (int iy = begin; iy < end; iy++) {
+            for (int ix = 0; ix < dimLon; ix++) {
+                // displacement over the whole interval in cells
+                RDMotionVector velocity = RDMotionAt(motion, ix, iy);
+                double dx = velocity.u * cellsX;
+                double dy = velocity.v * cellsY;
+
+                double sum = 0.0;
+                RDDataType result = 0.0f;
+                bool valid = true;
+                for (int k = 0; k < steps && valid; k++) {
+                    double a = (k + 0.5) / steps;
+                    RDDataType before, after;
+                    valid = rdSample(previous, ix - a * dx, iy - a * dy, before);
+                    if (!valid) {
+                        result = before;
+                        break;
+                    }
+                    valid = rdSample(current, ix + (1.0 - a) * dx, iy + (1.0 - a) * dy, after);
+                    if (!valid) {
+                        result = after;
+                        break;
+                    }
+                    sum += (1.0 - a) * before + a * after;
+                }
+                out[(size_t) iy * dimLon + ix] = valid ? (RDDataType) (sum / steps) : result;
+            }
+        }
+    }
+
+    RDScan *RDAdvectionCorrect(const RDScan *previous,
+                               const RDScan *current,
+                               const RDMotionField *motion,
+                               const RDAdvectionOptions &options) {
+        if (options.stepMinutes <= 0) {
+            throw RDConversionException("Step length must be positive");
+        }
+        if (previous->header.scanType != current->header.scanType
+            || previous->dimLon != current->dimLon || previous->dimLat != current->dimLat) {
+            throw RDConversionException("Scans are of different products or grids");
+        }
+        double seconds = difftime(RDScanTimeInSecondsSinceEpoch((RDScan *) current),
+                                  RDScanTimeInSecondsSinceEpoch((RDScan *) previous));
+        if (seconds <= 0) {
+            throw RDConversionException("Scans are not in chronological order");
+        }
+
+        RDMotionField estimated;
+        if (motion == NULL) {
+            RDMotionOptions motionOptions = options.motion;
+            if (motionOptions.threads == 0) motionOptions.threads = options.threads;
+            estimated = RDEstimateMotion(previous, current, motionOptions);
+            motion = &estimated;
+        }
+
+        int steps = std::max(1, (int) floor(seconds / (options.stepMinutes * 60.0) + 0.5));
+        double hours = seconds / 3600.0;
+        double cellsX = hours / motion->cellSizeX;
+        double cellsY = hours / motion->cellSizeY;
+
+        RDScan *result = rdCopyScan(current, false);
+        result->filename[0] = '\0';
+        RDSampler before = rdSampler(previous);
+        RDSampler after = rdSampler(current);
+
+        int dimLat = current->dimLat;
+        unsigned int threads = options.threads;
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = std::min(threads, (unsigned int) dimLat);
+
+        std::vector<std::thread> workers;
+        for (unsigned int t = 1; t < threads; t++) {
+            int begin = (int) ((size_t) dimLat * t / threads);
+            int end = (int) ((size_t) dimLat * (t + 1) / threads);
+            workers.push_back(std::thread(rdAdvectRows, std::cref(before), std::cref(after),
+                                          std::cref(*motion), cellsX, cellsY, steps, begin, end,
+                                          result->data));
+        }
+        rdAdvectRows(before, after, *motion, cellsX, cellsY, steps, 0, dimLat / threads, result->data);
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+
+        size_t count = (size_t) current->dimLon * dimLat;
+        result->min_value = result->max_value = 0;
+        bool first = true;
+        for (size_t i = 0; i < count; i++) {
+            RDDataType v = result->data[i];
+            if (!rdIsClean(after, v)) continue;
+            if (first || v < result->min_value) result->min_value = v;
+            if (first || v > result->max_value) result->max_value = v;
+            first = false;
+        }
+        return result;
+    }
+
+    RDAdvectionCorrector::RDAdvectionCorrector(const RDAdvectionOptions &options)
+            : m_options(options),
+              m_previous(NULL),
+              m_previousTime(0) {
+    }
+
+    RDAdvectionCorrector::~RDAdvectionCorrector() {
+        reset();
+    }
+
+    void RDAdvectionCorrector::reset() {
+        RDFreeScan(m_previous);
+        m_previous = NULL;
+        m_previousTime = 0;
+        m_motion.vectors.clear();
+    }
+
+    RDScan *RDAdvectionCorrector::ingest(const RDScan *scan, const RDMotionField *motion) {
+        time_t time = RDScanTimeInSecondsSinceEpoch((RDScan *) scan);
+        if (m_previous != NULL && time <= m_previousTime) {
+            throw RDConversionException("Scans must be ingested in chronological order without duplicates");
+        }
+
+        // the first scan, and the first after a gap, have nothing to interpolate with
+        bool connected = m_previous != NULL
+                         && scan->header.scanType == m_previous->header.scanType
+                         && scan->dimLon == m_previous->dimLon
+                         && scan->dimLat == m_previous->dimLat
+                         && time - m_previousTime <= (time_t) scan->header.intervalDuration * 60;
+
+        RDScan *result;
+        m_motion.vectors.clear();
+        if (connected) {
+            if (motion == NULL) {
+                RDMotionOptions motionOptions = m_options.motion;
+                if (motionOptions.threads == 0) motionOptions.threads = m_options.threads;
+                m_motion = RDEstimateMotion(m_previous, scan, motionOptions);
+                motion = &m_motion;
+            }
+            result = RDAdvectionCorrect(m_previous, scan, motion, m_options);
+        } else {
+            result = rdCopyScan(scan, true);
+        }
+
+        RDScan *copy;
+        try {
+            copy = rdCopyScan(scan, true);
+        } catch (const RDConversionException &) {
+            RDFreeScan(result);
+            throw;
+        }
+        RDFreeScan(m_previous);
+        m_previous = copy;
+        m_previousTime = time;
+        return result;
+    }
+
+    RDScan *RDAdvectionCorrector::ingestFile(const char *filename) {
+        RDScanFile scan(filename, false);
+        return ingest(scan.get());
+    }
+}
@@ -0,0 +1,575 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <radolan/archive.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+#include <radolan/scan_cube.h>
+#include <radolan/scan_utils.h>
+
+namespace Radolan {
+
+    /** Start of an archive file */
+    typedef struct {
+        char magic[4];
+        uint32_t byteOrder;
+        uint32_t version;
+        uint32_t reserved;
+    } RDArchiveFileHeader;
+
+    /**
+     * Start of a record, followed by tileCount + 1 offsets of the tiles
+     * (uint32_t, relative to the end of the offsets) and the tiles
+     */
+    typedef struct {
+        char magic[4];
+        uint32_t flags;
+        uint64_t recordSize;
+        int64_t time;
+        int32_t scanType;
+        int32_t dimLon;
+        int32_t dimLat;
+        int32_t tileSize;
+        float precision;
+        float headerPrecision;
+        uint32_t radarLocation;
+        uint32_t predictionMinutes;
+        int32_t intervalDuration;
+        int32_t radarFormat;
+        int32_t quantification;
+        uint32_t tileCount;
+        char softwareVersion[12];
+        char resolution[12];
+        char binaryFormat[12];
+    } RDArchiveRecordHeader;
+
+    static const char RD_ARCHIVE_MAGIC[4] = {'R', 'D', 'A', 'R'};
+    static const char RD_ARCHIVE_RECORD_MAGIC[4] = {'R', 'D', 'S', 'C'};
+    static const uint32_t RD_ARCHIVE_BYTE_ORDER = 0x01020304;
+    static const uint32_t RD_ARCHIVE_VERSION = 1;
+    static const uint32_t RD_ARCHIVE_KEYFRAME = 1;
+
+    // tileSize must be positive
+    static int rdTileCount(int dim, int tileSize) {
+        return (int) (((int64_t) dim + tileSize - 1) / tileSize);
+    }
+
+    /** Copies a tile out of a scan (copyIn false) or into it (true) */
+    static void rdCopyTile(uint16_t *scan, int dimLon, int x0, int y0, int width, int height,
+                           uint16_t *tile, bool copyIn) {
+        for (int y = 0; y < height; y++) {
+            uint16_t *row = scan + (size_t) (y0 + y) * dimLon + x0;
+            if (copyIn) {
+                memcpy(row, tile + (size_t) y * width, width * sizeof(uint16_t));
+            } else {
+                memcpy(tile + (size_t) y * width, row, width * sizeof(uint16_t));
+            }
+        }
+    }
+
+    static void rdWriteFully(int file, const unsigned char *buffer, size_t bytes) {
+        while (bytes > 0) {
+            ssize_t written = write(file, buffer, bytes);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) {
+                throw RDConversionException("Could not write to archive");
+            }
+            buffer += written;
+            bytes -= (size_t) written;
+        }
+    }
+
+    RDArchiveWriter::RDArchiveWriter(const char *path, const RDArchiveOptions &options)
+            : m_options(options) {
+        if (options.tileSize <= 0 || options.keyframeInterval <= 0
+            || options.compressionLevel < 1 || options.compressionLevel > 9) {
+            throw RDConversionException("Tile size and keyframe interval must be positive, the level 1-9");
+        }
+        m_file = open(path, O_RDWR | O_CREAT, 0644);
+        if (m_file < 0) {
+            throw RDConversionException("Could not open archive");
+        }
+
+        try {
+            struct stat st;
+            if (fstat(m_file, &st) != 0) {
+                throw RDConversionException("Could not open archive");
+            }
+            if (st.st_size == 0) {
+                RDArchiveFileHeader header;
+                memset(&header, 0, sizeof(header));
+                memcpy(header.magic, RD_ARCHIVE_MAGIC, sizeof(header.magic));
+                header.byteOrder = RD_ARCHIVE_BYTE_ORDER;
+                header.version = RD_ARCHIVE_VERSION;
+                rdWriteFully(m_file, (const unsigned char *) &header, sizeof(header));
+            } else {
+                // continue after the last complete record
+                RDArchiveReader reader(path);
+                std::vector<RDScanType> products = reader.products();
+                for (size_t i = 0; i < products.size(); i++) {
+                    State &state = m_states[products[i]];
+                    state.geometry = reader.product(products[i]);
+                    state.lastTime = state.geometry.entries.back().time;
+                    state.geometry.entries.clear();
+                    state.sinceKeyframe = 0;
+                }
+                if (ftruncate(m_file, (off_t) reader.endOfRecords()) != 0
+                    || lseek(m_file, 0, SEEK_END) < 0) {
+                    throw RDConversionException("Could not open archive");
+                }
+            }
+        } catch (const RDConversionException &) {
+            close(m_file);
+            throw;
+        }
+    }
+
+    RDArchiveWriter::~RDArchiveWriter() {
+        close(m_file);
+    }
+
+    void RDArchiveWriter::append(const RDScan *scan) {
+        RDScanType type = scan->header.scanType;
+        time_t time = RDScanTimeInSecondsSinceEpoch(const_cast<RDScan *>(scan));
+        float precision = RDCompactPrecision(scan->header);
+
+        std::map<RDScanType, State>::iterator found = m_states.find(type);
+        if (found != m_states.end()) {
+            const RDArchiveProduct &geometry = found->second.geometry;
+            if (scan->dimLon != geometry.dimLon || scan->dimLat != geometry.dimLat) {
+                throw RDConversionException("Scan has a different grid");
+            }
+            if (precision != geometry.precision) {
+                throw RDConversionException("Scan has a different precision");
+            }
+            if (time <= found->second.lastTime) {
+                throw RDConversionException("Scans must be appended in chronological order without duplicates");
+            }
+        }
+        State &state = m_states[type];
+        if (found == m_states.end()) {
+            state.geometry.scanType = type;
+            state.geometry.dimLon = scan->dimLon;
+            state.geometry.dimLat = scan->dimLat;
+            state.geometry.tileSize = m_options.tileSize;
+            state.geometry.precision = precision;
+            state.sinceKeyframe = 0;
+        }
+
+        int dimLon = scan->dimLon;
+        int dimLat = scan->dimLat;
+        int tileSize = state.geometry.tileSize;
+        int tilesX = rdTileCount(dimLon, tileSize);
+        int tilesY = rdTileCount(dimLat, tileSize);
+        int tileCount = tilesX * tilesY;
+        std::vector<uint16_t> values((size_t) dimLon * dimLat);
+        RDEncodeCompact(type, precision, scan->data, values.size(), &values[0]);
+
+        bool keyframe = state.values.empty() || state.sinceKeyframe + 1 >= m_options.keyframeInterval;
+
+        RDArchiveRecordHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, RD_ARCHIVE_RECORD_MAGIC, sizeof(header.magic));
+        header.flags = keyframe ? RD_ARCHIVE_KEYFRAME : 0;
+        header.time = (int64_t) time;
+        header.scanType = type;
+        header.dimLon = dimLon;
+        header.dimLat = dimLat;
+        header.tileSize = tileSize;
+        header.precision = precision;
+        header.headerPrecision = scan->header.precision;
+        header.radarLocation = scan->header.radarLocation;
+        header.predictionMinutes = scan->header.predictionMinutes;
+        header.intervalDuration = scan->header.intervalDuration;
+        header.radarFormat = scan->header.radarFormat;
+        header.quantification = scan->header.quantification;
+        header.tileCount = (uint32_t) tileCount;
+        strncpy(header.softwareVersion, scan->header.softwareVersion, sizeof(header.softwareVersion) - 1);
+        strncpy(header.resolution, scan->header.resolution, sizeof(header.resolution) - 1);
+        strncpy(header.binaryFormat, scan->header.binaryFormat, sizeof(header.binaryFormat) - 1);
+
+        std::vector<uint32_t> offsets(tileCount + 1, 0);
+        std::vector<unsigned char> payload;
+        std::vector<uint16_t> tile((size_t) tileSize * tileSize);
+        std::vector<uint16_t> previous(tile.size());
+        std::vector<unsigned char> bytes(2 * tile.size());
+        std::vector<unsigned char> compressed(compressBound((uLong) bytes.size()));
+
+        for (int t = 0; t < tileCount; t++) {
+            int x0 = (t % tilesX) * tileSize;
+            int y0 = (t / tilesX) * tileSize;
+            int width = std::min(tileSize, dimLon - x0);
+            int height = std::min(tileSize, dimLat - y0);
+            size_t cells = (size_t) width * height;
+            rdCopyTile(&values[0], dimLon, x0, y0, width, height, &tile[0], false);
+            if (keyframe) {
+                // difference to the cell on the left, or above at the start of a row
+                for (size_t i = 0; i < cells; i++) {
+                    previous[i] = i == 0 ? 0 : tile[i % width == 0 ? i - width : i - 1];
+                }
+            } else {
+                rdCopyTile(&state.values[0], dimLon, x0, y0, width, height, &previous[0], false);
+            }
+
+            // zigzag coded differences, low bytes first, then high bytes
+            for (size_t i = 0; i < cells; i++) {
+                uint16_t d = (uint16_t) (tile[i] - previous[i]);
+                uint16_t z = (uint16_t) ((d << 1) ^ (uint16_t) -(d >> 15));
+                bytes[i] = (unsigned char) (z & 0xFF);
+                bytes[cells + i] = (unsigned char) (z >> 8);
+            }
+
+            uLongf length = (uLongf) compressed.size();
+            if (compress2(&compressed[0], &length, &bytes[0], (uLong) (2 * cells), m_options.compressionLevel) != Z_OK) {
+                throw RDConversionException("Could not compress tile");
+            }
+            payload.insert(payload.end(), compressed.begin(), compressed.begin() + length);
+            offsets[t + 1] = (uint32_t) payload.size();
+        }
+
+        header.recordSize = sizeof(header) + offsets.size() * sizeof(uint32_t) + payload.size();
+        std::vector<unsigned char> record((size_t) header.recordSize);
+        memcpy(&record[0], &header, sizeof(header));
+        memcpy(&record[sizeof(header)], &offsets[0], offsets.size() * sizeof(uint32_t));
+        if (!payload.empty()) {
+            memcpy(&record[sizeof(header) + offsets.size() * sizeof(uint32_t)], &payload[0], payload.size());
+        }
+        off_t start = lseek(m_file, 0, SEEK_CUR);
+        if (start < 0) {
+            throw RDConversionException("Could not write to archive");
+        }
+        try {
+            rdWriteFully(m_file, &record[0], record.size());
+        } catch (const RDConversionException &) {
+            // cut off the partial record, so that the next one starts where it did
+            if (ftruncate(m_file, start) != 0 || lseek(m_file, start, SEEK_SET) < 0) {
+                throw RDConversionException("Could not write to archive nor remove the partial record");
+            }
+            throw;
+        }
+
+        state.values.swap(values);
+        state.lastTime = time;
+        state.sinceKeyframe = keyframe ? 0 : state.sinceKeyframe + 1;
+    }
+
+    void RDArchiveWriter::appendFile(const char *filename) {
+        RDScanFile scan(filename, false);
+        append(scan.get());
+    }
+
+    RDArchiveReader::RDArchiveReader(const char *path)
+            : m_data(NULL), m_size(0), m_end(0) {
+        m_file = open(path, O_RDONLY);
+        if (m_file < 0) {
+            throw RDConversionException("Could not open archive");
+        }
+
+        try {
+            struct stat st;
+            if (fstat(m_file, &st) != 0) {
+                throw RDConversionException("Could not open archive");
+            }
+            m_size = (size_t) st.st_size;
+            RDArchiveFileHeader fileHeader;
+            if (m_size < sizeof(fileHeader)) {
+                throw RDConversionException("File is not an archive");
+            }
+            void *data = mmap(NULL, m_size, PROT_READ, MAP_SHARED, m_file, 0);
+            if (data == MAP_FAILED) {
+                throw RDConversionException("Could not map archive");
+            }
+            m_data = (const unsigned char *) data;
+
+            memcpy(&fileHeader, m_data, sizeof(fileHeader));
+            if (memcmp(fileHeader.magic, RD_ARCHIVE_MAGIC, sizeof(fileHeader.magic)) != 0) {
+                throw RDConversionException("File is not an archive");
+            }
+            if (fileHeader.byteOrder != RD_ARCHIVE_BYTE_ORDER || fileHeader.version != RD_ARCHIVE_VERSION) {
+                throw RDConversionException("Archive was written with another byte order or version");
+            }
+
+            // index the records. Reading stops at an incomplete one.
+            uint64_t offset = sizeof(fileHeader);
+            RDArchiveRecordHeader header;
+            while (offset + sizeof(header) <= m_size) {
+                memcpy(&header, m_data + offset, sizeof(header));
+                uint64_t tableSize = ((uint64_t) header.tileCount + 1) * sizeof(uint32_t);
+                if (memcmp(header.magic, RD_ARCHIVE_RECORD_MAGIC, sizeof(header.magic)) != 0
+                    || header.recordSize < sizeof(header) + tableSize
+                    || header.recordSize > m_size - offset) {
+                    break;
+                }
+
+                RDScanType type = (RDScanType) header.scanType;
+                std::map<RDScanType, RDArchiveProduct>::iterator found = m_products.find(type);
+                if (found == m_products.end()) {
+                    RDArchiveProduct product;
+                    product.scanType = type;
+                    product.dimLon = header.dimLon;
+                    product.dimLat = header.dimLat;
+                    product.tileSize = header.tileSize;
+                    product.precision = header.precision;
+                    found = m_products.insert(std::make_pair(type, product)).first;
+                }
+                RDArchiveProduct &product = found->second;
+                if (header.tileSize <= 0 || header.dimLon <= 0 || header.dimLat <= 0
+                    || header.dimLon != product.dimLon || header.dimLat != product.dimLat
+                    || header.tileSize != product.tileSize || header.precision != product.precision
+                    || (int64_t) header.tileCount != (int64_t) rdTileCount(product.dimLon, product.tileSize)
+                                                     * rdTileCount(product.dimLat, product.tileSize)
+                    || (product.entries.empty() && !(header.flags & RD_ARCHIVE_KEYFRAME))
+                    || (!product.entries.empty() && header.time <= product.entries.back().time)) {
+                    throw RDConversionException("Archive is corrupt");
+                }
+
+                RDArchiveEntry entry;
+                entry.offset = offset;
+                entry.time = (time_t) header.time;
+                entry.keyframe = (header.flags & RD_ARCHIVE_KEYFRAME) != 0;
+                product.entries.push_back(entry);
+                offset += header.recordSize;
+            }
+            m_end = offset;
+        } catch (const RDConversionException &) {
+            if (m_data != NULL) munmap((void *) m_data, m_size);
+            close(m_file);
+            throw;
+        }
+    }
+
+    RDArchiveReader::~RDArchiveReader() {
+        munmap((void *) m_data, m_size);
+        close(m_file);
+    }
+
+    std::vector<RDScanType> RDArchiveReader::products() const {
+        std::vector<RDScanType> products;
+        std::map<RDScanType, RDArchiveProduct>::const_iterator pi;
+        for (pi = m_products.begin(); pi != m_products.end(); pi++) {
+            products.push_back(pi->first);
+        }
+        return products;
+    }
+
+    const RDArchiveProduct &RDArchiveReader::product(RDScanType scanType) const {
+        std::map<RDScanType, RDArchiveProduct>::const_iterator found = m_products.find(scanType);
+        if (found == m_products.end()) {
+            throw RDConversionException("Product is not in the archive");
+        }
+        return found->second;
+    }
+
+    static bool rdEntryBefore(const RDArchiveEntry &entry, time_t time) {
+        return entry.time < time;
+    }
+
+    long RDArchiveReader::find(RDScanType scanType, time_t time) const {
+        const std::vector<RDArchiveEntry> &entries = product(scanType).entries;
+        std::vector<RDArchiveEntry>::const_iterator it =
+                std::lower_bound(entries.begin(), entries.end(), time, rdEntryBefore);
+        if (it == entries.end() || it->time != time) return -1;
+        return (long) (it - entries.begin());
+    }
+
+    void RDArchiveReader::range(RDScanType scanType, time_t begin, time_t end, size_t &first, size_t &last) const {
+        const std::vector<RDArchiveEntry> &entries = product(scanType).entries;
+        first = (size_t) (std::lower_bound(entries.begin(), entries.end(), begin, rdEntryBefore) - entries.begin());
+        last = (size_t) (std::lower_bound(entries.begin() + first, entries.end(), end, rdEntryBefore) - entries.begin());
+    }
+
+    void RDArchiveReader::decodeTile(const RDArchiveEntry &entry, int tile, size_t cells, int width,
+                                     uint16_t *values, std::vector<unsigned char> &buffer) const {
+        RDArchiveRecordHeader header;
+        memcpy(&header, m_data + entry.offset, sizeof(header));
+        const unsigned char *table = m_data + entry.offset + sizeof(header);
+        const unsigned char *payload = table + ((size_t) header.tileCount + 1) * sizeof(uint32_t);
+        uint32_t begin, end;
+        memcpy(&begin, table + tile * sizeof(uint32_t), sizeof(uint32_t));
+        memcpy(&end, table + (tile + 1) * sizeof(uint32_t), sizeof(uint32_t));
+        if (begin > end || (uint64_t) (payload - m_data) + end > entry.offset + header.recordSize) {
+            throw RDConversionException("Archive is corrupt");
+        }
+
+        buffer.resize(2 * cells);
+        uLongf length = (uLongf) buffer.size();
+        if (uncompress(&buffer[0], &length, payload + begin, end - begin) != Z_OK || length != buffer.size()) {
+            throw RDConversionException("Could not decompress tile");
+        }
+
+        if (entry.keyframe) {
+            for (size_t i = 0; i < cells; i++) {
+                uint16_t z = (uint16_t) (buffer[i] | (buffer[cells + i] << 8));
+                uint16_t d = (uint16_t) ((z >> 1) ^ (uint16_t) -(z & 1));
+                uint16_t left = i == 0 ? 0 : values[i % width == 0 ? i - width : i - 1];
+                values[i] = (uint16_t) (left + d);
+            }
+        } else {
+            for (size_t i = 0; i < cells; i++) {
+                uint16_t z = (uint16_t) (buffer[i] | (buffer[cells + i] << 8));
+                uint16_t d = (uint16_t) ((z >> 1) ^ (uint16_t) -(z & 1));
+                values[i] = (uint16_t) (values[i] + d);
+            }
+        }
+    }
+
+    template<typename Callback>
+    void RDArchiveReader::decode(const RDArchiveProduct &product, size_t first, size_t last,
+                                 Callback callback) const {
+        if (first > last || last > product.entries.size()) {
+            throw RDConversionException("Scans are not in the archive");
+        }
+        if (first == last) return;
+
+        int dimLon = product.dimLon;
+        int dimLat = product.dimLat;
+        int tileSize = product.tileSize;
+        int tilesX = rdTileCount(dimLon, tileSize);
+        int tileCount = tilesX * rdTileCount(dimLat, tileSize);
+        std::vector<uint16_t> values((size_t) dimLon * dimLat);
+        std::vector<uint16_t> tile((size_t) tileSize * tileSize);
+        std::vector<unsigned char> buffer;
+
+        size_t start = first;
+        while (!product.entries[start].keyframe) start--;
+        for (size_t s = start; s < last; s++) {
+            for (int t = 0; t < tileCount; t++) {
+                int x0 = (t % tilesX) * tileSize;
+                int y0 = (t / tilesX) * tileSize;
+                int width = std::min(tileSize, dimLon - x0);
+                int height = std::min(tileSize, dimLat - y0);
+                rdCopyTile(&values[0], dimLon, x0, y0, width, height, &tile[0], false);
+                decodeTile(product.entries[s], t, (size_t) width * height, width, &tile[0], buffer);
+                rdCopyTile(&values[0], dimLon, x0, y0, width, height, &tile[0], true);
+            }
+            if (s >= first) callback(s, values);
+        }
+    }
+
+    RDScan *RDArchiveReader::allocateScan(const RDArchiveProduct &product, const RDArchiveEntry &entry,
+                                          const std::vector<uint16_t> &values) const {
+        RDArchiveRecordHeader header;
+        memcpy(&header, m_data + entry.offset, sizeof(header));
+
+        RDScan *scan = RDAllocateScan();
+        if (scan == NULL) {
+            throw RDConversionException("Could not allocate scan");
+        }
+        scan->data = (RDDataType *) malloc(values.size() * sizeof(RDDataType));
+        if (scan->data == NULL) {
+            RDFreeScan(scan);
+            throw RDConversionException("Could not allocate scan data");
+        }
+        RDDecodeCompact(product.scanType, product.precision, &values[0], values.size(), scan->data);
+
+        memset(&scan->header, 0, sizeof(scan->header));
+        scan->filename[0] = '\0';
+        scan->header.scanType = product.scanType;
+        RDSetScanTime(&scan->header, (time_t) entry.time);
+        scan->header.radarLocation = header.radarLocation;
+        scan->header.radarFormat = (RDRadarFormat) header.radarFormat;
+        scan->header.precision = header.headerPrecision;
+        scan->header.intervalDuration = (unsigned short) header.intervalDuration;
+        scan->header.predictionMinutes = header.predictionMinutes;
+        scan->header.quantification = (RDQuantification) header.quantification;
+        scan->header.radarStations = NULL;
+        memcpy(scan->header.softwareVersion, header.softwareVersion, sizeof(scan->header.softwareVersion) - 1);
+        scan->header.softwareVersion[sizeof(scan->header.softwareVersion) - 1] = '\0';
+        memcpy(scan->header.resolution, header.resolution, sizeof(scan->header.resolution) - 1);
+        scan->header.resolution[sizeof(scan->header.resolution) - 1] = '\0';
+        memcpy(scan->header.binaryFormat, header.binaryFormat, sizeof(scan->header.binaryFormat) - 1);
+        scan->header.binaryFormat[sizeof(scan->header.binaryFormat) - 1] = '\0';
+        scan->dimLon = product.dimLon;
+        scan->dimLat = product.dimLat;
+        scan->dbZPerUnit = 0;
+
+        // the extremes of the compact values, which sort like the values
+        uint16_t minimum = RD_CUBE_MAXIMUM, maximum = 0;
+        for (size_t i = 0; i < values.size(); i++) {
+            uint16_t v = values[i];
+            bool valid = v <= RD_CUBE_MAXIMUM;
+            minimum = std::min(minimum, valid ? v : RD_CUBE_MAXIMUM);
+            maximum = std::max(maximum, valid ? v : (uint16_t) 0);
+        }
+        RDDecodeCompact(product.scanType, product.precision, &minimum, 1, &scan->min_value);
+        RDDecodeCompact(product.scanType, product.precision, &maximum, 1, &scan->max_value);
+        return scan;
+    }
+
+    RDScan *RDArchiveReader::scan(RDScanType scanType, size_t index) const {
+        std::vector<RDScan *> result = scans(scanType, index, index + 1);
+        return result.front();
+    }
+
+    std::vector<RDScan *> RDArchiveReader::scans(RDScanType scanType, size_t first, size_t last) const {
+        const RDArchiveProduct &p = product(scanType);
+        std::vector<RDScan *> result;
+        try {
+            decode(p, first, last, [&](size_t s, const std::vector<uint16_t> &values) {
+                result.push_back(allocateScan(p, p.entries[s], values));
+            });
+        } catch (const RDConversionException &) {
+            for (size_t i = 0; i < result.size(); i++) RDFreeScan(result[i]);
+            throw;
+        }
+        return result;
+    }
+
+    void RDArchiveReader::tiles(RDScanType scanType, size_t first, size_t last, int tileX, int tileY,
+                                std::vector<uint16_t> &values, int &width, int &height) const {
+        const RDArchiveProduct &p = product(scanType);
+        int tilesX = rdTileCount(p.dimLon, p.tileSize);
+        int tilesY = rdTileCount(p.dimLat, p.tileSize);
+        if (tileX < 0 || tileX >= tilesX || tileY < 0 || tileY >= tilesY) {
+            throw RDConversionException("Tile is not in the grid");
+        }
+        if (first > last || last > p.entries.size()) {
+            throw RDConversionException("Scans are not in the archive");
+        }
+        width = std::min(p.tileSize, p.dimLon - tileX * p.tileSize);
+        height = std::min(p.tileSize, p.dimLat - tileY * p.tileSize);
+        size_t cells = (size_t) width * height;
+        values.resize((last - first) * cells);
+        if (first == last) return;
+
+        std::vector<uint16_t> tile(cells);
+        std::vector<unsigned char> buffer;
+        size_t start = first;
+        while (!p.entries[start].keyframe) start--;
+        for (size_t s = start; s < last; s++) {
+            decodeTile(p.entries[s], tileY * tilesX + tileX, cells, width, &tile[0], buffer);
+            if (s >= first) {
+                memcpy(&values[(s - first) * cells], &tile[0], cells * sizeof(uint16_t));
+            }
+        }
+    }
+}
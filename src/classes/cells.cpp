@@ -0,0 +1,369 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <radolan/cells.h>
+#include <radolan/grid_geometry.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+#include <radolan/scan_utils.h>
+
+namespace Radolan {
+
+    static int findRoot(std::vector<int> &parent, int x) {
+        while (parent[x] != x) {
+            // path halving
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    static void unite(std::vector<int> &parent, int a, int b) {
+        a = findRoot(parent, a);
+        b = findRoot(parent, b);
+        if (a < b) {
+            parent[b] = a;
+        } else if (b < a) {
+            parent[a] = b;
+        }
+    }
+
+    static void addToCell(RDRainCell &cell, int ix, int iy, RDDataType value) {
+        if (cell.area == 0) {
+            cell.minX = cell.maxX = ix;
+            cell.minY = cell.maxY = iy;
+            cell.maximum = value;
+            cell.maximumX = ix;
+            cell.maximumY = iy;
+        } else {
+            cell.minX = std::min(cell.minX, ix);
+            cell.maxX = std::max(cell.maxX, ix);
+            cell.maxY = iy;
+            if (value > cell.maximum) {
+                cell.maximum = value;
+                cell.maximumX = ix;
+                cell.maximumY = iy;
+            }
+        }
+        cell.area++;
+        cell.centroidX += ix;
+        cell.centroidY += iy;
+        cell.sum += value;
+    }
+
+    static void mergeCells(RDRainCell &into, const RDRainCell &cell) {
+        into.minX = std::min(into.minX, cell.minX);
+        into.minY = std::min(into.minY, cell.minY);
+        into.maxX = std::max(into.maxX, cell.maxX);
+        into.maxY = std::max(into.maxY, cell.maxY);
+        // ties go to the cell first in scan order, as in a single pass
+        if (cell.maximum > into.maximum
+            || (cell.maximum == into.maximum
+                && (cell.maximumY < into.maximumY
+                    || (cell.maximumY == into.maximumY && cell.maximumX < into.maximumX)))) {
+            into.maximum = cell.maximum;
+            into.maximumX = cell.maximumX;
+            into.maximumY = cell.maximumY;
+        }
+        into.area += cell.area;
+        into.centroidX += cell.centroidX;
+        into.centroidY += cell.centroidY;
+        into.sum += cell.sum;
+    }
+
+    int RDLabelCells(const RDScan *scan, const RDCellOptions &options, RDRainCells &result) {
+        if (options.connectivity != 4 && options.connectivity != 8) {
+            throw RDConversionException("Connectivity must be 4 or 8");
+        }
+        int dimLon = scan->dimLon;
+        int dimLat = scan->dimLat;
+        size_t count = (size_t) dimLon * dimLat;
+        result.dimLon = dimLon;
+        result.dimLat = dimLat;
+        result.labels.assign(count, -1);
+        result.cells.clear();
+
+        RDScanType type = scan->header.scanType;
+        RDDataType threshold = options.threshold;
+        bool diagonal = options.connectivity == 8;
+        std::vector<int> &labels = result.labels;
+        std::vector<int> parent;
+        std::vector<RDRainCell> provisional;
+        RDRainCell empty = {0, 0.0, 0.0, 0.0f, 0, 0, 0.0, 0, 0, 0, 0};
+
+        // first pass: provisional labels, merging with the west and south
+        // (and with 8-connectivity the south-west and south-east) neighbours
+        for (int iy = 0; iy < dimLat; iy++) {
+            const RDDataType *row = scan->data + (size_t) iy * dimLon;
+            int *rowLabels = &labels[(size_t) iy * dimLon];
+            const int *below = iy > 0 ? rowLabels - dimLon : NULL;
+            for (int ix = 0; ix < dimLon; ix++) {
+                RDDataType value = row[ix];
+                if (!(value >= threshold && RDIsCleanMeasurement(type, value))) continue;
+
+                int label = ix > 0 ? rowLabels[ix - 1] : -1;
+                if (below != NULL) {
+                    int first = diagonal ? std::max(ix - 1, 0) : ix;
+                    int last = diagonal ? std::min(ix + 1, dimLon - 1) : ix;
+                    for (int nx = first; nx <= last; nx++) {
+                        int neighbour = below[nx];
+                        if (neighbour < 0) continue;
+                        if (label < 0) {
+                            label = neighbour;
+                        } else if (neighbour != label) {
+                            unite(parent, label, neighbour);
+                        }
+                    }
+                }
+                if (label < 0) {
+                    label = (int) parent.size();
+                    parent.push_back(label);
+                    provisional.push_back(empty);
+                }
+                rowLabels[ix] = label;
+                addToCell(provisional[label], ix, iy, value);
+            }
+        }
+
+        // merge the statistics into the roots. Roots are the smallest label
+        // of their tree, so they are numbered in scan order.
+        std::vector<int> remap(parent.size(), -1);
+        for (size_t label = 0; label < parent.size(); label++) {
+            int root = findRoot(parent, (int) label);
+            if (root != (int) label) {
+                mergeCells(provisional[root], provisional[label]);
+            }
+        }
+        for (size_t label = 0; label < parent.size(); label++) {
+            int root = findRoot(parent, (int) label);
+            if (root == (int) label) {
+                RDRainCell &cell = provisional[label];
+                if (cell.area < options.minimumArea) continue;
+                cell.centroidX /= cell.area;
+                cell.centroidY /= cell.area;
+                remap[label] = (int) result.cells.size();
+                result.cells.push_back(cell);
+            } else {
+                remap[label] = remap[root];
+            }
+        }
+
+        // second pass: final labels
+        for (size_t i = 0; i < count; i++) {
+            if (labels[i] >= 0) labels[i] = remap[labels[i]];
+        }
+
+        return (int) result.cells.size();
+    }
+
+    /** Candidate match between a previous and a current cell */
+    typedef struct {
+        double score;
+        int previous;
+        int current;
+    } RDCellMatch;
+
+    static bool rdBetterOverlap(const RDCellMatch &a, const RDCellMatch &b) {
+        if (a.score != b.score) return a.score > b.score;
+        if (a.previous != b.previous) return a.previous < b.previous;
+        return a.current < b.current;
+    }
+
+    static bool rdCloser(const RDCellMatch &a, const RDCellMatch &b) {
+        if (a.score != b.score) return a.score < b.score;
+        if (a.previous != b.previous) return a.previous < b.previous;
+        return a.current < b.current;
+    }
+
+    RDCellTracker::RDCellTracker(const RDCellOptions &cellOptions,
+                                 const RDTrackerOptions &trackerOptions)
+            : m_cellOptions(cellOptions),
+              m_trackerOptions(trackerOptions),
+              m_initialized(false),
+              m_scanType(RD_RX),
+              m_dimLon(0),
+              m_dimLat(0),
+              m_cellSizeX(0),
+              m_cellSizeY(0),
+              m_lastTime(0),
+              m_nextId(1) {
+        if (cellOptions.connectivity != 4 && cellOptions.connectivity != 8) {
+            throw RDConversionException("Connectivity must be 4 or 8");
+        }
+    }
+
+    const std::vector<RDCellTrack> &RDCellTracker::ingest(const RDScan *scan) {
+        time_t time = RDScanTimeInSecondsSinceEpoch((RDScan *) scan);
+        if (!m_initialized) {
+            m_scanType = scan->header.scanType;
+            m_dimLon = scan->dimLon;
+            m_dimLat = scan->dimLat;
+            const RDGridGeometry *geometry = RDGridGeometry::forScan(scan);
+            m_cellSizeX = fabs(geometry->cornerX()[m_dimLon] - geometry->cornerX()[0]) / m_dimLon;
+            m_cellSizeY = fabs(geometry->cornerY()[m_dimLat] - geometry->cornerY()[0]) / m_dimLat;
+            m_initialized = true;
+        } else {
+            if (scan->header.scanType != m_scanType) {
+                throw RDConversionException("Scan is of a different product");
+            }
+            if (scan->dimLon != m_dimLon || scan->dimLat != m_dimLat) {
+                throw RDConversionException("Scan has a different grid");
+            }
+            if (time <= m_lastTime) {
+                throw RDConversionException("Scans must be ingested in chronological order without duplicates");
+            }
+            if (time - m_lastTime > (time_t) m_trackerOptions.maximumGapMinutes * 60) {
+                finishActiveTracks();
+            }
+        }
+
+        m_previousCells.labels.swap(m_cells.labels);
+        m_previousCells.cells.swap(m_cells.cells);
+        RDLabelCells(scan, m_cellOptions, m_cells);
+
+        const std::vector<RDRainCell> &previous = m_previousCells.cells;
+        const std::vector<RDRainCell> &current = m_cells.cells;
+        std::vector<int> matchOfCurrent(current.size(), -1);
+        std::vector<bool> previousMatched(m_active.size(), false);
+        double hours = m_active.empty() ? 0.0 : difftime(time, m_lastTime) / 3600.0;
+
+        if (!m_active.empty()) {
+            // overlapping grid cells, as (previous << 32 | current) pairs
+            m_pairs.clear();
+            const std::vector<int> &before = m_previousCells.labels;
+            const std::vector<int> &now = m_cells.labels;
+            for (size_t i = 0; i < now.size(); i++) {
+                if ((before[i] | now[i]) >= 0) {
+                    m_pairs.push_back(((uint64_t) before[i] << 32) | (uint32_t) now[i]);
+                }
+            }
+            std::sort(m_pairs.begin(), m_pairs.end());
+
+            std::vector<RDCellMatch> matches;
+            for (size_t i = 0; i < m_pairs.size();) {
+                size_t j = i;
+                while (j < m_pairs.size() && m_pairs[j] == m_pairs[i]) j++;
+                RDCellMatch match;
+                match.previous = (int) (m_pairs[i] >> 32);
+                match.current = (int) (m_pairs[i] & 0xFFFFFFFFu);
+                int smaller = std::min(previous[match.previous].area, current[match.current].area);
+                match.score = (double) (j - i) / smaller;
+                if (match.score >= m_trackerOptions.minimumOverlap) {
+                    matches.push_back(match);
+                }
+                i = j;
+            }
+            std::sort(matches.begin(), matches.end(), rdBetterOverlap);
+            for (size_t i = 0; i < matches.size(); i++) {
+                const RDCellMatch &match = matches[i];
+                if (previousMatched[match.previous] || matchOfCurrent[match.current] >= 0) continue;
+                previousMatched[match.previous] = true;
+                matchOfCurrent[match.current] = match.previous;
+            }
+
+            // remaining cells by distance to the predicted position
+            matches.clear();
+            double limit = m_trackerOptions.maximumDistance;
+            for (size_t p = 0; p < previous.size(); p++) {
+                if (previousMatched[p]) continue;
+                const RDCellTrack &track = m_active[p];
+                double predictedX = previous[p].centroidX * m_cellSizeX + track.u * hours;
+                double predictedY = previous[p].centroidY * m_cellSizeY + track.v * hours;
+                for (size_t c = 0; c < current.size(); c++) {
+                    if (matchOfCurrent[c] >= 0) continue;
+                    double dx = current[c].centroidX * m_cellSizeX - predictedX;
+                    double dy = current[c].centroidY * m_cellSizeY - predictedY;
+                    double distance = sqrt(dx * dx + dy * dy);
+                    if (distance <= limit) {
+                        RDCellMatch match = {distance, (int) p, (int) c};
+                        matches.push_back(match);
+                    }
+                }
+            }
+            std::sort(matches.begin(), matches.end(), rdCloser);
+            for (size_t i = 0; i < matches.size(); i++) {
+                const RDCellMatch &match = matches[i];
+                if (previousMatched[match.previous] || matchOfCurrent[match.current] >= 0) continue;
+                previousMatched[match.previous] = true;
+                matchOfCurrent[match.current] = match.previous;
+            }
+        }
+
+        // tracks in the order of the current cells
+        std::vector<RDCellTrack> active(current.size());
+        for (size_t c = 0; c < current.size(); c++) {
+            RDCellTrack &track = active[c];
+            int p = matchOfCurrent[c];
+            if (p >= 0) {
+                track.id = m_active[p].id;
+                track.points.swap(m_active[p].points);
+                track.u = (current[c].centroidX - previous[p].centroidX) * m_cellSizeX / hours;
+                track.v = (current[c].centroidY - previous[p].centroidY) * m_cellSizeY / hours;
+            } else {
+                track.id = m_nextId++;
+                track.u = track.v = 0.0;
+            }
+            RDTrackPoint point;
+            point.time = time;
+            point.cell = current[c];
+            track.points.push_back(point);
+        }
+        for (size_t p = 0; p < m_active.size(); p++) {
+            if (!previousMatched[p]) {
+                m_finished.push_back(RDCellTrack());
+                m_finished.back().id = m_active[p].id;
+                m_finished.back().points.swap(m_active[p].points);
+                m_finished.back().u = m_active[p].u;
+                m_finished.back().v = m_active[p].v;
+            }
+        }
+        m_active.swap(active);
+        m_lastTime = time;
+        return m_active;
+    }
+
+    const std::vector<RDCellTrack> &RDCellTracker::ingestFile(const char *filename) {
+        RDScanFile scan(filename, false);
+        ingest(scan.get());
+        return m_active;
+    }
+
+    void RDCellTracker::finishActiveTracks() {
+        m_finished.insert(m_finished.end(), m_active.begin(), m_active.end());
+        m_active.clear();
+        m_cells.labels.clear();
+        m_cells.cells.clear();
+    }
+
+    std::vector<RDCellTrack> RDCellTracker::takeFinishedTracks(bool finishActive) {
+        if (finishActive) {
+            finishActiveTracks();
+        }
+        std::vector<RDCellTrack> finished;
+        finished.swap(m_finished);
+        return finished;
+    }
+}
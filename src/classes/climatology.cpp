@@ -0,0 +1,487 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#include <radolan/climatology.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+#include <radolan/scan_utils.h>
+
+namespace Radolan {
+
+    // checkpoint file signature and version
+    static const char RD_CLIMATOLOGY_MAGIC[8] = {'R', 'D', 'C', 'L', 'I', 'M', '0', '1'};
+    static const uint32_t RD_BYTE_ORDER_MARK = 0x01020304;
+
+    /** Fixed size part of a checkpoint */
+    typedef struct {
+        char magic[8];
+        uint32_t byteOrderMark;
+        int32_t scanType;
+        int32_t dimLon;
+        int32_t dimLat;
+        float precision;
+        uint32_t intervalDuration;
+        uint32_t thresholdCount;
+        double wetThreshold;
+        uint64_t scans;
+        int64_t firstTime;
+        int64_t lastTime;
+    } RDClimatologyCheckpoint;
+
+    RDClimatology::RDClimatology(const std::vector<double> &thresholds,
+                                 double wetThreshold,
+                                 int tileRows)
+            : m_thresholds(thresholds),
+              m_wetThreshold(wetThreshold),
+              m_tileRows(tileRows),
+              m_initialized(false),
+              m_dimLon(0),
+              m_dimLat(0),
+              m_cells(0),
+              m_scans(0),
+              m_firstTime(0),
+              m_lastTime(0),
+              m_lower(0),
+              m_upper(0),
+              m_tiles(0) {
+        if (tileRows <= 0) {
+            throw RDConversionException("Tiles must have at least one row");
+        }
+        memset(&m_header, 0, sizeof(m_header));
+    }
+
+    void RDClimatology::initialize(const RDRadolanHeader &header, int dimLon, int dimLat) {
+        m_header = header;
+        m_header.radarStations = NULL;
+        m_header.numberOfRadarStations = 0;
+        m_dimLon = dimLon;
+        m_dimLat = dimLat;
+        m_cells = (size_t) dimLon * dimLat;
+
+        RDScanType type = header.scanType;
+        m_lower = RDMinValue(type);
+        // clutter and missing markers of RX and EX are the two largest values
+        m_upper = (type == RD_RX || type == RD_EX) ? RDClutterValue(type) : INFINITY;
+
+        m_tiles = ((size_t) dimLat + m_tileRows - 1) / m_tileRows;
+        std::vector<std::mutex>(m_tiles).swap(m_tileMutexes);
+        m_count.assign(m_cells, 0);
+        m_sum.assign(m_cells, 0.0);
+        m_max.assign(m_cells, -INFINITY);
+        m_wet.assign(m_cells, 0);
+        m_exceedances.assign(m_thresholds.size() * m_cells, 0);
+        m_initialized = true;
+    }
+
+    void RDClimatology::checkCompatible(RDScanType type, int dimLon, int dimLat, float precision) const {
+        if (type != m_header.scanType) {
+            throw RDConversionException("Scan is of a different product");
+        }
+        if (dimLon != m_dimLon || dimLat != m_dimLat) {
+            throw RDConversionException("Scan has a different grid");
+        }
+        if (precision != m_header.precision) {
+            throw RDConversionException("Scan has a different precision");
+        }
+    }
+
+    void RDClimatology::ingest(RDScan *scan) {
+        time_t time = RDScanTimeInSecondsSinceEpoch(scan);
+        uint64_t sequence;
+        {
+            std::lock_guard<std::mutex> lock(m_stateMutex);
+            if (!m_initialized) {
+                initialize(scan->header, scan->dimLon, scan->dimLat);
+                m_firstTime = m_lastTime = time;
+            } else {
+                checkCompatible(scan->header.scanType, scan->dimLon, scan->dimLat, scan->header.precision);
+            }
+            m_firstTime = std::min(m_firstTime, time);
+            m_lastTime = std::max(m_lastTime, time);
+            sequence = m_scans++;
+        }
+
+        // Threads start at different tiles, so they rarely wait for each other
+        for (size_t t = 0; t < m_tiles; t++) {
+            ingestTile((sequence + t) % m_tiles, scan->data);
+        }
+    }
+
+    void RDClimatology::ingestTile(size_t tile, const RDDataType *data) {
+        std::lock_guard<std::mutex> lock(m_tileMutexes[tile]);
+
+        size_t begin = tile * m_tileRows * (size_t) m_dimLon;
+        size_t end = std::min(m_cells, begin + m_tileRows * (size_t) m_dimLon);
+        const float lower = m_lower, upper = m_upper, wet = (float) m_wetThreshold;
+
+        uint32_t *count = &m_count[0];
+        double *sum = &m_sum[0];
+        float *max = &m_max[0];
+        uint32_t *wetCount = &m_wet[0];
+        for (size_t i = begin; i < end; i++) {
+            float v = data[i];
+            uint32_t isValid = (v >= lower) & (v < upper);
+            count[i] += isValid;
+            sum[i] += isValid ? v : 0.0;
+            max[i] = isValid && v > max[i] ? v : max[i];
+            wetCount[i] += isValid & (v > wet);
+        }
+
+        for (size_t k = 0; k < m_thresholds.size(); k++) {
+            const float threshold = (float) m_thresholds[k];
+            uint32_t *exceedances = &m_exceedances[k * m_cells];
+            for (size_t i = begin; i < end; i++) {
+                float v = data[i];
+                exceedances[i] += (v >= lower) & (v < upper) & (v > threshold);
+            }
+        }
+    }
+
+    void RDClimatology::ingestFile(const char *filename) {
+        RDScanFile scan(filename, false);
+        ingest(scan.get());
+    }
+
+    size_t RDClimatology::ingestFiles(const std::vector<std::string> &filenames, unsigned int threads) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        std::atomic<size_t> next(0);
+        std::atomic<size_t> skipped(0);
+        std::atomic<bool> failed(false);
+        std::mutex errorMutex;
+        std::string error;
+
+        auto work = [&]() {
+            while (!failed) {
+                size_t index = next++;
+                if (index >= filenames.size()) break;
+
+                RDScan *scan = RDAllocateScan();
+                if (scan == NULL) {
+                    skipped++;
+                    continue;
+                }
+                scan->data = NULL;
+                if (!RDReadScan(filenames[index].c_str(), scan, false)) {
+                    RDFreeScan(scan);
+                    skipped++;
+                    continue;
+                }
+                try {
+                    ingest(scan);
+                } catch (const RDConversionException &e) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!failed) {
+                        error = filenames[index] + ": " + e.what();
+                        failed = true;
+                    }
+                }
+                RDFreeScan(scan);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < threads; t++) {
+            workers.push_back(std::thread(work));
+        }
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+
+        if (failed) {
+            throw RDConversionException(error.c_str());
+        }
+        return skipped;
+    }
+
+    void RDClimatology::merge(const RDClimatology &other) {
+        if (&other == this) {
+            throw RDConversionException("Can not merge a climatology into itself");
+        }
+        if (other.m_thresholds != m_thresholds || other.m_wetThreshold != m_wetThreshold) {
+            throw RDConversionException("Climatologies have different thresholds");
+        }
+
+        // both at once, so a.merge(b) and b.merge(a) can not deadlock
+        std::unique_lock<std::mutex> lock(m_stateMutex, std::defer_lock);
+        std::unique_lock<std::mutex> otherLock(other.m_stateMutex, std::defer_lock);
+        std::lock(lock, otherLock);
+        if (!other.m_initialized) return;
+
+        if (!m_initialized) {
+            initialize(other.m_header, other.m_dimLon, other.m_dimLat);
+            m_firstTime = other.m_firstTime;
+            m_lastTime = other.m_lastTime;
+        } else {
+            checkCompatible(other.m_header.scanType, other.m_dimLon, other.m_dimLat, other.m_header.precision);
+        }
+        m_firstTime = std::min(m_firstTime, other.m_firstTime);
+        m_lastTime = std::max(m_lastTime, other.m_lastTime);
+        m_scans += other.m_scans;
+
+        // all tiles of both, since the other one may be split differently.
+        // Taken in address order, so merges in both directions agree.
+        std::vector<std::unique_lock<std::mutex> > tileLocks, otherTileLocks;
+        if (this < &other) {
+            tileLocks = lockTiles();
+            otherTileLocks = other.lockTiles();
+        } else {
+            otherTileLocks = other.lockTiles();
+            tileLocks = lockTiles();
+        }
+        for (size_t t = 0; t < m_tiles; t++) {
+            size_t begin = t * m_tileRows * (size_t) m_dimLon;
+            size_t end = std::min(m_cells, begin + m_tileRows * (size_t) m_dimLon);
+            for (size_t i = begin; i < end; i++) {
+                m_count[i] += other.m_count[i];
+                m_sum[i] += other.m_sum[i];
+                m_max[i] = std::max(m_max[i], other.m_max[i]);
+                m_wet[i] += other.m_wet[i];
+            }
+            for (size_t k = 0; k < m_thresholds.size(); k++) {
+                for (size_t i = begin; i < end; i++) {
+                    m_exceedances[k * m_cells + i] += other.m_exceedances[k * m_cells + i];
+                }
+            }
+        }
+    }
+
+    // writes an array, returns false on error
+    template<typename T>
+    static bool rdWriteArray(FILE *f, const std::vector<T> &v) {
+        return v.empty() || fwrite(&v[0], sizeof(T), v.size(), f) == v.size();
+    }
+
+    template<typename T>
+    static bool rdReadArray(FILE *f, std::vector<T> &v) {
+        return v.empty() || fread(&v[0], sizeof(T), v.size(), f) == v.size();
+    }
+
+    void RDClimatology::save(const char *path) const {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+
+        RDClimatologyCheckpoint c;
+        memset(&c, 0, sizeof(c));
+        memcpy(c.magic, RD_CLIMATOLOGY_MAGIC, sizeof(c.magic));
+        c.byteOrderMark = RD_BYTE_ORDER_MARK;
+        c.scanType = m_header.scanType;
+        c.dimLon = m_dimLon;
+        c.dimLat = m_dimLat;
+        c.precision = m_header.precision;
+        c.intervalDuration = m_header.intervalDuration;
+        c.thresholdCount = (uint32_t) m_thresholds.size();
+        c.wetThreshold = m_wetThreshold;
+        c.scans = m_scans;
+        c.firstTime = m_firstTime;
+        c.lastTime = m_lastTime;
+
+        std::string temporary = std::string(path) + ".tmp";
+        FILE *f = fopen(temporary.c_str(), "wb");
+        if (f == NULL) {
+            throw RDConversionException("Could not create checkpoint file");
+        }
+
+        // no tile must change while its arrays are written
+        std::vector<std::unique_lock<std::mutex> > tileLocks = lockTiles();
+
+        bool ok = fwrite(&c, sizeof(c), 1, f) == 1
+                  && rdWriteArray(f, m_thresholds)
+                  && rdWriteArray(f, m_count)
+                  && rdWriteArray(f, m_sum)
+                  && rdWriteArray(f, m_max)
+                  && rdWriteArray(f, m_wet)
+                  && rdWriteArray(f, m_exceedances);
+        tileLocks.clear();
+
+        ok = (fclose(f) == 0) && ok;
+        if (!ok || rename(temporary.c_str(), path) != 0) {
+            remove(temporary.c_str());
+            throw RDConversionException("Could not write checkpoint file");
+        }
+    }
+
+    void RDClimatology::load(const char *path) {
+        FILE *f = fopen(path, "rb");
+        if (f == NULL) {
+            throw RDConversionException("Could not open checkpoint file");
+        }
+
+        RDClimatologyCheckpoint c;
+        if (fread(&c, sizeof(c), 1, f) != 1
+            || memcmp(c.magic, RD_CLIMATOLOGY_MAGIC, sizeof(c.magic)) != 0
+            || c.byteOrderMark != RD_BYTE_ORDER_MARK) {
+            fclose(f);
+            throw RDConversionException("Not a climatology checkpoint of this machine");
+        }
+
+        // the sizes in the header must match the file before anything is
+        // allocated. Every term is bounded by the file size, so nothing overflows.
+        bool sizesValid = fseek(f, 0, SEEK_END) == 0;
+        uint64_t fileSize = sizesValid ? (uint64_t) ftell(f) : 0;
+        uint64_t perCell = sizeof(uint32_t) + sizeof(double) + sizeof(float) + sizeof(uint32_t)
+                           + c.thresholdCount * (uint64_t) sizeof(uint32_t);
+        uint64_t cells = 0;
+        if (c.scans > 0) {
+            sizesValid = sizesValid && c.dimLon > 0 && c.dimLat > 0;
+            cells = sizesValid ? (uint64_t) c.dimLon * (uint64_t) c.dimLat : 0;
+        }
+        sizesValid = sizesValid
+                     && c.thresholdCount <= fileSize / sizeof(double)
+                     && cells <= fileSize / perCell
+                     && fileSize == sizeof(c) + c.thresholdCount * (uint64_t) sizeof(double) + cells * perCell
+                     && fseek(f, sizeof(c), SEEK_SET) == 0;
+        if (!sizesValid) {
+            fclose(f);
+            throw RDConversionException("Checkpoint file is truncated or has a corrupt grid size");
+        }
+
+        std::vector<double> thresholds(c.thresholdCount);
+        if (!rdReadArray(f, thresholds)) {
+            fclose(f);
+            throw RDConversionException("Checkpoint file is truncated");
+        }
+
+        RDClimatology saved(thresholds, c.wetThreshold, m_tileRows);
+        if (c.scans > 0) {
+            RDRadolanHeader header;
+            memset(&header, 0, sizeof(header));
+            header.scanType = (RDScanType) c.scanType;
+            header.precision = c.precision;
+            header.intervalDuration = (unsigned short) c.intervalDuration;
+            saved.initialize(header, c.dimLon, c.dimLat);
+            saved.m_scans = c.scans;
+            saved.m_firstTime = (time_t) c.firstTime;
+            saved.m_lastTime = (time_t) c.lastTime;
+
+            bool ok = rdReadArray(f, saved.m_count)
+                      && rdReadArray(f, saved.m_sum)
+                      && rdReadArray(f, saved.m_max)
+                      && rdReadArray(f, saved.m_wet)
+                      && rdReadArray(f, saved.m_exceedances);
+            if (!ok) {
+                fclose(f);
+                throw RDConversionException("Checkpoint file is truncated");
+            }
+        }
+        fclose(f);
+
+        merge(saved);
+    }
+
+    std::vector<std::unique_lock<std::mutex> > RDClimatology::lockTiles() const {
+        std::vector<std::unique_lock<std::mutex> > locks;
+        for (size_t t = 0; t < m_tiles; t++) {
+            locks.push_back(std::unique_lock<std::mutex>(m_tileMutexes[t]));
+        }
+        return locks;
+    }
+
+    uint64_t RDClimatology::scanCount() const {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        return m_scans;
+    }
+
+    time_t RDClimatology::firstTime() const {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        return m_firstTime;
+    }
+
+    time_t RDClimatology::lastTime() const {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        return m_lastTime;
+    }
+
+    RDScan *RDClimatology::allocateResult() const {
+        if (!m_initialized) {
+            throw RDConversionException("No scans were ingested");
+        }
+        return RDAllocateResultScan(m_header, m_dimLon, m_dimLat, m_lastTime);
+    }
+
+    RDScan *RDClimatology::mean() const {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        RDScan *result = allocateResult();
+        std::vector<std::unique_lock<std::mutex> > tileLocks = lockTiles();
+        RDDataType missing = RDMissingValue(m_header.scanType);
+        for (size_t i = 0; i < m_cells; i++) {
+            result->data[i] = m_count[i] > 0 ? (RDDataType) (m_sum[i] / m_count[i]) : missing;
+        }
+        return result;
+    }
+
+    RDScan *RDClimatology::maximum() const {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        RDScan *result = allocateResult();
+        std::vector<std::unique_lock<std::mutex> > tileLocks = lockTiles();
+        RDDataType missing = RDMissingValue(m_header.scanType);
+        for (size_t i = 0; i < m_cells; i++) {
+            result->data[i] = m_count[i] > 0 ? m_max[i] : missing;
+        }
+        return result;
+    }
+
+    RDScan *RDClimatology::wetFraction() const {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        RDScan *result = allocateResult();
+        std::vector<std::unique_lock<std::mutex> > tileLocks = lockTiles();
+        RDDataType missing = RDMissingValue(m_header.scanType);
+        for (size_t i = 0; i < m_cells; i++) {
+            result->data[i] = m_count[i] > 0 ? (RDDataType) m_wet[i] / m_count[i] : missing;
+        }
+        return result;
+    }
+
+    RDScan *RDClimatology::validCount() const {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        RDScan *result = allocateResult();
+        std::vector<std::unique_lock<std::mutex> > tileLocks = lockTiles();
+        for (size_t i = 0; i < m_cells; i++) {
+            result->data[i] = (RDDataType) m_count[i];
+        }
+        return result;
+    }
+
+    RDScan *RDClimatology::exceedanceCount(size_t threshold) const {
+        if (threshold >= m_thresholds.size()) {
+            throw RDConversionException("No such threshold");
+        }
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        RDScan *result = allocateResult();
+        std::vector<std::unique_lock<std::mutex> > tileLocks = lockTiles();
+        RDDataType missing = RDMissingValue(m_header.scanType);
+        const uint32_t *exceedances = &m_exceedances[threshold * m_cells];
+        for (size_t i = 0; i < m_cells; i++) {
+            result->data[i] = m_count[i] > 0 ? (RDDataType) exceedances[i] : missing;
+        }
+        return result;
+    }
+}
@@ -164,6 +164,17 @@ namespace Radolan
         return rdCartesianPoint(m_originCartesian.x + dx, m_originCartesian.y + dy);
     }
 
+    RDCartesianPoint RDCoordinateSystem::cartesianCornerCoordinate(RDGridPoint corner) {
+        // the lower left corner of cell (0,0) is m_offset away from the origin
+        return rdCartesianPoint(m_originCartesian.x + (corner.ix - m_offset.x) * MESH_WIDTH,
+                                m_originCartesian.y + (corner.iy - m_offset.y) * MESH_WIDTH);
+    }
+
+    RDCartesianPoint RDCoordinateSystem::cartesianCentreCoordinate(RDGridPoint cell) {
+        return rdCartesianPoint(m_originCartesian.x + (cell.ix + 0.5 - m_offset.x) * MESH_WIDTH,
+                                m_originCartesian.y + (cell.iy + 0.5 - m_offset.y) * MESH_WIDTH);
+    }
+
     RDGeographicalPointRad RDCoordinateSystem::geographicalCoordinateRad(RDCartesianPoint p) {
         static double b_lambda_0 = rad(LAMBDA_0);
         static double b_phi_0 = rad(PHI_0);
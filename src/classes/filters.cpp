@@ -0,0 +1,275 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <string.h>
+#include <thread>
+
+#include <radolan/filters.h>
+#include <radolan/radolan_utils.h>
+
+namespace Radolan {
+
+    RDScanFilter::RDScanFilter(unsigned int threads, int tileRows)
+            : m_threads(threads),
+              m_tileRows(std::max(1, tileRows)) {
+        if (m_threads == 0) {
+            m_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+    }
+
+    void RDScanFilter::forEachBand(int dimLat, const std::function<void(int, int)> &work) const {
+        int bands = (dimLat + m_tileRows - 1) / m_tileRows;
+        unsigned int threads = std::min(m_threads, (unsigned int) std::max(bands, 1));
+        std::atomic<int> next(0);
+        auto worker = [&]() {
+            for (int band = next++; band < bands; band = next++) {
+                work(band * m_tileRows, std::min(dimLat, (band + 1) * m_tileRows));
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned int t = 1; t < threads; t++) {
+            workers.push_back(std::thread(worker));
+        }
+        worker();
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+    }
+
+    void RDScanFilter::prepare(const RDScan *source, RDScan *target, float invalidValue) {
+        if (source->dimLon != target->dimLon || source->dimLat != target->dimLat) {
+            throw RDConversionException("Source and target have different grids");
+        }
+        size_t count = (size_t) source->dimLon * source->dimLat;
+        m_values.resize(count);
+        m_weights.resize(count);
+        m_rowValues.resize(count);
+        m_rowWeights.resize(count);
+
+        RDScanType type = source->header.scanType;
+        const RDDataType minValue = RDMinValue(type);
+        const RDDataType maxValue = RDMaxValue(type);
+        const RDDataType missingValue = RDMissingValue(type);
+        const RDDataType clutterValue = RDClutterValue(type);
+        const int dimLon = source->dimLon;
+        const RDDataType *data = source->data;
+        float *values = &m_values[0];
+        float *weights = &m_weights[0];
+
+        forEachBand(source->dimLat, [=](int begin, int end) {
+            for (size_t i = (size_t) begin * dimLon; i < (size_t) end * dimLon; i++) {
+                RDDataType v = data[i];
+                bool clean = v >= minValue && v <= maxValue && v != missingValue && v != clutterValue;
+                values[i] = clean ? v : invalidValue;
+                weights[i] = clean ? 1.0f : 0.0f;
+            }
+        });
+    }
+
+    void RDScanFilter::updateRange(RDScan *target) const {
+        size_t count = (size_t) target->dimLon * target->dimLat;
+        bool first = true;
+        for (size_t i = 0; i < count; i++) {
+            if (m_weights[i] == 0.0f) continue;
+            RDDataType v = target->data[i];
+            if (first || v < target->min_value) target->min_value = v;
+            if (first || v > target->max_value) target->max_value = v;
+            first = false;
+        }
+    }
+
+    void RDScanFilter::gaussian(RDScan *scan, float sigma) {
+        gaussian(scan, scan, sigma);
+    }
+
+    void RDScanFilter::gaussian(const RDScan *source, RDScan *target, float sigma) {
+        prepare(source, target, 0.0f);
+        const int dimLon = source->dimLon;
+        const int dimLat = source->dimLat;
+        const int radius = std::max(0, (int) ceil(3.0f * sigma));
+        std::vector<float> kernel(2 * radius + 1, 1.0f);
+        for (int k = -radius; k <= radius && sigma > 0.0f; k++) {
+            kernel[k + radius] = expf(-0.5f * k * k / (sigma * sigma));
+        }
+
+        // along the rows, from zero padded copies
+        forEachBand(dimLat, [&](int begin, int end) {
+            std::vector<float> paddedValues(dimLon + 2 * radius, 0.0f);
+            std::vector<float> paddedWeights(dimLon + 2 * radius, 0.0f);
+            for (int iy = begin; iy < end; iy++) {
+                size_t row = (size_t) iy * dimLon;
+                std::copy(&m_values[row], &m_values[row] + dimLon, &paddedValues[radius]);
+                std::copy(&m_weights[row], &m_weights[row] + dimLon, &paddedWeights[radius]);
+                float *sums = &m_rowValues[row];
+                float *weights = &m_rowWeights[row];
+                std::fill(sums, sums + dimLon, 0.0f);
+                std::fill(weights, weights + dimLon, 0.0f);
+                for (int k = 0; k <= 2 * radius; k++) {
+                    const float w = kernel[k];
+                    const float *v = &paddedValues[k];
+                    const float *c = &paddedWeights[k];
+                    for (int ix = 0; ix < dimLon; ix++) {
+                        sums[ix] += w * v[ix];
+                        weights[ix] += w * c[ix];
+                    }
+                }
+            }
+        });
+
+        // along the columns, normalized by the weights of the clean cells
+        const RDDataType *data = source->data;
+        RDDataType *out = target->data;
+        forEachBand(dimLat, [&](int begin, int end) {
+            std::vector<float> sums(dimLon), weights(dimLon);
+            for (int iy = begin; iy < end; iy++) {
+                std::fill(sums.begin(), sums.end(), 0.0f);
+                std::fill(weights.begin(), weights.end(), 0.0f);
+                for (int k = std::max(-radius, -iy); k <= std::min(radius, dimLat - 1 - iy); k++) {
+                    const float w = kernel[k + radius];
+                    const float *v = &m_rowValues[(size_t) (iy + k) * dimLon];
+                    const float *c = &m_rowWeights[(size_t) (iy + k) * dimLon];
+                    for (int ix = 0; ix < dimLon; ix++) {
+                        sums[ix] += w * v[ix];
+                        weights[ix] += w * c[ix];
+                    }
+                }
+                size_t row = (size_t) iy * dimLon;
+                const float *clean = &m_weights[row];
+                const RDDataType *in = data + row;
+                RDDataType *result = out + row;
+                // clean cells have a weight of at least 1 from themselves,
+                // the others are not used
+                for (int ix = 0; ix < dimLon; ix++) {
+                    sums[ix] /= weights[ix] + 1e-30f;
+                }
+                for (int ix = 0; ix < dimLon; ix++) {
+                    float smoothed = sums[ix];
+                    float original = in[ix];
+                    result[ix] = clean[ix] > 0.0f ? smoothed : original;
+                }
+            }
+        });
+        updateRange(target);
+    }
+
+    void RDScanFilter::maximum(RDScan *scan, int window) {
+        maximum(scan, scan, window);
+    }
+
+    void RDScanFilter::maximum(const RDScan *source, RDScan *target, int window) {
+        if (window <= 0 || window % 2 == 0) {
+            throw RDConversionException("Window size must be odd and positive");
+        }
+        prepare(source, target, -INFINITY);
+        const int dimLon = source->dimLon;
+        const int dimLat = source->dimLat;
+        const int radius = window / 2;
+
+        forEachBand(dimLat, [&](int begin, int end) {
+            std::vector<float> padded(dimLon + 2 * radius, -INFINITY);
+            for (int iy = begin; iy < end; iy++) {
+                size_t row = (size_t) iy * dimLon;
+                std::copy(&m_values[row], &m_values[row] + dimLon, &padded[radius]);
+                float *maxima = &m_rowValues[row];
+                std::copy(&padded[0], &padded[0] + dimLon, maxima);
+                for (int k = 1; k < window; k++) {
+                    const float *v = &padded[k];
+                    for (int ix = 0; ix < dimLon; ix++) {
+                        maxima[ix] = v[ix] > maxima[ix] ? v[ix] : maxima[ix];
+                    }
+                }
+            }
+        });
+
+        const RDDataType *data = source->data;
+        RDDataType *out = target->data;
+        forEachBand(dimLat, [&](int begin, int end) {
+            std::vector<float> maxima(dimLon);
+            for (int iy = begin; iy < end; iy++) {
+                std::fill(maxima.begin(), maxima.end(), -INFINITY);
+                for (int k = std::max(-radius, -iy); k <= std::min(radius, dimLat - 1 - iy); k++) {
+                    const float *v = &m_rowValues[(size_t) (iy + k) * dimLon];
+                    for (int ix = 0; ix < dimLon; ix++) {
+                        maxima[ix] = v[ix] > maxima[ix] ? v[ix] : maxima[ix];
+                    }
+                }
+                size_t row = (size_t) iy * dimLon;
+                const float *clean = &m_weights[row];
+                const RDDataType *in = data + row;
+                RDDataType *result = out + row;
+                for (int ix = 0; ix < dimLon; ix++) {
+                    float maximum = maxima[ix];
+                    float original = in[ix];
+                    result[ix] = clean[ix] > 0.0f ? maximum : original;
+                }
+            }
+        });
+        updateRange(target);
+    }
+
+    void RDScanFilter::median(RDScan *scan, int window) {
+        median(scan, scan, window);
+    }
+
+    void RDScanFilter::median(const RDScan *source, RDScan *target, int window) {
+        if (window <= 0 || window % 2 == 0) {
+            throw RDConversionException("Window size must be odd and positive");
+        }
+        prepare(source, target, 0.0f);
+        const int dimLon = source->dimLon;
+        const int dimLat = source->dimLat;
+        const int radius = window / 2;
+
+        // the values are read from m_values, so the target may be the source
+        const RDDataType *data = source->data;
+        RDDataType *out = target->data;
+        forEachBand(dimLat, [&](int begin, int end) {
+            std::vector<float> neighbours((size_t) window * window);
+            for (int iy = begin; iy < end; iy++) {
+                int y0 = std::max(0, iy - radius), y1 = std::min(dimLat - 1, iy + radius);
+                for (int ix = 0; ix < dimLon; ix++) {
+                    size_t i = (size_t) iy * dimLon + ix;
+                    if (m_weights[i] == 0.0f) {
+                        out[i] = data[i];
+                        continue;
+                    }
+                    int x0 = std::max(0, ix - radius), x1 = std::min(dimLon - 1, ix + radius);
+                    size_t n = 0;
+                    for (int y = y0; y <= y1; y++) {
+                        const float *values = &m_values[(size_t) y * dimLon];
+                        const float *weights = &m_weights[(size_t) y * dimLon];
+                        for (int x = x0; x <= x1; x++) {
+                            if (weights[x] > 0.0f) neighbours[n++] = values[x];
+                        }
+                    }
+                    std::nth_element(neighbours.begin(), neighbours.begin() + n / 2, neighbours.begin() + n);
+                    out[i] = neighbours[n / 2];
+                }
+            }
+        });
+        updateRange(target);
+    }
+}
@@ -0,0 +1,586 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <radolan/flatgeobuf_converter.h>
+#include <radolan/grid_geometry.h>
+#include <radolan/radolan_utils.h>
+
+namespace Radolan {
+
+    // Magic bytes of FlatGeobuf version 3
+    static const uint8_t FGB_MAGIC[8] = {0x66, 0x67, 0x62, 0x03, 0x66, 0x67, 0x62, 0x00};
+
+    // Fan-out of the packed R-tree
+    static const uint64_t FGB_NODE_SIZE = 16;
+
+    // Size of a serialized R-tree node: 4 doubles and a 64 bit offset
+    static const size_t FGB_NODE_ITEM_SIZE = 40;
+
+    // Values of the GeometryType and ColumnType enums in the FlatGeobuf schema
+    static const uint8_t FGB_GEOMETRY_POINT = 1;
+    static const uint8_t FGB_GEOMETRY_POLYGON = 3;
+    static const uint8_t FGB_COLUMN_FLOAT = 9;
+    static const uint8_t FGB_COLUMN_DATETIME = 13;
+
+    // The RADOLAN polar stereographic projection (units km, spherical earth)
+    static const char *RADOLAN_WKT =
+            "PROJCS[\"RADOLAN polar stereographic\","
+            "GEOGCS[\"RADOLAN sphere\","
+            "DATUM[\"RADOLAN sphere\",SPHEROID[\"Sphere\",6370040,0]],"
+            "PRIMEM[\"Greenwich\",0],"
+            "UNIT[\"degree\",0.0174532925199433]],"
+            "PROJECTION[\"Polar_Stereographic\"],"
+            "PARAMETER[\"latitude_of_origin\",60],"
+            "PARAMETER[\"central_meridian\",10],"
+            "PARAMETER[\"scale_factor\",1],"
+            "PARAMETER[\"false_easting\",0],"
+            "PARAMETER[\"false_northing\",0],"
+            "UNIT[\"kilometre\",1000]]";
+
+    /**
+     * A field of a flatbuffers table. Offset fields (references to strings,
+     * vectors or tables) are written as 4 byte placeholders and patched once
+     * the referenced object has been written.
+     */
+    typedef struct {
+        int slot;
+        size_t bytes;
+        uint64_t bits;
+        size_t position;
+    } RDFlatField;
+
+    static RDFlatField rdFlatField(int slot, size_t bytes, uint64_t bits) {
+        RDFlatField f = {slot, bytes, bits, 0};
+        return f;
+    }
+
+    static RDFlatField rdFlatOffsetField(int slot) {
+        return rdFlatField(slot, 4, 0);
+    }
+
+    static uint64_t doubleBits(double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    static uint32_t floatBits(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    /**
+     * Minimal size prefixed flatbuffers serializer. Unlike the flatbuffers
+     * library it lays objects out front to back: a table is followed by the
+     * objects it refers to, so all offsets point forward as the format
+     * requires. Scalars are written little endian and aligned relative to
+     * the start of the buffer (including the size prefix).
+     */
+    class RDFlatBuffer {
+    public:
+
+        /** Starts a new buffer with room for the size prefix and the root offset */
+        void reset() {
+            m_data.assign(8, 0);
+        }
+
+        size_t size() const { return m_data.size(); }
+
+        const uint8_t *data() const { return &m_data[0]; }
+
+        /** Pads until (size + extra) is a multiple of alignment */
+        void align(size_t alignment, size_t extra = 0) {
+            while ((m_data.size() + extra) % alignment != 0) m_data.push_back(0);
+        }
+
+        size_t putScalar(uint64_t bits, size_t bytes) {
+            align(bytes);
+            size_t position = m_data.size();
+            for (size_t i = 0; i < bytes; i++) m_data.push_back((uint8_t) (bits >> (8 * i)));
+            return position;
+        }
+
+        void patch(size_t position, uint64_t bits, size_t bytes) {
+            for (size_t i = 0; i < bytes; i++) m_data[position + i] = (uint8_t) (bits >> (8 * i));
+        }
+
+        void patchOffset(size_t field, size_t target) {
+            patch(field, target - field, 4);
+        }
+
+        size_t putString(const std::string &s) {
+            size_t position = putScalar(s.size(), 4);
+            m_data.insert(m_data.end(), s.begin(), s.end());
+            m_data.push_back(0);
+            return position;
+        }
+
+        size_t putBytes(const std::vector<uint8_t> &bytes) {
+            size_t position = putScalar(bytes.size(), 4);
+            m_data.insert(m_data.end(), bytes.begin(), bytes.end());
+            return position;
+        }
+
+        size_t putDoubles(const double *values, size_t count) {
+            align(8, 4);
+            size_t position = putScalar(count, 4);
+            for (size_t i = 0; i < count; i++) putScalar(doubleBits(values[i]), 8);
+            return position;
+        }
+
+        /** Writes a vector of offsets. The element positions are returned for patching */
+        size_t putOffsets(size_t count, std::vector<size_t> &elements) {
+            size_t position = putScalar(count, 4);
+            for (size_t i = 0; i < count; i++) elements.push_back(putScalar(0, 4));
+            return position;
+        }
+
+        /**
+         * Writes a vtable followed by its table. Fields are stored largest
+         * first to keep padding small.
+         *
+         * @param fields fields to write, their positions are filled in
+         * @param slots number of slots in the table's schema
+         * @return position of the table
+         */
+        size_t putTable(std::vector<RDFlatField> &fields, int slots) {
+            align(2);
+            size_t vtable = putScalar(4 + 2 * slots, 2);
+            putScalar(0, 2);
+            for (int i = 0; i < slots; i++) putScalar(0, 2);
+
+            align(4);
+            size_t table = putScalar(0, 4);
+            for (size_t bytes = 8; bytes > 0; bytes /= 2) {
+                for (size_t i = 0; i < fields.size(); i++) {
+                    if (fields[i].bytes != bytes) continue;
+                    fields[i].position = putScalar(fields[i].bits, bytes);
+                    patch(vtable + 4 + 2 * fields[i].slot, fields[i].position - table, 2);
+                }
+            }
+            patch(vtable + 2, m_data.size() - table, 2);
+            patch(table, table - vtable, 4);
+            return table;
+        }
+
+        /** Sets the root table and the size prefix */
+        void finish(size_t root) {
+            patchOffset(4, root);
+            align(8);
+            patch(0, m_data.size() - 4, 4);
+        }
+
+    private:
+        std::vector<uint8_t> m_data;
+    };
+
+    // Position on a 16 bit Hilbert curve (after flatbush / flatgeobuf)
+    static uint32_t hilbert(uint32_t x, uint32_t y) {
+        uint32_t a = x ^ y;
+        uint32_t b = 0xFFFF ^ a;
+        uint32_t c = 0xFFFF ^ (x | y);
+        uint32_t d = x & (y ^ 0xFFFF);
+
+        uint32_t A = a | (b >> 1);
+        uint32_t B = (a >> 1) ^ a;
+        uint32_t C = ((c >> 1) ^ (b & (d >> 1))) ^ c;
+        uint32_t D = ((a & (c >> 1)) ^ (d >> 1)) ^ d;
+
+        a = A; b = B; c = C; d = D;
+        A = ((a & (a >> 2)) ^ (b & (b >> 2)));
+        B = ((a & (b >> 2)) ^ (b & ((a ^ b) >> 2)));
+        C ^= ((a & (c >> 2)) ^ (b & (d >> 2)));
+        D ^= ((b & (c >> 2)) ^ ((a ^ b) & (d >> 2)));
+
+        a = A; b = B; c = C; d = D;
+        A = ((a & (a >> 4)) ^ (b & (b >> 4)));
+        B = ((a & (b >> 4)) ^ (b & ((a ^ b) >> 4)));
+        C ^= ((a & (c >> 4)) ^ (b & (d >> 4)));
+        D ^= ((b & (c >> 4)) ^ ((a ^ b) & (d >> 4)));
+
+        a = A; b = B; c = C; d = D;
+        C ^= ((a & (c >> 8)) ^ (b & (d >> 8)));
+        D ^= ((b & (c >> 8)) ^ ((a ^ b) & (d >> 8)));
+
+        a = C ^ (C >> 1);
+        b = D ^ (D >> 1);
+
+        uint32_t i0 = x ^ y;
+        uint32_t i1 = b | (0xFFFF ^ (i0 | a));
+
+        i0 = (i0 | (i0 << 8)) & 0x00FF00FF;
+        i0 = (i0 | (i0 << 4)) & 0x0F0F0F0F;
+        i0 = (i0 | (i0 << 2)) & 0x33333333;
+        i0 = (i0 | (i0 << 1)) & 0x55555555;
+
+        i1 = (i1 | (i1 << 8)) & 0x00FF00FF;
+        i1 = (i1 | (i1 << 4)) & 0x0F0F0F0F;
+        i1 = (i1 | (i1 << 2)) & 0x33333333;
+        i1 = (i1 | (i1 << 1)) & 0x55555555;
+
+        return (i1 << 1) | i0;
+    }
+
+    /** Bounding box, also the node type of the R-tree */
+    typedef struct {
+        double minX;
+        double minY;
+        double maxX;
+        double maxY;
+        uint64_t offset;
+    } RDNodeItem;
+
+    static RDNodeItem rdEmptyNodeItem(uint64_t offset) {
+        RDNodeItem n = {HUGE_VAL, HUGE_VAL, -HUGE_VAL, -HUGE_VAL, offset};
+        return n;
+    }
+
+    static void expand(RDNodeItem &n, const RDNodeItem &other) {
+        n.minX = std::min(n.minX, other.minX);
+        n.minY = std::min(n.minY, other.minY);
+        n.maxX = std::max(n.maxX, other.maxX);
+        n.maxY = std::max(n.maxY, other.maxY);
+    }
+
+    /** A feature in the order of the grid */
+    typedef struct {
+        uint32_t cell;
+        uint32_t hilbert;
+        uint32_t size;
+    } RDFeatureItem;
+
+    static bool compareHilbert(const RDFeatureItem &a, const RDFeatureItem &b) {
+        if (a.hilbert != b.hilbert) return a.hilbert > b.hilbert;
+        return a.cell < b.cell;
+    }
+
+    /** Computes the vertices of the feature of a cell from the cached grid geometry */
+    class RDCellGeometry {
+    public:
+        RDCellGeometry(const RDGridGeometry *grid, bool polygons, bool geographic)
+                : m_grid(grid), m_polygons(polygons), m_geographic(geographic) {
+            if (geographic) {
+                m_lon = polygons ? grid->cornerLongitudes() : grid->centreLongitudes();
+                m_lat = polygons ? grid->cornerLatitudes() : grid->centreLatitudes();
+            }
+        }
+
+        /**
+         * @param cell cell index
+         * @param xy receives up to 5 interleaved vertices
+         * @param bounds receives the bounding box
+         * @return number of vertices
+         */
+        size_t vertices(uint32_t cell, double *xy, RDNodeItem &bounds) const {
+            int ix = cell % m_grid->dimLon();
+            int iy = cell / m_grid->dimLon();
+            size_t count;
+            if (!m_polygons) {
+                if (m_geographic) {
+                    xy[0] = m_lon[cell];
+                    xy[1] = m_lat[cell];
+                } else {
+                    xy[0] = m_grid->centreX()[ix];
+                    xy[1] = m_grid->centreY()[iy];
+                }
+                count = 1;
+            } else {
+                // bottom left, top left, top right, bottom right and back
+                const int dx[5] = {0, 0, 1, 1, 0};
+                const int dy[5] = {0, 1, 1, 0, 0};
+                size_t stride = (size_t) m_grid->dimLon() + 1;
+                for (int k = 0; k < 5; k++) {
+                    if (m_geographic) {
+                        size_t i = (iy + dy[k]) * stride + ix + dx[k];
+                        xy[2 * k] = m_lon[i];
+                        xy[2 * k + 1] = m_lat[i];
+                    } else {
+                        xy[2 * k] = m_grid->cornerX()[ix + dx[k]];
+                        xy[2 * k + 1] = m_grid->cornerY()[iy + dy[k]];
+                    }
+                }
+                count = 5;
+            }
+            bounds = rdEmptyNodeItem(0);
+            for (size_t k = 0; k < count; k++) {
+                RDNodeItem p = {xy[2 * k], xy[2 * k + 1], xy[2 * k], xy[2 * k + 1], 0};
+                expand(bounds, p);
+            }
+            return count;
+        }
+
+    private:
+        const RDGridGeometry *m_grid;
+        bool m_polygons;
+        bool m_geographic;
+        const double *m_lon;
+        const double *m_lat;
+    };
+
+    // Properties of a feature: column index (ushort) followed by the value.
+    // Strings and date-times are prefixed by their length (uint).
+    static void encodeProperties(std::vector<uint8_t> &properties, float value, const std::string &time) {
+        uint32_t bits = floatBits(value);
+        uint32_t length = (uint32_t) time.size();
+        properties.resize(12 + time.size());
+        properties[0] = 0;
+        properties[1] = 0;
+        for (int b = 0; b < 4; b++) properties[2 + b] = (uint8_t) (bits >> (8 * b));
+        properties[6] = 1;
+        properties[7] = 0;
+        for (int b = 0; b < 4; b++) properties[8 + b] = (uint8_t) (length >> (8 * b));
+        std::copy(time.begin(), time.end(), properties.begin() + 12);
+    }
+
+    static void serializeFeature(RDFlatBuffer &fb, const double *xy, size_t vertices,
+                                 const std::vector<uint8_t> &properties) {
+        fb.reset();
+
+        // Feature: geometry (0), properties (1), columns (2)
+        std::vector<RDFlatField> feature;
+        feature.push_back(rdFlatOffsetField(0));
+        feature.push_back(rdFlatOffsetField(1));
+        size_t root = fb.putTable(feature, 3);
+
+        // Geometry: ends (0), xy (1), z, m, t, tm, type, parts. Single ring
+        // polygons need no ends and the type is given in the header
+        std::vector<RDFlatField> geometry;
+        geometry.push_back(rdFlatOffsetField(1));
+        fb.patchOffset(feature[0].position, fb.putTable(geometry, 8));
+        fb.patchOffset(geometry[0].position, fb.putDoubles(xy, 2 * vertices));
+
+        fb.patchOffset(feature[1].position, fb.putBytes(properties));
+        fb.finish(root);
+    }
+
+    static void serializeColumn(RDFlatBuffer &fb, size_t element, const char *name, uint8_t type) {
+        // Column: name (0), type (1), ...
+        std::vector<RDFlatField> column;
+        column.push_back(rdFlatOffsetField(0));
+        column.push_back(rdFlatField(1, 1, type));
+        fb.patchOffset(element, fb.putTable(column, 11));
+        fb.patchOffset(column[0].position, fb.putString(name));
+    }
+
+    static void serializeHeader(RDFlatBuffer &fb, RDScan *scan, bool polygons, bool geographic,
+                                const RDNodeItem &extent, uint64_t featureCount) {
+        fb.reset();
+
+        // Header: name (0), envelope (1), geometry_type (2), has_z .. has_tm (3-6),
+        // columns (7), features_count (8), index_node_size (9), crs (10), ...
+        std::vector<RDFlatField> header;
+        header.push_back(rdFlatOffsetField(0));
+        if (featureCount > 0) header.push_back(rdFlatOffsetField(1));
+        header.push_back(rdFlatField(2, 1, polygons ? FGB_GEOMETRY_POLYGON : FGB_GEOMETRY_POINT));
+        header.push_back(rdFlatOffsetField(7));
+        header.push_back(rdFlatField(8, 8, featureCount));
+        header.push_back(rdFlatField(9, 2, featureCount > 0 ? FGB_NODE_SIZE : 0));
+        header.push_back(rdFlatOffsetField(10));
+        size_t root = fb.putTable(header, 14);
+
+        size_t field = 0;
+        fb.patchOffset(header[field++].position, fb.putString(RDScanTypeToString(scan->header.scanType)));
+
+        if (featureCount > 0) {
+            const double envelope[4] = {extent.minX, extent.minY, extent.maxX, extent.maxY};
+            fb.patchOffset(header[field++].position, fb.putDoubles(envelope, 4));
+        }
+        field++;
+
+        std::vector<size_t> columns;
+        fb.patchOffset(header[field++].position, fb.putOffsets(2, columns));
+        serializeColumn(fb, columns[0], "value", FGB_COLUMN_FLOAT);
+        serializeColumn(fb, columns[1], "time", FGB_COLUMN_DATETIME);
+        field += 2;
+
+        // Crs: org (0), code (1), name (2), description (3), wkt (4), code_string (5)
+        std::vector<RDFlatField> crs;
+        crs.push_back(rdFlatOffsetField(geographic ? 0 : 2));
+        crs.push_back(geographic ? rdFlatField(1, 4, 4326) : rdFlatOffsetField(4));
+        fb.patchOffset(header[field].position, fb.putTable(crs, 6));
+        if (geographic) {
+            fb.patchOffset(crs[0].position, fb.putString("EPSG"));
+        } else {
+            fb.patchOffset(crs[0].position, fb.putString("RADOLAN polar stereographic"));
+            fb.patchOffset(crs[1].position, fb.putString(RADOLAN_WKT));
+        }
+
+        fb.finish(root);
+    }
+
+    // Start and end index of the nodes of each tree level, leaves first
+    static std::vector<std::pair<uint64_t, uint64_t> > levelBounds(uint64_t numItems) {
+        std::vector<uint64_t> levelNumNodes;
+        uint64_t n = numItems;
+        uint64_t numNodes = n;
+        levelNumNodes.push_back(n);
+        do {
+            n = (n + FGB_NODE_SIZE - 1) / FGB_NODE_SIZE;
+            numNodes += n;
+            levelNumNodes.push_back(n);
+        } while (n != 1);
+
+        std::vector<std::pair<uint64_t, uint64_t> > bounds;
+        n = numNodes;
+        for (size_t i = 0; i < levelNumNodes.size(); i++) {
+            n -= levelNumNodes[i];
+            bounds.push_back(std::make_pair(n, n + levelNumNodes[i]));
+        }
+        return bounds;
+    }
+
+    static void writeOrThrow(FILE *file, const void *data, size_t size) {
+        if (size > 0 && fwrite(data, 1, size, file) != size) {
+            fclose(file);
+            throw RDConversionException("Could not write to output file");
+        }
+    }
+
+    static void writeNodes(FILE *file, const std::vector<RDNodeItem> &nodes) {
+        std::vector<uint8_t> buffer;
+        buffer.reserve(4096 * FGB_NODE_ITEM_SIZE);
+        for (size_t i = 0; i < nodes.size(); i++) {
+            const uint64_t values[5] = {doubleBits(nodes[i].minX), doubleBits(nodes[i].minY),
+                                        doubleBits(nodes[i].maxX), doubleBits(nodes[i].maxY),
+                                        nodes[i].offset};
+            for (int k = 0; k < 5; k++) {
+                for (int b = 0; b < 8; b++) buffer.push_back((uint8_t) (values[k] >> (8 * b)));
+            }
+            if (buffer.size() == buffer.capacity() || i + 1 == nodes.size()) {
+                writeOrThrow(file, &buffer[0], buffer.size());
+                buffer.clear();
+            }
+        }
+    }
+
+    void Radolan2FlatGeobuf::convertToPoints(RDScan *scan, const char *filename, bool geographic) {
+        convert(scan, filename, false, geographic);
+    }
+
+    void Radolan2FlatGeobuf::convertToPolygons(RDScan *scan, const char *filename, bool geographic) {
+        convert(scan, filename, true, geographic);
+    }
+
+    void Radolan2FlatGeobuf::convert(RDScan *scan, const char *filename, bool polygons, bool geographic) {
+        const RDGridGeometry *grid = RDGridGeometry::forScan(scan);
+        RDCellGeometry cells(grid, polygons, geographic);
+
+        char timeString[32];
+        RDScanTimeString(scan, timeString, sizeof(timeString));
+        std::string time(timeString);
+
+        RDFlatBuffer fb;
+        std::vector<uint8_t> properties;
+        double xy[10];
+        RDNodeItem bounds;
+
+        // First pass: collect the features, their extent and their sizes
+        std::vector<RDFeatureItem> items;
+        RDNodeItem extent = rdEmptyNodeItem(0);
+        uint32_t count = (uint32_t) scan->dimLon * scan->dimLat;
+        for (uint32_t cell = 0; cell < count; cell++) {
+            RDDataType value = scan->data[cell];
+            if (value == -32.5 || value == 92.5) continue;
+
+            size_t vertices = cells.vertices(cell, xy, bounds);
+            expand(extent, bounds);
+            encodeProperties(properties, value, time);
+            serializeFeature(fb, xy, vertices, properties);
+
+            RDFeatureItem item = {cell, 0, (uint32_t) fb.size()};
+            items.push_back(item);
+        }
+
+        // Sort along the Hilbert curve through the extent
+        double width = extent.maxX - extent.minX;
+        double height = extent.maxY - extent.minY;
+        for (size_t i = 0; i < items.size(); i++) {
+            cells.vertices(items[i].cell, xy, bounds);
+            uint32_t hx = width > 0 ? (uint32_t) (0xFFFF * ((bounds.minX + bounds.maxX) / 2 - extent.minX) / width) : 0;
+            uint32_t hy = height > 0 ? (uint32_t) (0xFFFF * ((bounds.minY + bounds.maxY) / 2 - extent.minY) / height) : 0;
+            items[i].hilbert = hilbert(hx, hy);
+        }
+        std::sort(items.begin(), items.end(), compareHilbert);
+
+        // Packed R-tree: leaves point to the byte offsets of the features,
+        // inner nodes to the index of their first child
+        std::vector<RDNodeItem> nodes;
+        if (!items.empty()) {
+            std::vector<std::pair<uint64_t, uint64_t> > levels = levelBounds(items.size());
+            nodes.resize(levels[0].second);
+
+            uint64_t offset = 0;
+            for (size_t i = 0; i < items.size(); i++) {
+                cells.vertices(items[i].cell, xy, bounds);
+                bounds.offset = offset;
+                nodes[levels[0].first + i] = bounds;
+                offset += items[i].size;
+            }
+
+            for (size_t level = 0; level + 1 < levels.size(); level++) {
+                uint64_t pos = levels[level].first;
+                uint64_t end = levels[level].second;
+                uint64_t parent = levels[level + 1].first;
+                while (pos < end) {
+                    RDNodeItem node = rdEmptyNodeItem(pos);
+                    for (uint64_t j = 0; j < FGB_NODE_SIZE && pos < end; j++) {
+                        expand(node, nodes[pos++]);
+                    }
+                    nodes[parent++] = node;
+                }
+            }
+        }
+
+        // Second pass: write header, index and the features in Hilbert order
+        FILE *file = fopen(filename, "wb");
+        if (file == NULL) {
+            throw RDConversionException("Could not open output file");
+        }
+        setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+        writeOrThrow(file, FGB_MAGIC, sizeof(FGB_MAGIC));
+        serializeHeader(fb, scan, polygons, geographic, extent, items.size());
+        writeOrThrow(file, fb.data(), fb.size());
+        writeNodes(file, nodes);
+
+        for (size_t i = 0; i < items.size(); i++) {
+            size_t vertices = cells.vertices(items[i].cell, xy, bounds);
+            encodeProperties(properties, scan->data[items[i].cell], time);
+            serializeFeature(fb, xy, vertices, properties);
+            writeOrThrow(file, fb.data(), fb.size());
+        }
+
+        if (fclose(file) != 0) {
+            throw RDConversionException("Could not close output file");
+        }
+    }
+}
@@ -0,0 +1,383 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdlib.h>
+#include <thread>
+#include <utility>
+
+#include <radolan/coordinate_system.h>
+#include <radolan/gauge_adjustment.h>
+#include <radolan/grid_geometry.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+
+namespace Radolan {
+
+    /** (squared distance, point index) */
+    typedef std::pair<double, int> RDNeighbour;
+
+    /**
+     * Static 2D tree over a set of points, stored implicitly: the median
+     * of each range is the node, the halves left and right of it are
+     * its subtrees.
+     */
+    class RDKDTree {
+    public:
+
+        RDKDTree(const std::vector<double> &x, const std::vector<double> &y)
+                : m_x(x), m_y(y), m_index(x.size()) {
+            for (size_t i = 0; i < m_index.size(); i++) m_index[i] = (int) i;
+            build(0, m_index.size(), 0);
+        }
+
+        /**
+         * The k nearest points within maximumDistance, nearest first.
+         */
+        void nearest(double x, double y, int k, double maximumDistance,
+                     std::vector<RDNeighbour> &result) const {
+            result.clear();
+            if (k <= 0) return;
+            search(0, m_index.size(), 0, x, y, (size_t) k, maximumDistance * maximumDistance, result);
+            std::sort_heap(result.begin(), result.end());
+        }
+
+    private:
+
+        void build(size_t begin, size_t end, int axis) {
+            if (end - begin < 2) return;
+            size_t middle = (begin + end) / 2;
+            const std::vector<double> &c = axis == 0 ? m_x : m_y;
+            std::nth_element(m_index.begin() + begin, m_index.begin() + middle, m_index.begin() + end,
+                             [&c](int a, int b) { return c[a] < c[b]; });
+            build(begin, middle, 1 - axis);
+            build(middle + 1, end, 1 - axis);
+        }
+
+        // result is a max-heap of at most k neighbours
+        void search(size_t begin, size_t end, int axis, double x, double y, size_t k, double limit,
+                    std::vector<RDNeighbour> &result) const {
+            if (begin >= end) return;
+            size_t middle = (begin + end) / 2;
+            int point = m_index[middle];
+            double dx = m_x[point] - x, dy = m_y[point] - y;
+            double distance = dx * dx + dy * dy;
+            if (distance <= limit && (result.size() < k || distance < result.front().first)) {
+                if (result.size() == k) {
+                    std::pop_heap(result.begin(), result.end());
+                    result.pop_back();
+                }
+                result.push_back(RDNeighbour(distance, point));
+                std::push_heap(result.begin(), result.end());
+            }
+
+            double split = axis == 0 ? -dx : -dy;
+            size_t nearBegin = split < 0 ? begin : middle + 1, nearEnd = split < 0 ? middle : end;
+            size_t farBegin = split < 0 ? middle + 1 : begin, farEnd = split < 0 ? end : middle;
+            search(nearBegin, nearEnd, 1 - axis, x, y, k, limit, result);
+            double bound = result.size() < k ? limit : std::min(limit, result.front().first);
+            if (split * split <= bound) {
+                search(farBegin, farEnd, 1 - axis, x, y, k, limit, result);
+            }
+        }
+
+        const std::vector<double> &m_x;
+        const std::vector<double> &m_y;
+        std::vector<int> m_index;
+    };
+
+    /** LU factorization with partial pivoting of a small dense system */
+    class RDLinearSystem {
+    public:
+
+        /** @return false if the matrix is singular */
+        bool factorize(std::vector<double> &matrix, int n) {
+            m_n = n;
+            m_lu.swap(matrix);
+            m_pivot.resize(n);
+            for (int c = 0; c < n; c++) {
+                int pivot = c;
+                for (int r = c + 1; r < n; r++) {
+                    if (fabs(m_lu[r * n + c]) > fabs(m_lu[pivot * n + c])) pivot = r;
+                }
+                m_pivot[c] = pivot;
+                if (fabs(m_lu[pivot * n + c]) < 1e-12) return false;
+                if (pivot != c) {
+                    std::swap_ranges(&m_lu[c * n], &m_lu[c * n] + n, &m_lu[pivot * n]);
+                }
+                for (int r = c + 1; r < n; r++) {
+                    double f = m_lu[r * n + c] /= m_lu[c * n + c];
+                    for (int j = c + 1; j < n; j++) m_lu[r * n + j] -= f * m_lu[c * n + j];
+                }
+            }
+            return true;
+        }
+
+        /** Solves in place */
+        void solve(std::vector<double> &b) const {
+            int n = m_n;
+            // rows were swapped as a whole, so all swaps come first
+            for (int c = 0; c < n; c++) std::swap(b[c], b[m_pivot[c]]);
+            for (int c = 0; c < n; c++) {
+                for (int r = c + 1; r < n; r++) b[r] -= m_lu[r * n + c] * b[c];
+            }
+            for (int r = n - 1; r >= 0; r--) {
+                for (int j = r + 1; j < n; j++) b[r] -= m_lu[r * n + j] * b[j];
+                b[r] /= m_lu[r * n + r];
+            }
+        }
+
+    private:
+        int m_n;
+        std::vector<double> m_lu;
+        std::vector<int> m_pivot;
+    };
+
+    /** Interpolation state of one thread */
+    class RDResidualInterpolator {
+    public:
+
+        RDResidualInterpolator(const RDGaugeAdjustmentOptions &options,
+                               const std::vector<double> &x, const std::vector<double> &y,
+                               const std::vector<double> &residuals, double sill)
+                : m_options(options), m_x(x), m_y(y), m_residuals(residuals), m_sill(sill),
+                  m_cached(false),
+                  m_singular(false) {
+        }
+
+        /** @return interpolated residual at (x,y) from the neighbours, nearest first */
+        double interpolate(double x, double y, const std::vector<RDNeighbour> &neighbours) {
+            if (neighbours.front().first < 1e-12) {
+                return m_residuals[neighbours.front().second];
+            }
+            if (m_options.interpolation == RD_INTERPOLATION_KRIGING && neighbours.size() > 1) {
+                double value;
+                if (krige(x, y, neighbours, value)) return value;
+            }
+            return idw(neighbours);
+        }
+
+    private:
+
+        double idw(const std::vector<RDNeighbour> &neighbours) const {
+            double sum = 0, weights = 0;
+            double exponent = -0.5 * m_options.idwPower;
+            for (size_t i = 0; i < neighbours.size(); i++) {
+                double w = pow(neighbours[i].first, exponent);
+                sum += w * m_residuals[neighbours[i].second];
+                weights += w;
+            }
+            return sum / weights;
+        }
+
+        double variogram(double h) const {
+            if (h <= 0) return 0;
+            return m_options.nugget + (m_sill - m_options.nugget) * (1.0 - exp(-h / m_options.range));
+        }
+
+        bool krige(double x, double y, const std::vector<RDNeighbour> &neighbours, double &value) {
+            // the system only depends on the set of gauges, which is often
+            // the same for neighbouring cells
+            m_set.resize(neighbours.size());
+            for (size_t i = 0; i < neighbours.size(); i++) m_set[i] = neighbours[i].second;
+            std::sort(m_set.begin(), m_set.end());
+            int n = (int) m_set.size() + 1;
+
+            if (!m_cached || m_set != m_cachedSet) {
+                m_cachedSet = m_set;
+                m_matrix.assign((size_t) n * n, 1.0);
+                for (int i = 0; i < n - 1; i++) {
+                    for (int j = 0; j < n - 1; j++) {
+                        double dx = m_x[m_set[i]] - m_x[m_set[j]], dy = m_y[m_set[i]] - m_y[m_set[j]];
+                        m_matrix[i * n + j] = variogram(sqrt(dx * dx + dy * dy));
+                    }
+                }
+                m_matrix[(size_t) n * n - 1] = 0.0;
+                m_singular = !m_system.factorize(m_matrix, n);
+                m_cached = true;
+            }
+            if (m_singular) return false;
+
+            m_rhs.resize(n);
+            for (int i = 0; i < n - 1; i++) {
+                double dx = m_x[m_set[i]] - x, dy = m_y[m_set[i]] - y;
+                m_rhs[i] = variogram(sqrt(dx * dx + dy * dy));
+            }
+            m_rhs[n - 1] = 1.0;
+            m_system.solve(m_rhs);
+
+            value = 0;
+            for (int i = 0; i < n - 1; i++) value += m_rhs[i] * m_residuals[m_set[i]];
+            return true;
+        }
+
+        const RDGaugeAdjustmentOptions &m_options;
+        const std::vector<double> &m_x;
+        const std::vector<double> &m_y;
+        const std::vector<double> &m_residuals;
+        double m_sill;
+
+        // factorized system of the last set of gauges
+        bool m_cached;
+        bool m_singular;
+        std::vector<int> m_set;
+        std::vector<int> m_cachedSet;
+        std::vector<double> m_matrix;
+        std::vector<double> m_rhs;
+        RDLinearSystem m_system;
+    };
+
+    RDScan *RDAdjustWithGauges(const RDScan *radar,
+                               const std::vector<RDGauge> &gauges,
+                               const RDGaugeAdjustmentOptions &options,
+                               std::vector<RDGaugeResidual> *residuals) {
+        if (options.neighbours <= 0 || options.maximumDistance <= 0) {
+            throw RDConversionException("Number of neighbours and maximum distance must be positive");
+        }
+        if (options.interpolation == RD_INTERPOLATION_KRIGING && options.range <= 0) {
+            throw RDConversionException("Variogram range must be positive");
+        }
+        if (options.adjustment == RD_ADJUST_MULTIPLICATIVE
+            && (options.ratioOffset <= 0 || options.maximumRatio < 1)) {
+            throw RDConversionException("Ratio offset must be positive and maximum ratio at least 1");
+        }
+
+        int dimLon = radar->dimLon;
+        int dimLat = radar->dimLat;
+        RDScanType type = radar->header.scanType;
+        const RDGridGeometry *geometry = RDGridGeometry::forScan(radar);
+        RDCoordinateSystem rcs = geometry->coordinateSystem();
+        const double *cornerX = geometry->cornerX();
+        const double *cornerY = geometry->cornerY();
+        double cellX = (cornerX[dimLon] - cornerX[0]) / dimLon;
+        double cellY = (cornerY[dimLat] - cornerY[0]) / dimLat;
+        bool multiplicative = options.adjustment == RD_ADJUST_MULTIPLICATIVE;
+
+        // residuals at the gauges
+        std::vector<double> x, y, values;
+        if (residuals != NULL) residuals->clear();
+        for (size_t g = 0; g < gauges.size(); g++) {
+            const RDGauge &gauge = gauges[g];
+            if (!(gauge.value >= 0)) continue;
+            RDCartesianPoint p = rcs.cartesianCoordinate(rdGeographicalPoint(gauge.longitude, gauge.latitude));
+            double fx = floor((p.x - cornerX[0]) / cellX), fy = floor((p.y - cornerY[0]) / cellY);
+            if (!(fx >= 0 && fx < dimLon && fy >= 0 && fy < dimLat)) continue;
+            int ix = (int) fx, iy = (int) fy;
+            RDDataType r = radar->data[(size_t) iy * dimLon + ix];
+            if (!RDIsCleanMeasurement(type, r)) continue;
+
+            double residual = gauge.value - r;
+            if (multiplicative) {
+                residual = (gauge.value + options.ratioOffset) / (r + options.ratioOffset);
+                residual = std::max(1.0 / options.maximumRatio, std::min((double) options.maximumRatio, residual));
+            }
+            x.push_back(p.x);
+            y.push_back(p.y);
+            values.push_back(residual);
+            if (residuals != NULL) {
+                RDGaugeResidual gr = {g, ix, iy, gauge.value, r, residual};
+                residuals->push_back(gr);
+            }
+        }
+
+        double sill = options.sill;
+        if (sill <= 0 && !values.empty()) {
+            double mean = 0, variance = 0;
+            for (size_t i = 0; i < values.size(); i++) mean += values[i];
+            mean /= values.size();
+            for (size_t i = 0; i < values.size(); i++) variance += (values[i] - mean) * (values[i] - mean);
+            sill = variance / values.size();
+        }
+        if (sill <= options.nugget) sill = options.nugget + 1.0;
+
+        size_t count = (size_t) dimLon * dimLat;
+        RDScan *result = RDAllocateScan();
+        if (result == NULL) {
+            throw RDConversionException("Could not allocate scan");
+        }
+        result->data = (RDDataType *) malloc(count * sizeof(RDDataType));
+        if (result->data == NULL) {
+            RDFreeScan(result);
+            throw RDConversionException("Could not allocate scan data");
+        }
+        result->header = radar->header;
+        result->header.radarStations = NULL;
+        result->header.numberOfRadarStations = 0;
+        result->filename[0] = '\0';
+        result->dimLon = dimLon;
+        result->dimLat = dimLat;
+        result->dbZPerUnit = radar->dbZPerUnit;
+
+        RDKDTree tree(x, y);
+        const double *centreX = geometry->centreX();
+        const double *centreY = geometry->centreY();
+        double none = multiplicative ? 1.0 : 0.0;
+
+        unsigned int threads = options.threads;
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = std::min(threads, (unsigned int) dimLat);
+        std::atomic<int> nextRow(0);
+        auto work = [&]() {
+            RDResidualInterpolator interpolator(options, x, y, values, sill);
+            std::vector<RDNeighbour> neighbours;
+            for (int iy = nextRow++; iy < dimLat; iy = nextRow++) {
+                const RDDataType *in = radar->data + (size_t) iy * dimLon;
+                RDDataType *out = result->data + (size_t) iy * dimLon;
+                for (int ix = 0; ix < dimLon; ix++) {
+                    RDDataType r = in[ix];
+                    if (!RDIsCleanMeasurement(type, r)) {
+                        out[ix] = r;
+                        continue;
+                    }
+                    tree.nearest(centreX[ix], centreY[iy], options.neighbours, options.maximumDistance, neighbours);
+                    double residual = neighbours.empty() ? none : interpolator.interpolate(centreX[ix], centreY[iy], neighbours);
+                    double adjusted = multiplicative ? r * residual : r + residual;
+                    out[ix] = (RDDataType) std::max(0.0, adjusted);
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned int t = 1; t < threads; t++) {
+            workers.push_back(std::thread(work));
+        }
+        work();
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+
+        result->min_value = result->max_value = 0;
+        bool first = true;
+        for (size_t i = 0; i < count; i++) {
+            RDDataType v = result->data[i];
+            if (!RDIsCleanMeasurement(type, v)) continue;
+            if (first || v < result->min_value) result->min_value = v;
+            if (first || v > result->max_value) result->max_value = v;
+            first = false;
+        }
+        return result;
+    }
+}
@@ -0,0 +1,485 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+#include <radolan/geotiff_converter.h>
+#include <radolan/coordinate_system.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+#include <radolan/scan_utils.h>
+
+namespace Radolan {
+
+    // TIFF field types
+    static const uint16_t TIFF_ASCII = 2;
+    static const uint16_t TIFF_SHORT = 3;
+    static const uint16_t TIFF_LONG = 4;
+    static const uint16_t TIFF_DOUBLE = 12;
+
+    /** One image of the file: the full resolution or an overview, north up */
+    typedef struct {
+        int width;
+        int height;
+        std::vector<float> pixels;
+        /// compressed tiles, row by row
+        std::vector<std::vector<uint8_t> > tiles;
+    } RDGeoTIFFImage;
+
+    /** An IFD entry. Values of more than 4 bytes are written after the IFD. */
+    typedef struct {
+        uint16_t code;
+        uint16_t type;
+        uint32_t count;
+        std::vector<uint8_t> value;
+    } RDTIFFField;
+
+    static RDTIFFField tiffField(uint16_t code, uint16_t type, uint32_t count, const void *value, size_t size) {
+        RDTIFFField field;
+        field.code = code;
+        field.type = type;
+        field.count = count;
+        field.value.assign((const uint8_t *) value, (const uint8_t *) value + size);
+        return field;
+    }
+
+    static RDTIFFField shortField(uint16_t code, uint16_t value) {
+        return tiffField(code, TIFF_SHORT, 1, &value, sizeof(value));
+    }
+
+    static RDTIFFField shortsField(uint16_t code, const std::vector<uint16_t> &values) {
+        return tiffField(code, TIFF_SHORT, (uint32_t) values.size(), &values[0], values.size() * sizeof(uint16_t));
+    }
+
+    static RDTIFFField longField(uint16_t code, uint32_t value) {
+        return tiffField(code, TIFF_LONG, 1, &value, sizeof(value));
+    }
+
+    static RDTIFFField longsField(uint16_t code, const std::vector<uint32_t> &values) {
+        return tiffField(code, TIFF_LONG, (uint32_t) values.size(), &values[0], values.size() * sizeof(uint32_t));
+    }
+
+    static RDTIFFField doublesField(uint16_t code, const std::vector<double> &values) {
+        return tiffField(code, TIFF_DOUBLE, (uint32_t) values.size(), &values[0], values.size() * sizeof(double));
+    }
+
+    static RDTIFFField asciiField(uint16_t code, const std::string &text) {
+        return tiffField(code, TIFF_ASCII, (uint32_t) text.size() + 1, text.c_str(), text.size() + 1);
+    }
+
+    static void append(std::vector<uint8_t> &buffer, const void *data, size_t size) {
+        buffer.insert(buffer.end(), (const uint8_t *) data, (const uint8_t *) data + size);
+    }
+
+    /**
+     * Serializes an IFD at the given file position, followed by the values
+     * that do not fit into the entries. The size does not depend on the
+     * position or the next pointer.
+     */
+    static std::vector<uint8_t> tiffDirectory(std::vector<RDTIFFField> fields, uint32_t position, uint32_t next) {
+        std::sort(fields.begin(), fields.end(),
+                  [](const RDTIFFField &a, const RDTIFFField &b) { return a.code < b.code; });
+
+        uint16_t count = (uint16_t) fields.size();
+        uint32_t extra = position + 2 + 12 * count + 4;
+        std::vector<uint8_t> directory, values;
+        append(directory, &count, sizeof(count));
+        for (size_t i = 0; i < fields.size(); i++) {
+            const RDTIFFField &field = fields[i];
+            append(directory, &field.code, sizeof(field.code));
+            append(directory, &field.type, sizeof(field.type));
+            append(directory, &field.count, sizeof(field.count));
+            uint8_t inline_value[4] = {0, 0, 0, 0};
+            if (field.value.size() <= 4) {
+                memcpy(inline_value, &field.value[0], field.value.size());
+            } else {
+                // values start on a word boundary
+                uint32_t offset = extra + (uint32_t) values.size();
+                memcpy(inline_value, &offset, sizeof(offset));
+                values.insert(values.end(), field.value.begin(), field.value.end());
+                if (values.size() % 2 != 0) values.push_back(0);
+            }
+            append(directory, inline_value, sizeof(inline_value));
+        }
+        append(directory, &next, sizeof(next));
+        directory.insert(directory.end(), values.begin(), values.end());
+        return directory;
+    }
+
+    /** Key directory, double and ASCII parameters of the GeoKeys */
+    typedef struct {
+        std::vector<uint16_t> directory;
+        std::vector<double> doubles;
+        std::string ascii;
+    } RDGeoKeys;
+
+    static void shortKey(RDGeoKeys &keys, uint16_t key, uint16_t value) {
+        uint16_t entry[] = {key, 0, 1, value};
+        keys.directory.insert(keys.directory.end(), entry, entry + 4);
+    }
+
+    static void doubleKey(RDGeoKeys &keys, uint16_t key, double value) {
+        uint16_t entry[] = {key, 34736, 1, (uint16_t) keys.doubles.size()};
+        keys.directory.insert(keys.directory.end(), entry, entry + 4);
+        keys.doubles.push_back(value);
+    }
+
+    static void asciiKey(RDGeoKeys &keys, uint16_t key, const std::string &value) {
+        uint16_t entry[] = {key, 34737, (uint16_t) (value.size() + 1), (uint16_t) keys.ascii.size()};
+        keys.directory.insert(keys.directory.end(), entry, entry + 4);
+        keys.ascii += value + "|";
+    }
+
+    /** The RADOLAN polar stereographic projection, in kilometres on a sphere */
+    static RDGeoKeys radolanGeoKeys() {
+        RDGeoKeys keys;
+        uint16_t header[] = {1, 1, 0, 0};
+        keys.directory.assign(header, header + 4);
+
+        // in order of the key ids
+        shortKey(keys, 1024, 1);                 // GTModelTypeGeoKey: projected
+        shortKey(keys, 1025, 1);                 // GTRasterTypeGeoKey: pixel is area
+        asciiKey(keys, 1026, "RADOLAN polar stereographic");
+        shortKey(keys, 2048, 32767);             // GeographicTypeGeoKey: user defined
+        asciiKey(keys, 2049, "RADOLAN sphere");
+        shortKey(keys, 2050, 32767);             // GeogGeodeticDatumGeoKey: user defined
+        shortKey(keys, 2051, 8901);              // GeogPrimeMeridianGeoKey: Greenwich
+        shortKey(keys, 2054, 9102);              // GeogAngularUnitsGeoKey: degree
+        shortKey(keys, 2056, 32767);             // GeogEllipsoidGeoKey: user defined
+        doubleKey(keys, 2057, 6370040.0);        // GeogSemiMajorAxisGeoKey
+        doubleKey(keys, 2058, 6370040.0);        // GeogSemiMinorAxisGeoKey
+        shortKey(keys, 3072, 32767);             // ProjectedCSTypeGeoKey: user defined
+        shortKey(keys, 3074, 32767);             // ProjectionGeoKey: user defined
+        shortKey(keys, 3075, 15);                // ProjCoordTransGeoKey: CT_PolarStereographic
+        shortKey(keys, 3076, 9036);              // ProjLinearUnitsGeoKey: kilometre
+        doubleKey(keys, 3081, 60.0);             // ProjNatOriginLatGeoKey: latitude of true scale
+        doubleKey(keys, 3082, 0.0);              // ProjFalseEastingGeoKey
+        doubleKey(keys, 3083, 0.0);              // ProjFalseNorthingGeoKey
+        doubleKey(keys, 3092, 1.0);              // ProjScaleAtNatOriginGeoKey
+        doubleKey(keys, 3095, 10.0);             // ProjStraightVertPoleLongGeoKey
+
+        keys.directory[3] = (uint16_t) (keys.directory.size() / 4 - 1);
+        return keys;
+    }
+
+    /**
+     * Averages the valid pixels of the full resolution image in blocks of
+     * factor x factor pixels. Blocks without valid pixels are missing.
+     */
+    static void buildOverview(const RDGeoTIFFImage &full, int factor, RDScanType type, RDGeoTIFFImage &overview) {
+        RDDataType missing = RDMissingValue(type);
+        RDDataType clutter = RDClutterValue(type);
+        overview.width = (full.width + factor - 1) / factor;
+        overview.height = (full.height + factor - 1) / factor;
+        overview.pixels.assign((size_t) overview.width * overview.height, missing);
+
+        std::vector<double> sums(overview.width);
+        std::vector<int> counts(overview.width);
+        for (int oy = 0; oy < overview.height; oy++) {
+            std::fill(sums.begin(), sums.end(), 0.0);
+            std::fill(counts.begin(), counts.end(), 0);
+            int y1 = std::min(full.height, (oy + 1) * factor);
+            for (int y = oy * factor; y < y1; y++) {
+                const float *row = &full.pixels[(size_t) y * full.width];
+                for (int x = 0; x < full.width; x++) {
+                    float v = row[x];
+                    if (v != missing && v != clutter && !isnan(v)) {
+                        sums[x / factor] += v;
+                        counts[x / factor]++;
+                    }
+                }
+            }
+            float *target = &overview.pixels[(size_t) oy * overview.width];
+            for (int ox = 0; ox < overview.width; ox++) {
+                if (counts[ox] > 0) target[ox] = (float) (sums[ox] / counts[ox]);
+            }
+        }
+    }
+
+    /**
+     * Floating point predictor (TIFF Technical Note 3): the bytes of each
+     * row are sorted into planes, most significant first, and each byte is
+     * replaced by its difference to the one before.
+     */
+    static void floatingPointPredictor(const float *row, int width, uint8_t *target) {
+        for (int i = 0; i < width; i++) {
+            uint32_t bits;
+            memcpy(&bits, &row[i], sizeof(bits));
+            target[i] = (uint8_t) (bits >> 24);
+            target[width + i] = (uint8_t) (bits >> 16);
+            target[2 * width + i] = (uint8_t) (bits >> 8);
+            target[3 * width + i] = (uint8_t) bits;
+        }
+        for (int i = 4 * width - 1; i > 0; i--) {
+            target[i] = (uint8_t) (target[i] - target[i - 1]);
+        }
+    }
+
+    static void compressTile(const RDGeoTIFFImage &image, int tileX, int tileY, float fill,
+                             const RDGeoTIFFOptions &options, std::vector<uint8_t> &compressed) {
+        int size = options.tileSize;
+        // edge tiles are stored in full size
+        std::vector<float> tile((size_t) size * size, fill);
+        int x0 = tileX * size, y0 = tileY * size;
+        int columns = std::min(size, image.width - x0);
+        int rows = std::min(size, image.height - y0);
+        for (int y = 0; y < rows; y++) {
+            memcpy(&tile[(size_t) y * size], &image.pixels[(size_t) (y0 + y) * image.width + x0],
+                   columns * sizeof(float));
+        }
+
+        std::vector<uint8_t> raw(tile.size() * sizeof(float));
+        if (options.predictor) {
+            for (int y = 0; y < size; y++) {
+                floatingPointPredictor(&tile[(size_t) y * size], size, &raw[(size_t) y * size * sizeof(float)]);
+            }
+        } else {
+            memcpy(&raw[0], &tile[0], raw.size());
+        }
+
+        uLongf length = compressBound((uLong) raw.size());
+        compressed.resize(length);
+        if (compress2(&compressed[0], &length, &raw[0], (uLong) raw.size(), options.compressionLevel) != Z_OK) {
+            throw RDConversionException("Could not compress GeoTIFF tile");
+        }
+        compressed.resize(length);
+    }
+
+    static int tilesAcross(const RDGeoTIFFImage &image, int tileSize) {
+        return (image.width + tileSize - 1) / tileSize;
+    }
+
+    static int tilesDown(const RDGeoTIFFImage &image, int tileSize) {
+        return (image.height + tileSize - 1) / tileSize;
+    }
+
+    /** Compresses the tiles of all images, taking them from a common queue */
+    static void compressTiles(std::vector<RDGeoTIFFImage> &images, float fill, const RDGeoTIFFOptions &options) {
+        typedef struct {
+            size_t image;
+            int tileX, tileY;
+            size_t index;
+        } Job;
+
+        std::vector<Job> jobs;
+        for (size_t i = 0; i < images.size(); i++) {
+            int across = tilesAcross(images[i], options.tileSize);
+            int down = tilesDown(images[i], options.tileSize);
+            images[i].tiles.resize((size_t) across * down);
+            for (int y = 0; y < down; y++) {
+                for (int x = 0; x < across; x++) {
+                    Job job = {i, x, y, (size_t) y * across + x};
+                    jobs.push_back(job);
+                }
+            }
+        }
+
+        std::atomic<size_t> next(0);
+        std::atomic<bool> failed(false);
+        auto work = [&]() {
+            for (size_t j = next++; j < jobs.size() && !failed; j = next++) {
+                const Job &job = jobs[j];
+                try {
+                    compressTile(images[job.image], job.tileX, job.tileY, fill, options,
+                                 images[job.image].tiles[job.index]);
+                } catch (const RDConversionException &) {
+                    failed = true;
+                }
+            }
+        };
+
+        unsigned int threads = options.threads;
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = (unsigned int) std::min((size_t) threads, jobs.size());
+        if (threads <= 1) {
+            work();
+        } else {
+            std::vector<std::thread> workers;
+            for (unsigned int i = 0; i < threads; i++) {
+                workers.push_back(std::thread(work));
+            }
+            for (size_t i = 0; i < workers.size(); i++) {
+                workers[i].join();
+            }
+        }
+        if (failed) {
+            throw RDConversionException("Could not compress GeoTIFF tile");
+        }
+    }
+
+    void
+    Radolan2GeoTIFF::convertScan(RDScan *scan, const char *filename, const RDGeoTIFFOptions &options) {
+        if (options.tileSize < 16 || options.tileSize % 16 != 0) {
+            throw RDConversionException("GeoTIFF tile size must be a multiple of 16");
+        }
+        if (options.overviews < 0 || options.overviews > 16) {
+            throw RDConversionException("Number of GeoTIFF overviews must be within 0-16");
+        }
+        if (options.compressionLevel < 1 || options.compressionLevel > 9) {
+            throw RDConversionException("Deflate compression level must be within 1-9");
+        }
+
+        RDScanType type = scan->header.scanType;
+        float fill = RDMissingValue(type);
+
+        // RADOLAN rows run south to north, TIFF rows north to south
+        std::vector<RDGeoTIFFImage> images(1);
+        RDGeoTIFFImage &full = images[0];
+        full.width = scan->dimLon;
+        full.height = scan->dimLat;
+        full.pixels.resize((size_t) full.width * full.height);
+        for (int y = 0; y < full.height; y++) {
+            memcpy(&full.pixels[(size_t) y * full.width],
+                   scan->data + (size_t) (full.height - 1 - y) * full.width,
+                   full.width * sizeof(float));
+        }
+
+        for (int level = 1; level <= options.overviews; level++) {
+            images.push_back(RDGeoTIFFImage());
+            buildOverview(images[0], 1 << level, type, images.back());
+        }
+
+        compressTiles(images, fill, options);
+
+        // the fields of each IFD, tile offsets filled in later
+        RDCoordinateSystem rcs(type);
+        RDCartesianPoint upperLeft = rcs.cartesianCornerCoordinate(rdGridPoint(0, scan->dimLat));
+        RDCartesianPoint lowerRight = rcs.cartesianCornerCoordinate(rdGridPoint(scan->dimLon, 0));
+        RDGeoKeys keys = radolanGeoKeys();
+
+        char nodata[32];
+        snprintf(nodata, sizeof(nodata), "%g", fill);
+
+        time_t time = RDScanTimeInSecondsSinceEpoch(scan);
+        struct tm tm;
+        gmtime_r(&time, &tm);
+        char datetime[20];
+        strftime(datetime, sizeof(datetime), "%Y:%m:%d %H:%M:%S", &tm);
+
+        std::vector<std::vector<RDTIFFField> > directories(images.size());
+        std::vector<std::vector<uint32_t> > offsets(images.size()), counts(images.size());
+        for (size_t i = 0; i < images.size(); i++) {
+            const RDGeoTIFFImage &image = images[i];
+            std::vector<RDTIFFField> &fields = directories[i];
+            for (size_t t = 0; t < image.tiles.size(); t++) {
+                counts[i].push_back((uint32_t) image.tiles[t].size());
+            }
+            offsets[i].resize(image.tiles.size());
+
+            fields.push_back(longField(254, i == 0 ? 0 : 1));   // NewSubfileType: reduced resolution
+            fields.push_back(longField(256, (uint32_t) image.width));
+            fields.push_back(longField(257, (uint32_t) image.height));
+            fields.push_back(shortField(258, 32));              // BitsPerSample
+            fields.push_back(shortField(259, 8));               // Compression: deflate
+            fields.push_back(shortField(262, 1));               // PhotometricInterpretation: black is zero
+            fields.push_back(shortField(277, 1));               // SamplesPerPixel
+            fields.push_back(shortField(284, 1));               // PlanarConfiguration: chunky
+            fields.push_back(shortField(317, options.predictor ? 3 : 1));
+            fields.push_back(longField(322, (uint32_t) options.tileSize));
+            fields.push_back(longField(323, (uint32_t) options.tileSize));
+            fields.push_back(longsField(324, offsets[i]));
+            fields.push_back(longsField(325, counts[i]));
+            fields.push_back(shortField(339, 3));               // SampleFormat: IEEE floating point
+            fields.push_back(asciiField(42113, nodata));        // GDAL_NODATA
+            if (i == 0) {
+                fields.push_back(asciiField(270, std::string("RADOLAN ") + RDScanTypeToString(type)));
+                fields.push_back(asciiField(306, datetime));
+                std::vector<double> scale;
+                scale.push_back((lowerRight.x - upperLeft.x) / scan->dimLon);
+                scale.push_back((upperLeft.y - lowerRight.y) / scan->dimLat);
+                scale.push_back(0.0);
+                fields.push_back(doublesField(33550, scale));  // ModelPixelScaleTag
+                double tiepoint[] = {0.0, 0.0, 0.0, upperLeft.x, upperLeft.y, 0.0};
+                fields.push_back(doublesField(33922, std::vector<double>(tiepoint, tiepoint + 6)));
+                fields.push_back(shortsField(34735, keys.directory));
+                fields.push_back(doublesField(34736, keys.doubles));
+                fields.push_back(asciiField(34737, keys.ascii));
+            }
+        }
+
+        // IFDs first, then the tiles from the smallest overview to the full resolution
+        std::vector<uint32_t> positions(images.size() + 1, 8);
+        for (size_t i = 0; i < images.size(); i++) {
+            positions[i + 1] = positions[i] + (uint32_t) tiffDirectory(directories[i], positions[i], 0).size();
+        }
+        uint64_t position = positions.back();
+        for (size_t i = images.size(); i-- > 0;) {
+            for (size_t t = 0; t < images[i].tiles.size(); t++) {
+                offsets[i][t] = (uint32_t) position;
+                position += images[i].tiles[t].size();
+            }
+        }
+        if (position > UINT32_MAX) {
+            throw RDConversionException("GeoTIFF would exceed 4 GB");
+        }
+
+        FILE *file = fopen(filename, "wb");
+        if (file == NULL) {
+            throw RDConversionException("Could not open GeoTIFF file for writing");
+        }
+        std::vector<uint8_t> head;
+        uint16_t one = 1;
+        bool little = *(uint8_t *) &one == 1;
+        uint16_t magic = 42;
+        uint32_t first = 8;
+        append(head, little ? "II" : "MM", 2);
+        append(head, &magic, sizeof(magic));
+        append(head, &first, sizeof(first));
+        bool ok = fwrite(&head[0], 1, head.size(), file) == head.size();
+        for (size_t i = 0; i < images.size() && ok; i++) {
+            std::vector<RDTIFFField> &fields = directories[i];
+            for (size_t f = 0; f < fields.size(); f++) {
+                if (fields[f].code == 324) fields[f] = longsField(324, offsets[i]);
+            }
+            uint32_t next = i + 1 < images.size() ? positions[i + 1] : 0;
+            std::vector<uint8_t> directory = tiffDirectory(fields, positions[i], next);
+            ok = fwrite(&directory[0], 1, directory.size(), file) == directory.size();
+        }
+        for (size_t i = images.size(); i-- > 0 && ok;) {
+            for (size_t t = 0; t < images[i].tiles.size() && ok; t++) {
+                const std::vector<uint8_t> &tile = images[i].tiles[t];
+                ok = fwrite(&tile[0], 1, tile.size(), file) == tile.size();
+            }
+        }
+        if (fclose(file) != 0 || !ok) {
+            throw RDConversionException("Could not write GeoTIFF file");
+        }
+    }
+
+    void
+    Radolan2GeoTIFF::convertFile(const char *radolanPath, const char *filename, const RDGeoTIFFOptions &options) {
+        RDScanFile scan(radolanPath, false);
+        convertScan(scan.get(), filename, options);
+    }
+}
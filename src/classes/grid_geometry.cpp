@@ -0,0 +1,125 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <map>
+
+#include <radolan/grid_geometry.h>
+
+namespace Radolan {
+
+    const RDGridGeometry *RDGridGeometry::forScan(const RDScan *scan) {
+        // products of the same size may sit on different grids (EZ and
+        // EX), so the key includes the position of the grid
+        typedef std::pair<std::pair<int, int>, std::pair<double, double> > Key;
+        static std::mutex cacheMutex;
+        static std::map<Key, RDGridGeometry *> cache;
+
+        RDCoordinateSystem rcs(scan->header.scanType);
+        RDCartesianPoint origin = rcs.cartesianCornerCoordinate(rdGridPoint(0, 0));
+        Key key(std::make_pair(scan->dimLon, scan->dimLat), std::make_pair(origin.x, origin.y));
+
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        std::map<Key, RDGridGeometry *>::iterator it = cache.find(key);
+        if (it != cache.end()) {
+            return it->second;
+        }
+        RDGridGeometry *geometry = new RDGridGeometry(scan->header.scanType, scan->dimLon, scan->dimLat);
+        cache[key] = geometry;
+        return geometry;
+    }
+
+    RDGridGeometry::RDGridGeometry(RDScanType type, int dimLon, int dimLat)
+            : m_dimLon(dimLon),
+              m_dimLat(dimLat),
+              m_coordinateSystem(type),
+              m_hasGeographical(false) {
+        m_cornerX.resize(dimLon + 1);
+        m_centreX.resize(dimLon);
+        for (int ix = 0; ix <= dimLon; ix++) {
+            m_cornerX[ix] = m_coordinateSystem.cartesianCornerCoordinate(rdGridPoint(ix, 0)).x;
+            if (ix < dimLon) m_centreX[ix] = m_coordinateSystem.cartesianCentreCoordinate(rdGridPoint(ix, 0)).x;
+        }
+
+        m_cornerY.resize(dimLat + 1);
+        m_centreY.resize(dimLat);
+        for (int iy = 0; iy <= dimLat; iy++) {
+            m_cornerY[iy] = m_coordinateSystem.cartesianCornerCoordinate(rdGridPoint(0, iy)).y;
+            if (iy < dimLat) m_centreY[iy] = m_coordinateSystem.cartesianCentreCoordinate(rdGridPoint(0, iy)).y;
+        }
+    }
+
+    void RDGridGeometry::computeGeographical() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_hasGeographical) return;
+
+        // the conversion only reads the coordinate system's state,
+        // but its methods are not const
+        RDCoordinateSystem rcs = m_coordinateSystem;
+
+        size_t corners = (size_t) (m_dimLon + 1) * (m_dimLat + 1);
+        m_cornerLon.resize(corners);
+        m_cornerLat.resize(corners);
+        for (int iy = 0; iy <= m_dimLat; iy++) {
+            for (int ix = 0; ix <= m_dimLon; ix++) {
+                RDGeographicalPoint geo = rcs.geographicalCoordinate(rdCartesianPoint(m_cornerX[ix], m_cornerY[iy]));
+                size_t i = (size_t) iy * (m_dimLon + 1) + ix;
+                m_cornerLon[i] = geo.longitude;
+                m_cornerLat[i] = geo.latitude;
+            }
+        }
+
+        size_t cells = (size_t) m_dimLon * m_dimLat;
+        m_centreLon.resize(cells);
+        m_centreLat.resize(cells);
+        for (int iy = 0; iy < m_dimLat; iy++) {
+            for (int ix = 0; ix < m_dimLon; ix++) {
+                RDGeographicalPoint geo = rcs.geographicalCoordinate(rdCartesianPoint(m_centreX[ix], m_centreY[iy]));
+                size_t i = (size_t) iy * m_dimLon + ix;
+                m_centreLon[i] = geo.longitude;
+                m_centreLat[i] = geo.latitude;
+            }
+        }
+
+        m_hasGeographical = true;
+    }
+
+    const double *RDGridGeometry::cornerLongitudes() const {
+        computeGeographical();
+        return &m_cornerLon[0];
+    }
+
+    const double *RDGridGeometry::cornerLatitudes() const {
+        computeGeographical();
+        return &m_cornerLat[0];
+    }
+
+    const double *RDGridGeometry::centreLongitudes() const {
+        computeGeographical();
+        return &m_centreLon[0];
+    }
+
+    const double *RDGridGeometry::centreLatitudes() const {
+        computeGeographical();
+        return &m_centreLat[0];
+    }
+}
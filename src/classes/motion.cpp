@@ -0,0 +1,414 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#include <radolan/grid_geometry.h>
+#include <radolan/motion.h>
+#include <radolan/radolan_utils.h>
+
+namespace Radolan {
+
+    // upper bound of the correlations with the current block moved by the shift
+    static const int RD_MOTION_REFINEMENTS = 4;
+
+    /**
+     * Radix-2 FFT of n x n values of a fixed power of two size n, with the
+     * twiddle factors and the bit reversal permutation computed once. Real
+     * and imaginary parts are kept in separate arrays, so the butterflies
+     * run along whole rows and vectorize.
+     */
+    class RDFFT {
+    public:
+
+        explicit RDFFT(int n) : m_n(n), m_cos(n / 2), m_sin(n / 2), m_reversed(n) {
+            int bits = 0;
+            while ((1 << bits) < n) bits++;
+            for (int i = 0; i < n; i++) {
+                int r = 0;
+                for (int b = 0; b < bits; b++) {
+                    if (i & (1 << b)) r |= 1 << (bits - 1 - b);
+                }
+                m_reversed[i] = r;
+            }
+            for (int i = 0; i < n / 2; i++) {
+                double angle = -2.0 * M_PI * i / n;
+                m_cos[i] = (float) cos(angle);
+                m_sin[i] = (float) sin(angle);
+            }
+        }
+
+        /**
+         * 2D transform in place. The forward result is transposed, which
+         * the inverse undoes. The inverse is not scaled.
+         */
+        void transform2D(float *re, float *im, bool inverse) const {
+            transformColumns(re, im, inverse);
+            transpose(re);
+            transpose(im);
+            transformColumns(re, im, inverse);
+        }
+
+    private:
+
+        // transforms all columns at once
+        void transformColumns(float *re, float *im, bool inverse) const {
+            int n = m_n;
+            for (int i = 0; i < n; i++) {
+                int j = m_reversed[i];
+                if (i < j) {
+                    std::swap_ranges(re + i * n, re + (i + 1) * n, re + j * n);
+                    std::swap_ranges(im + i * n, im + (i + 1) * n, im + j * n);
+                }
+            }
+            float sign = inverse ? -1.0f : 1.0f;
+            for (int length = 2; length <= n; length <<= 1) {
+                int half = length / 2;
+                int stride = n / length;
+                for (int start = 0; start < n; start += length) {
+                    for (int k = 0; k < half; k++) {
+                        float wr = m_cos[k * stride];
+                        float wi = sign * m_sin[k * stride];
+                        float *ar = re + (start + k) * n, *ai = im + (start + k) * n;
+                        float *br = ar + half * n, *bi = ai + half * n;
+                        for (int x = 0; x < n; x++) {
+                            float tr = wr * br[x] - wi * bi[x];
+                            float ti = wr * bi[x] + wi * br[x];
+                            br[x] = ar[x] - tr;
+                            bi[x] = ai[x] - ti;
+                            ar[x] += tr;
+                            ai[x] += ti;
+                        }
+                    }
+                }
+            }
+        }
+
+        void transpose(float *data) const {
+            for (int y = 0; y < m_n; y++) {
+                for (int x = y + 1; x < m_n; x++) {
+                    std::swap(data[y * m_n + x], data[x * m_n + y]);
+                }
+            }
+        }
+
+        int m_n;
+        std::vector<float> m_cos;
+        std::vector<float> m_sin;
+        std::vector<int> m_reversed;
+    };
+
+    /** Rain above the threshold, 0 elsewhere */
+    static std::vector<float> rdRainField(const RDScan *scan, float threshold) {
+        size_t count = (size_t) scan->dimLon * scan->dimLat;
+        std::vector<float> field(count);
+        RDScanType type = scan->header.scanType;
+        for (size_t i = 0; i < count; i++) {
+            float v = scan->data[i];
+            field[i] = RDIsCleanMeasurement(type, v) && v > threshold ? v - threshold : 0.0f;
+        }
+        return field;
+    }
+
+    /** Buffers of one worker, n x n values each */
+    typedef struct {
+        std::vector<float> re;
+        std::vector<float> im;
+        std::vector<float> crossRe;
+        std::vector<float> crossIm;
+    } RDMotionWorkspace;
+
+    /**
+     * Copies a block into the buffer with its mean removed and a Hann window
+     * applied. @return number of rain cells in the block
+     */
+    static int rdLoadBlock(const std::vector<float> &field, int dimLon, int x0, int y0, int n,
+                           const std::vector<float> &window, float *out) {
+        double sum = 0;
+        int rain = 0;
+        for (int y = 0; y < n; y++) {
+            const float *row = &field[(size_t) (y0 + y) * dimLon + x0];
+            for (int x = 0; x < n; x++) {
+                sum += row[x];
+                rain += row[x] > 0.0f;
+            }
+        }
+        float mean = (float) (sum / (n * n));
+        for (int y = 0; y < n; y++) {
+            const float *row = &field[(size_t) (y0 + y) * dimLon + x0];
+            for (int x = 0; x < n; x++) {
+                out[y * n + x] = (row[x] - mean) * window[y] * window[x];
+            }
+        }
+        return rain;
+    }
+
+    /** Sub-cell offset of a peak from its two neighbours (parabola fit) */
+    static float rdPeakOffset(float left, float centre, float right) {
+        float denominator = left - 2.0f * centre + right;
+        if (denominator >= 0.0f) return 0.0f;
+        float offset = 0.5f * (left - right) / denominator;
+        return std::max(-0.5f, std::min(0.5f, offset));
+    }
+
+    /**
+     * Phase correlation of the block at (x0,y0) in the previous field with
+     * the block at (x1,y1) in the current one.
+     * @return false if the blocks don't have enough rain
+     */
+    static bool rdCorrelateBlock(const std::vector<float> &previous, const std::vector<float> &current,
+                                 int dimLon, int x0, int y0, int x1, int y1, int n, int minimumRain,
+                                 const RDFFT &fft, const std::vector<float> &window,
+                                 RDMotionWorkspace &w, float &dx, float &dy, float &quality) {
+        float *re = &w.re[0], *im = &w.im[0];
+        float *crossRe = &w.crossRe[0], *crossIm = &w.crossIm[0];
+        if (rdLoadBlock(previous, dimLon, x0, y0, n, window, re) < minimumRain
+            || rdLoadBlock(current, dimLon, x1, y1, n, window, im) < minimumRain) {
+            return false;
+        }
+
+        // both real blocks in one complex transform: z = a + i b
+        fft.transform2D(re, im, false);
+
+        // cross-power spectrum conj(A) B, with A = (Z(k) + conj(Z(-k))) / 2
+        // and B = (Z(k) - conj(Z(-k))) / 2i
+        float largest = 0.0f;
+        for (int y = 0; y < n; y++) {
+            int my = (n - y) & (n - 1);
+            for (int x = 0; x < n; x++) {
+                int i = y * n + x;
+                int j = my * n + ((n - x) & (n - 1));
+                float ar = 0.5f * (re[i] + re[j]), ai = 0.5f * (im[i] - im[j]);
+                float br = 0.5f * (im[i] + im[j]), bi = -0.5f * (re[i] - re[j]);
+                crossRe[i] = ar * br + ai * bi;
+                crossIm[i] = ar * bi - ai * br;
+                largest = std::max(largest, crossRe[i] * crossRe[i] + crossIm[i] * crossIm[i]);
+            }
+        }
+
+        // normalized to unit magnitude except for the weakest frequencies,
+        // whose phase is mostly noise
+        float floor = 1e-3f * sqrtf(largest) + 1e-30f;
+        float total = 0.0f;
+        for (int i = 0; i < n * n; i++) {
+            float magnitude = sqrtf(crossRe[i] * crossRe[i] + crossIm[i] * crossIm[i]);
+            float weight = 1.0f / (magnitude + floor);
+            crossRe[i] *= weight;
+            crossIm[i] *= weight;
+            total += magnitude * weight;
+        }
+        if (total <= 0.0f) {
+            return false;
+        }
+        fft.transform2D(crossRe, crossIm, true);
+
+        int peak = 0;
+        for (int i = 1; i < n * n; i++) {
+            if (crossRe[i] > crossRe[peak]) peak = i;
+        }
+        int px = peak % n, py = peak / n;
+        float centre = crossRe[peak];
+        float left = crossRe[py * n + (px + n - 1) % n];
+        float right = crossRe[py * n + (px + 1) % n];
+        float below = crossRe[((py + n - 1) % n) * n + px];
+        float above = crossRe[((py + 1) % n) * n + px];
+
+        // shifts beyond half the block wrap around to negative ones
+        dx = (px > n / 2 ? px - n : px) + rdPeakOffset(left, centre, right) + (x1 - x0);
+        dy = (py > n / 2 ? py - n : py) + rdPeakOffset(below, centre, above) + (y1 - y0);
+        quality = centre / total;
+        return true;
+    }
+
+    /** Fills the vectors without estimate with the mean of their filled neighbours */
+    static void rdFillMotion(RDMotionField &field) {
+        std::vector<bool> filled(field.vectors.size());
+        for (size_t i = 0; i < filled.size(); i++) filled[i] = field.vectors[i].estimated;
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            std::vector<bool> next = filled;
+            for (int row = 0; row < field.rows; row++) {
+                for (int column = 0; column < field.columns; column++) {
+                    size_t index = (size_t) row * field.columns + column;
+                    if (filled[index]) continue;
+                    double u = 0, v = 0;
+                    int count = 0;
+                    for (int r = std::max(0, row - 1); r <= std::min(field.rows - 1, row + 1); r++) {
+                        for (int c = std::max(0, column - 1); c <= std::min(field.columns - 1, column + 1); c++) {
+                            size_t neighbour = (size_t) r * field.columns + c;
+                            if (!filled[neighbour]) continue;
+                            u += field.vectors[neighbour].u;
+                            v += field.vectors[neighbour].v;
+                            count++;
+                        }
+                    }
+                    if (count > 0) {
+                        field.vectors[index].u = (float) (u / count);
+                        field.vectors[index].v = (float) (v / count);
+                        next[index] = true;
+                        changed = true;
+                    }
+                }
+            }
+            filled.swap(next);
+        }
+    }
+
+    RDMotionField RDEstimateMotion(const RDScan *previous,
+                                   const RDScan *current,
+                                   const RDMotionOptions &options) {
+        int n = options.blockSize;
+        if (n < 4 || (n & (n - 1)) != 0) {
+            throw RDConversionException("Block size must be a power of two of at least 4");
+        }
+        if (options.blockStep <= 0) {
+            throw RDConversionException("Block step must be positive");
+        }
+        if (previous->header.scanType != current->header.scanType
+            || previous->dimLon != current->dimLon || previous->dimLat != current->dimLat) {
+            throw RDConversionException("Scans are of different products or grids");
+        }
+        if (previous->dimLon < n || previous->dimLat < n) {
+            throw RDConversionException("Grid is smaller than a block");
+        }
+        double seconds = difftime(RDScanTimeInSecondsSinceEpoch((RDScan *) current),
+                                  RDScanTimeInSecondsSinceEpoch((RDScan *) previous));
+        if (seconds <= 0) {
+            throw RDConversionException("Scans are not in chronological order");
+        }
+
+        int dimLon = previous->dimLon;
+        int dimLat = previous->dimLat;
+        const RDGridGeometry *geometry = RDGridGeometry::forScan(previous);
+
+        RDMotionField field;
+        field.step = options.blockStep;
+        field.columns = (dimLon - n) / options.blockStep + 1;
+        field.rows = (previous->dimLat - n) / options.blockStep + 1;
+        field.originX = field.originY = n / 2.0 - 0.5;
+        field.cellSizeX = fabs(geometry->cornerX()[dimLon] - geometry->cornerX()[0]) / dimLon;
+        field.cellSizeY = fabs(geometry->cornerY()[previous->dimLat] - geometry->cornerY()[0]) / previous->dimLat;
+        RDMotionVector none = {0.0f, 0.0f, 0.0f, false};
+        field.vectors.assign((size_t) field.columns * field.rows, none);
+
+        std::vector<float> a = rdRainField(previous, options.threshold);
+        std::vector<float> b = rdRainField(current, options.threshold);
+
+        RDFFT fft(n);
+        std::vector<float> window(n);
+        for (int i = 0; i < n; i++) {
+            window[i] = (float) (0.5 - 0.5 * cos(2.0 * M_PI * (i + 0.5) / n));
+        }
+        int minimumRain = (int) ceil(options.minimumRainFraction * n * n);
+        double kmhX = field.cellSizeX * 3600.0 / seconds;
+        double kmhY = field.cellSizeY * 3600.0 / seconds;
+
+        unsigned int threads = options.threads;
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = std::min(threads, (unsigned int) field.vectors.size());
+
+        std::atomic<size_t> next(0);
+        auto work = [&]() {
+            RDMotionWorkspace w;
+            w.re.resize((size_t) n * n);
+            w.im.resize((size_t) n * n);
+            w.crossRe.resize((size_t) n * n);
+            w.crossIm.resize((size_t) n * n);
+            for (size_t block = next++; block < field.vectors.size(); block = next++) {
+                int x0 = (int) (block % field.columns) * options.blockStep;
+                int y0 = (int) (block / field.columns) * options.blockStep;
+                float dx, dy, quality;
+                if (!rdCorrelateBlock(a, b, dimLon, x0, y0, x0, y0, n, minimumRain, fft, window, w,
+                                      dx, dy, quality)) {
+                    continue;
+                }
+                // the window biases the shift towards 0. Correlating again with
+                // the current block moved by the shift leaves a smaller rest,
+                // repeated until the whole cells of the shift stay the same.
+                int x1 = x0, y1 = y0;
+                for (int refinement = 0; refinement < RD_MOTION_REFINEMENTS; refinement++) {
+                    int nextX = std::max(0, std::min(dimLon - n, x0 + (int) floor(dx + 0.5f)));
+                    int nextY = std::max(0, std::min(dimLat - n, y0 + (int) floor(dy + 0.5f)));
+                    float refinedX, refinedY, refinedQuality;
+                    if ((nextX == x1 && nextY == y1)
+                        || !rdCorrelateBlock(a, b, dimLon, x0, y0, nextX, nextY, n, minimumRain, fft, window, w,
+                                             refinedX, refinedY, refinedQuality)) {
+                        break;
+                    }
+                    x1 = nextX;
+                    y1 = nextY;
+                    dx = refinedX;
+                    dy = refinedY;
+                    quality = refinedQuality;
+                }
+                RDMotionVector &vector = field.vectors[block];
+                vector.u = (float) (dx * kmhX);
+                vector.v = (float) (dy * kmhY);
+                vector.quality = quality;
+                vector.estimated = true;
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned int t = 1; t < threads; t++) {
+            workers.push_back(std::thread(work));
+        }
+        work();
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+
+        rdFillMotion(field);
+        return field;
+    }
+
+    RDMotionVector RDMotionAt(const RDMotionField &field, double x, double y) {
+        double gx = (x - field.originX) / field.step;
+        double gy = (y - field.originY) / field.step;
+        gx = std::max(0.0, std::min((double) field.columns - 1, gx));
+        gy = std::max(0.0, std::min((double) field.rows - 1, gy));
+
+        int c0 = std::min((int) gx, field.columns - 1), r0 = std::min((int) gy, field.rows - 1);
+        int c1 = std::min(c0 + 1, field.columns - 1), r1 = std::min(r0 + 1, field.rows - 1);
+        double tx = gx - c0, ty = gy - r0;
+
+        const RDMotionVector &v00 = field.vectors[(size_t) r0 * field.columns + c0];
+        const RDMotionVector &v10 = field.vectors[(size_t) r0 * field.columns + c1];
+        const RDMotionVector &v01 = field.vectors[(size_t) r1 * field.columns + c0];
+        const RDMotionVector &v11 = field.vectors[(size_t) r1 * field.columns + c1];
+
+        RDMotionVector result;
+        result.u = (float) ((1 - ty) * ((1 - tx) * v00.u + tx * v10.u) + ty * ((1 - tx) * v01.u + tx * v11.u));
+        result.v = (float) ((1 - ty) * ((1 - tx) * v00.v + tx * v10.v) + ty * ((1 - tx) * v01.v + tx * v11.v));
+        result.quality = 0.0f;
+        result.estimated = false;
+        return result;
+    }
+}
@@ -0,0 +1,298 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include <radolan/neighbourhood.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+
+namespace Radolan {
+
+    /** Runs tasks 0..count-1 on up to the given number of threads (0: all cores) */
+    static void rdForEachTask(size_t count, unsigned int threads, const std::function<void(size_t)> &task) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = (unsigned int) std::min((size_t) threads, count);
+        std::atomic<size_t> next(0);
+        auto work = [&]() {
+            for (size_t i = next++; i < count; i = next++) {
+                task(i);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned int t = 1; t < threads; t++) {
+            workers.push_back(std::thread(work));
+        }
+        work();
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+    }
+
+    static void rdCheckWindows(const std::vector<int> &windows) {
+        for (size_t i = 0; i < windows.size(); i++) {
+            if (windows[i] <= 0 || windows[i] % 2 == 0) {
+                throw RDConversionException("Window sizes must be odd and positive");
+            }
+        }
+    }
+
+    // 1 where the value is clean, times the threshold test if given
+    static std::vector<float> rdMask(const RDScan *scan, const RDDataType *threshold) {
+        size_t count = (size_t) scan->dimLon * scan->dimLat;
+        RDScanType type = scan->header.scanType;
+        std::vector<float> mask(count);
+        for (size_t i = 0; i < count; i++) {
+            RDDataType v = scan->data[i];
+            bool set = RDIsCleanMeasurement(type, v) && (threshold == NULL || v >= *threshold);
+            mask[i] = set ? 1.0f : 0.0f;
+        }
+        return mask;
+    }
+
+    RDSummedAreaTable::RDSummedAreaTable() : m_dimLon(0), m_dimLat(0) {
+    }
+
+    void RDSummedAreaTable::build(const RDScan *scan) {
+        size_t count = (size_t) scan->dimLon * scan->dimLat;
+        RDScanType type = scan->header.scanType;
+        std::vector<float> values(count);
+        for (size_t i = 0; i < count; i++) {
+            RDDataType v = scan->data[i];
+            values[i] = RDIsCleanMeasurement(type, v) ? v : 0.0f;
+        }
+        build(&values[0], scan->dimLon, scan->dimLat);
+    }
+
+    void RDSummedAreaTable::buildMask(const RDScan *scan, RDDataType threshold) {
+        build(&rdMask(scan, &threshold)[0], scan->dimLon, scan->dimLat);
+    }
+
+    void RDSummedAreaTable::buildValidMask(const RDScan *scan) {
+        build(&rdMask(scan, NULL)[0], scan->dimLon, scan->dimLat);
+    }
+
+    void RDSummedAreaTable::build(const float *values, int dimLon, int dimLat) {
+        m_dimLon = dimLon;
+        m_dimLat = dimLat;
+        size_t stride = (size_t) dimLon + 1;
+        m_table.assign(stride * (dimLat + 1), 0.0);
+        for (int iy = 0; iy < dimLat; iy++) {
+            const float *row = values + (size_t) iy * dimLon;
+            const double *above = &m_table[(size_t) iy * stride];
+            double *table = &m_table[(size_t) (iy + 1) * stride];
+            double rowSum = 0.0;
+            for (int ix = 0; ix < dimLon; ix++) {
+                rowSum += row[ix];
+                table[ix + 1] = above[ix + 1] + rowSum;
+            }
+        }
+    }
+
+    double RDSummedAreaTable::boxSum(int x0, int y0, int x1, int y1) const {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, m_dimLon - 1);
+        y1 = std::min(y1, m_dimLat - 1);
+        if (x1 < x0 || y1 < y0) return 0.0;
+        size_t stride = (size_t) m_dimLon + 1;
+        const double *lower = &m_table[(size_t) y0 * stride];
+        const double *upper = &m_table[(size_t) (y1 + 1) * stride];
+        return upper[x1 + 1] - lower[x1 + 1] - upper[x0] + lower[x0];
+    }
+
+    void RDSummedAreaTable::windowSumsOfRow(int iy, int window, double *out) const {
+        int half = window / 2;
+        size_t stride = (size_t) m_dimLon + 1;
+        const double *lower = &m_table[(size_t) std::max(iy - half, 0) * stride];
+        const double *upper = &m_table[(size_t) (std::min(iy + half, m_dimLat - 1) + 1) * stride];
+        for (int ix = 0; ix < m_dimLon; ix++) {
+            int x0 = std::max(ix - half, 0);
+            int x1 = std::min(ix + half, m_dimLon - 1) + 1;
+            out[ix] = (upper[x1] - lower[x1]) - (upper[x0] - lower[x0]);
+        }
+    }
+
+    void RDSummedAreaTable::windowSums(int window, double *out) const {
+        for (int iy = 0; iy < m_dimLat; iy++) {
+            windowSumsOfRow(iy, window, out + (size_t) iy * m_dimLon);
+        }
+    }
+
+    std::vector<RDFractionsSkillScore> RDComputeFSS(const RDScan *forecast,
+                                                    const RDScan *observed,
+                                                    const std::vector<RDDataType> &thresholds,
+                                                    const std::vector<int> &windows,
+                                                    unsigned int threads) {
+        if (forecast->dimLon != observed->dimLon || forecast->dimLat != observed->dimLat) {
+            throw RDConversionException("Forecast and observation have different grids");
+        }
+        rdCheckWindows(windows);
+
+        int dimLon = forecast->dimLon;
+        int dimLat = forecast->dimLat;
+        size_t count = (size_t) dimLon * dimLat;
+
+        // cells with clean values in both scans
+        std::vector<float> valid = rdMask(forecast, NULL);
+        std::vector<float> validObserved = rdMask(observed, NULL);
+        double validCount = 0;
+        for (size_t i = 0; i < count; i++) {
+            valid[i] *= validObserved[i];
+            validCount += valid[i];
+        }
+        validObserved.clear();
+        RDSummedAreaTable validTable;
+        validTable.build(&valid[0], dimLon, dimLat);
+
+        // exceedance tables per threshold
+        std::vector<RDSummedAreaTable> forecastTables(thresholds.size());
+        std::vector<RDSummedAreaTable> observedTables(thresholds.size());
+        std::vector<double> forecastCounts(thresholds.size());
+        std::vector<double> observedCounts(thresholds.size());
+        rdForEachTask(thresholds.size() * 2, threads, [&](size_t task) {
+            size_t t = task / 2;
+            bool isForecast = task % 2 == 0;
+            std::vector<float> mask = rdMask(isForecast ? forecast : observed, &thresholds[t]);
+            double exceeding = 0;
+            for (size_t i = 0; i < count; i++) {
+                mask[i] *= valid[i];
+                exceeding += mask[i];
+            }
+            (isForecast ? forecastTables : observedTables)[t].build(&mask[0], dimLon, dimLat);
+            (isForecast ? forecastCounts : observedCounts)[t] = exceeding;
+        });
+
+        std::vector<RDFractionsSkillScore> scores(thresholds.size() * windows.size());
+        rdForEachTask(scores.size(), threads, [&](size_t task) {
+            size_t t = task / windows.size();
+            int window = windows[task % windows.size()];
+            std::vector<double> validSums(dimLon), forecastSums(dimLon), observedSums(dimLon);
+
+            double difference = 0, reference = 0;
+            for (int iy = 0; iy < dimLat; iy++) {
+                validTable.windowSumsOfRow(iy, window, &validSums[0]);
+                forecastTables[t].windowSumsOfRow(iy, window, &forecastSums[0]);
+                observedTables[t].windowSumsOfRow(iy, window, &observedSums[0]);
+                const float *validRow = &valid[(size_t) iy * dimLon];
+                for (int ix = 0; ix < dimLon; ix++) {
+                    if (validRow[ix] == 0.0f) continue;
+                    double pf = forecastSums[ix] / validSums[ix];
+                    double po = observedSums[ix] / validSums[ix];
+                    difference += (pf - po) * (pf - po);
+                    reference += pf * pf + po * po;
+                }
+            }
+
+            RDFractionsSkillScore &score = scores[task];
+            score.threshold = thresholds[t];
+            score.window = window;
+            score.fss = reference > 0 ? 1.0 - difference / reference : NAN;
+            score.observedFraction = validCount > 0 ? observedCounts[t] / validCount : 0.0;
+            score.forecastFraction = validCount > 0 ? forecastCounts[t] / validCount : 0.0;
+            score.fssUniform = 0.5 + score.observedFraction / 2.0;
+        });
+        return scores;
+    }
+
+    std::vector<RDScan *> RDNeighbourhoodProbabilities(const RDScan *scan,
+                                                       const std::vector<RDDataType> &thresholds,
+                                                       const std::vector<int> &windows,
+                                                       unsigned int threads) {
+        rdCheckWindows(windows);
+
+        int dimLon = scan->dimLon;
+        int dimLat = scan->dimLat;
+        size_t count = (size_t) dimLon * dimLat;
+        RDDataType missing = RDMissingValue(scan->header.scanType);
+
+        std::vector<RDScan *> results;
+        try {
+            for (size_t i = 0; i < thresholds.size() * windows.size(); i++) {
+                RDScan *result = RDAllocateScan();
+                if (result == NULL) {
+                    throw RDConversionException("Could not allocate scan");
+                }
+                results.push_back(result);
+                result->data = (RDDataType *) malloc(count * sizeof(RDDataType));
+                if (result->data == NULL) {
+                    throw RDConversionException("Could not allocate scan data");
+                }
+                result->header = scan->header;
+                result->header.radarStations = NULL;
+                result->header.numberOfRadarStations = 0;
+                result->filename[0] = '\0';
+                result->dimLon = dimLon;
+                result->dimLat = dimLat;
+                result->dbZPerUnit = 0;
+            }
+        } catch (const RDConversionException &) {
+            for (size_t i = 0; i < results.size(); i++) RDFreeScan(results[i]);
+            throw;
+        }
+
+        RDSummedAreaTable validTable;
+        validTable.buildValidMask(scan);
+        std::vector<RDSummedAreaTable> tables(thresholds.size());
+        rdForEachTask(thresholds.size(), threads, [&](size_t t) {
+            tables[t].buildMask(scan, thresholds[t]);
+        });
+
+        rdForEachTask(results.size(), threads, [&](size_t task) {
+            size_t t = task / windows.size();
+            int window = windows[task % windows.size()];
+            RDScan *result = results[task];
+            std::vector<double> validSums(dimLon), sums(dimLon);
+            RDDataType maximum = 0;
+            for (int iy = 0; iy < dimLat; iy++) {
+                validTable.windowSumsOfRow(iy, window, &validSums[0]);
+                tables[t].windowSumsOfRow(iy, window, &sums[0]);
+                RDDataType *row = result->data + (size_t) iy * dimLon;
+                for (int ix = 0; ix < dimLon; ix++) {
+                    if (validSums[ix] > 0) {
+                        row[ix] = (RDDataType) (sums[ix] / validSums[ix]);
+                        maximum = std::max(maximum, row[ix]);
+                    } else {
+                        row[ix] = missing;
+                    }
+                }
+            }
+            result->min_value = 0;
+            result->max_value = maximum;
+        });
+        return results;
+    }
+
+    RDScan *RDNeighbourhoodProbability(const RDScan *scan, RDDataType threshold, int window) {
+        return RDNeighbourhoodProbabilities(scan, std::vector<RDDataType>(1, threshold),
+                                            std::vector<int>(1, window), 1)[0];
+    }
+}
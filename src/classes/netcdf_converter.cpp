@@ -20,9 +20,19 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
-
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
 #include <netcdf>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
 
 #include <radolan/types.h>
 #include <radolan/netcdf_converter.h>
@@ -34,72 +44,56 @@ namespace Radolan
 
 #define ADD_DIMENSION_Z 0
 
-    netCDF::NcFile *
-    Radolan2NetCDF::convertFile(const char *radolanPath,
-                                const char *netcdfPath,
-                                bool write_one_bytes_as_byte,
-                                const RDDataType *threshold,
-                                netCDF::NcFile::FileMode mode,
-                                bool omitOutside) {
-        if (mode == netCDF::NcFile::read) {
-            throw RDConversionException("Mode 'ReadOnly' does not make sense");
-        }
-        RDScan *scan = RDAllocateScan();
-        int res = RDReadScan(radolanPath, scan, omitOutside);
-        switch (res) {
-            case -1:
-                throw RDConversionException("Insufficient memory for reading radolan scan");
-                break;
-            case -2:
-                throw RDConversionException("Radolan file not found");
-                break;
-            case -3:
-                throw RDConversionException("I/O eror when reading radolan file");
-                break;
-            default:
-                break;
-        }
-        netCDF::NcFile *file = Radolan2NetCDF::convertScan(scan, netcdfPath, write_one_bytes_as_byte, threshold, mode);
-        RDFreeScan(scan);
-        return file;
+    /**
+     * Writes the global attributes common to all converted files.
+     */
+    static void
+    addGlobalAttributes(const netCDF::NcGroup &group) {
+        group.putAtt("Conventions", "CF 1.6");
+        group.putAtt("title", "Radolan composite in NetCDF/CF-Metadata form.");
+        group.putAtt("institution", "German Weather Forecast Service (DWD)");
+        group.putAtt("version", "1.0");
     }
 
-    netCDF::NcFile *
-    Radolan2NetCDF::convertScan(RDScan *scan,
-                                const char *netcdfPath,
-                                bool write_one_bytes_as_byte,
-                                const RDDataType *threshold,
-                                netCDF::NcFile::FileMode mode) {
+    /**
+     * Adds the time dimension and coordinate variable and writes
+     * the scan's timestamp into it.
+     */
+    static netCDF::NcDim
+    addTimeCoordinate(const netCDF::NcGroup &group, RDScan *scan) {
         using namespace netCDF;
-        using namespace std;
 
-        NcFile *file = NULL;
-        try {
-            file = new netCDF::NcFile(netcdfPath, mode);
-        } catch (const netCDF::exceptions::NcException &e) {
-            cerr << "ERROR:exception while creating file " << netcdfPath << " : " << e.what() << endl;
-            throw RDConversionException(e.what());
-        }
+        NcDim dimT = group.addDim("time", 1);
 
-        // Global attributes
-        file->putAtt("Conventions", "CF 1.6");
-        file->putAtt("title", "Radolan composite in NetCDF/CF-Metadata form.");
-        file->putAtt("institution", "German Weather Forecast Service (DWD)");
-        file->putAtt("version", "1.0");
+        double timestamp = (double) RDScanTimeInSecondsSinceEpoch(scan);
 
-        // Dimensions
-        vector<NcDim> dims;
-        NcDim dimT = file->addDim("time", 1);
-        NcDim dimX = file->addDim("x", scan->dimLon);
-        NcDim dimY = file->addDim("y", scan->dimLat);
+        NcVar time = group.addVar("time", ncDouble, dimT);
+        time.putVar(&timestamp);
+        time.putAtt("units", "seconds since 1970-01-01 00:00:00.0");
+        time.putAtt("calendar", "gregorian");
+        time.putAtt("standard_name", "time");
 
-#if ADD_DIMENSION_Z
-        NcDim dimZ = file->addDim("z", 1);
-#endif
+        return dimT;
+    }
 
-        // dims.push_back(dimT);
+    /**
+     * Adds the x/y dimensions, coordinate variables and the grid mapping
+     * for the scan's grid to the given group.
+     *
+     * @return dimensions to be used for data variables on this grid
+     */
+    static std::vector<netCDF::NcDim>
+    addGridCoordinates(const netCDF::NcGroup &group, RDScan *scan) {
+        using namespace netCDF;
+        using namespace std;
+
+        // Dimensions
+        vector<NcDim> dims;
+        NcDim dimX = group.addDim("x", scan->dimLon);
+        NcDim dimY = group.addDim("y", scan->dimLat);
 
 #if ADD_DIMENSION_Z
+        NcDim dimZ = group.addDim("z", 1);
         dims.push_back(dimZ);
 #endif
 
@@ -110,16 +104,16 @@ namespace Radolan
 
         // Coordinates
 
-        netCDF::NcVar x = file->addVar("x", ncDouble, dimX);
+        NcVar x = group.addVar("x", ncDouble, dimX);
         x.putAtt("standard_name", "projection_x_coordinate");
         x.putAtt("units", "km");
 
-        NcVar y = file->addVar("y", ncDouble, dimY);
+        NcVar y = group.addVar("y", ncDouble, dimY);
         y.putAtt("standard_name", "projection_y_coordinate");
         y.putAtt("units", "km");
 
 #if ADD_DIMENSION_Z
-        NcVar z = file->addVar("z", ncDouble, dimZ);
+        NcVar z = group.addVar("z", ncDouble, dimZ);
         z.putAtt("standard_name", "projection_z_coordinate");
         z.putAtt("units", "km");
 #endif
@@ -127,7 +121,7 @@ namespace Radolan
         RDGridPoint origin = rdGridPoint(0, 0);
         RDGeographicalPoint origin_geo = rcs.geographicalCoordinate(origin);
 
-        NcVar crs = file->addVar("crs", NcType::nc_BYTE, dims); // note: type is of no consequence
+        NcVar crs = group.addVar("crs", NcType::nc_BYTE, dims); // note: type is of no consequence
         crs.putAtt("grid_mapping_name", "polar_stereographic");
         crs.putAtt("longitude_of_projection_origin", NcType::nc_DOUBLE, origin_geo.longitude);
         crs.putAtt("latitude_of_projection_origin", NcType::nc_DOUBLE, origin_geo.latitude);
@@ -137,11 +131,137 @@ namespace Radolan
                    rcs.polarStereographicScalingFactor(origin_geo.longitude, origin_geo.latitude));
         crs.putAtt("units", "km");
 
-        // Data
+        // write x-axis information (cell centres, as all other exporters)
+        const RDGridGeometry *grid = RDGridGeometry::forScan(scan);
+        const double *xData = grid->centreX();
+        x.putVar(xData);
+        x.putAtt("valid_min", ncDouble, xData[0]);
+        x.putAtt("valid_max", ncDouble, xData[scan->dimLon - 1]);
+
+        // write y-axis information
+        const double *yData = grid->centreY();
+        y.putVar(yData);
+        y.putAtt("valid_min", ncDouble, yData[0]);
+        y.putAtt("valid_max", ncDouble, yData[scan->dimLat - 1]);
+
+#if ADD_DIMENSION_Z
+        // write z-Axis information
+        float *zData = (float *) malloc(sizeof (float) * 1);
+        zData[0] = 0.0;
+        z.putVar(zData);
+        z.putAtt("valid_min", ncFloat, zData[0]);
+        z.putAtt("valid_max", ncFloat, zData[0]);
+        free(zData);
+#endif
+        return dims;
+    }
+
+    /**
+     * Scan data as it goes into the data variable: threshold applied,
+     * packed into RVP6 bytes or bit rounded. Preparing the data needs no
+     * netCDF calls, so it can be done on any thread.
+     */
+    struct RDPreparedData {
+        bool asBytes;
+        bool quantized;
+        int nsb;
+        std::vector<RDByteType> bytes;
+        std::vector<RDDataType> values;
+    };
+
+    static void
+    prepareScanData(RDScan *scan,
+                    bool write_one_bytes_as_byte,
+                    const RDDataType *threshold,
+                    bool quantize,
+                    RDPreparedData &prepared) {
         bool is_one_byte = scan->header.scanType == RD_EX || scan->header.scanType == RD_RX;
+        size_t cells = (size_t) scan->dimLon * scan->dimLat;
+
+        // Bit rounding only applies to FLOAT data on a known precision grid
+        prepared.asBytes = is_one_byte && write_one_bytes_as_byte;
+        prepared.quantized = quantize && !prepared.asBytes && scan->header.precision > 0.0f;
+        prepared.nsb = 0;
+
+        // Re-package data: x and y are switched around in the data (following
+        // the cf-metadata convention)
+
+        if (prepared.asBytes) {
+            prepared.bytes.resize(cells);
+            RDByteType *buffer = &prepared.bytes[0];
+
+            for (int iy = 0; iy < scan->dimLon; iy++) {
+                for (int ix = 0; ix < scan->dimLat; ix++) {
+                    size_t index = iy * scan->dimLat + ix;
+                    RDDataType val = scan->data[index];
+                    RDByteType byteValue = RDRVP6ToByteValue(val);
+
+                    if (val == RDMissingValue(scan->header.scanType)) {
+                        buffer[index] = RX_ERROR_VALUE;
+                    } else {
+                        // if a threshold is enabled, check the
+                        // threshold first. This is checked on
+                        // the converted value, not the byte value
+
+                        bool should_write = (threshold == NULL)
+                                            ? true
+                                            : (val >= (*threshold));
+
+                        buffer[index] = should_write ? byteValue : 0x00;
+                    }
+                }
+            }
+        } else {
+            prepared.values.resize(cells);
+            RDDataType *converted = &prepared.values[0];
+
+            for (int iy = 0; iy < scan->dimLon; iy++) {
+                for (int ix = 0; ix < scan->dimLat; ix++) {
+                    size_t index = iy * scan->dimLat + ix;
+                    RDDataType val = scan->data[index];
+
+                    if (val == RDMissingValue(scan->header.scanType)) {
+                        // If the value is marked missing, use
+                        // it as it is
+                        converted[index] = RDMissingValue(scan->header.scanType);
+                    } else {
+                        // if a threshold is enabled, check the
+                        // threshold first
+
+                        bool should_write = (threshold == NULL)
+                                            ? true
+                                            : (val >= (*threshold));
+
+                        converted[index] = should_write
+                                           ? val
+                                           : RDMinValue(scan->header.scanType);
+                    }
+                }
+            }
+
+            if (prepared.quantized) {
+                prepared.nsb = RDBitRound(converted, scan->dimLon * scan->dimLat,
+                                          scan->header.precision, RDMissingValue(scan->header.scanType));
+            }
+        }
+    }
+
+    /**
+     * Adds a data variable named after the scan's product and writes
+     * the prepared data into it.
+     */
+    static void
+    addScanVariable(const netCDF::NcGroup &group,
+                    const std::vector<netCDF::NcDim> &dims,
+                    RDScan *scan,
+                    const RDPreparedData &prepared) {
+        using namespace netCDF;
+        using namespace std;
+
+        // Data
         NcVar data;
-        if (is_one_byte && write_one_bytes_as_byte) {
-            data = file->addVar(RDScanTypeToString(scan->header.scanType), ncUbyte, dims);
+        if (prepared.asBytes) {
+            data = group.addVar(RDScanTypeToString(scan->header.scanType), ncUbyte, dims);
 
             RDByteType valid_min = RDRVP6ToByteValue(RDMinValue(scan->header.scanType));
             data.putAtt("valid_min", ncInt, valid_min);
@@ -156,7 +276,7 @@ namespace Radolan
             data.putAtt("add_offset", ncFloat, -32.5f);
             data.putAtt("scale_factor", ncFloat, 0.5f);
         } else {
-            data = file->addVar(RDScanTypeToString(scan->header.scanType), ncFloat, dims);
+            data = group.addVar(RDScanTypeToString(scan->header.scanType), ncFloat, dims);
             data.putAtt("valid_min", ncFloat, RDMinValue(scan->header.scanType));
             data.putAtt("valid_max", ncFloat, RDMaxValue(scan->header.scanType));
             data.putAtt("_FillValue", ncFloat, RDMissingValue(scan->header.scanType));
@@ -164,22 +284,14 @@ namespace Radolan
 
         // Enable compression: no shuffle filter, compression rate 1
         // (see http://www.unidata.ucar.edu/software/netcdf/papers/AMS_2008.pdf)
-        data.setCompression(false, true, 1);
+        // The zeroed trailing bits of quantized data only pay off when
+        // the bytes are shuffled, though.
+        data.setCompression(prepared.quantized, true, 1);
 
         data.putAtt("grid_mapping", "polar_stereographic");
         data.putAtt("radolan_product", RDScanTypeToString(scan->header.scanType));
         data.putAtt("standard_name", Radolan2NetCDF::getStandardName(scan->header.scanType));
 
-        // TIME
-
-        double timestamp = (double) RDScanTimeInSecondsSinceEpoch(scan);
-
-        NcVar time = file->addVar("time", ncDouble, dimT);
-        time.putVar(&timestamp);
-        time.putAtt("units", "seconds since 1970-01-01 00:00:00.0");
-        time.putAtt("calendar", "gregorian");
-        time.putAtt("standard_name", "time");
-
         // start point and counters for writing
         // the buffer to netcdf
 
@@ -198,163 +310,530 @@ namespace Radolan
         countp[1] = scan->dimLon;
         #endif
 
-        // Re-package data: x and y are switched around in the data (following
-        // the cf-metadata convention)
+        if (prepared.quantized) {
+            // CF 1.11 quantization container, shared by all
+            // variables of the group
+            if (group.getVar("quantization_info").isNull()) {
+                NcVar info = group.addVar("quantization_info", ncByte);
+                info.putAtt("algorithm", "bitround");
+                info.putAtt("implementation", "libradolan RDBitRound");
+                info.putAtt("comment", "Mantissa bits below half the product precision (PR) are rounded "
+                                       "to zero. quantization_nsb is the number of bits kept for the "
+                                       "largest value, smaller values keep fewer bits.");
+            }
+            data.putAtt("quantization", "quantization_info");
+            data.putAtt("quantization_nsb", ncInt, prepared.nsb);
+            data.putAtt("least_significant_digit", ncInt, (int) lround(-log10(scan->header.precision)));
+        }
 
-        if (is_one_byte && write_one_bytes_as_byte) {
-            size_t memSize = scan->dimLon * scan->dimLat * sizeof(RDByteType);
-            RDByteType *buffer = (RDByteType *) malloc(memSize);
+        // write out
+        try {
+            if (prepared.asBytes) {
+                data.putVar(startp, countp, &prepared.bytes[0]);
+            } else {
+                data.putVar(startp, countp, &prepared.values[0]);
+            }
+        } catch (const std::exception &e) {
+            throw RDConversionException(e.what());
+        }
+    }
 
-            for (int iy = 0; iy < scan->dimLon; iy++) {
-                for (int ix = 0; ix < scan->dimLat; ix++) {
-                    size_t index = iy * scan->dimLat + ix;
-                    RDDataType val = scan->data[index];
-                    RDByteType byteValue = RDRVP6ToByteValue(val);
+    /**
+     * Adds a data variable named after the scan's product and writes
+     * the scan data into it.
+     */
+    static void
+    addScanVariable(const netCDF::NcGroup &group,
+                    const std::vector<netCDF::NcDim> &dims,
+                    RDScan *scan,
+                    bool write_one_bytes_as_byte,
+                    const RDDataType *threshold,
+                    bool quantize) {
+        RDPreparedData prepared;
+        prepareScanData(scan, write_one_bytes_as_byte, threshold, quantize, prepared);
+        addScanVariable(group, dims, scan, prepared);
+    }
 
-                    if (val == RDMissingValue(scan->header.scanType)) {
-                        buffer[index] = RX_ERROR_VALUE;
-                    } else {
-                        // if a threshold is enabled, check the
-                        // threshold first. This is checked on
-                        // the converted value, not the byte value
+    /**
+     * Creates a NetCDF file holding a single scan.
+     */
+    static netCDF::NcFile *
+    createScanFile(RDScan *scan,
+                   const char *netcdfPath,
+                   netCDF::NcFile::FileMode mode,
+                   const RDPreparedData &prepared) {
+        using namespace netCDF;
+        using namespace std;
 
-                        bool should_write = (threshold == NULL)
-                                            ? true
-                                            : (val >= (*threshold));
+        NcFile *file = NULL;
+        try {
+            file = new netCDF::NcFile(netcdfPath, mode);
+        } catch (const netCDF::exceptions::NcException &e) {
+            cerr << "ERROR:exception while creating file " << netcdfPath << " : " << e.what() << endl;
+            throw RDConversionException(e.what());
+        }
 
-                        buffer[index] = should_write ? byteValue : 0x00;
-                    }
-                }
+        addGlobalAttributes(*file);
+        addTimeCoordinate(*file, scan);
+        vector<NcDim> dims = addGridCoordinates(*file, scan);
+        addScanVariable(*file, dims, scan, prepared);
+
+        return file;
+    }
+
+    netCDF::NcFile *
+    Radolan2NetCDF::convertFile(const char *radolanPath,
+                                const char *netcdfPath,
+                                bool write_one_bytes_as_byte,
+                                const RDDataType *threshold,
+                                netCDF::NcFile::FileMode mode,
+                                bool omitOutside,
+                                bool quantize) {
+        if (mode == netCDF::NcFile::read) {
+            throw RDConversionException("Mode 'ReadOnly' does not make sense");
+        }
+        RDScan *scan = RDAllocateScan();
+        int res = RDReadScan(radolanPath, scan, omitOutside);
+        switch (res) {
+            case -1:
+                throw RDConversionException("Insufficient memory for reading radolan scan");
+                break;
+            case -2:
+                throw RDConversionException("Radolan file not found");
+                break;
+            case -3:
+                throw RDConversionException("I/O eror when reading radolan file");
+                break;
+            default:
+                break;
+        }
+        netCDF::NcFile *file = Radolan2NetCDF::convertScan(scan, netcdfPath, write_one_bytes_as_byte, threshold, mode, quantize);
+        RDFreeScan(scan);
+        return file;
+    }
+
+    netCDF::NcFile *
+    Radolan2NetCDF::convertScan(RDScan *scan,
+                                const char *netcdfPath,
+                                bool write_one_bytes_as_byte,
+                                const RDDataType *threshold,
+                                netCDF::NcFile::FileMode mode,
+                                bool quantize) {
+        RDPreparedData prepared;
+        prepareScanData(scan, write_one_bytes_as_byte, threshold, quantize, prepared);
+        return createScanFile(scan, netcdfPath, mode, prepared);
+    }
+
+    netCDF::NcFile *
+    Radolan2NetCDF::convertScans(const std::vector<RDScan *> &scans,
+                                 const char *netcdfPath,
+                                 bool write_one_bytes_as_byte,
+                                 const RDDataType *threshold,
+                                 netCDF::NcFile::FileMode mode,
+                                 bool quantize) {
+        using namespace netCDF;
+        using namespace std;
+
+        if (scans.empty()) {
+            throw RDConversionException("No scans to convert");
+        }
+
+        // Sort the scans by grid. The key is the grid size, so products
+        // on the same grid end up sharing their coordinates.
+        time_t timestamp = RDScanTimeInSecondsSinceEpoch(scans[0]);
+        map<pair<int, int>, vector<RDScan *> > grids;
+        for (size_t i = 0; i < scans.size(); i++) {
+            RDScan *scan = scans[i];
+            if (RDScanTimeInSecondsSinceEpoch(scan) != timestamp) {
+                throw RDConversionException("Scans to be combined must have the same timestamp");
             }
+            grids[make_pair(scan->dimLon, scan->dimLat)].push_back(scan);
+        }
 
-            // write out
-            try {
-                data.putVar(startp, countp, buffer);
-            } catch (const std::exception &e) {
-                throw RDConversionException(e.what());
+        NcFile *file = NULL;
+        try {
+            file = new netCDF::NcFile(netcdfPath, mode);
+        } catch (const netCDF::exceptions::NcException &e) {
+            cerr << "ERROR:exception while creating file " << netcdfPath << " : " << e.what() << endl;
+            throw RDConversionException(e.what());
+        }
+
+        try {
+            addGlobalAttributes(*file);
+
+            // time is shared by all groups (dimensions are visible
+            // in child groups)
+            addTimeCoordinate(*file, scans[0]);
+
+            map<pair<int, int>, vector<RDScan *> >::iterator gi;
+            for (gi = grids.begin(); gi != grids.end(); gi++) {
+                NcGroup group = *file;
+                if (grids.size() > 1) {
+                    ostringstream name;
+                    name << "grid_" << gi->first.first << "x" << gi->first.second;
+                    group = file->addGroup(name.str());
+                }
+
+                vector<RDScan *> &gridScans = gi->second;
+                vector<NcDim> dims = addGridCoordinates(group, gridScans[0]);
+
+                set<RDScanType> products;
+                for (size_t i = 0; i < gridScans.size(); i++) {
+                    RDScanType type = gridScans[i]->header.scanType;
+                    if (!products.insert(type).second) {
+                        string msg = string("Product ") + RDScanTypeToString(type) + " given more than once";
+                        throw RDConversionException(msg.c_str());
+                    }
+                    addScanVariable(group, dims, gridScans[i], write_one_bytes_as_byte, threshold, quantize);
+                }
             }
+        } catch (const netCDF::exceptions::NcException &e) {
+            delete file;
+            throw RDConversionException(e.what());
+        } catch (const RDConversionException &) {
+            delete file;
+            throw;
+        }
 
-            free(buffer);
-        } else {
-            size_t memSize = scan->dimLon * scan->dimLat * sizeof(RDDataType);
-            RDDataType *converted = (RDDataType *) malloc(memSize);
+        return file;
+    }
 
-            // vector<size_t> index( dims.size() );
+    std::vector<std::string>
+    Radolan2NetCDF::convertFilesByTimestamp(const std::vector<std::string> &radolanPaths,
+                                            const char *outputDirectory,
+                                            bool write_one_bytes_as_byte,
+                                            const RDDataType *threshold,
+                                            bool omitOutside,
+                                            bool quantize) {
+        using namespace std;
 
-            for (int iy = 0; iy < scan->dimLon; iy++) {
-                for (int ix = 0; ix < scan->dimLat; ix++) {
-                    size_t index = iy * scan->dimLat + ix;
-                    RDDataType val = scan->data[index];
+        // group by timestamp, reading only the headers. The header
+        // fields are used as key so that the file name can be
+        // constructed from it directly.
+        typedef map<string, vector<string> > Groups;
+        Groups groups;
+        for (size_t i = 0; i < radolanPaths.size(); i++) {
+            RDRadolanHeader header;
+            if (!RDReadScanHeader(radolanPaths[i].c_str(), &header)) {
+                cerr << "ERROR:could not read header of " << radolanPaths[i] << endl;
+                continue;
+            }
+            char key[16];
+            snprintf(key, sizeof(key), "%02u%02u%02u%02u%02u",
+                     header.year % 100, header.month, header.day, header.hour, header.minute);
+            groups[key].push_back(radolanPaths[i]);
+            free(header.radarStations);
+        }
 
-                    if (val == RDMissingValue(scan->header.scanType)) {
-                        // If the value is marked missing, use
-                        // it as it is
-                        converted[index] = RDMissingValue(scan->header.scanType);
-                    } else {
-                        // if a threshold is enabled, check the
-                        // threshold first
+        vector<string> written;
+        for (Groups::iterator gi = groups.begin(); gi != groups.end(); gi++) {
+            string path = string(outputDirectory) + "/radolan-" + gi->first + ".nc";
 
-                        bool should_write = (threshold == NULL)
-                                            ? true
-                                            : (val >= (*threshold));
+            vector<RDScan *> scans;
+            for (size_t i = 0; i < gi->second.size(); i++) {
+                RDScan *scan = RDAllocateScan();
+                if (scan == NULL) {
+                    for (size_t j = 0; j < scans.size(); j++) RDFreeScan(scans[j]);
+                    throw RDConversionException("Could not allocate scan");
+                }
+                scan->data = NULL;
+                if (RDReadScan(gi->second[i].c_str(), scan, omitOutside)) {
+                    scans.push_back(scan);
+                } else {
+                    cerr << "ERROR:could not read " << gi->second[i] << endl;
+                    RDFreeScan(scan);
+                }
+            }
 
-                        converted[index] = should_write
-                                           ? val
-                                           : RDMinValue(scan->header.scanType);
-                    }
+            try {
+                if (!scans.empty()) {
+                    netCDF::NcFile *file = convertScans(scans, path.c_str(), write_one_bytes_as_byte, threshold,
+                                                                 netCDF::NcFile::replace, quantize);
+                    delete file;
+                    written.push_back(path);
                 }
+            } catch (const RDConversionException &) {
+                for (size_t i = 0; i < scans.size(); i++) RDFreeScan(scans[i]);
+                throw;
             }
 
-            // write out
+            for (size_t i = 0; i < scans.size(); i++) RDFreeScan(scans[i]);
+        }
+
+        return written;
+    }
+
+    /** A file read and prepared by a worker, waiting for the writer */
+    struct RDConversionJob {
+        size_t index;
+        RDScan *scan;
+        RDPreparedData prepared;
+        std::string error;
+    };
+
+    std::vector<std::string>
+    Radolan2NetCDF::convertFiles(const std::vector<std::string> &radolanPaths,
+                                 const char *outputDirectory,
+                                 bool write_one_bytes_as_byte,
+                                 const RDDataType *threshold,
+                                 bool omitOutside,
+                                 bool quantize,
+                                 unsigned int threads) {
+        using namespace std;
+
+        // largest files first, so no big file is left for the end
+        vector<pair<off_t, size_t> > order;
+        for (size_t i = 0; i < radolanPaths.size(); i++) {
+            struct stat info;
+            off_t size = stat(radolanPaths[i].c_str(), &info) == 0 ? info.st_size : 0;
+            order.push_back(make_pair(-size, i));
+        }
+        sort(order.begin(), order.end());
+
+        vector<string> netcdfPaths(radolanPaths.size());
+        for (size_t i = 0; i < radolanPaths.size(); i++) {
+            const string &path = radolanPaths[i];
+            size_t slash = path.find_last_of('/');
+            string name = slash == string::npos ? path : path.substr(slash + 1);
+            netcdfPaths[i] = string(outputDirectory) + "/" + name + ".nc";
+        }
+
+        if (threads == 0) {
+            threads = max(1u, thread::hardware_concurrency());
+        }
+        threads = (unsigned int) min((size_t) threads, radolanPaths.size());
+
+        // Workers read and prepare the scans. The calling thread is the
+        // only one talking to netCDF, as HDF5 is not thread-safe. At most
+        // one job per worker waits for it, which keeps memory flat.
+        atomic<size_t> next(0);
+        std::mutex queueMutex;
+        condition_variable ready;
+        condition_variable space;
+        deque<RDConversionJob *> queue;
+        size_t capacity = max(1u, threads);
+
+        auto prepareNext = [&]() -> RDConversionJob * {
+            size_t n = next++;
+            if (n >= order.size()) return NULL;
+            RDConversionJob *job = new RDConversionJob();
+            job->index = order[n].second;
+            job->scan = RDAllocateScan();
             try {
-                data.putVar(startp, countp, converted);
+                if (job->scan == NULL) {
+                    throw RDConversionException("Could not allocate scan");
+                }
+                job->scan->data = NULL;
+                if (!RDReadScan(radolanPaths[job->index].c_str(), job->scan, omitOutside)) {
+                    throw RDConversionException("Could not read radolan file");
+                }
+                prepareScanData(job->scan, write_one_bytes_as_byte, threshold, quantize, job->prepared);
+
+                // the prepared copy is all the writer needs
+                free(job->scan->data);
+                job->scan->data = NULL;
             } catch (const std::exception &e) {
-                throw RDConversionException(e.what());
+                job->error = e.what();
+            }
+            return job;
+        };
+
+        auto work = [&]() {
+            RDConversionJob *job;
+            while ((job = prepareNext()) != NULL) {
+                unique_lock<std::mutex> lock(queueMutex);
+                space.wait(lock, [&]() { return queue.size() < capacity; });
+                queue.push_back(job);
+                ready.notify_one();
             }
+        };
 
-            free(converted);
+        vector<thread> workers;
+        if (threads > 1) {
+            for (unsigned int i = 0; i < threads; i++) {
+                workers.push_back(thread(work));
+            }
         }
 
-        // write x-axis information
-        float *xData = (float *) malloc(sizeof(float) * scan->dimLon);
-        for (int i = 0; i < scan->dimLon; i++) {
-            RDCartesianPoint cp = rcs.cartesianCoordinate(rdGridPoint(i, 0));
-            xData[i] = cp.x;
+        vector<pair<size_t, string> > written;
+        for (size_t done = 0; done < order.size(); done++) {
+            RDConversionJob *job;
+            if (workers.empty()) {
+                job = prepareNext();
+            } else {
+                unique_lock<std::mutex> lock(queueMutex);
+                ready.wait(lock, [&]() { return !queue.empty(); });
+                job = queue.front();
+                queue.pop_front();
+                space.notify_one();
+            }
+
+            const string &netcdfPath = netcdfPaths[job->index];
+            if (job->error.empty()) {
+                try {
+                    netCDF::NcFile *file = createScanFile(job->scan, netcdfPath.c_str(),
+                                                          netCDF::NcFile::replace, job->prepared);
+                    delete file;
+                    written.push_back(make_pair(job->index, netcdfPath));
+                } catch (const std::exception &e) {
+                    job->error = e.what();
+                }
+            }
+            if (!job->error.empty()) {
+                cerr << "ERROR:" << radolanPaths[job->index] << ": " << job->error << endl;
+            }
+            RDFreeScan(job->scan);
+            delete job;
         }
-        x.putVar(xData);
-        x.putAtt("valid_min", ncFloat, xData[0]);
-        x.putAtt("valid_max", ncFloat, xData[scan->dimLon - 1]);
-        free(xData);
 
-        // write y-axis information
-        float *yData = (float *) malloc(sizeof(float) * scan->dimLat);
-        for (int i = 0; i < scan->dimLat; i++) {
-            RDCartesianPoint cp = rcs.cartesianCoordinate(rdGridPoint(0, i));
-            yData[i] = cp.y;
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
         }
-        y.putVar(yData);
-        y.putAtt("valid_min", ncFloat, yData[0]);
-        y.putAtt("valid_max", ncFloat, yData[scan->dimLon - 1]);
-        free(yData);
 
-        #if ADD_DIMENSION_Z
-        // write z-Axis information
-        float *zData = (float *) malloc(sizeof (float) * 1);
-        zData[0] = 0.0;
-        z.putVar(zData);
-        z.putAtt("valid_min", ncFloat, zData[0]);
-        z.putAtt("valid_max", ncFloat, zData[0]);
-        free(zData);
-        #endif
+        sort(written.begin(), written.end());
+        vector<string> result;
+        for (size_t i = 0; i < written.size(); i++) {
+            result.push_back(written[i].second);
+        }
+        return result;
+    }
+
+    /**
+     * Adds a float variable on the grid and writes the scan's data into it.
+     * The units attribute is only written if units is not NULL.
+     */
+    static void
+    addClimatologyVariable(const netCDF::NcGroup &group,
+                           const std::vector<netCDF::NcDim> &dims,
+                           const char *name,
+                           RDScan *scan,
+                           const char *cellMethods,
+                           const char *units) {
+        using namespace netCDF;
+
+        NcVar data = group.addVar(name, ncFloat, dims);
+        data.putAtt("_FillValue", ncFloat, RDMissingValue(scan->header.scanType));
+        data.setCompression(false, true, 1);
+        data.putAtt("grid_mapping", "polar_stereographic");
+        data.putAtt("radolan_product", RDScanTypeToString(scan->header.scanType));
+        data.putAtt("cell_methods", cellMethods);
+        if (units != NULL) {
+            data.putAtt("units", units);
+        }
+        data.putVar(scan->data);
+    }
+
+    netCDF::NcFile *
+    Radolan2NetCDF::convertClimatology(const RDClimatology &climatology,
+                                       const char *netcdfPath,
+                                       netCDF::NcFile::FileMode mode) {
+        using namespace netCDF;
+        using namespace std;
+
+        // also serves as template for the grid
+        RDScan *mean = climatology.mean();
+        RDScan *maximum = NULL;
+        RDScan *layer = NULL;
+
+        NcFile *file = NULL;
+        try {
+            file = new netCDF::NcFile(netcdfPath, mode);
+        } catch (const netCDF::exceptions::NcException &e) {
+            RDFreeScan(mean);
+            cerr << "ERROR:exception while creating file " << netcdfPath << " : " << e.what() << endl;
+            throw RDConversionException(e.what());
+        }
+
+        try {
+            addGlobalAttributes(*file);
+            NcDim dimT = addTimeCoordinate(*file, mean);
+
+            // the period the climatology covers
+            NcDim dimBounds = file->addDim("nv", 2);
+            vector<NcDim> boundsDims;
+            boundsDims.push_back(dimT);
+            boundsDims.push_back(dimBounds);
+            double bounds[2] = {(double) climatology.firstTime(), (double) climatology.lastTime()};
+            NcVar climatologyBounds = file->addVar("climatology_bounds", ncDouble, boundsDims);
+            climatologyBounds.putAtt("units", "seconds since 1970-01-01 00:00:00.0");
+            climatologyBounds.putVar(bounds);
+            file->getVar("time").putAtt("climatology", "climatology_bounds");
+
+            file->putAtt("scan_count", ncUint64, (unsigned long long) climatology.scanCount());
+            file->putAtt("wet_threshold", ncDouble, climatology.wetThreshold());
+
+            vector<NcDim> dims = addGridCoordinates(*file, mean);
+
+            // mean and maximum are in the unit of the product
+            addClimatologyVariable(*file, dims, "mean", mean, "time: mean", NULL);
+
+            maximum = climatology.maximum();
+            addClimatologyVariable(*file, dims, "maximum", maximum, "time: maximum", NULL);
+            RDFreeScan(maximum);
+            maximum = NULL;
+
+            layer = climatology.wetFraction();
+            addClimatologyVariable(*file, dims, "wet_fraction", layer, "time: mean", "1");
+            file->getVar("wet_fraction").putAtt("comment", "fraction of valid scans above wet_threshold");
+            RDFreeScan(layer);
+
+            layer = climatology.validCount();
+            addClimatologyVariable(*file, dims, "valid_count", layer, "time: sum", "1");
+            RDFreeScan(layer);
+            layer = NULL;
+
+            // one layer per threshold
+            const vector<double> &thresholds = climatology.thresholds();
+            if (!thresholds.empty()) {
+                NcDim dimThreshold = file->addDim("threshold", thresholds.size());
+                NcVar threshold = file->addVar("threshold", ncDouble, dimThreshold);
+                threshold.putAtt("radolan_product", RDScanTypeToString(mean->header.scanType));
+                threshold.putVar(&thresholds[0]);
+
+                vector<NcDim> exceedanceDims;
+                exceedanceDims.push_back(dimThreshold);
+                exceedanceDims.insert(exceedanceDims.end(), dims.begin(), dims.end());
+                NcVar exceedances = file->addVar("exceedance_count", ncFloat, exceedanceDims);
+                exceedances.putAtt("_FillValue", ncFloat, RDMissingValue(mean->header.scanType));
+                exceedances.setCompression(false, true, 1);
+                exceedances.putAtt("grid_mapping", "polar_stereographic");
+                exceedances.putAtt("cell_methods", "time: sum");
+                exceedances.putAtt("comment", "number of valid scans above threshold");
+                exceedances.putAtt("units", "1");
+
+                vector<size_t> startp(exceedanceDims.size(), 0);
+                vector<size_t> countp(exceedanceDims.size(), 1);
+                countp[countp.size() - 2] = mean->dimLat;
+                countp[countp.size() - 1] = mean->dimLon;
+                for (size_t k = 0; k < thresholds.size(); k++) {
+                    layer = climatology.exceedanceCount(k);
+                    startp[0] = k;
+                    exceedances.putVar(startp, countp, layer->data);
+                    RDFreeScan(layer);
+                    layer = NULL;
+                }
+            }
+        } catch (const netCDF::exceptions::NcException &e) {
+            if (maximum != NULL) RDFreeScan(maximum);
+            if (layer != NULL) RDFreeScan(layer);
+            RDFreeScan(mean);
+            delete file;
+            throw RDConversionException(e.what());
+        } catch (const RDConversionException &) {
+            if (maximum != NULL) RDFreeScan(maximum);
+            if (layer != NULL) RDFreeScan(layer);
+            RDFreeScan(mean);
+            delete file;
+            throw;
+        }
+
+        RDFreeScan(mean);
         return file;
     }
 
     const char *
     Radolan2NetCDF::getStandardName(RDScanType scanType) {
-        const char *result = NULL;
-        switch (scanType) {
-            case
-                RD_RX:
-            case
-                RD_EX:
-                result = "reflectivity";
-                break;
-            case
-                RD_RZ:
-            case
-                RD_RY:
-            case
-                RD_RV:
-            case
-                RD_EZ:
-            case
-                RD_RH:
-            case
-                RD_RB:
-            case
-                RD_RW:
-            case
-                RD_RL:
-            case
-                RD_RU:
-            case
-                RD_RS:
-            case
-                RD_RQ:
-            case
-                RD_SQ:
-            case
-                RD_SH:
-            case
-                RD_SF:
-                result = "rainrate";
-                break;
-            default:
-                result = "unknown";
-                break;
-        }
-        return
-                result;
+        return RDStandardName(scanType);
     }
 
     void
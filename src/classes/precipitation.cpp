@@ -0,0 +1,100 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <stdint.h>
+#include <string.h>
+
+#include <radolan/precipitation.h>
+#include <radolan/radolan_utils.h>
+
+namespace Radolan {
+
+    RDZRRelation rdZRRelation(float a, float b) {
+        RDZRRelation zr;
+        zr.a = a;
+        zr.b = b;
+        return zr;
+    }
+
+    void RDRainrateLookupTable(RDZRRelation zr, RDDataType *lut) {
+        for (int byte = 0; byte < 256; byte++) {
+            double dbz = RD_DBZ_BASEVALUE + byte / 2.0;
+            lut[byte] = (RDDataType) pow(pow(10.0, dbz / 10.0) / zr.a, 1.0 / zr.b);
+        }
+        lut[RX_CLUTTER_VALUE] = RD_CLUTTER_VALUE;
+        for (int byte = RX_ERROR_VALUE; byte < 256; byte++) {
+            lut[byte] = RD_ERROR_VALUE;
+        }
+    }
+
+    void RDRainrateFromReflectivity(const RDDataType *dbz, size_t count, RDZRRelation zr, RDDataType *out) {
+        RDDataType lut[256];
+        RDRainrateLookupTable(zr, lut);
+        for (size_t i = 0; i < count; i++) {
+            float byte = (dbz[i] - (float) RD_DBZ_BASEVALUE) * 2.0f + 0.5f;
+            byte = byte < 0.0f ? 0.0f : (byte > 255.0f ? 255.0f : byte);
+            out[i] = lut[(int) byte];
+        }
+    }
+
+    // Scales all values except the missing and clutter markers. The markers
+    // are kept by blending the bits with a mask instead of branching, so
+    // that the loop vectorizes.
+    static void scaleValues(const RDDataType *data, size_t count, float factor,
+                            RDDataType missing, RDDataType clutter, RDDataType *out) {
+        for (size_t i = 0; i < count; i++) {
+            float v = data[i];
+            float scaled = v * factor;
+            uint32_t keep = 0u - (uint32_t) ((v == missing) | (v == clutter));
+            uint32_t original, result;
+            memcpy(&original, &v, sizeof(original));
+            memcpy(&result, &scaled, sizeof(result));
+            result = (original & keep) | (result & ~keep);
+            memcpy(&out[i], &result, sizeof(result));
+        }
+    }
+
+    void RDConvertPrecipitation(const RDScan *scan,
+                                RDPrecipitationUnit unit,
+                                RDDataType *out,
+                                RDZRRelation zr) {
+        unsigned short minutes = scan->header.intervalDuration;
+        if (minutes == 0) {
+            throw RDConversionException("Scan has no interval duration");
+        }
+        size_t count = (size_t) scan->dimLon * scan->dimLat;
+
+        RDScanType type = scan->header.scanType;
+        if (type == RD_RX || type == RD_EX) {
+            RDRainrateFromReflectivity(scan->data, count, zr, out);
+            if (unit == RD_MM) {
+                scaleValues(out, count, minutes / 60.0f, RD_ERROR_VALUE, RD_CLUTTER_VALUE, out);
+            }
+        } else {
+            // the values are mm over the interval (precision applied when reading)
+            float factor = unit == RD_MM ? 1.0f : 60.0f / minutes;
+            scaleValues(scan->data, count, factor, RDMissingValue(type), RDClutterValue(type), out);
+        }
+    }
+}
@@ -0,0 +1,359 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+#include <thread>
+
+#include <radolan/quantile_sketch.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+#include <radolan/scan_utils.h>
+
+namespace Radolan {
+
+    // marks buffered values that are not valid
+    static const uint16_t RD_STEP_INVALID = 0xFFFF;
+
+    // cells merged together, so the buffered steps are read in whole cache lines
+    static const size_t RD_SKETCH_BLOCK = 256;
+
+    /** Scale function k1 of the t-digest and its inverse */
+    static double rdScale(double q, double compression) {
+        return compression / (2.0 * M_PI) * asin(2.0 * q - 1.0);
+    }
+
+    static double rdScaleInverse(double k, double compression) {
+        double x = k * 2.0 * M_PI / compression;
+        if (x >= M_PI / 2.0) return 1.0;
+        return (sin(x) + 1.0) / 2.0;
+    }
+
+    /**
+     * Merges two lists of centroids, each sorted by mean, and compresses
+     * the result so that no centroid spans more than one unit of the scale
+     * function. This leaves at most compression + 1 centroids.
+     *
+     * @return number of centroids written to out
+     */
+    static size_t rdMergeCentroids(const RDCentroid *a, size_t na,
+                                   const RDCentroid *b, size_t nb,
+                                   double compression, RDCentroid *out) {
+        double total = 0;
+        for (size_t i = 0; i < na; i++) total += a[i].weight;
+        for (size_t i = 0; i < nb; i++) total += b[i].weight;
+        if (total == 0) return 0;
+
+        size_t ia = 0, ib = 0, n = 0;
+        double mean = 0, weight = 0, before = 0;
+        double limit = 0;
+        while (ia < na || ib < nb) {
+            const RDCentroid &c = (ib >= nb || (ia < na && a[ia].mean <= b[ib].mean)) ? a[ia++] : b[ib++];
+            if (weight == 0) {
+                mean = c.mean;
+                weight = c.weight;
+                limit = rdScaleInverse(rdScale(before / total, compression) + 1.0, compression) * total;
+            } else if (before + weight + c.weight <= limit) {
+                weight += c.weight;
+                mean += (c.mean - mean) * c.weight / weight;
+            } else {
+                out[n].mean = (float) mean;
+                out[n].weight = (uint32_t) weight;
+                n++;
+                before += weight;
+                mean = c.mean;
+                weight = c.weight;
+                limit = rdScaleInverse(rdScale(before / total, compression) + 1.0, compression) * total;
+            }
+        }
+        out[n].mean = (float) mean;
+        out[n].weight = (uint32_t) weight;
+        return n + 1;
+    }
+
+    /**
+     * Value at the given rank (0 to total weight) of a digest, interpolated
+     * between the centres of the centroids. Centroids of weight one are
+     * exact values, the ends are interpolated towards min and max.
+     */
+    static float rdDigestValue(const RDCentroid *c, size_t n, float min, float max, double rank) {
+        double centre = c[0].weight / 2.0;
+        if (rank < centre) {
+            if (c[0].weight == 1) return c[0].mean;
+            return (float) (min + (c[0].mean - min) * rank / centre);
+        }
+        double before = 0;
+        for (size_t i = 0; i + 1 < n; i++) {
+            double next = before + c[i].weight + c[i + 1].weight / 2.0;
+            if (rank < next) {
+                if (c[i].weight == 1 && c[i + 1].weight == 1) {
+                    return rank - centre < next - rank ? c[i].mean : c[i + 1].mean;
+                }
+                double t = (rank - centre) / (next - centre);
+                return (float) (c[i].mean + t * (c[i + 1].mean - c[i].mean));
+            }
+            before += c[i].weight;
+            centre = next;
+        }
+        const RDCentroid &last = c[n - 1];
+        if (last.weight == 1) return last.mean;
+        double t = std::min(1.0, (rank - centre) / (last.weight / 2.0));
+        return (float) (last.mean + t * (max - last.mean));
+    }
+
+    RDQuantileSketch::RDQuantileSketch(double compression, size_t batchScans, unsigned int threads)
+            : m_compression(compression),
+              m_batchScans(batchScans),
+              m_threads(threads),
+              m_initialized(false),
+              m_dimLon(0),
+              m_dimLat(0),
+              m_cells(0),
+              m_scans(0),
+              m_lastTime(0),
+              m_lower(0),
+              m_resolution(0),
+              m_buffered(0) {
+        if (compression < 2.0 || compression > 60000.0) {
+            throw RDConversionException("Compression must lie between 2 and 60000");
+        }
+        if (batchScans == 0) {
+            throw RDConversionException("Batches must have at least one scan");
+        }
+        if (m_threads == 0) {
+            m_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        m_capacity = (size_t) ceil(compression) + 1;
+        memset(&m_header, 0, sizeof(m_header));
+    }
+
+    void RDQuantileSketch::ingest(RDScan *scan) {
+        RDScanType type = scan->header.scanType;
+        if (!m_initialized) {
+            bool reflectivity = type == RD_RX || type == RD_EX;
+            if (!reflectivity && scan->header.precision <= 0) {
+                throw RDConversionException("Scan has no precision");
+            }
+            m_header = scan->header;
+            m_header.radarStations = NULL;
+            m_header.numberOfRadarStations = 0;
+            m_dimLon = scan->dimLon;
+            m_dimLat = scan->dimLat;
+            m_cells = (size_t) m_dimLon * m_dimLat;
+            m_lower = RDMinValue(type);
+            m_resolution = reflectivity ? 0.5f : scan->header.precision;
+
+            m_buffer.assign(m_batchScans * m_cells, RD_STEP_INVALID);
+            m_minimumCount.assign(m_cells, 0);
+            m_size.assign(m_cells, 0);
+            m_min.assign(m_cells, INFINITY);
+            m_max.assign(m_cells, -INFINITY);
+            m_centroids.assign(m_capacity * m_cells, RDCentroid());
+            m_initialized = true;
+        } else {
+            if (type != m_header.scanType) {
+                throw RDConversionException("Scan is of a different product");
+            }
+            if (scan->dimLon != m_dimLon || scan->dimLat != m_dimLat) {
+                throw RDConversionException("Scan has a different grid");
+            }
+            if (scan->header.precision != m_header.precision) {
+                throw RDConversionException("Scan has a different precision");
+            }
+        }
+
+        uint16_t *steps = &m_buffer[m_buffered * m_cells];
+        const float inverse = 1.0f / m_resolution;
+        for (size_t i = 0; i < m_cells; i++) {
+            float v = scan->data[i];
+            float step = (v - m_lower) * inverse + 0.5f;
+            steps[i] = RDIsCleanMeasurement(type, v) && step < RD_STEP_INVALID
+                       ? (uint16_t) step
+                       : RD_STEP_INVALID;
+        }
+
+        m_lastTime = std::max(m_lastTime, RDScanTimeInSecondsSinceEpoch(scan));
+        m_scans++;
+        if (++m_buffered == m_batchScans) {
+            flush();
+        }
+    }
+
+    void RDQuantileSketch::ingestFile(const char *filename) {
+        RDScanFile scan(filename, false);
+        ingest(scan.get());
+    }
+
+    void RDQuantileSketch::forEachRange(const std::function<void(size_t, size_t)> &work) const {
+        size_t blocks = (m_cells + RD_SKETCH_BLOCK - 1) / RD_SKETCH_BLOCK;
+        size_t threads = std::max((size_t) 1, std::min((size_t) m_threads, blocks));
+        if (threads == 1) {
+            work(0, m_cells);
+            return;
+        }
+        size_t blocksPerThread = (blocks + threads - 1) / threads;
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; t++) {
+            size_t begin = std::min(m_cells, t * blocksPerThread * RD_SKETCH_BLOCK);
+            size_t end = std::min(m_cells, (t + 1) * blocksPerThread * RD_SKETCH_BLOCK);
+            workers.push_back(std::thread(work, begin, end));
+        }
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+    }
+
+    void RDQuantileSketch::flush() {
+        if (!m_initialized || m_buffered == 0) return;
+        forEachRange([this](size_t begin, size_t end) {
+            mergeBatch(begin, end);
+        });
+        m_buffered = 0;
+    }
+
+    void RDQuantileSketch::mergeBatch(size_t begin, size_t end) {
+        const size_t scans = m_buffered;
+        std::vector<RDCentroid> values(scans);
+        std::vector<RDCentroid> merged(m_capacity);
+
+        for (size_t i = begin; i < end; i++) {
+            size_t n = 0;
+            uint32_t minimum = 0;
+            for (size_t s = 0; s < scans; s++) {
+                uint16_t step = m_buffer[s * m_cells + i];
+                if (step == RD_STEP_INVALID) continue;
+                if (step == 0) {
+                    minimum++;
+                    continue;
+                }
+                values[n].mean = m_lower + step * m_resolution;
+                values[n].weight = 1;
+                n++;
+            }
+            m_minimumCount[i] += minimum;
+            if (n == 0) continue;
+
+            std::sort(values.begin(), values.begin() + n, [](const RDCentroid &a, const RDCentroid &b) {
+                return a.mean < b.mean;
+            });
+            m_min[i] = std::min(m_min[i], values[0].mean);
+            m_max[i] = std::max(m_max[i], values[n - 1].mean);
+
+            RDCentroid *digest = &m_centroids[i * m_capacity];
+            size_t size = rdMergeCentroids(digest, m_size[i], &values[0], n, m_compression, &merged[0]);
+            std::copy(merged.begin(), merged.begin() + size, digest);
+            m_size[i] = (uint16_t) size;
+        }
+    }
+
+    void RDQuantileSketch::merge(RDQuantileSketch &other) {
+        if (&other == this) {
+            throw RDConversionException("Can not merge a sketch into itself");
+        }
+        if (other.m_compression != m_compression) {
+            throw RDConversionException("Sketches have a different compression");
+        }
+        other.flush();
+        if (!other.m_initialized) return;
+        flush();
+
+        if (!m_initialized) {
+            m_header = other.m_header;
+            m_dimLon = other.m_dimLon;
+            m_dimLat = other.m_dimLat;
+            m_cells = other.m_cells;
+            m_lower = other.m_lower;
+            m_resolution = other.m_resolution;
+            m_buffer.assign(m_batchScans * m_cells, RD_STEP_INVALID);
+            m_minimumCount.assign(m_cells, 0);
+            m_size.assign(m_cells, 0);
+            m_min.assign(m_cells, INFINITY);
+            m_max.assign(m_cells, -INFINITY);
+            m_centroids.assign(m_capacity * m_cells, RDCentroid());
+            m_initialized = true;
+        } else if (other.m_header.scanType != m_header.scanType
+                   || other.m_dimLon != m_dimLon || other.m_dimLat != m_dimLat
+                   || other.m_header.precision != m_header.precision) {
+            throw RDConversionException("Sketches are of different products or grids");
+        }
+
+        forEachRange([this, &other](size_t begin, size_t end) {
+            std::vector<RDCentroid> merged(m_capacity);
+            for (size_t i = begin; i < end; i++) {
+                m_minimumCount[i] += other.m_minimumCount[i];
+                if (other.m_size[i] == 0) continue;
+                m_min[i] = std::min(m_min[i], other.m_min[i]);
+                m_max[i] = std::max(m_max[i], other.m_max[i]);
+                RDCentroid *digest = &m_centroids[i * m_capacity];
+                size_t size = rdMergeCentroids(digest, m_size[i],
+                                               &other.m_centroids[i * m_capacity], other.m_size[i],
+                                               m_compression, &merged[0]);
+                std::copy(merged.begin(), merged.begin() + size, digest);
+                m_size[i] = (uint16_t) size;
+            }
+        });
+
+        m_scans += other.m_scans;
+        m_lastTime = std::max(m_lastTime, other.m_lastTime);
+    }
+
+    RDScan *RDQuantileSketch::quantile(double level) {
+        if (!m_initialized) {
+            throw RDConversionException("No scans were ingested");
+        }
+        if (!(level >= 0.0 && level <= 1.0)) {
+            throw RDConversionException("Quantile level must lie in [0,1]");
+        }
+        flush();
+
+        RDScan *result = RDAllocateResultScan(m_header, m_dimLon, m_dimLat, m_lastTime);
+
+        RDDataType missing = RDMissingValue(m_header.scanType);
+        forEachRange([&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const RDCentroid *digest = &m_centroids[i * m_capacity];
+                double weight = 0;
+                for (size_t c = 0; c < m_size[i]; c++) weight += digest[c].weight;
+                double minimum = m_minimumCount[i];
+                double total = minimum + weight;
+
+                double rank = level * total;
+                if (total == 0) {
+                    result->data[i] = missing;
+                } else if (rank <= minimum || weight == 0) {
+                    result->data[i] = m_lower;
+                } else {
+                    result->data[i] = rdDigestValue(digest, m_size[i], m_min[i], m_max[i], rank - minimum);
+                }
+            }
+        });
+
+        for (size_t i = 0; i < m_cells; i++) {
+            if (result->data[i] != missing && result->data[i] > result->max_value) {
+                result->max_value = result->data[i];
+            }
+        }
+        return result;
+    }
+}
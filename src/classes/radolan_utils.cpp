@@ -22,6 +22,7 @@
  */
 
 #include <cmath>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
@@ -58,6 +59,14 @@ namespace Radolan {
         };
     }
 
+    bool RDIsSigned(RDScanType t) {
+        return t == RD_RD;
+    }
+
+    RDDataType RDLowestValue(RDScanType t, float precision) {
+        return RDIsSigned(t) ? -4095.0f * precision : RDMinValue(t);
+    }
+
     RDDataType RDMissingValue(RDScanType t) {
         switch (t) {
             case RD_RX:
@@ -97,7 +106,8 @@ namespace Radolan {
     }
 
     float RDRainrateFromDezibels(RDDataType dezibels) {
-        return powf(dezibels / 256.0f, 1.0f / 1.42f);
+        // Z = 256 R^1.42 with Z = 10^(dBZ/10)
+        return powf(powf(10.0f, dezibels / 10.0f) / 256.0f, 1.0f / 1.42f);
     }
 
     unsigned char RDRVP6ToByteValue(float rvp6) {
@@ -128,7 +138,7 @@ namespace Radolan {
         t->tm_min = scan->header.minute;
         t->tm_hour = scan->header.hour;
         t->tm_mday = scan->header.day;
-        t->tm_mon = scan->header.month;
+        t->tm_mon = scan->header.month - 1;   // 0-11
 
         //printf("SCAN HEADER MONTH = %d\n",scan->header.month );
 
@@ -145,6 +155,22 @@ namespace Radolan {
         return time;
     }
 
+    void RDSetScanTime(RDRadolanHeader *header, time_t time) {
+        struct tm t;
+        gmtime_r(&time, &t);
+        header->year = (unsigned short) (t.tm_year - 100);
+        header->month = (unsigned short) (t.tm_mon + 1);
+        header->day = (unsigned short) t.tm_mday;
+        header->hour = (unsigned short) t.tm_hour;
+        header->minute = (unsigned short) t.tm_min;
+    }
+
+    void RDScanTimeString(RDScan *scan, char *buffer, size_t size) {
+        snprintf(buffer, size, "%04d-%02d-%02dT%02d:%02d:00Z",
+                 2000 + scan->header.year, scan->header.month, scan->header.day,
+                 scan->header.hour, scan->header.minute);
+    }
+
     size_t RDBytesPerPixel(RDScanType type) {
         switch (type) {
             case RD_RX:
@@ -200,20 +226,17 @@ namespace Radolan {
         return result;
     }
 
-    float RDMMPerHour(RDScanType t, RDDataType value) {
-        float result = (float) value;
+    const char *RDStandardName(RDScanType t) {
+        const char *result = NULL;
         switch (t) {
             case RD_RX:
             case RD_EX:
-                result = -INFINITY;
+                result = "reflectivity";
                 break;
             case RD_RZ:
             case RD_RY:
             case RD_RV:
             case RD_EZ:
-                // 1/100 mm / 5 min
-                result = value * 12.0f / 100.0f;
-                break;
             case RD_RH:
             case RD_RB:
             case RD_RW:
@@ -221,27 +244,57 @@ namespace Radolan {
             case RD_RU:
             case RD_RS:
             case RD_RQ:
-                // 1/10 mm / h
-                result /= 10.0f;
-                break;
             case RD_SQ:
-                // 1/10 mm / 6h
-                result = value / 10.0f;
-                break;
             case RD_SH:
-                // 1/10 mm / 12h
-                result = value / 10.0f;
-                break;
             case RD_SF:
-                // 1/10 mm / 24h
+                result = "rainrate";
                 break;
             default:
-                result = value;
+                result = "unknown";
                 break;
         }
         return result;
     }
 
+    unsigned short RDIntervalDuration(RDScanType t) {
+        switch (t) {
+            case RD_RZ:
+            case RD_RY:
+            case RD_RV:
+            case RD_EZ:
+                return 5;
+            case RD_RH:
+            case RD_RB:
+            case RD_RW:
+            case RD_RL:
+            case RD_RU:
+            case RD_RS:
+            case RD_RQ:
+                return 60;
+            case RD_SQ:
+                return 6 * 60;
+            case RD_SH:
+                return 12 * 60;
+            case RD_SF:
+                return 24 * 60;
+            default:
+                return 0;
+        }
+    }
+
+    float RDMMPerHour(RDScanType t, RDDataType value) {
+        if (t == RD_RX || t == RD_EX) {
+            return -INFINITY;
+        }
+        unsigned short minutes = RDIntervalDuration(t);
+        if (minutes == 0 || value == RDMissingValue(t) || value == RDClutterValue(t)) {
+            return value;
+        }
+        // the values are mm over the interval (precision applied when reading),
+        // same factor as RDConvertPrecipitation
+        return value * (60.0f / minutes);
+    }
+
     const char *RDScanTypeToString(RDScanType type) {
         switch (type) {
             case RD_RX:
@@ -542,7 +595,7 @@ namespace Radolan {
                 "raa01-%s_10000-%02d%02d%02d%02d%02d-dwd---bin",
                 typeString,
                 timeComponents.tm_year - 100,
-                timeComponents.tm_mon,
+                timeComponents.tm_mon + 1,
                 timeComponents.tm_mday,
                 timeComponents.tm_hour,
                 timeComponents.tm_min);
@@ -551,6 +604,43 @@ namespace Radolan {
         return strdup(fn);
     }
 
+    int RDBitRound(RDDataType *data, size_t count, float precision, RDDataType skipValue) {
+        if (!(precision > 0.0f)) {
+            return -1;
+        }
+
+        // keeping (e + lsb) mantissa bits of a value in [2^e,2^(e+1))
+        // leaves a resolution of 2^-lsb <= precision / 2
+        int lsb = (int) ceil(-log2(precision / 2.0));
+        int maxKeep = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            RDDataType value = data[i];
+            if (value == skipValue) continue;
+
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+
+            int exponent = (int) ((bits >> 23) & 0xff);
+            if (exponent == 0xff) continue;
+
+            int keep = exponent - 127 + lsb;
+            if (keep < 0) keep = 0;
+            if (keep > maxKeep) maxKeep = keep;
+            if (keep >= 23) continue;
+
+            // round to nearest, then drop the trailing bits. A carry
+            // into the exponent is the correct result of the rounding.
+            int drop = 23 - keep;
+            uint32_t half = 1u << (drop - 1);
+            uint32_t mask = ~((1u << drop) - 1u);
+            bits = (bits + half) & mask;
+
+            memcpy(&data[i], &bits, sizeof(bits));
+        }
+        return maxKeep;
+    }
+
 #ifdef __cplusplus
 }
 #endif
@@ -36,7 +36,7 @@ _Bool readUnsignedInt(gzFile *f, int len, unsigned int *value) {
     char buf[len + 1];
     int objectsRead = gzread(f, &buf[0], len);
     buf[len] = '\0';
-    if (objectsRead == 1) {
+    if (objectsRead == len) {
         *value = (unsigned int) atoi(buf);
         return true;
     } else {
@@ -80,11 +80,30 @@ _Bool readLong(gzFile *f, int len, long *value) {
     }
 }
 
+void RDScanDimensions(RDScanType type, int *dimLon, int *dimLat) {
+    switch (type) {
+        case RD_TZ:
+        case RD_TH:
+        case RD_EX:
+        case RD_EZ:
+        case RD_EW:
+            *dimLat = 1500;
+            *dimLon = 1400;
+            break;
+        default:
+            *dimLat = 900;
+            *dimLon = 900;
+    }
+}
+
 void RDReadRadolanHeader(gzFile *f, RDRadolanHeader *header) {
 
     // just a char buffer used throughout the function to store data temporarily
     char valueBuffer[80];
 
+    // not every header carries every tag
+    memset(header, 0, sizeof(RDRadolanHeader));
+
     // a few pieces of information are always in the same place
     // at the start of the header
     gzread(f, valueBuffer, 2);
@@ -198,7 +217,7 @@ void RDReadRadolanHeader(gzFile *f, RDRadolanHeader *header) {
                 strncpy(valueBuffer, pos, 3);
                 valueBuffer[3] = '\0';
                 int len = atoi(valueBuffer);
-                header->radarStations = (char *) calloc(len, sizeof(char));
+                header->radarStations = (char *) calloc(len + 1, sizeof(char));
                 strncpy(header->radarStations, (pos + 3), len);
                 bytesRead += (5 + len);
             }
@@ -206,19 +225,9 @@ void RDReadRadolanHeader(gzFile *f, RDRadolanHeader *header) {
     }
 
     // figure out the real header and payload size
-    size_t realPayloadSize = 0;
-    switch (header->scanType) {
-        case RD_TZ:
-        case RD_TH:
-        case RD_EX:
-        case RD_EZ:
-        case RD_EW:
-            realPayloadSize = 1500 * 1400 * RDBytesPerPixel(header->scanType);
-            break;
-        default:
-            realPayloadSize = 900 * 900 * RDBytesPerPixel(header->scanType);
-            break;
-    }
+    int dimLon, dimLat;
+    RDScanDimensions(header->scanType, &dimLon, &dimLat);
+    size_t realPayloadSize = (size_t) dimLon * dimLat * RDBytesPerPixel(header->scanType);
     header->headerSize = header->payloadSize - realPayloadSize;
     header->payloadSize = realPayloadSize;
 
@@ -245,19 +254,7 @@ int RDReadScan(const char *filename, RDScan *scan, bool ommitOutside) {
         RDReadRadolanHeader(f, &scan->header);
 
         // figure out the resolution lat x lon
-        switch (scan->header.scanType) {
-            case RD_TZ:
-            case RD_TH:
-            case RD_EX:
-            case RD_EZ:
-            case RD_EW:
-                scan->dimLat = 1500;
-                scan->dimLon = 1400;
-                break;
-            default:
-                scan->dimLat = 900;
-                scan->dimLon = 900;
-        }
+        RDScanDimensions(scan->header.scanType, &scan->dimLon, &scan->dimLat);
 
         // allocate sufficient block for the actual data
         // the actual number of vertices is payload size / 2 (data is 16bit word, 4 flag, 12 data = 2 bytes)
@@ -341,6 +338,7 @@ int RDReadScan(const char *filename, RDScan *scan, bool ommitOutside) {
                     if (scan->data[bufferIndex] > scan->max_value) scan->max_value = scan->data[bufferIndex];
                     else if (scan->data[bufferIndex] < scan->min_value) scan->min_value = scan->data[bufferIndex];
                 }
+                free(buffer);
             } break;
 
             default: {
@@ -416,27 +414,23 @@ int RDReadScan(const char *filename, RDScan *scan, bool ommitOutside) {
                     _Bool negativeSignBitSet = (flagValue & RD_NEGATIVE_SIGN_BIT) == RD_NEGATIVE_SIGN_BIT;
 
                     if (clutterBitSet) {
-                        // There is some obvious confusion in the specifications as to the meaning of
-                        // this bit. In praxi it turns out, that this value is used for error as well
-                        // as clutter. 
-
-                        // Perhaps we need to check in the value given matches the value
-                        // for clutter. If so, we use the RD_ERROR_VALUE, if not we use the rain value?
-
-                        if (beef != RD_CLUTTER_VALUE) {
-                            if (ommitOutside) {
-                                scan->data[bufferIndex] = RDMinValue(scan->header.scanType);
-                            } else {
-                                scan->data[bufferIndex] = RD_ERROR_VALUE;
-                            }
-                        }
-                        else {
-                            scan->data[bufferIndex] = RDMaxValue(scan->header.scanType);
+                        // In practice this bit marks clutter as well as errors.
+                        // Either way the value carried along is of no use.
+                        if (ommitOutside) {
+                            scan->data[bufferIndex] = RDMinValue(scan->header.scanType);
+                        } else {
+                            scan->data[bufferIndex] = RDClutterValue(scan->header.scanType);
                         }
                     }
 
                     else if (errorBitSet) {
-                        scan->data[bufferIndex] = rainValue;
+                        // No data (outside of the composite or missing). The payload
+                        // is 2500, which must not end up as rain value.
+                        if (ommitOutside) {
+                            scan->data[bufferIndex] = RDMinValue(scan->header.scanType);
+                        } else {
+                            scan->data[bufferIndex] = RDMissingValue(scan->header.scanType);
+                        }
                     }
 
                     else if (secondaryValueBitSet) {
@@ -465,6 +459,7 @@ int RDReadScan(const char *filename, RDScan *scan, bool ommitOutside) {
                         if (beef > rawMax) rawMax = beef;
                     }
                 }
+                free(buffer);
             }
         }  // switch scan type
 
@@ -476,6 +471,18 @@ int RDReadScan(const char *filename, RDScan *scan, bool ommitOutside) {
     return 1;
 }
 
+int RDReadScanHeader(const char *filename, RDRadolanHeader *header) {
+    gzFile *f = gzopen(filename, "r");
+    if (f == NULL) {
+        fprintf(stderr, "RDReadScanHeader : ERROR : could not open file %s\n", filename);
+        return 0;
+    }
+    memset(header, 0, sizeof(RDRadolanHeader));
+    RDReadRadolanHeader(f, header);
+    gzclose(f);
+    return 1;
+}
+
 RDScan *RDAllocateScan() {
     RDScan *scan = (RDScan *) malloc(sizeof(RDScan));
     if (scan == NULL) {
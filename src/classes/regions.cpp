@@ -0,0 +1,269 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <stdint.h>
+
+#include <radolan/radolan_utils.h>
+#include <radolan/regions.h>
+
+namespace Radolan {
+
+    // Directions of boundary edges on the corner lattice. Turning right
+    // means (direction + 1) % 4.
+    enum {
+        RDUp = 0,
+        RDRight = 1,
+        RDDown = 2,
+        RDLeft = 3
+    };
+
+    static const int DIRECTION_DX[4] = {0, 1, 0, -1};
+    static const int DIRECTION_DY[4] = {1, 0, -1, 0};
+
+    static int findRoot(std::vector<int> &parent, int x) {
+        while (parent[x] != x) {
+            // path halving
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    }
+
+    static void unite(std::vector<int> &parent, int a, int b) {
+        a = findRoot(parent, a);
+        b = findRoot(parent, b);
+        if (a < b) {
+            parent[b] = a;
+        } else if (b < a) {
+            parent[a] = b;
+        }
+    }
+
+    void RDClassifyScan(RDScan *scan, const std::vector<RDDataType> &classBreaks, int *classes) {
+        RDScanType t = scan->header.scanType;
+        RDDataType minValue = RDMinValue(t);
+        RDDataType maxValue = RDMaxValue(t);
+        RDDataType missingValue = RDMissingValue(t);
+        RDDataType clutterValue = RDClutterValue(t);
+
+        size_t count = (size_t) scan->dimLon * scan->dimLat;
+        for (size_t i = 0; i < count; i++) {
+            RDDataType value = scan->data[i];
+            bool clean = value >= minValue && value <= maxValue
+                         && value != missingValue && value != clutterValue;
+            if (clean) {
+                std::vector<RDDataType>::const_iterator it =
+                        std::upper_bound(classBreaks.begin(), classBreaks.end(), value);
+                classes[i] = (int) (it - classBreaks.begin()) - 1;
+            } else {
+                classes[i] = -1;
+            }
+        }
+    }
+
+    int RDLabelRegions(const int *classes, int dimLon, int dimLat, RDRegions &regions) {
+        size_t count = (size_t) dimLon * dimLat;
+        regions.dimLon = dimLon;
+        regions.dimLat = dimLat;
+        regions.labels.assign(count, -1);
+        regions.regionClass.clear();
+        regions.regionSize.clear();
+
+        std::vector<int> &labels = regions.labels;
+        std::vector<int> parent;
+
+        // first pass: provisional labels, merging with the west
+        // and south neighbours of equal class
+        for (int iy = 0; iy < dimLat; iy++) {
+            for (int ix = 0; ix < dimLon; ix++) {
+                size_t i = (size_t) iy * dimLon + ix;
+                int c = classes[i];
+                if (c < 0) continue;
+
+                int label = -1;
+                if (ix > 0 && classes[i - 1] == c) {
+                    label = labels[i - 1];
+                }
+                if (iy > 0 && classes[i - dimLon] == c) {
+                    if (label < 0) {
+                        label = labels[i - dimLon];
+                    } else {
+                        unite(parent, label, labels[i - dimLon]);
+                    }
+                }
+                if (label < 0) {
+                    label = (int) parent.size();
+                    parent.push_back(label);
+                }
+                labels[i] = label;
+            }
+        }
+
+        // second pass: resolve to consecutive labels in scan order
+        std::vector<int> remap(parent.size(), -1);
+        for (size_t i = 0; i < count; i++) {
+            if (labels[i] < 0) continue;
+            int root = findRoot(parent, labels[i]);
+            if (remap[root] < 0) {
+                remap[root] = (int) regions.regionClass.size();
+                regions.regionClass.push_back(classes[i]);
+                regions.regionSize.push_back(0);
+            }
+            labels[i] = remap[root];
+            regions.regionSize[labels[i]]++;
+        }
+
+        return (int) regions.regionClass.size();
+    }
+
+    void RDTraceRegionBoundaries(const RDRegions &regions, std::vector<std::vector<RDRing> > &rings) {
+        const int dimLon = regions.dimLon;
+        const int dimLat = regions.dimLat;
+        const std::vector<int> &labels = regions.labels;
+        const int64_t cornersPerRow = dimLon + 1;
+        const size_t numRegions = regions.regionClass.size();
+
+        rings.assign(numRegions, std::vector<RDRing>());
+        if (numRegions == 0) return;
+
+        // Boundary edges run between cells of different label and are
+        // oriented such that the region is on the right hand side. They
+        // are encoded as (start corner << 2 | direction) and bucketed by
+        // label, so each region's edges can be looked up by corner.
+        std::vector<size_t> offsets(numRegions + 1, 0);
+        for (int pass = 0; pass < 2; pass++) {
+            std::vector<size_t> fill;
+            std::vector<int64_t> edges;
+            if (pass == 1) {
+                for (size_t r = 0; r < numRegions; r++) offsets[r + 1] += offsets[r];
+                fill.assign(offsets.begin(), offsets.end() - 1);
+                edges.resize(offsets[numRegions]);
+            }
+
+            for (int iy = 0; iy < dimLat; iy++) {
+                for (int ix = 0; ix < dimLon; ix++) {
+                    size_t i = (size_t) iy * dimLon + ix;
+                    int label = labels[i];
+                    if (label < 0) continue;
+
+                    bool west = ix == 0 || labels[i - 1] != label;
+                    bool north = iy == dimLat - 1 || labels[i + dimLon] != label;
+                    bool east = ix == dimLon - 1 || labels[i + 1] != label;
+                    bool south = iy == 0 || labels[i - dimLon] != label;
+
+                    if (pass == 0) {
+                        offsets[label + 1] += west + north + east + south;
+                        continue;
+                    }
+
+                    int64_t corner = iy * cornersPerRow + ix;
+                    if (west) edges[fill[label]++] = (corner << 2) | RDUp;
+                    if (north) edges[fill[label]++] = ((corner + cornersPerRow) << 2) | RDRight;
+                    if (east) edges[fill[label]++] = ((corner + cornersPerRow + 1) << 2) | RDDown;
+                    if (south) edges[fill[label]++] = ((corner + 1) << 2) | RDLeft;
+                }
+            }
+
+            if (pass == 0) continue;
+
+            for (size_t r = 0; r < numRegions; r++) {
+                std::vector<int64_t>::iterator first = edges.begin() + offsets[r];
+                std::vector<int64_t>::iterator last = edges.begin() + offsets[r + 1];
+                std::sort(first, last);
+
+                size_t numEdges = last - first;
+                std::vector<char> used(numEdges, 0);
+
+                for (size_t e = 0; e < numEdges; e++) {
+                    if (used[e]) continue;
+
+                    RDRing ring;
+                    size_t current = e;
+                    int firstDirection = (int) (first[e] & 3);
+                    int direction = firstDirection;
+
+                    while (true) {
+                        used[current] = 1;
+                        int64_t corner = (first[current] >> 2);
+                        int x = (int) (corner % cornersPerRow);
+                        int y = (int) (corner / cornersPerRow);
+                        int endX = x + DIRECTION_DX[direction];
+                        int endY = y + DIRECTION_DY[direction];
+                        int64_t endCorner = endY * cornersPerRow + endX;
+
+                        // outgoing edges at the end corner
+                        std::vector<int64_t>::iterator lo = std::lower_bound(first, last, endCorner << 2);
+                        std::vector<int64_t>::iterator hi = std::lower_bound(first, last, (endCorner + 1) << 2);
+
+                        // prefer turning right, then straight on, then left. This
+                        // keeps cells that only touch at a corner apart.
+                        size_t next = numEdges;
+                        int nextDirection = -1;
+                        for (int turn = 1; turn >= -1 && next == numEdges; turn--) {
+                            int wanted = (direction + turn + 4) % 4;
+                            for (std::vector<int64_t>::iterator it = lo; it != hi; it++) {
+                                size_t candidate = it - first;
+                                if ((int) (*it & 3) == wanted && (!used[candidate] || candidate == e)) {
+                                    next = candidate;
+                                    nextDirection = wanted;
+                                    break;
+                                }
+                            }
+                        }
+
+                        if (ring.empty()) {
+                            ring.push_back(rdGridPoint(x, y));
+                        }
+
+                        if (next == numEdges || next == e) {
+                            // closed. Drop the start if it is not a corner.
+                            if (direction == firstDirection && ring.size() > 1) {
+                                ring.erase(ring.begin());
+                            }
+                            ring.push_back(ring.front());
+                            break;
+                        }
+
+                        if (nextDirection != direction) {
+                            ring.push_back(rdGridPoint(endX, endY));
+                        }
+                        current = next;
+                        direction = nextDirection;
+                    }
+
+                    rings[r].push_back(ring);
+                }
+            }
+        }
+    }
+
+    bool RDIsHole(const RDRing &ring) {
+        // shoelace formula, positive for counter-clockwise rings
+        int64_t area = 0;
+        for (size_t i = 0; i + 1 < ring.size(); i++) {
+            area += (int64_t) ring[i].ix * ring[i + 1].iy - (int64_t) ring[i + 1].ix * ring[i].iy;
+        }
+        return area > 0;
+    }
+}
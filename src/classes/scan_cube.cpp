@@ -0,0 +1,294 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+#include <radolan/scan_cube.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+#include <radolan/scan_utils.h>
+
+namespace Radolan {
+
+    // slices start on cache lines
+    static const size_t RD_CUBE_ALIGNMENT = 64;
+
+    float RDCompactPrecision(const RDRadolanHeader &header) {
+        // reflectivities are in steps of 0.5 dBZ (RVP6 units),
+        // whatever the header says
+        bool reflectivity = header.scanType == RD_RX || header.scanType == RD_EX;
+        float precision = reflectivity ? 0.5f : header.precision;
+        if (precision <= 0) {
+            throw RDConversionException("Scan has no precision");
+        }
+        return precision;
+    }
+
+    void RDEncodeCompact(RDScanType type, float precision, const RDDataType *values, size_t count,
+                         uint16_t *target) {
+        const float minimum = RDLowestValue(type, precision);
+        const float maximum = RDMaxValue(type);
+        const float inverse = 1.0f / precision;
+        const float missing = RDMissingValue(type);
+        const float clutter = RDClutterValue(type);
+        for (size_t i = 0; i < count; i++) {
+            float v = values[i];
+            // no branches, so the loop vectorizes
+            uint32_t isClutter = v == clutter;
+            uint32_t isValue = (v >= minimum) & (v <= maximum) & (v != missing) & !isClutter;
+            float raw = std::max(0.0f, std::min((v - minimum) * inverse + 0.5f, (float) RD_CUBE_MAXIMUM));
+            uint32_t code = isClutter ? RD_CUBE_CLUTTER : RD_CUBE_MISSING;
+            target[i] = (uint16_t) (isValue ? (uint32_t) (int32_t) raw : code);
+        }
+    }
+
+    void RDDecodeCompact(RDScanType type, float precision, const uint16_t *values, size_t count,
+                         RDDataType *target) {
+        const float minimum = RDLowestValue(type, precision);
+        const float missing = RDMissingValue(type);
+        const float clutter = RDClutterValue(type);
+        // conversion and codes in separate loops, so the first one vectorizes
+        if (RDIsSigned(type)) {
+            // whole steps from zero times the precision, like the values
+            // read from the file, so they come back bit-identical
+            const int32_t zero = (int32_t) (-minimum / precision + 0.5f);
+            for (size_t i = 0; i < count; i++) {
+                target[i] = (float) ((int32_t) values[i] - zero) * precision;
+            }
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                target[i] = minimum + (float) values[i] * precision;
+            }
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (values[i] > RD_CUBE_MAXIMUM) {
+                target[i] = values[i] == RD_CUBE_MISSING ? missing : clutter;
+            }
+        }
+    }
+
+    template<typename T>
+    RDScanCube<T>::RDScanCube()
+            : m_dimLon(0),
+              m_dimLat(0),
+              m_stride(0),
+              m_precision(1.0f),
+              m_offset(0.0f),
+              m_missing(0),
+              m_clutter(0),
+              m_data(NULL),
+              m_capacity(0) {
+        memset(&m_header, 0, sizeof(m_header));
+    }
+
+    template<typename T>
+    RDScanCube<T>::~RDScanCube() {
+        free(m_data);
+    }
+
+    template<typename T>
+    void RDScanCube<T>::clear() {
+        free(m_data);
+        m_data = NULL;
+        m_capacity = 0;
+        m_times.clear();
+        memset(&m_header, 0, sizeof(m_header));
+        m_dimLon = m_dimLat = 0;
+        m_stride = 0;
+        m_precision = 1.0f;
+        m_offset = 0.0f;
+    }
+
+    template<typename T>
+    void RDScanCube<T>::reserve(size_t scans) {
+        if (m_data == NULL) {
+            // allocated with the first scan
+            m_capacity = std::max(m_capacity, scans);
+        } else if (scans > m_capacity) {
+            grow(scans);
+        }
+    }
+
+    template<typename T>
+    void RDScanCube<T>::grow(size_t capacity) {
+        void *block = NULL;
+        size_t bytes = capacity * m_stride * sizeof(T);
+        if (posix_memalign(&block, RD_CUBE_ALIGNMENT, bytes) != 0) {
+            throw RDConversionException("Could not allocate scan cube");
+        }
+        if (m_data != NULL) {
+            memcpy(block, m_data, m_times.size() * m_stride * sizeof(T));
+            free(m_data);
+        }
+        m_data = (T *) block;
+        m_capacity = capacity;
+    }
+
+    template<typename T>
+    void RDScanCube<T>::append(const RDScan *scan) {
+        RDScanType type = scan->header.scanType;
+        time_t time = RDScanTimeInSecondsSinceEpoch(const_cast<RDScan *>(scan));
+
+        if (m_data == NULL) {
+            float precision = 1.0f;
+            float offset = 0.0f;
+            if (sizeof(T) < sizeof(RDDataType)) {
+                precision = RDCompactPrecision(scan->header);
+                offset = RDLowestValue(type, precision);
+            }
+
+            size_t perLine = RD_CUBE_ALIGNMENT / sizeof(T);
+            size_t cells = (size_t) scan->dimLon * scan->dimLat;
+            m_stride = (cells + perLine - 1) / perLine * perLine;
+            m_header = scan->header;
+            m_header.radarStations = NULL;
+            m_header.numberOfRadarStations = 0;
+            m_dimLon = scan->dimLon;
+            m_dimLat = scan->dimLat;
+            m_precision = precision;
+            m_offset = offset;
+            m_missing = RDMissingValue(type);
+            m_clutter = RDClutterValue(type);
+            grow(std::max(m_capacity, (size_t) 4));
+        } else {
+            if (type != m_header.scanType) {
+                throw RDConversionException("Scan is of a different product");
+            }
+            if (scan->dimLon != m_dimLon || scan->dimLat != m_dimLat) {
+                throw RDConversionException("Scan has a different grid");
+            }
+            if (sizeof(T) < sizeof(RDDataType) && scan->header.precision != m_header.precision) {
+                throw RDConversionException("Scan has a different precision");
+            }
+            if (time <= m_times.back()) {
+                throw RDConversionException("Scans must be appended in chronological order without duplicates");
+            }
+            if (m_times.size() == m_capacity) {
+                grow(2 * m_capacity);
+            }
+        }
+
+        T *slice = m_data + m_times.size() * m_stride;
+        size_t cells = (size_t) m_dimLon * m_dimLat;
+        encode(scan->data, slice);
+        memset(slice + cells, 0, (m_stride - cells) * sizeof(T));
+        m_times.push_back(time);
+    }
+
+    template<typename T>
+    void RDScanCube<T>::appendFile(const char *filename) {
+        RDScanFile scan(filename, false);
+        append(scan.get());
+    }
+
+    template<>
+    void RDScanCube<float>::encode(const RDDataType *values, float *target) const {
+        memcpy(target, values, (size_t) m_dimLon * m_dimLat * sizeof(float));
+    }
+
+    template<>
+    void RDScanCube<uint16_t>::encode(const RDDataType *values, uint16_t *target) const {
+        RDEncodeCompact(m_header.scanType, m_precision, values, (size_t) m_dimLon * m_dimLat, target);
+    }
+
+    template<>
+    RDDataType RDScanCube<float>::decode(float stored) const {
+        return stored;
+    }
+
+    template<>
+    RDDataType RDScanCube<uint16_t>::decode(uint16_t stored) const {
+        if (stored == RD_CUBE_MISSING) return m_missing;
+        if (stored == RD_CUBE_CLUTTER) return m_clutter;
+        return m_offset + stored * m_precision;
+    }
+
+    template<typename T>
+    long RDScanCube<T>::find(time_t time) const {
+        std::vector<time_t>::const_iterator it = std::lower_bound(m_times.begin(), m_times.end(), time);
+        if (it == m_times.end() || *it != time) return -1;
+        return (long) (it - m_times.begin());
+    }
+
+    template<typename T>
+    void RDScanCube<T>::range(time_t begin, time_t end, size_t &first, size_t &last) const {
+        first = (size_t) (std::lower_bound(m_times.begin(), m_times.end(), begin) - m_times.begin());
+        last = (size_t) (std::lower_bound(m_times.begin() + first, m_times.end(), end) - m_times.begin());
+        if (last < first) last = first;
+    }
+
+    template<typename T>
+    RDCubeView<T> RDScanCube<T>::scanView(size_t t) const {
+        return window(t, t + 1, 0, m_dimLon, 0, m_dimLat);
+    }
+
+    template<typename T>
+    RDCubeView<T> RDScanCube<T>::window(size_t t0, size_t t1, int x0, int x1, int y0, int y1) const {
+        if (t0 > t1 || t1 > m_times.size() || x0 < 0 || x0 > x1 || x1 > m_dimLon
+            || y0 < 0 || y0 > y1 || y1 > m_dimLat) {
+            throw RDConversionException("Window is not within the scan cube");
+        }
+        RDCubeView<T> view;
+        view.data = m_data + t0 * m_stride + (size_t) y0 * m_dimLon + x0;
+        view.times = t1 - t0;
+        view.rows = y1 - y0;
+        view.columns = x1 - x0;
+        view.timeStride = m_stride;
+        view.rowStride = (size_t) m_dimLon;
+        return view;
+    }
+
+    template<typename T>
+    RDCubeView<T> RDScanCube<T>::series(int x, int y, size_t t0, size_t t1) const {
+        return window(t0, std::min(t1, m_times.size()), x, x + 1, y, y + 1);
+    }
+
+    template<typename T>
+    RDScan *RDScanCube<T>::scanAt(size_t t) const {
+        if (t >= m_times.size()) {
+            throw RDConversionException("Scan is not within the scan cube");
+        }
+        size_t cells = (size_t) m_dimLon * m_dimLat;
+        RDScan *result = RDAllocateResultScan(m_header, m_dimLon, m_dimLat, m_times[t]);
+
+        RDScanType type = m_header.scanType;
+        const T *slice = scan(t);
+        result->min_value = RDMaxValue(type);
+        result->max_value = RDMinValue(type);
+        for (size_t i = 0; i < cells; i++) {
+            RDDataType v = decode(slice[i]);
+            result->data[i] = v;
+            if (RDIsCleanMeasurement(type, v)) {
+                result->min_value = std::min(result->min_value, v);
+                result->max_value = std::max(result->max_value, v);
+            }
+        }
+        return result;
+    }
+
+    template class RDScanCube<float>;
+
+    template class RDScanCube<uint16_t>;
+}
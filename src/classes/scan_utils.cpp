@@ -0,0 +1,71 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <radolan/read.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/scan_utils.h>
+
+namespace Radolan {
+
+    RDScan *RDAllocateResultScan(const RDRadolanHeader &header, int dimLon, int dimLat, time_t time) {
+        RDScan *result = RDAllocateScan();
+        if (result == NULL) {
+            throw RDConversionException("Could not allocate scan");
+        }
+        result->data = (RDDataType *) malloc((size_t) dimLon * dimLat * sizeof(RDDataType));
+        if (result->data == NULL) {
+            RDFreeScan(result);
+            throw RDConversionException("Could not allocate scan data");
+        }
+
+        result->filename[0] = '\0';
+        result->header = header;
+        result->header.radarStations = NULL;
+        result->header.numberOfRadarStations = 0;
+        RDSetScanTime(&result->header, time);
+        result->dimLon = dimLon;
+        result->dimLat = dimLat;
+        result->dbZPerUnit = 0;
+        result->min_value = 0;
+        result->max_value = 0;
+        return result;
+    }
+
+    RDScanFile::RDScanFile(const char *filename, bool omitOutside) {
+        m_scan = RDAllocateScan();
+        if (m_scan == NULL) {
+            throw RDConversionException("Could not allocate scan");
+        }
+        m_scan->data = NULL;
+        if (!RDReadScan(filename, m_scan, omitOutside)) {
+            RDFreeScan(m_scan);
+            throw RDConversionException("Could not read radolan file");
+        }
+    }
+
+    RDScanFile::~RDScanFile() {
+        RDFreeScan(m_scan);
+    }
+}
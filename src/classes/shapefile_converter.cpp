@@ -25,144 +25,290 @@
 
 #include <radolan/shapefile_converter.h>
 #include <radolan/coordinate_system.h>
+#include <radolan/grid_geometry.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/regions.h>
+#include <radolan/text_converter.h>
 #include <shapefil.h>
 
 #ifdef __cplusplus
 namespace Radolan {
 #endif
 
-    void Radolan2Shapefile::convertToPoints(RDScan *scan,
-                                            const char *filename,
-                                            bool geographic,
-                                            bool withValues)
-    {
-        SHPHandle shapefile = withValues ? SHPCreate(filename, SHPT_MULTIPOINTM) : SHPCreate(filename, SHPT_MULTIPOINT);
-        if (shapefile) {
-            int partIndexes[1] = {0};
-            int *parts = &partIndexes[0];
-            int maxNumObjects = scan->dimLat * scan->dimLon;
+    // ISO 8601 timestamp of the scan for the TIME attribute
+    static std::string scanTimestamp(RDScan *scan) {
+        char buffer[32];
+        RDScanTimeString(scan, buffer, sizeof(buffer));
+        return std::string(buffer);
+    }
 
-            double *px = (double *) calloc(maxNumObjects, sizeof(double));
-            double *py = (double *) calloc(maxNumObjects, sizeof(double));
-            double *m = (double *) calloc(maxNumObjects, sizeof(double));
+    RDShapefileWriter::RDShapefileWriter(const char *filename,
+                                         int shapeType,
+                                         const char *timestamp,
+                                         size_t batchSize)
+            : m_filename(filename),
+              m_shapeType(shapeType),
+              m_hasMeasure(shapeType == SHPT_POINTM || shapeType == SHPT_POLYGONM),
+              m_timestamp(timestamp),
+              m_batchSize(batchSize > 0 ? batchSize : 1),
+              m_shapefile(NULL),
+              m_table(NULL) {
+        m_shapefile = SHPCreate(filename, shapeType);
+        if (!m_shapefile) {
+            throw RDConversionException("Could not open output file");
+        }
+        m_table = DBFCreate(filename);
+        if (!m_table) {
+            SHPClose(m_shapefile);
+            throw RDConversionException("Could not open output attribute table");
+        }
+        m_valueField = DBFAddField(m_table, "VALUE", FTDouble, 12, 3);
+        m_ixField = DBFAddField(m_table, "IX", FTInteger, 5, 0);
+        m_iyField = DBFAddField(m_table, "IY", FTInteger, 5, 0);
+        m_timeField = DBFAddField(m_table, "TIME", FTString, 20, 0);
+
+        m_vertexStart.reserve(m_batchSize + 1);
+        m_vertexStart.push_back(0);
+        m_value.reserve(m_batchSize);
+        m_ix.reserve(m_batchSize);
+        m_iy.reserve(m_batchSize);
+    }
 
-            if (px == NULL || py == NULL || m == NULL) {
-                throw new RDConversionException("Could not allocate memory");
-            }
+    RDShapefileWriter::~RDShapefileWriter() {
+        if (m_table) DBFClose(m_table);
+        if (m_shapefile) SHPClose(m_shapefile);
+    }
 
-            RDCoordinateSystem rcs = RDCoordinateSystem(scan->header.scanType);
-            int index = 0, ix, iy;
-            for (iy = 0; iy < scan->dimLat; iy++) {
-                for (ix = 0; ix < scan->dimLon; ix++) {
-                    RDDataType value = scan->data[iy * scan->dimLon + ix];
-                    if (!(value == -32.5 || value == 92.5)) {
-                        RDCartesianPoint cart = rcs.cartesianCoordinate(rdGridPoint(ix, iy));
-                        double lat;
-                        double lon;
-                        if (geographic == true) {
-                            RDGeographicalPoint geo = rcs.geographicalCoordinate(cart);
-                            lon = geo.longitude;
-                            lat = geo.latitude;
-                        } else {
-                            lon = cart.x;
-                            lat = cart.y;
-                        }
-                        px[index] = lat;
-                        py[index] = lon;
-                        m[index] = value;
-                        index++;
-                    }
-                }
+    void RDShapefileWriter::addPoint(double x, double y, double value, int ix, int iy) {
+        m_x.push_back(x);
+        m_y.push_back(y);
+        m_vertexStart.push_back((int) m_x.size());
+        m_value.push_back(value);
+        m_ix.push_back(ix);
+        m_iy.push_back(iy);
+        if (m_value.size() >= m_batchSize) flush();
+    }
+
+    void RDShapefileWriter::addPolygon(const double *px, const double *py, int count, double value, int ix, int iy) {
+        m_x.insert(m_x.end(), px, px + count);
+        m_y.insert(m_y.end(), py, py + count);
+        m_vertexStart.push_back((int) m_x.size());
+        m_value.push_back(value);
+        m_ix.push_back(ix);
+        m_iy.push_back(iy);
+        if (m_value.size() >= m_batchSize) flush();
+    }
+
+    void RDShapefileWriter::flush() {
+        int partStart = 0;
+        for (size_t i = 0; i < m_value.size(); i++) {
+            int first = m_vertexStart[i];
+            int count = m_vertexStart[i + 1] - first;
+            if (m_hasMeasure) {
+                m_measure.assign(count, m_value[i]);
             }
+            SHPObject *shape = SHPCreateObject(m_shapeType, -1,
+                                               (m_shapeType == SHPT_POLYGON || m_shapeType == SHPT_POLYGONM) ? 1 : 0,
+                                               &partStart, NULL, count, &m_x[first], &m_y[first], NULL,
+                                               m_hasMeasure ? &m_measure[0] : NULL);
+            int record = SHPWriteObject(m_shapefile, -1, shape);
+            SHPDestroyObject(shape);
+
+            DBFWriteDoubleAttribute(m_table, record, m_valueField, m_value[i]);
+            DBFWriteIntegerAttribute(m_table, record, m_ixField, m_ix[i]);
+            DBFWriteIntegerAttribute(m_table, record, m_iyField, m_iy[i]);
+            DBFWriteStringAttribute(m_table, record, m_timeField, m_timestamp.c_str());
+        }
+
+        m_x.clear();
+        m_y.clear();
+        m_vertexStart.resize(1);
+        m_value.clear();
+        m_ix.clear();
+        m_iy.clear();
+    }
 
-            SHPObject *multipoint = withValues
-                ? SHPCreateObject(SHPT_MULTIPOINTM, 0, 1, parts, NULL, index, px, py, NULL, m)
-                : SHPCreateSimpleObject(SHPT_MULTIPOINT, 1, px, py, NULL);
+    void RDShapefileWriter::close(bool writeIndex) {
+        flush();
+        DBFClose(m_table);
+        m_table = NULL;
+        SHPClose(m_shapefile);
+        m_shapefile = NULL;
+
+        if (writeIndex) {
+            // shapelib accepts the name with or without extension
+            std::string base = m_filename;
+            if (base.size() > 4 && base[base.size() - 4] == '.') {
+                base.erase(base.size() - 4);
+            }
 
-            SHPWriteObject(shapefile, -1, multipoint);
+            SHPHandle shapefile = SHPOpen(m_filename.c_str(), "rb");
+            if (!shapefile) {
+                throw RDConversionException("Could not reopen output file for indexing");
+            }
+            SHPTree *tree = SHPCreateTree(shapefile, 2, 0, NULL, NULL);
             SHPClose(shapefile);
-            SHPDestroyObject(multipoint);
-            free(px);
-            free(py);
-            free(m);
-        } else {
-            throw new RDConversionException("Could not open output file");
+            if (!tree) {
+                throw RDConversionException("Could not create spatial index");
+            }
+            SHPTreeTrimExtraNodes(tree);
+            int written = SHPWriteTree(tree, (base + ".qix").c_str());
+            SHPDestroyTree(tree);
+            if (!written) {
+                throw RDConversionException("Could not write spatial index");
+            }
+        }
+    }
+
+    void Radolan2Shapefile::convertToPoints(RDScan *scan,
+                                            const char *filename,
+                                            bool geographic,
+                                            bool withValues)
+    {
+        const RDGridGeometry *grid = RDGridGeometry::forScan(scan);
+        const double *cx = grid->centreX();
+        const double *cy = grid->centreY();
+        const double *lon = geographic ? grid->centreLongitudes() : NULL;
+        const double *lat = geographic ? grid->centreLatitudes() : NULL;
+
+        RDShapefileWriter writer(filename, withValues ? SHPT_POINTM : SHPT_POINT, scanTimestamp(scan).c_str());
+        for (int iy = 0; iy < scan->dimLat; iy++) {
+            for (int ix = 0; ix < scan->dimLon; ix++) {
+                size_t i = (size_t) iy * scan->dimLon + ix;
+                RDDataType value = scan->data[i];
+                if (value == -32.5 || value == 92.5) continue;
+                if (geographic) {
+                    writer.addPoint(lon[i], lat[i], value, ix, iy);
+                } else {
+                    writer.addPoint(cx[ix], cy[iy], value, ix, iy);
+                }
+            }
         }
+        writer.close();
     }
 
     void Radolan2Shapefile::convertToPolygons(RDScan *scan,
                                               const char *filename,
                                               bool geographic,
                                               bool withValues) {
+        const RDGridGeometry *grid = RDGridGeometry::forScan(scan);
+        const double *cx = grid->cornerX();
+        const double *cy = grid->cornerY();
+        const double *lon = geographic ? grid->cornerLongitudes() : NULL;
+        const double *lat = geographic ? grid->cornerLatitudes() : NULL;
+        size_t stride = (size_t) scan->dimLon + 1;
+
+        RDShapefileWriter writer(filename, withValues ? SHPT_POLYGONM : SHPT_POLYGON, scanTimestamp(scan).c_str());
+        for (int iy = 0; iy < scan->dimLat; iy++) {
+            for (int ix = 0; ix < scan->dimLon; ix++) {
+                RDDataType value = scan->data[(size_t) iy * scan->dimLon + ix];
+                if (value == -32.5 || value == 92.5) continue;
+
+                // bottom left, top left, top right, bottom right and back
+                double px[5], py[5];
+                if (geographic) {
+                    size_t corners[5] = {iy * stride + ix, (iy + 1) * stride + ix, (iy + 1) * stride + ix + 1,
+                                         iy * stride + ix + 1, iy * stride + ix};
+                    for (int k = 0; k < 5; k++) {
+                        px[k] = lon[corners[k]];
+                        py[k] = lat[corners[k]];
+                    }
+                } else {
+                    px[0] = px[1] = px[4] = cx[ix];
+                    px[2] = px[3] = cx[ix + 1];
+                    py[0] = py[3] = py[4] = cy[iy];
+                    py[1] = py[2] = cy[iy + 1];
+                }
+                writer.addPolygon(px, py, 5, value, ix, iy);
+            }
+        }
+        writer.close();
+    }
+
+    void Radolan2Shapefile::convertToRegions(RDScan *scan,
+                                             const char *filename,
+                                             const std::vector<RDDataType> &classBreaks,
+                                             bool geographic,
+                                             bool withValues) {
+        size_t count = (size_t) scan->dimLon * scan->dimLat;
+        std::vector<int> classes(count);
+        RDClassifyScan(scan, classBreaks, &classes[0]);
+
+        RDRegions regions;
+        int numRegions = RDLabelRegions(&classes[0], scan->dimLon, scan->dimLat, regions);
+
+        std::vector<std::vector<RDRing> > rings;
+        RDTraceRegionBoundaries(regions, rings);
+
         SHPHandle shapefile = withValues
           ? SHPCreate(filename, SHPT_POLYGONM)
           : SHPCreate(filename, SHPT_POLYGON);
+        if (!shapefile) {
+            throw RDConversionException("Could not open output file");
+        }
 
-        if (shapefile) {
-            int partIndexes[1] = {0};
-            int *parts = &partIndexes[0];
-            int ix, iy;
-
-            RDCoordinateSystem rcs = RDCoordinateSystem(scan->header.scanType);
-            for (iy = 0; iy < scan->dimLat; iy++) {
-                for (ix = 0; ix < scan->dimLon; ix++) {
-                    double value = scan->data[iy * scan->dimLon + ix];
-                    if (!(value == -32.5 || value == 92.5)) {
-                        double px[5], py[5], m[5];
-                        double lat_min, lat_max, lon_min, lon_max;
-
-                        RDCartesianPoint cart_min = rcs.cartesianCoordinate(rdGridPoint(ix, iy));
-                        RDCartesianPoint cart_max = rcs.cartesianCoordinate(rdGridPoint(ix + 1, iy + 1));
-
-                        if (geographic == true) {
-                            RDGeographicalPoint geo_min = rcs.geographicalCoordinate(cart_min);
-                            lon_min = geo_min.longitude;
-                            lat_min = geo_min.latitude;
-                            RDGeographicalPoint geo_max = rcs.geographicalCoordinate(cart_max);
-                            lon_max = geo_max.longitude;
-                            lat_max = geo_max.latitude;
-                        } else {
-                            lon_min = cart_min.x;
-                            lat_min = cart_min.y;
-                            lon_max = cart_max.x;
-                            lat_max = cart_max.y;
-                        }
-
-                        // bottom left
-                        px[0] = lon_min;
-                        py[0] = lat_min;
-
-                        // top left
-                        px[1] = lon_min;
-                        py[1] = lat_max;
-
-                        // top right
-                        px[2] = lon_max;
-                        py[2] = lat_max;
-
-                        // bottom right
-                        px[3] = lon_max;
-                        py[3] = lat_min;
-
-                        // and back
-                        px[4] = lon_min;
-                        py[4] = lat_min;
-
-                        m[0] = m[1] = m[2] = m[3] = m[4] = value;
-
-                        SHPObject *polygon = withValues
-                         ? SHPCreateObject(SHPT_POLYGONM, iy * scan->dimLat + ix, 4, parts, NULL, 5, px, py, NULL, m)
-                         : SHPCreateSimpleObject(SHPT_POLYGON, 5, px, py, NULL);
-
-                        SHPWriteObject(shapefile, -1, polygon);
-                        SHPDestroyObject(polygon);
+        DBFHandle table = DBFCreate(filename);
+        if (!table) {
+            SHPClose(shapefile);
+            throw RDConversionException("Could not open output attribute table");
+        }
+        int classField = DBFAddField(table, "CLASS", FTInteger, 4, 0);
+        int lowerField = DBFAddField(table, "LOWER", FTDouble, 12, 3);
+        int upperField = DBFAddField(table, "UPPER", FTDouble, 12, 3);
+        int cellsField = DBFAddField(table, "CELLS", FTInteger, 9, 0);
+
+        const RDGridGeometry *grid = RDGridGeometry::forScan(scan);
+        const double *cx = grid->cornerX();
+        const double *cy = grid->cornerY();
+        const double *lon = geographic ? grid->cornerLongitudes() : NULL;
+        const double *lat = geographic ? grid->cornerLatitudes() : NULL;
+        size_t stride = (size_t) scan->dimLon + 1;
+
+        std::vector<double> px, py, m;
+        std::vector<int> parts;
+
+        for (int r = 0; r < numRegions; r++) {
+            int regionClass = regions.regionClass[r];
+            double lower = classBreaks[regionClass];
+            double upper = (regionClass + 1 < (int) classBreaks.size())
+                           ? classBreaks[regionClass + 1]
+                           : RDMaxValue(scan->header.scanType);
+
+            px.clear();
+            py.clear();
+            parts.clear();
+            for (size_t ri = 0; ri < rings[r].size(); ri++) {
+                const RDRing &ring = rings[r][ri];
+                parts.push_back((int) px.size());
+                for (size_t vi = 0; vi < ring.size(); vi++) {
+                    const RDGridPoint &corner = ring[vi];
+                    if (geographic) {
+                        size_t i = corner.iy * stride + corner.ix;
+                        px.push_back(lon[i]);
+                        py.push_back(lat[i]);
+                    } else {
+                        px.push_back(cx[corner.ix]);
+                        py.push_back(cy[corner.iy]);
                     }
                 }
             }
-            SHPClose(shapefile);
-        } else {
-            throw new RDConversionException("Could not open output file");
+            m.assign(px.size(), lower);
+
+            SHPObject *polygon = SHPCreateObject(withValues ? SHPT_POLYGONM : SHPT_POLYGON, -1,
+                                                 (int) parts.size(), &parts[0], NULL,
+                                                 (int) px.size(), &px[0], &py[0], NULL,
+                                                 withValues ? &m[0] : NULL);
+            int record = SHPWriteObject(shapefile, -1, polygon);
+            SHPDestroyObject(polygon);
+
+            DBFWriteIntegerAttribute(table, record, classField, regionClass);
+            DBFWriteDoubleAttribute(table, record, lowerField, lower);
+            DBFWriteDoubleAttribute(table, record, upperField, upper);
+            DBFWriteIntegerAttribute(table, record, cellsField, regions.regionSize[r]);
         }
+
+        DBFClose(table);
+        SHPClose(shapefile);
     }
 
     void Radolan2Shapefile::getBoundingBoxPolygon(RDScan *scan,
@@ -171,7 +317,8 @@ namespace Radolan {
                                                   bool geographic)
     {
         RDCoordinateSystem rcs = RDCoordinateSystem(scan->header.scanType);
-        RDCartesianPoint cart = rcs.cartesianCoordinate(rdGridPoint(0, 0));
+        // outer corners of the grid, so the box encloses all cell polygons
+        RDCartesianPoint cart = rcs.cartesianCornerCoordinate(rdGridPoint(0, 0));
 
         px.resize(5, 0.0);
         py.resize(5, 0.0);
@@ -180,15 +327,15 @@ namespace Radolan {
         px[0] = (double) cart.x;
         py[0] = (double) cart.y;
 
-        cart = rcs.cartesianCoordinate(rdGridPoint(0, scan->dimLat - 1));
+        cart = rcs.cartesianCornerCoordinate(rdGridPoint(0, scan->dimLat));
         px[1] = (double) cart.x;
         py[1] = (double) cart.y;
 
-        cart = rcs.cartesianCoordinate(rdGridPoint(scan->dimLon - 1, scan->dimLat - 1));
+        cart = rcs.cartesianCornerCoordinate(rdGridPoint(scan->dimLon, scan->dimLat));
         px[2] = (double) cart.x;
         py[2] = (double) cart.y;
 
-        cart = rcs.cartesianCoordinate(rdGridPoint(scan->dimLon - 1, 0));
+        cart = rcs.cartesianCornerCoordinate(rdGridPoint(scan->dimLon, 0));
         px[3] = (double) cart.x;
         py[3] = (double) cart.y;
 
@@ -239,24 +386,14 @@ namespace Radolan {
     }
 
     void Radolan2Shapefile::printAsProj(RDScan *scan, bool geographic) {
-        float lat, lon;
-        int ix, iy;
-        RDCoordinateSystem rcs = RDCoordinateSystem(scan->header.scanType);
-        for (iy = 0; iy < scan->dimLat; iy++) {
-            for (ix = 0; ix < scan->dimLon; ix++) {
-                if (geographic) {
-                    RDGeographicalPoint geo = rcs.geographicalCoordinate(rdGridPoint(ix, iy));
-                    lon = geo.longitude;
-                    lat = geo.latitude;
-                }
-                else {
-                    RDCartesianPoint cart = rcs.cartesianCoordinate(rdGridPoint(ix, iy));
-                    lon = cart.x;
-                    lat = cart.y;
-                }
-                printf("%f\t%f\t%f\n", lat, lon, scan->data[iy * scan->dimLat + ix]);
-            }
-        }
+        RDTextOptions options = rdTextOptions();
+        options.geographic = geographic;
+        options.yFirst = true;
+        options.separator = '\t';
+
+        // the exporter writes to the descriptor directly
+        fflush(stdout);
+        Radolan2Text::writeXYZ(scan, fileno(stdout), options);
     }
 
 #ifdef __cplusplus
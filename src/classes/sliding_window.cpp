@@ -0,0 +1,320 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <string.h>
+
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+#include <radolan/scan_utils.h>
+#include <radolan/sliding_window.h>
+
+namespace Radolan {
+
+    // raw value of missing and clutter cells in the ring
+    static const uint16_t RD_RAW_INVALID = 0xFFFF;
+
+    RDSlidingWindow::RDSlidingWindow(const std::vector<int> &windowMinutes,
+                                     int intervalMinutes,
+                                     bool withMaxima,
+                                     RDInvalidPolicy invalidPolicy)
+            : m_intervalMinutes(intervalMinutes),
+              m_withMaxima(withMaxima),
+              m_invalidPolicy(invalidPolicy),
+              m_minimumCoverage(0.5),
+              m_initialized(false),
+              m_dimLon(0),
+              m_dimLat(0),
+              m_cells(0),
+              m_lastTime(0),
+              m_capacity(0),
+              m_newest(0) {
+        if (windowMinutes.empty()) {
+            throw RDConversionException("No window lengths given");
+        }
+        if (intervalMinutes <= 0) {
+            throw RDConversionException("Scan interval must be positive");
+        }
+        for (size_t w = 0; w < windowMinutes.size(); w++) {
+            if (windowMinutes[w] <= 0 || windowMinutes[w] % intervalMinutes != 0) {
+                throw RDConversionException("Window length is not a multiple of the scan interval");
+            }
+            int length = windowMinutes[w] / intervalMinutes;
+            if (length >= RD_RAW_INVALID) {
+                throw RDConversionException("Window is too long");
+            }
+            m_lengths.push_back(length);
+            m_capacity = std::max(m_capacity, (size_t) length);
+        }
+
+        // window indices from the longest to the shortest, for reading
+        // the maxima off the queues front to back
+        for (size_t w = 0; w < m_lengths.size(); w++) m_longestFirst.push_back(w);
+        std::sort(m_longestFirst.begin(), m_longestFirst.end(), [this](size_t a, size_t b) {
+            return m_lengths[a] > m_lengths[b];
+        });
+
+        memset(&m_header, 0, sizeof(m_header));
+    }
+
+    void RDSlidingWindow::setMinimumCoverage(double fraction) {
+        m_minimumCoverage = fraction;
+    }
+
+    void RDSlidingWindow::ingest(RDScan *scan) {
+        RDScanType type = scan->header.scanType;
+        if (type == RD_RX || type == RD_EX) {
+            throw RDConversionException("Reflectivity products can not be accumulated");
+        }
+        if (scan->header.intervalDuration != m_intervalMinutes) {
+            throw RDConversionException("Scan has a different interval duration");
+        }
+
+        time_t time = RDScanTimeInSecondsSinceEpoch(scan);
+        time_t interval = (time_t) m_intervalMinutes * 60;
+        size_t gap = 0;
+
+        if (!m_initialized) {
+            if (scan->header.precision <= 0) {
+                throw RDConversionException("Scan has no precision");
+            }
+            m_header = scan->header;
+            m_header.radarStations = NULL;
+            m_header.numberOfRadarStations = 0;
+            m_dimLon = scan->dimLon;
+            m_dimLat = scan->dimLat;
+            m_cells = (size_t) m_dimLon * m_dimLat;
+
+            // start with windows full of missing scans
+            size_t windows = m_lengths.size();
+            m_ring.assign(m_capacity * m_cells, RD_RAW_INVALID);
+            m_newest = m_capacity - 1;
+            m_sums.assign(windows * m_cells, 0);
+            m_invalid.resize(windows * m_cells);
+            for (size_t w = 0; w < windows; w++) {
+                std::fill(m_invalid.begin() + w * m_cells, m_invalid.begin() + (w + 1) * m_cells,
+                          (uint16_t) m_lengths[w]);
+            }
+            if (m_withMaxima) {
+                m_queue.assign(m_capacity * m_cells, 0);
+                m_queueFront.assign(m_cells, 0);
+                m_queueSize.assign(m_cells, 0);
+                m_maxima.assign(windows * m_cells, RD_RAW_INVALID);
+            }
+            m_initialized = true;
+        } else {
+            if (type != m_header.scanType) {
+                throw RDConversionException("Scan is of a different product");
+            }
+            if (scan->dimLon != m_dimLon || scan->dimLat != m_dimLat) {
+                throw RDConversionException("Scan has a different grid");
+            }
+            if (scan->header.precision != m_header.precision) {
+                throw RDConversionException("Scan has a different precision");
+            }
+            if (time <= m_lastTime) {
+                throw RDConversionException("Scans must be ingested in chronological order without duplicates");
+            }
+            if ((time - m_lastTime) % interval != 0) {
+                throw RDConversionException("Scan does not lie on the interval grid");
+            }
+            gap = (size_t) ((time - m_lastTime) / interval) - 1;
+        }
+
+        // intervals without a scan move the windows on with missing scans
+        for (size_t i = 0; i < std::min(gap, m_capacity); i++) {
+            push(NULL);
+        }
+        push(scan->data);
+
+        m_header.day = scan->header.day;
+        m_header.month = scan->header.month;
+        m_header.year = scan->header.year;
+        m_header.hour = scan->header.hour;
+        m_header.minute = scan->header.minute;
+        m_lastTime = time;
+    }
+
+    void RDSlidingWindow::push(const RDDataType *data) {
+        const size_t cells = m_cells;
+        const size_t capacity = m_capacity;
+        const size_t windows = m_lengths.size();
+        const float inverse = 1.0f / m_header.precision;
+
+        size_t slot = m_newest + 1 == capacity ? 0 : m_newest + 1;
+
+        // scans dropping out of each window. For the longest window this
+        // is the slot about to be overwritten, so it is read first.
+        std::vector<const uint16_t *> expired(windows);
+        for (size_t w = 0; w < windows; w++) {
+            size_t e = (slot + capacity - (size_t) m_lengths[w]) % capacity;
+            expired[w] = &m_ring[e * cells];
+        }
+
+        uint16_t *newest = &m_ring[slot * cells];
+
+        for (size_t i = 0; i < cells; i++) {
+            uint16_t v = RD_RAW_INVALID;
+            if (data != NULL && data[i] >= 0.0f) {
+                float raw = data[i] * inverse + 0.5f;
+                v = raw < (float) RD_RAW_INVALID ? (uint16_t) raw : (uint16_t) (RD_RAW_INVALID - 1);
+            }
+            uint32_t isInvalid = v == RD_RAW_INVALID;
+            uint32_t value = isInvalid ? 0u : v;
+
+            for (size_t w = 0; w < windows; w++) {
+                uint16_t e = expired[w][i];
+                uint32_t expiredInvalid = e == RD_RAW_INVALID;
+                m_sums[w * cells + i] += value - (expiredInvalid ? 0u : e);
+                m_invalid[w * cells + i] = (uint16_t) (m_invalid[w * cells + i] + isInvalid - expiredInvalid);
+            }
+            newest[i] = v;
+
+            if (!m_withMaxima) continue;
+
+            // monotonic queue of slots whose values decrease from front to back
+            uint16_t *queue = &m_queue[i * capacity];
+            size_t front = m_queueFront[i];
+            size_t size = m_queueSize[i];
+            if (size > 0 && queue[front] == slot) {
+                front = front + 1 == capacity ? 0 : front + 1;
+                size--;
+            }
+            if (!isInvalid) {
+                while (size > 0) {
+                    size_t back = (front + size - 1) % capacity;
+                    if (m_ring[queue[back] * cells + i] > v) break;
+                    size--;
+                }
+                queue[(front + size) % capacity] = (uint16_t) slot;
+                size++;
+            }
+            m_queueFront[i] = (uint16_t) front;
+            m_queueSize[i] = (uint16_t) size;
+
+            // the maximum of a window is the first queued value within it
+            size_t k = 0;
+            for (size_t o = 0; o < windows; o++) {
+                size_t w = m_longestFirst[o];
+                while (k < size) {
+                    size_t age = (slot + capacity - queue[(front + k) % capacity]) % capacity;
+                    if (age < (size_t) m_lengths[w]) break;
+                    k++;
+                }
+                m_maxima[w * cells + i] = k < size
+                                          ? m_ring[queue[(front + k) % capacity] * cells + i]
+                                          : RD_RAW_INVALID;
+            }
+        }
+
+        m_newest = slot;
+    }
+
+    void RDSlidingWindow::ingestFile(const char *filename) {
+        RDScanFile scan(filename, false);
+        ingest(scan.get());
+    }
+
+    RDScan *RDSlidingWindow::allocateResult(size_t window) const {
+        if (!m_initialized) {
+            throw RDConversionException("No scans were ingested");
+        }
+        if (window >= m_lengths.size()) {
+            throw RDConversionException("No such window");
+        }
+
+        RDScan *result = RDAllocateScan();
+        if (result == NULL) {
+            throw RDConversionException("Could not allocate scan");
+        }
+        result->data = (RDDataType *) malloc(m_cells * sizeof(RDDataType));
+        if (result->data == NULL) {
+            RDFreeScan(result);
+            throw RDConversionException("Could not allocate scan data");
+        }
+        result->filename[0] = '\0';
+        result->header = m_header;
+        result->dimLon = m_dimLon;
+        result->dimLat = m_dimLat;
+        result->dbZPerUnit = 0;
+        result->min_value = 0;
+        result->max_value = 0;
+        return result;
+    }
+
+    RDScan *RDSlidingWindow::total(size_t window) const {
+        RDScan *result = allocateResult(window);
+        result->header.intervalDuration = (unsigned short) windowMinutes(window);
+
+        const uint32_t length = (uint32_t) m_lengths[window];
+        const uint32_t *sums = &m_sums[window * m_cells];
+        const uint16_t *invalid = &m_invalid[window * m_cells];
+        RDDataType missing = RDMissingValue(m_header.scanType);
+
+        for (size_t i = 0; i < m_cells; i++) {
+            double total = (double) sums[i] * m_header.precision;
+            uint32_t valid = length - invalid[i];
+
+            bool isMissing = false;
+            if (m_invalidPolicy == RD_INVALID_AS_MISSING) {
+                isMissing = invalid[i] > 0;
+            } else if (m_invalidPolicy == RD_INVALID_SCALED) {
+                if (valid == 0 || valid < m_minimumCoverage * length) {
+                    isMissing = true;
+                } else {
+                    total *= (double) length / valid;
+                }
+            }
+
+            if (isMissing) {
+                result->data[i] = missing;
+            } else {
+                result->data[i] = (RDDataType) total;
+                if (result->data[i] > result->max_value) result->max_value = result->data[i];
+            }
+        }
+
+        return result;
+    }
+
+    RDScan *RDSlidingWindow::maximum(size_t window) const {
+        if (!m_withMaxima) {
+            throw RDConversionException("Rolling maxima are not kept");
+        }
+        RDScan *result = allocateResult(window);
+
+        const uint16_t *maxima = &m_maxima[window * m_cells];
+        RDDataType missing = RDMissingValue(m_header.scanType);
+
+        for (size_t i = 0; i < m_cells; i++) {
+            if (maxima[i] == RD_RAW_INVALID) {
+                result->data[i] = missing;
+            } else {
+                result->data[i] = (RDDataType) (maxima[i] * m_header.precision);
+                if (result->data[i] > result->max_value) result->max_value = result->data[i];
+            }
+        }
+
+        return result;
+    }
+}
@@ -0,0 +1,282 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdint.h>
+#include <thread>
+
+#include <radolan/radolan_utils.h>
+#include <radolan/statistics.h>
+
+namespace Radolan {
+
+    // steps resolved by the fine histogram. Values beyond end up in the
+    // last step and are summed up separately.
+    static const uint32_t RD_FINE_STEPS = 1u << 16;
+
+    // slots after the steps for the cells that are not valid
+    static const uint32_t RD_MISSING_SLOT = RD_FINE_STEPS;
+    static const uint32_t RD_CLUTTER_SLOT = RD_FINE_STEPS + 1;
+    static const uint32_t RD_EXCLUDED_SLOT = RD_FINE_STEPS + 2;
+
+    // cells per block of the kernel
+    static const size_t RD_STATISTICS_CHUNK = 2048;
+
+    /** Constants of the kernel, derived from scan and options */
+    typedef struct {
+        const RDDataType *data;
+        const unsigned char *mask;
+        float lower;          // value of step 0 (lowest value of the product)
+        float inverse;        // steps per unit
+        float upper;          // values at or above are markers (RX, EX)
+        float missing;
+        float clutter;
+        float histogramMin;
+        float histogramMax;
+        float binsPerUnit;
+        uint32_t bins;
+    } RDStatisticsParameters;
+
+    /**
+     * Statistics of a part of the grid. All values but the ones beyond the
+     * fine steps are counted per step, everything else is derived from
+     * these counts afterwards.
+     */
+    typedef struct {
+        std::vector<uint32_t> fine;
+        // below, bins, above, excluded
+        std::vector<uint64_t> histogram;
+        uint64_t overflowCount;
+        double overflowSum;
+        double overflowMax;
+    } RDPartialStatistics;
+
+    static void rdInitPartial(RDPartialStatistics &p, uint32_t bins) {
+        p.fine.assign(RD_EXCLUDED_SLOT + 1, 0);
+        p.histogram.assign(bins + 3, 0);
+        p.overflowCount = 0;
+        p.overflowSum = 0.0;
+        p.overflowMax = 0.0;
+    }
+
+    static void rdStatisticsKernel(const RDStatisticsParameters &p, size_t begin, size_t end,
+                                   RDPartialStatistics &partial) {
+        uint32_t slot[RD_STATISTICS_CHUNK];
+        uint32_t bin[RD_STATISTICS_CHUNK];
+        unsigned char all[RD_STATISTICS_CHUNK];
+        std::fill(all, all + RD_STATISTICS_CHUNK, 1);
+
+        // copied so that no loads from p remain in the loop
+        const float lower = p.lower, inverse = p.inverse, upper = p.upper;
+        const float missingValue = p.missing, clutterValue = p.clutter;
+        const float histogramMin = p.histogramMin, histogramMax = p.histogramMax;
+        const float binsPerUnit = p.binsPerUnit, lastBin = (float) (p.bins - 1);
+        const float lastStep = (float) (RD_FINE_STEPS - 1);
+        const uint32_t above = p.bins + 1, excluded = p.bins + 2;
+
+        for (size_t chunk = begin; chunk < end; chunk += RD_STATISTICS_CHUNK) {
+            size_t n = std::min(RD_STATISTICS_CHUNK, end - chunk);
+            const RDDataType *data = p.data + chunk;
+            const unsigned char *mask = p.mask != NULL ? p.mask + chunk : all;
+
+            // Only classifies and computes the slots, without reductions
+            // or conditional float operations, so it is vectorized.
+            for (size_t i = 0; i < n; i++) {
+                float v = data[i];
+                bool inside = mask[i] != 0;
+                bool isClutter = v == clutterValue;
+                bool isValid = inside & (v >= lower) & (v < upper) & (v != missingValue) & !isClutter;
+
+                float x = (v - lower) * inverse + 0.5f;
+                x = x > 0.0f ? x : 0.0f;
+                x = x < lastStep ? x : lastStep;
+                uint32_t other = isClutter ? RD_CLUTTER_SLOT : RD_MISSING_SLOT;
+                other = inside ? other : RD_EXCLUDED_SLOT;
+                slot[i] = isValid ? (uint32_t) (int32_t) x : other;
+
+                float b = (v - histogramMin) * binsPerUnit;
+                b = b > 0.0f ? b : 0.0f;
+                b = b < lastBin ? b : lastBin;
+                uint32_t histogramBin = 1u + (uint32_t) (int32_t) b;
+                histogramBin = v >= histogramMax ? above : histogramBin;
+                histogramBin = v < histogramMin ? 0u : histogramBin;
+                bin[i] = isValid ? histogramBin : excluded;
+            }
+
+            for (size_t i = 0; i < n; i++) {
+                partial.fine[slot[i]]++;
+                partial.histogram[bin[i]]++;
+                if (slot[i] == RD_FINE_STEPS - 1) {
+                    partial.overflowCount++;
+                    partial.overflowSum += data[i];
+                    partial.overflowMax = std::max(partial.overflowMax, (double) data[i]);
+                }
+            }
+        }
+    }
+
+    static void rdMergePartial(RDPartialStatistics &into, const RDPartialStatistics &other) {
+        for (size_t i = 0; i < into.fine.size(); i++) into.fine[i] += other.fine[i];
+        for (size_t i = 0; i < into.histogram.size(); i++) into.histogram[i] += other.histogram[i];
+        into.overflowCount += other.overflowCount;
+        into.overflowSum += other.overflowSum;
+        into.overflowMax = std::max(into.overflowMax, other.overflowMax);
+    }
+
+    RDScanStatistics RDComputeStatistics(const RDScan *scan,
+                                         const RDStatisticsOptions &options,
+                                         unsigned int threads) {
+        if (options.histogramBins <= 0 || !(options.histogramMax > options.histogramMin)) {
+            throw RDConversionException("Invalid histogram bins");
+        }
+        for (size_t q = 0; q < options.quantileLevels.size(); q++) {
+            if (!(options.quantileLevels[q] >= 0.0 && options.quantileLevels[q] <= 1.0)) {
+                throw RDConversionException("Quantile levels must lie in [0,1]");
+            }
+        }
+
+        RDScanType type = scan->header.scanType;
+        bool reflectivity = type == RD_RX || type == RD_EX;
+        double precision = reflectivity ? 0.5 : (scan->header.precision > 0 ? scan->header.precision : 0.01);
+        double resolution = options.resolution > 0 ? options.resolution : precision;
+
+        RDStatisticsParameters p;
+        p.data = scan->data;
+        p.mask = options.mask;
+        // below zero for signed products (RD)
+        p.lower = RDLowestValue(type, (float) precision);
+        p.inverse = (float) (1.0 / resolution);
+        // clutter and missing markers of RX and EX are the two largest values
+        p.upper = reflectivity ? RDClutterValue(type) : INFINITY;
+        p.missing = RDMissingValue(type);
+        p.clutter = RDClutterValue(type);
+        p.histogramMin = (float) options.histogramMin;
+        p.histogramMax = (float) options.histogramMax;
+        p.bins = (uint32_t) options.histogramBins;
+        p.binsPerUnit = (float) (options.histogramBins / (options.histogramMax - options.histogramMin));
+
+        size_t count = (size_t) scan->dimLon * scan->dimLat;
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        size_t chunks = (count + RD_STATISTICS_CHUNK - 1) / RD_STATISTICS_CHUNK;
+        threads = (unsigned int) std::max((size_t) 1, std::min((size_t) threads, chunks));
+
+        std::vector<RDPartialStatistics> partials(threads);
+        for (size_t t = 0; t < threads; t++) {
+            rdInitPartial(partials[t], p.bins);
+        }
+
+        // contiguous ranges of whole chunks per thread
+        size_t chunksPerThread = (chunks + threads - 1) / threads;
+        if (threads == 1) {
+            rdStatisticsKernel(p, 0, count, partials[0]);
+        } else {
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t < threads; t++) {
+                size_t begin = std::min(count, t * chunksPerThread * RD_STATISTICS_CHUNK);
+                size_t end = std::min(count, (t + 1) * chunksPerThread * RD_STATISTICS_CHUNK);
+                workers.push_back(std::thread(rdStatisticsKernel, std::cref(p), begin, end,
+                                              std::ref(partials[t])));
+            }
+            for (size_t t = 0; t < workers.size(); t++) {
+                workers[t].join();
+            }
+            for (size_t t = 1; t < threads; t++) {
+                rdMergePartial(partials[0], partials[t]);
+            }
+        }
+        const RDPartialStatistics &all = partials[0];
+        // for signed products the same 4095 steps in double, so values near
+        // zero come out as exact as for unsigned ones
+        const double lower = RDIsSigned(type) ? -4095.0 * precision : (double) p.lower;
+        const uint32_t lastStep = RD_FINE_STEPS - 1;
+
+        // everything below is derived from the counts per step
+        uint64_t valid = all.overflowCount;
+        double sum = all.overflowSum;
+        uint64_t wet = 0;
+        double wetSum = 0.0;
+        uint32_t minStep = lastStep, maxStep = 0;
+        // values above the threshold lie above this step
+        double wetStep = floor((options.wetThreshold - lower) / resolution + 1e-6);
+        for (uint32_t step = 0; step < lastStep; step++) {
+            uint32_t n = all.fine[step];
+            if (n == 0) continue;
+            double value = lower + step * resolution;
+            valid += n;
+            sum += n * value;
+            if (step > wetStep) {
+                wet += n;
+                wetSum += n * value;
+            }
+            minStep = std::min(minStep, step);
+            maxStep = step;
+        }
+        if (all.overflowCount > 0 && all.overflowMax > options.wetThreshold) {
+            wet += all.overflowCount;
+            wetSum += all.overflowSum;
+        }
+
+        RDScanStatistics s;
+        s.validCount = (size_t) valid;
+        s.missingCount = all.fine[RD_MISSING_SLOT];
+        s.clutterCount = all.fine[RD_CLUTTER_SLOT];
+        s.cellCount = s.validCount + s.missingCount + s.clutterCount;
+        s.wetCount = (size_t) wet;
+        s.rainAreaFraction = valid > 0 ? (double) wet / valid : 0.0;
+        s.meanIntensity = wet > 0 ? wetSum / wet : 0.0;
+
+        if (valid > 0) {
+            s.min = lower + minStep * resolution;
+            s.max = all.overflowCount > 0 ? all.overflowMax : lower + maxStep * resolution;
+            s.mean = sum / valid;
+        } else {
+            s.min = s.max = s.mean = NAN;
+        }
+
+        s.belowHistogram = (size_t) all.histogram[0];
+        s.aboveHistogram = (size_t) all.histogram[p.bins + 1];
+        s.histogram.assign(all.histogram.begin() + 1, all.histogram.begin() + 1 + p.bins);
+
+        for (size_t q = 0; q < options.quantileLevels.size(); q++) {
+            if (valid == 0) {
+                s.quantiles.push_back(NAN);
+                continue;
+            }
+            uint64_t rank = (uint64_t) ceil(options.quantileLevels[q] * valid);
+            rank = std::max(rank, (uint64_t) 1);
+            uint64_t cumulative = 0;
+            uint32_t step = 0;
+            for (; step < lastStep; step++) {
+                cumulative += all.fine[step];
+                if (cumulative >= rank) break;
+            }
+            s.quantiles.push_back(step == lastStep ? s.max : lower + step * resolution);
+        }
+
+        return s;
+    }
+}
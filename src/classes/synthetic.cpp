@@ -0,0 +1,415 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <stdlib.h>
+#include <string.h>
+
+#include <radolan/synthetic.h>
+#include <radolan/coordinate_system.h>
+#include <radolan/precipitation.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+#include <radolan/write.h>
+
+namespace Radolan {
+
+    typedef struct {
+        const char *name;
+        double latitude;
+        double longitude;
+    } RDRadarSite;
+
+    // radars of the DWD's composite
+    static const RDRadarSite RD_RADAR_SITES[] = {
+            {"asb", 53.564, 6.748},
+            {"boo", 54.004, 10.047},
+            {"drs", 51.125, 13.769},
+            {"eis", 49.541, 12.403},
+            {"ess", 51.406, 6.967},
+            {"fbg", 47.874, 8.004},
+            {"fld", 51.311, 8.802},
+            {"hnr", 52.460, 9.695},
+            {"isn", 48.175, 12.102},
+            {"mem", 48.042, 10.219},
+            {"neu", 50.500, 11.135},
+            {"nhb", 50.110, 6.548},
+            {"oft", 49.985, 8.713},
+            {"pro", 52.649, 13.858},
+            {"ros", 54.176, 12.058},
+            {"tur", 48.586, 9.783},
+            {"umd", 52.160, 11.176}
+    };
+
+    static const int RD_RADAR_COUNT = sizeof(RD_RADAR_SITES) / sizeof(RD_RADAR_SITES[0]);
+
+    // reach of the radars in km
+    static const double RD_RADAR_RANGE = 150.0;
+
+    /** Interval in minutes and precision of the products the generator supports */
+    static bool RDSyntheticProduct(RDScanType type, int &interval, float &precision) {
+        switch (type) {
+            case RD_RX:
+            case RD_EX:
+                interval = 5;
+                precision = 1.0f;
+                return true;
+            case RD_RZ:
+            case RD_RY:
+            case RD_RV:
+                interval = 5;
+                precision = 0.01f;
+                return true;
+            case RD_RH:
+            case RD_RB:
+            case RD_RW:
+            case RD_RL:
+            case RD_RU:
+            case RD_RS:
+            case RD_RQ:
+                interval = 60;
+                precision = 0.1f;
+                return true;
+            case RD_SQ:
+                interval = 360;
+                precision = 0.1f;
+                return true;
+            case RD_SH:
+                interval = 720;
+                precision = 0.1f;
+                return true;
+            case RD_SF:
+                interval = 1440;
+                precision = 0.1f;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /** Quantile of the standard normal distribution */
+    static double RDNormalQuantile(double p) {
+        double low = -10.0, high = 10.0;
+        for (int i = 0; i < 100; i++) {
+            double mid = 0.5 * (low + high);
+            if (0.5 * erfc(-mid / sqrt(2.0)) < p) low = mid; else high = mid;
+        }
+        return 0.5 * (low + high);
+    }
+
+    /** Moving average over 2 * radius + 1 cells of each row, wrapping around at the edges */
+    static void RDBoxBlurRows(const float *source, float *target, int width, int height, int radius) {
+        const float norm = 1.0f / (2 * radius + 1);
+        for (int y = 0; y < height; y++) {
+            const float *row = source + (size_t) y * width;
+            float *out = target + (size_t) y * width;
+            double sum = 0;
+            for (int i = -radius; i <= radius; i++) {
+                sum += row[(i + width) % width];
+            }
+            for (int x = 0; x < width; x++) {
+                out[x] = (float) sum * norm;
+                sum += row[(x + radius + 1) % width] - row[(x - radius + width) % width];
+            }
+        }
+    }
+
+    /** Moving average over 2 * radius + 1 cells of each column, wrapping around at the edges */
+    static void RDBoxBlurColumns(const float *source, float *target, int width, int height, int radius) {
+        const float norm = 1.0f / (2 * radius + 1);
+        // whole rows at a time, so the memory is read in order
+        std::vector<double> sum(width, 0.0);
+        for (int i = -radius; i <= radius; i++) {
+            const float *row = source + (size_t) ((i + height) % height) * width;
+            for (int x = 0; x < width; x++) sum[x] += row[x];
+        }
+        for (int y = 0; y < height; y++) {
+            float *out = target + (size_t) y * width;
+            const float *entering = source + (size_t) ((y + radius + 1) % height) * width;
+            const float *leaving = source + (size_t) ((y - radius + height) % height) * width;
+            for (int x = 0; x < width; x++) {
+                out[x] = (float) sum[x] * norm;
+                sum[x] += entering[x] - leaving[x];
+            }
+        }
+    }
+
+    RDSyntheticGenerator::RDSyntheticGenerator(const RDSyntheticOptions &options)
+            : m_options(options),
+              m_intervalMinutes(0),
+              m_precision(1.0f),
+              m_random(options.seed),
+              m_carryX(0),
+              m_carryY(0),
+              m_working(0),
+              m_started(false),
+              m_lastTime(0) {
+        if (!RDSyntheticProduct(options.scanType, m_intervalMinutes, m_precision)) {
+            std::string message = std::string("Can not generate product ") + RDScanTypeToString(options.scanType);
+            throw RDConversionException(message.c_str());
+        }
+        if (options.intervalMinutes > 0) {
+            m_intervalMinutes = options.intervalMinutes;
+        }
+        if (options.wetFraction <= 0 || options.wetFraction >= 1) {
+            throw RDConversionException("Wet fraction must be between 0 and 1");
+        }
+        if (options.persistence < 0 || options.persistence > 1) {
+            throw RDConversionException("Persistence must be between 0 and 1");
+        }
+
+        RDScanDimensions(options.scanType, &m_dimLon, &m_dimLat);
+        m_margin = (int) ceil(3.0 * std::max(1.0, options.correlationLength));
+        m_width = m_dimLon + 2 * m_margin;
+        m_height = m_dimLat + 2 * m_margin;
+        m_threshold = RDNormalQuantile(1.0 - options.wetFraction);
+
+        // radars within reach of each cell
+        RDCoordinateSystem rcs(options.scanType);
+        std::vector<double> x(m_dimLon), y(m_dimLat);
+        for (int ix = 0; ix < m_dimLon; ix++) x[ix] = rcs.cartesianCentreCoordinate(rdGridPoint(ix, 0)).x;
+        for (int iy = 0; iy < m_dimLat; iy++) y[iy] = rcs.cartesianCentreCoordinate(rdGridPoint(0, iy)).y;
+        m_coverage.assign((size_t) m_dimLon * m_dimLat, 0);
+        for (int r = 0; r < RD_RADAR_COUNT; r++) {
+            RDCartesianPoint site = rcs.cartesianCoordinate(
+                    rdGeographicalPoint(RD_RADAR_SITES[r].longitude, RD_RADAR_SITES[r].latitude));
+            for (int iy = 0; iy < m_dimLat; iy++) {
+                double dy = y[iy] - site.y;
+                if (fabs(dy) > RD_RADAR_RANGE) continue;
+                for (int ix = 0; ix < m_dimLon; ix++) {
+                    double dx = x[ix] - site.x;
+                    if (dx * dx + dy * dy <= RD_RADAR_RANGE * RD_RADAR_RANGE) {
+                        m_coverage[(size_t) iy * m_dimLon + ix] |= 1u << r;
+                    }
+                }
+            }
+        }
+
+        // permanent clutter within the composite
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        m_clutter.assign(m_coverage.size(), false);
+        for (size_t i = 0; i < m_coverage.size(); i++) {
+            if (m_coverage[i] != 0 && uniform(m_random) < options.clutterFraction) {
+                m_clutter[i] = true;
+            }
+        }
+        m_working = (1u << RD_RADAR_COUNT) - 1;
+    }
+
+    void RDSyntheticGenerator::smoothNoise() {
+        size_t cells = (size_t) m_width * m_height;
+        m_noise.resize(cells);
+        m_buffer.resize(cells);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        for (size_t i = 0; i < cells; i++) {
+            m_noise[i] = normal(m_random);
+        }
+
+        // three box filters come close to a gaussian with
+        // standard deviation sqrt(3 * ((2r+1)^2 - 1) / 12)
+        double sigma = std::max(1.0, m_options.correlationLength);
+        int radius = std::max(1, (int) lround((sqrt(4.0 * sigma * sigma + 1.0) - 1.0) / 2.0));
+        radius = std::min(radius, (std::min(m_width, m_height) - 1) / 2);
+        for (int pass = 0; pass < 3; pass++) {
+            RDBoxBlurRows(&m_noise[0], &m_buffer[0], m_width, m_height, radius);
+            RDBoxBlurColumns(&m_buffer[0], &m_noise[0], m_width, m_height, radius);
+        }
+
+        double sum = 0, squares = 0;
+        for (size_t i = 0; i < cells; i++) {
+            sum += m_noise[i];
+            squares += (double) m_noise[i] * m_noise[i];
+        }
+        double mean = sum / cells;
+        double deviation = sqrt(std::max(squares / cells - mean * mean, 1e-12));
+        for (size_t i = 0; i < cells; i++) {
+            m_noise[i] = (float) ((m_noise[i] - mean) / deviation);
+        }
+    }
+
+    void RDSyntheticGenerator::start() {
+        smoothNoise();
+        m_field.swap(m_noise);
+        m_started = true;
+    }
+
+    void RDSyntheticGenerator::step(double seconds) {
+        // move by whole cells, keep the rest for later
+        m_carryX += m_options.motionX * seconds / 3600.0;
+        m_carryY += m_options.motionY * seconds / 3600.0;
+        int shiftX = (int) floor(m_carryX);
+        int shiftY = (int) floor(m_carryY);
+        m_carryX -= shiftX;
+        m_carryY -= shiftY;
+        shiftX = ((shiftX % m_width) + m_width) % m_width;
+        shiftY = ((shiftY % m_height) + m_height) % m_height;
+
+        double a = pow(m_options.persistence, seconds / 300.0);
+        float keep = (float) a;
+        float renew = (float) sqrt(std::max(0.0, 1.0 - a * a));
+
+        smoothNoise();
+        for (int y = 0; y < m_height; y++) {
+            const float *from = &m_field[(size_t) ((y - shiftY + m_height) % m_height) * m_width];
+            float *noise = &m_noise[(size_t) y * m_width];
+            for (int x = 0; x < m_width; x++) {
+                int fromX = x - shiftX;
+                if (fromX < 0) fromX += m_width;
+                noise[x] = keep * from[fromX] + renew * noise[x];
+            }
+        }
+        m_field.swap(m_noise);
+    }
+
+    void RDSyntheticGenerator::updateRadars(double seconds) {
+        double scans = seconds / (60.0 * m_intervalMinutes);
+        double repair = std::min(1.0, m_intervalMinutes / std::max(1.0, m_options.outageMinutes));
+        double failing = 1.0 - pow(1.0 - std::min(1.0, m_options.outageProbability), scans);
+        double repairing = 1.0 - pow(1.0 - repair, scans);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        for (int r = 0; r < RD_RADAR_COUNT; r++) {
+            uint32_t bit = 1u << r;
+            double p = uniform(m_random);
+            if ((m_working & bit) && p < failing) {
+                m_working &= ~bit;
+            } else if (!(m_working & bit) && p < repairing) {
+                m_working |= bit;
+            }
+        }
+    }
+
+    RDScan *RDSyntheticGenerator::generate(time_t time) {
+        if (!m_started) {
+            start();
+        } else {
+            if (time <= m_lastTime) {
+                throw RDConversionException("Scans must be generated in chronological order");
+            }
+            double seconds = difftime(time, m_lastTime);
+            step(seconds);
+            updateRadars(seconds);
+        }
+        m_lastTime = time;
+
+        RDScanType type = m_options.scanType;
+        size_t cells = (size_t) m_dimLon * m_dimLat;
+        RDScan *scan = RDAllocateScan();
+        if (scan == NULL) {
+            throw RDConversionException("Could not allocate scan");
+        }
+        scan->data = (RDDataType *) malloc(cells * sizeof(RDDataType));
+        if (scan->data == NULL) {
+            RDFreeScan(scan);
+            throw RDConversionException("Could not allocate scan data");
+        }
+
+        RDRadolanHeader &header = scan->header;
+        memset(&header, 0, sizeof(header));
+        header.scanType = type;
+        RDSetScanTime(&header, time);
+        header.radarLocation = 10000;
+        header.radarFormat = R128km;
+        strcpy(header.softwareVersion, "   synth");
+        header.precision = m_precision;
+        header.intervalDuration = (unsigned short) m_intervalMinutes;
+        snprintf(header.resolution, sizeof(header.resolution), "%4dx%4d", m_dimLat, m_dimLon);
+        header.payloadSize = cells * RDBytesPerPixel(type);
+
+        // list of the working radars as in the DWD's files
+        std::string stations = "<";
+        for (int r = 0; r < RD_RADAR_COUNT; r++) {
+            if (m_working & (1u << r)) {
+                if (header.numberOfRadarStations++ > 0) stations += ",";
+                stations += RD_RADAR_SITES[r].name;
+            }
+        }
+        stations += ">";
+        header.radarStations = strdup(stations.c_str());
+
+        scan->filename[0] = '\0';
+        scan->dimLon = m_dimLon;
+        scan->dimLat = m_dimLat;
+        scan->dbZPerUnit = 0;
+
+        bool reflectivity = RDBytesPerPixel(type) == 1;
+        RDZRRelation zr = rdZRRelation();
+        double hours = m_intervalMinutes / 60.0;
+        const float missing = RDMissingValue(type);
+        const float clutter = RDClutterValue(type);
+        const float minimum = RDMinValue(type);
+        const float maximum = reflectivity ? RDClutterValue(type) - 0.5f : 4095 * m_precision;
+
+        scan->min_value = RDMaxValue(type);
+        scan->max_value = minimum;
+        for (int iy = 0; iy < m_dimLat; iy++) {
+            const float *row = &m_field[(size_t) (iy + m_margin) * m_width + m_margin];
+            for (int ix = 0; ix < m_dimLon; ix++) {
+                size_t i = (size_t) iy * m_dimLon + ix;
+                if ((m_coverage[i] & m_working) == 0) {
+                    scan->data[i] = missing;
+                    continue;
+                }
+                if (m_clutter[i]) {
+                    scan->data[i] = clutter;
+                    continue;
+                }
+                double excess = row[ix] - m_threshold;
+                double rate = excess > 0 ? m_options.rainRateScale * expm1(excess) : 0.0;
+                float value;
+                if (reflectivity) {
+                    // Z = a R^b, in steps of 0.5 dBZ
+                    value = rate > 0 ? (float) (round(20.0 * log10(zr.a * pow(rate, zr.b))) / 2.0) : minimum;
+                } else {
+                    value = (float) (round(rate * hours / m_precision) * m_precision);
+                }
+                value = std::max(minimum, std::min(value, maximum));
+                scan->data[i] = value;
+                scan->min_value = std::min(scan->min_value, value);
+                scan->max_value = std::max(scan->max_value, value);
+            }
+        }
+        return scan;
+    }
+
+    std::vector<std::string> RDSyntheticGenerator::writeFiles(const char *directory, time_t begin, time_t end,
+                                                              bool compress) {
+        std::vector<std::string> paths;
+        time_t interval = (time_t) m_intervalMinutes * 60;
+        time_t first = (begin + interval - 1) / interval * interval;
+        for (time_t time = first; time <= end; time += interval) {
+            RDScan *scan = generate(time);
+            char *filename = RDGuessFilename(m_options.scanType, time);
+            std::string path = std::string(directory) + "/" + filename;
+            free(filename);
+            bool written = RDWriteScan(path.c_str(), scan, compress);
+            RDFreeScan(scan);
+            if (!written) {
+                std::string message = "Could not write " + path;
+                throw RDConversionException(message.c_str());
+            }
+            paths.push_back(path);
+        }
+        return paths;
+    }
+}
@@ -0,0 +1,273 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<charconv>) && __cplusplus >= 201703L
+#include <charconv>
+#endif
+#endif
+
+#include <radolan/text_converter.h>
+#include <radolan/grid_geometry.h>
+#include <radolan/radolan_utils.h>
+
+namespace Radolan {
+
+    // output is flushed in chunks of this size
+    static const size_t TEXT_BUFFER_SIZE = 1 << 20;
+
+    static const uint64_t POWERS_OF_TEN[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+    /**
+     * Output buffer on a file descriptor. Numbers are formatted in place
+     * and the buffer is handed to write() whenever a megabyte is filled.
+     */
+    class RDTextBuffer {
+    public:
+        RDTextBuffer(int fd) : m_fd(fd), m_buffer(TEXT_BUFFER_SIZE + 256), m_used(0) {}
+
+        void append(char c) {
+            m_buffer[m_used++] = c;
+        }
+
+        void append(const char *s) {
+            size_t length = strlen(s);
+            memcpy(&m_buffer[m_used], s, length);
+            m_used += length;
+        }
+
+        void appendInt(long value) {
+            char digits[24];
+            int n = snprintf(digits, sizeof(digits), "%ld", value);
+            memcpy(&m_buffer[m_used], digits, n);
+            m_used += n;
+        }
+
+        /** Appends value with the given number of decimals (at most 6) */
+        void appendFixed(double value, int decimals) {
+            char *out = &m_buffer[m_used];
+#if defined(__cpp_lib_to_chars)
+            std::to_chars_result result = std::to_chars(out, out + 64, value, std::chars_format::fixed, decimals);
+            if (result.ec != std::errc()) {
+                throw RDConversionException("Could not format value");
+            }
+            m_used += result.ptr - out;
+#else
+            double scaled = fabs(value) * POWERS_OF_TEN[decimals] + 0.5;
+            if (!(scaled < 9.0e18)) {
+                // nan, inf or too large for the integer path
+                int n = snprintf(out, 64, "%.*f", decimals, value);
+                if (n < 0 || n >= 64) {
+                    throw RDConversionException("Could not format value");
+                }
+                m_used += n;
+                return;
+            }
+            uint64_t n = (uint64_t) scaled;
+            char *p = out;
+            if (value < 0 && n != 0) *p++ = '-';
+
+            // digits are produced backwards
+            char digits[24];
+            int count = 0;
+            for (int i = 0; i < decimals; i++) {
+                digits[count++] = (char) ('0' + n % 10);
+                n /= 10;
+            }
+            do {
+                digits[count++] = (char) ('0' + n % 10);
+                n /= 10;
+            } while (n > 0);
+            while (count > decimals) *p++ = digits[--count];
+            if (decimals > 0) {
+                *p++ = '.';
+                while (count > 0) *p++ = digits[--count];
+            }
+            m_used += p - out;
+#endif
+        }
+
+        /** Flushes the buffer if it is full. Call at least every 200 characters. */
+        void lineDone() {
+            if (m_used >= TEXT_BUFFER_SIZE) flush();
+        }
+
+        void flush() {
+            size_t written = 0;
+            while (written < m_used) {
+                ssize_t n = write(m_fd, &m_buffer[written], m_used - written);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throw RDConversionException("Could not write to output file");
+                }
+                written += n;
+            }
+            m_used = 0;
+        }
+
+    private:
+        int m_fd;
+        std::vector<char> m_buffer;
+        size_t m_used;
+    };
+
+    // number of decimals needed to represent the values of a product
+    static int valueDecimals(RDScan *scan) {
+        if (scan->header.scanType == RD_RX || scan->header.scanType == RD_EX) return 1;
+        if (scan->header.precision <= 0) return 2;
+        int decimals = (int) ceil(-log10(scan->header.precision) - 1e-6);
+        return decimals < 0 ? 0 : (decimals > 6 ? 6 : decimals);
+    }
+
+    static bool skipCell(RDScan *scan, RDDataType value, const RDTextOptions &options) {
+        if (options.skipMissing && !RDIsCleanMeasurement(scan->header.scanType, value)) return true;
+        if (options.skipZero && value == RDMinValue(scan->header.scanType)) return true;
+        return false;
+    }
+
+    // Writes the cells as lines "[ix,iy,]x,y,value"
+    static void writeLines(RDScan *scan, int fd, const RDTextOptions &options, char separator, bool withIndexes) {
+        const RDGridGeometry *grid = RDGridGeometry::forScan(scan);
+        const double *cx = grid->centreX();
+        const double *cy = grid->centreY();
+        const double *lon = options.geographic ? grid->centreLongitudes() : NULL;
+        const double *lat = options.geographic ? grid->centreLatitudes() : NULL;
+        int coordinateDecimals = options.geographic ? 6 : 3;
+        int decimals = valueDecimals(scan);
+
+        RDTextBuffer out(fd);
+        if (withIndexes) {
+            out.append(options.geographic ? "ix,iy,lon,lat,value\n" : "ix,iy,x,y,value\n");
+        }
+        for (int iy = 0; iy < scan->dimLat; iy++) {
+            for (int ix = 0; ix < scan->dimLon; ix++) {
+                size_t i = (size_t) iy * scan->dimLon + ix;
+                RDDataType value = scan->data[i];
+                if (skipCell(scan, value, options)) continue;
+
+                double x = options.geographic ? lon[i] : cx[ix];
+                double y = options.geographic ? lat[i] : cy[iy];
+                if (options.yFirst) std::swap(x, y);
+
+                if (withIndexes) {
+                    out.appendInt(ix);
+                    out.append(separator);
+                    out.appendInt(iy);
+                    out.append(separator);
+                }
+                out.appendFixed(x, coordinateDecimals);
+                out.append(separator);
+                out.appendFixed(y, coordinateDecimals);
+                out.append(separator);
+                out.appendFixed(value, decimals);
+                out.append('\n');
+                out.lineDone();
+            }
+        }
+        out.flush();
+    }
+
+    // opens a file for writing, runs the exporter and closes it again
+    template<typename Writer>
+    static void writeFile(const char *filename, Writer writer) {
+        int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw RDConversionException("Could not open output file");
+        }
+        try {
+            writer(fd);
+        } catch (const RDConversionException &) {
+            close(fd);
+            throw;
+        }
+        if (close(fd) != 0) {
+            throw RDConversionException("Could not close output file");
+        }
+    }
+
+    void Radolan2Text::writeXYZ(RDScan *scan, int fd, const RDTextOptions &options) {
+        writeLines(scan, fd, options, options.separator, false);
+    }
+
+    void Radolan2Text::convertToXYZ(RDScan *scan, const char *filename, const RDTextOptions &options) {
+        writeFile(filename, [&](int fd) { writeXYZ(scan, fd, options); });
+    }
+
+    void Radolan2Text::writeCSV(RDScan *scan, int fd, const RDTextOptions &options) {
+        writeLines(scan, fd, options, ',', true);
+    }
+
+    void Radolan2Text::convertToCSV(RDScan *scan, const char *filename, const RDTextOptions &options) {
+        writeFile(filename, [&](int fd) { writeCSV(scan, fd, options); });
+    }
+
+    void Radolan2Text::writeASCIIGrid(RDScan *scan, int fd) {
+        const RDGridGeometry *grid = RDGridGeometry::forScan(scan);
+        int decimals = valueDecimals(scan);
+
+        RDTextBuffer out(fd);
+        out.append("ncols ");
+        out.appendInt(scan->dimLon);
+        out.append("\nnrows ");
+        out.appendInt(scan->dimLat);
+        out.append("\nxllcorner ");
+        out.appendFixed(grid->cornerX()[0], 6);
+        out.append("\nyllcorner ");
+        out.appendFixed(grid->cornerY()[0], 6);
+        out.append("\ncellsize ");
+        out.appendFixed(grid->cornerX()[1] - grid->cornerX()[0], 6);
+        out.append("\nNODATA_value -9999\n");
+
+        // rows run from north to south
+        for (int iy = scan->dimLat - 1; iy >= 0; iy--) {
+            const RDDataType *row = scan->data + (size_t) iy * scan->dimLon;
+            for (int ix = 0; ix < scan->dimLon; ix++) {
+                if (ix > 0) out.append(' ');
+                if (RDIsCleanMeasurement(scan->header.scanType, row[ix])) {
+                    out.appendFixed(row[ix], decimals);
+                } else {
+                    out.append("-9999");
+                }
+                // a row is longer than the buffer's slack
+                out.lineDone();
+            }
+            out.append('\n');
+            out.lineDone();
+        }
+        out.flush();
+    }
+
+    void Radolan2Text::convertToASCIIGrid(RDScan *scan, const char *filename) {
+        writeFile(filename, [&](int fd) { writeASCIIGrid(scan, fd); });
+    }
+}
@@ -0,0 +1,460 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <mutex>
+#include <string.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+#include <radolan/transpose_store.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+#include <radolan/scan_cube.h>
+
+namespace Radolan {
+
+    /** Fixed part at the start of a store, followed by the timestamps */
+    typedef struct {
+        char magic[4];
+        uint32_t byteOrder;
+        uint32_t version;
+        int32_t scanType;
+        int32_t dimLon;
+        int32_t dimLat;
+        int32_t tileSize;
+        int32_t chunkLength;
+        float precision;
+        int32_t intervalDuration;
+        uint64_t count;
+    } RDTransposeFileHeader;
+
+    static const char RD_TRANSPOSE_MAGIC[4] = {'R', 'D', 'T', 'S'};
+    static const uint32_t RD_TRANSPOSE_BYTE_ORDER = 0x01020304;
+    static const uint32_t RD_TRANSPOSE_VERSION = 1;
+
+    // the data starts on a page
+    static const uint64_t RD_TRANSPOSE_ALIGNMENT = 4096;
+
+    // scans transposed at once by a thread: 64 bytes per cell
+    static const size_t RD_TRANSPOSE_GROUP = 32;
+
+    static uint64_t rdDataOffset(uint64_t count) {
+        uint64_t bytes = sizeof(RDTransposeFileHeader) + count * sizeof(int64_t);
+        return (bytes + RD_TRANSPOSE_ALIGNMENT - 1) / RD_TRANSPOSE_ALIGNMENT * RD_TRANSPOSE_ALIGNMENT;
+    }
+
+    /** @return position of a cell within a chunk: tile rows, tiles, cells of the tile */
+    static uint64_t rdCellIndex(int x, int y, int dimLon, int dimLat, int tileSize) {
+        int top = y / tileSize * tileSize;
+        int left = x / tileSize * tileSize;
+        int height = std::min(tileSize, dimLat - top);
+        int width = std::min(tileSize, dimLon - left);
+        return (uint64_t) top * dimLon + (uint64_t) left * height + (uint64_t) (y - top) * width + (x - left);
+    }
+
+    static time_t rdHeaderTime(const RDRadolanHeader &header) {
+        struct tm t;
+        memset(&t, 0, sizeof(t));
+        t.tm_min = header.minute;
+        t.tm_hour = header.hour;
+        t.tm_mday = header.day;
+        t.tm_mon = header.month - 1;
+        t.tm_year = header.year + 100;
+        return timegm(&t);
+    }
+
+    static void rdWriteFully(int file, const void *buffer, size_t bytes, uint64_t offset) {
+        const char *p = (const char *) buffer;
+        while (bytes > 0) {
+            ssize_t written = pwrite(file, p, bytes, (off_t) offset);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) {
+                throw RDConversionException("Could not write to store");
+            }
+            p += written;
+            bytes -= (size_t) written;
+            offset += (uint64_t) written;
+        }
+    }
+
+    static void rdReadFully(int file, void *buffer, size_t bytes, uint64_t offset) {
+        char *p = (char *) buffer;
+        while (bytes > 0) {
+            ssize_t read = pread(file, p, bytes, (off_t) offset);
+            if (read < 0 && errno == EINTR) continue;
+            if (read <= 0) {
+                throw RDConversionException("Could not read from store");
+            }
+            p += read;
+            bytes -= (size_t) read;
+            offset += (uint64_t) read;
+        }
+    }
+
+    /** Transposes one band of tile rows of one chunk */
+    class RDTransposeBand {
+    public:
+
+        RDTransposeBand(const std::vector<std::string> &paths, const RDTransposeFileHeader &header,
+                        size_t chunkLength, int y0, int y1, uint16_t *band)
+                : m_paths(paths), m_header(header), m_chunkLength(chunkLength), m_y0(y0), m_y1(y1),
+                  m_band(band), m_next(0), m_failed(false) {
+            // position of each cell of the band within the band
+            int dimLon = header.dimLon;
+            uint64_t base = rdCellIndex(0, y0, dimLon, header.dimLat, header.tileSize);
+            m_cells.reserve((size_t) (y1 - y0) * dimLon);
+            for (int y = y0; y < y1; y++) {
+                for (int x = 0; x < dimLon; x++) {
+                    m_cells.push_back((uint32_t) (rdCellIndex(x, y, dimLon, header.dimLat, header.tileSize) - base));
+                }
+            }
+        }
+
+        void run(unsigned int threads) {
+            size_t groups = (m_paths.size() + RD_TRANSPOSE_GROUP - 1) / RD_TRANSPOSE_GROUP;
+            threads = (unsigned int) std::min((size_t) threads, groups);
+            if (threads <= 1) {
+                work();
+            } else {
+                std::vector<std::thread> workers;
+                for (unsigned int i = 0; i < threads; i++) {
+                    workers.push_back(std::thread(&RDTransposeBand::work, this));
+                }
+                for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+            }
+            if (m_failed) {
+                throw RDConversionException(m_error.c_str());
+            }
+        }
+
+    private:
+
+        void work() {
+            size_t cells = m_cells.size();
+            std::vector<uint16_t> group(RD_TRANSPOSE_GROUP * cells);
+
+            for (size_t first = (m_next++) * RD_TRANSPOSE_GROUP; first < m_paths.size() && !m_failed;
+                 first = (m_next++) * RD_TRANSPOSE_GROUP) {
+                size_t count = std::min(RD_TRANSPOSE_GROUP, m_paths.size() - first);
+                for (size_t j = 0; j < count; j++) {
+                    if (!read(m_paths[first + j], &group[j * cells])) return;
+                }
+
+                // each cell receives count neighbouring values
+                for (size_t i = 0; i < cells; i++) {
+                    uint16_t *target = m_band + (size_t) m_cells[i] * m_chunkLength + first;
+                    for (size_t j = 0; j < count; j++) target[j] = group[j * cells + i];
+                }
+            }
+        }
+
+        // reads a scan and encodes the rows of the band
+        bool read(const std::string &path, uint16_t *target) {
+            RDScan *scan = RDAllocateScan();
+            if (scan == NULL) {
+                fail("Could not allocate scan");
+                return false;
+            }
+            scan->data = NULL;
+            if (!RDReadScan(path.c_str(), scan, false)) {
+                RDFreeScan(scan);
+                fail("Could not read radolan file " + path);
+                return false;
+            }
+            bool fits = scan->header.scanType == m_header.scanType
+                        && scan->dimLon == m_header.dimLon && scan->dimLat == m_header.dimLat;
+            try {
+                fits = fits && RDCompactPrecision(scan->header) == m_header.precision;
+            } catch (const RDConversionException &) {
+                fits = false;
+            }
+            if (fits) {
+                RDEncodeCompact(scan->header.scanType, m_header.precision,
+                                scan->data + (size_t) m_y0 * scan->dimLon,
+                                (size_t) (m_y1 - m_y0) * scan->dimLon, target);
+            } else {
+                fail("Scan does not fit the first one: " + path);
+            }
+            RDFreeScan(scan);
+            return fits;
+        }
+
+        void fail(const std::string &error) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_failed) {
+                m_error = error;
+                m_failed = true;
+            }
+        }
+
+        const std::vector<std::string> &m_paths;
+        const RDTransposeFileHeader &m_header;
+        size_t m_chunkLength;
+        int m_y0;
+        int m_y1;
+        uint16_t *m_band;
+        std::vector<uint32_t> m_cells;
+
+        std::atomic<size_t> m_next;
+        std::atomic<bool> m_failed;
+        std::mutex m_mutex;
+        std::string m_error;
+    };
+
+    void RDTransposeFiles(const std::vector<std::string> &radolanPaths,
+                          const char *storePath,
+                          const RDTransposeOptions &options) {
+        if (options.tileSize <= 0 || options.chunkLength <= 0 || options.memoryLimit == 0) {
+            throw RDConversionException("Tile size, chunk length and memory limit must be positive");
+        }
+        if (radolanPaths.empty()) {
+            throw RDConversionException("No radolan files to transpose");
+        }
+
+        // order by time, reading only the headers
+        std::vector<std::pair<time_t, size_t> > order;
+        RDRadolanHeader header;
+        memset(&header, 0, sizeof(header));
+        for (size_t i = 0; i < radolanPaths.size(); i++) {
+            RDRadolanHeader h;
+            if (!RDReadScanHeader(radolanPaths[i].c_str(), &h)) {
+                throw RDConversionException(("Could not read header of " + radolanPaths[i]).c_str());
+            }
+            free(h.radarStations);
+            if (i == 0) {
+                header = h;
+                header.radarStations = NULL;
+            } else if (h.scanType != header.scanType) {
+                throw RDConversionException(("File is of a different product: " + radolanPaths[i]).c_str());
+            }
+            order.push_back(std::make_pair(rdHeaderTime(h), i));
+        }
+        std::sort(order.begin(), order.end());
+        std::vector<std::string> paths(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            if (i > 0 && order[i].first == order[i - 1].first) {
+                throw RDConversionException(("Two files have the same time: " + radolanPaths[order[i].second]).c_str());
+            }
+            paths[i] = radolanPaths[order[i].second];
+        }
+
+        // the grid is only known after reading a scan
+        RDScan *scan = RDAllocateScan();
+        if (scan == NULL) {
+            throw RDConversionException("Could not allocate scan");
+        }
+        scan->data = NULL;
+        if (!RDReadScan(paths[0].c_str(), scan, false)) {
+            RDFreeScan(scan);
+            throw RDConversionException(("Could not read radolan file " + paths[0]).c_str());
+        }
+        RDTransposeFileHeader fileHeader;
+        memset(&fileHeader, 0, sizeof(fileHeader));
+        memcpy(fileHeader.magic, RD_TRANSPOSE_MAGIC, sizeof(fileHeader.magic));
+        fileHeader.byteOrder = RD_TRANSPOSE_BYTE_ORDER;
+        fileHeader.version = RD_TRANSPOSE_VERSION;
+        fileHeader.scanType = scan->header.scanType;
+        fileHeader.dimLon = scan->dimLon;
+        fileHeader.dimLat = scan->dimLat;
+        fileHeader.tileSize = options.tileSize;
+        fileHeader.chunkLength = options.chunkLength;
+        fileHeader.intervalDuration = scan->header.intervalDuration;
+        fileHeader.count = paths.size();
+        try {
+            fileHeader.precision = RDCompactPrecision(scan->header);
+        } catch (const RDConversionException &) {
+            RDFreeScan(scan);
+            throw;
+        }
+        RDFreeScan(scan);
+
+        std::vector<int64_t> times(order.size());
+        for (size_t i = 0; i < order.size(); i++) times[i] = (int64_t) order[i].first;
+
+        unsigned int threads = options.threads;
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        int file = open(storePath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (file < 0) {
+            throw RDConversionException("Could not create store");
+        }
+        try {
+            rdWriteFully(file, &fileHeader, sizeof(fileHeader), 0);
+            rdWriteFully(file, &times[0], times.size() * sizeof(int64_t), sizeof(fileHeader));
+
+            int dimLon = fileHeader.dimLon;
+            int dimLat = fileHeader.dimLat;
+            int tileSize = options.tileSize;
+            size_t cells = (size_t) dimLon * dimLat;
+            uint64_t dataOffset = rdDataOffset(fileHeader.count);
+            std::vector<uint16_t> band;
+
+            for (size_t begin = 0; begin < paths.size(); begin += options.chunkLength) {
+                size_t length = std::min((size_t) options.chunkLength, paths.size() - begin);
+                std::vector<std::string> chunk(paths.begin() + begin, paths.begin() + begin + length);
+                uint64_t chunkOffset = dataOffset + (uint64_t) begin * cells * sizeof(uint16_t);
+
+                // rows per pass: the band and the groups of the threads
+                size_t perRow = (length + threads * RD_TRANSPOSE_GROUP) * dimLon * sizeof(uint16_t);
+                size_t fitting = options.memoryLimit / perRow;
+                int rows = dimLat;
+                if (fitting < (size_t) dimLat) {
+                    rows = std::max(tileSize, (int) fitting / tileSize * tileSize);
+                }
+
+                for (int y0 = 0; y0 < dimLat; y0 += rows) {
+                    int y1 = std::min(dimLat, y0 + rows);
+                    size_t bandCells = (size_t) (y1 - y0) * dimLon;
+                    band.resize(bandCells * length);
+                    RDTransposeBand transpose(chunk, fileHeader, length, y0, y1, &band[0]);
+                    transpose.run(threads);
+
+                    uint64_t base = rdCellIndex(0, y0, dimLon, dimLat, tileSize);
+                    rdWriteFully(file, &band[0], band.size() * sizeof(uint16_t),
+                                 chunkOffset + base * length * sizeof(uint16_t));
+                }
+            }
+        } catch (const RDConversionException &) {
+            close(file);
+            throw;
+        }
+        if (close(file) != 0) {
+            throw RDConversionException("Could not write store");
+        }
+    }
+
+    RDTransposeStore::RDTransposeStore(const char *storePath) {
+        m_file = open(storePath, O_RDONLY);
+        if (m_file < 0) {
+            throw RDConversionException("Could not open store");
+        }
+        try {
+            RDTransposeFileHeader header;
+            rdReadFully(m_file, &header, sizeof(header), 0);
+            if (memcmp(header.magic, RD_TRANSPOSE_MAGIC, sizeof(header.magic)) != 0) {
+                throw RDConversionException("File is not a store");
+            }
+            if (header.byteOrder != RD_TRANSPOSE_BYTE_ORDER || header.version != RD_TRANSPOSE_VERSION) {
+                throw RDConversionException("Store was written with another byte order or version");
+            }
+            m_scanType = (RDScanType) header.scanType;
+            m_dimLon = header.dimLon;
+            m_dimLat = header.dimLat;
+            m_tileSize = header.tileSize;
+            m_chunkLength = header.chunkLength;
+            m_precision = header.precision;
+            m_intervalDuration = header.intervalDuration;
+            m_dataOffset = rdDataOffset(header.count);
+
+            struct stat st;
+            uint64_t expected = m_dataOffset + header.count * m_dimLon * m_dimLat * sizeof(uint16_t);
+            if (fstat(m_file, &st) != 0 || (uint64_t) st.st_size < expected) {
+                throw RDConversionException("Store is truncated");
+            }
+
+            std::vector<int64_t> times(header.count);
+            if (header.count > 0) {
+                rdReadFully(m_file, &times[0], times.size() * sizeof(int64_t), sizeof(header));
+            }
+            m_times.assign(times.begin(), times.end());
+        } catch (const RDConversionException &) {
+            close(m_file);
+            throw;
+        }
+    }
+
+    RDTransposeStore::~RDTransposeStore() {
+        close(m_file);
+    }
+
+    void RDTransposeStore::range(time_t begin, time_t end, size_t &first, size_t &last) const {
+        first = (size_t) (std::lower_bound(m_times.begin(), m_times.end(), begin) - m_times.begin());
+        last = (size_t) (std::lower_bound(m_times.begin() + first, m_times.end(), end) - m_times.begin());
+    }
+
+    void RDTransposeStore::readRun(int x, int y, int count, size_t t0, size_t t1, uint16_t *target) const {
+        size_t cells = (size_t) m_dimLon * m_dimLat;
+        uint64_t cell = rdCellIndex(x, y, m_dimLon, m_dimLat, m_tileSize);
+        size_t length = t1 - t0;
+        std::vector<uint16_t> buffer;
+
+        for (size_t begin = t0 / m_chunkLength * m_chunkLength; begin < t1; begin += m_chunkLength) {
+            size_t chunkLength = std::min((size_t) m_chunkLength, m_times.size() - begin);
+            uint64_t offset = m_dataOffset + (uint64_t) begin * cells * sizeof(uint16_t)
+                              + cell * chunkLength * sizeof(uint16_t);
+            size_t k0 = std::max(t0, begin) - begin;
+            size_t k1 = std::min(t1, begin + chunkLength) - begin;
+            uint16_t *out = target + (begin + k0 - t0);
+
+            if (count > 1 && k0 == 0 && k1 == chunkLength) {
+                // the whole run in one read
+                buffer.resize((size_t) count * chunkLength);
+                rdReadFully(m_file, &buffer[0], buffer.size() * sizeof(uint16_t), offset);
+                for (int i = 0; i < count; i++) {
+                    memcpy(out + i * length, &buffer[i * chunkLength], chunkLength * sizeof(uint16_t));
+                }
+            } else {
+                for (int i = 0; i < count; i++) {
+                    rdReadFully(m_file, out + i * length, (k1 - k0) * sizeof(uint16_t),
+                                offset + ((uint64_t) i * chunkLength + k0) * sizeof(uint16_t));
+                }
+            }
+        }
+    }
+
+    void RDTransposeStore::series(int x, int y, size_t t0, size_t t1, std::vector<RDDataType> &values) const {
+        area(x, x + 1, y, y + 1, t0, t1, values);
+    }
+
+    void RDTransposeStore::area(int x0, int x1, int y0, int y1, size_t t0, size_t t1,
+                                std::vector<RDDataType> &values) const {
+        if (x0 < 0 || x0 >= x1 || x1 > m_dimLon || y0 < 0 || y0 >= y1 || y1 > m_dimLat
+            || t0 > t1 || t1 > m_times.size()) {
+            throw RDConversionException("Block is not within the store");
+        }
+        size_t length = t1 - t0;
+        size_t width = (size_t) (x1 - x0);
+        std::vector<uint16_t> raw(width * (y1 - y0) * length);
+        if (length > 0) {
+            for (int y = y0; y < y1; y++) {
+                // runs end at tile borders
+                for (int x = x0; x < x1;) {
+                    int end = std::min(x1, (x / m_tileSize + 1) * m_tileSize);
+                    readRun(x, y, end - x, t0, t1, &raw[((y - y0) * width + (x - x0)) * length]);
+                    x = end;
+                }
+            }
+        }
+        values.resize(raw.size());
+        if (!raw.empty()) {
+            RDDecodeCompact(m_scanType, m_precision, &raw[0], raw.size(), &values[0]);
+        }
+    }
+}
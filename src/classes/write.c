@@ -0,0 +1,168 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <radolan/write.h>
+#include <radolan/read.h>
+#include <radolan/radolan_utils.h>
+
+#ifdef __cplusplus
+namespace Radolan
+{
+#endif
+
+// end of the header
+#define RD_ETX 0x03
+
+/** Tag PR for the given precision, or NULL if the reader would not understand it */
+static const char *RDPrecisionTag(float precision) {
+    if (fabsf(precision - 1.0f) < 1e-6f) return " E+00";
+    if (fabsf(precision - 0.1f) < 1e-6f) return " E-01";
+    if (fabsf(precision - 0.01f) < 1e-7f) return " E-02";
+    return NULL;
+}
+
+static unsigned char RDEncodeRVP6(RDScanType type, RDDataType value) {
+    if (value == RDMissingValue(type) || isnan(value)) return RX_ERROR_VALUE;
+    if (value == RDClutterValue(type)) return RX_CLUTTER_VALUE;
+    long code = lroundf((value - RDMinValue(type)) * 2.0f);
+    if (code < 0) code = 0;
+    if (code >= RX_CLUTTER_VALUE) code = RX_CLUTTER_VALUE - 1;
+    return (unsigned char) code;
+}
+
+static unsigned short int RDEncodeWord(RDScanType type, float precision, RDDataType value) {
+    if (value == RDMissingValue(type) || isnan(value)) {
+        // as in the DWD's files, the payload of missing values is 2500
+        return (RD_ERROR_BIT << 12) | 2500;
+    }
+    if (value == RDClutterValue(type)) {
+        return RD_CLUTTER_BIT << 12;
+    }
+    unsigned short int flags = 0;
+    if (value < 0) {
+        flags = RD_NEGATIVE_SIGN_BIT << 12;
+        value = -value;
+    }
+    long raw = lroundf(value / precision);
+    if (raw > 4095) raw = 4095;
+    return flags | (unsigned short int) raw;
+}
+
+int RDWriteScan(const char *filename, RDScan *scan, bool compress) {
+    RDRadolanHeader *h = &scan->header;
+    RDScanType type = h->scanType;
+
+    int dimLon, dimLat;
+    RDScanDimensions(type, &dimLon, &dimLat);
+    if (type == RD_UNKNOWN || scan->dimLon != dimLon || scan->dimLat != dimLat) {
+        fprintf(stderr, "RDWriteScan : ERROR : %s needs a grid of %dx%d\n", RDScanTypeToString(type), dimLon, dimLat);
+        return 0;
+    }
+
+    const char *precisionTag = RDPrecisionTag(h->precision);
+    if (precisionTag == NULL) {
+        fprintf(stderr, "RDWriteScan : ERROR : precision %g can not be written\n", h->precision);
+        return 0;
+    }
+
+    // the tags following BY
+    char tags[1024];
+    int length = 0;
+    if (h->radarFormat == R100km || h->radarFormat == R128km) {
+        length += snprintf(tags + length, sizeof(tags) - length, "VS%2d", (int) h->radarFormat);
+    }
+    if (h->softwareVersion[0] != '\0') {
+        length += snprintf(tags + length, sizeof(tags) - length, "SW%-9.8s", h->softwareVersion);
+    }
+    length += snprintf(tags + length, sizeof(tags) - length, "PR%sINT%4u", precisionTag,
+                       (unsigned int) h->intervalDuration);
+    length += snprintf(tags + length, sizeof(tags) - length, "GP%4dx%4d", dimLat, dimLon);
+    if (h->predictionMinutes > 0) {
+        length += snprintf(tags + length, sizeof(tags) - length, "VV%3u", h->predictionMinutes % 1000);
+    }
+    if (h->radarStations != NULL && h->radarStations[0] != '\0') {
+        length += snprintf(tags + length, sizeof(tags) - length, "MS%3d%.900s",
+                           (int) strlen(h->radarStations) > 900 ? 900 : (int) strlen(h->radarStations),
+                           h->radarStations);
+    }
+    if (length >= (int) sizeof(tags)) {
+        fprintf(stderr, "RDWriteScan : ERROR : header too long\n");
+        return 0;
+    }
+
+    size_t cells = (size_t) dimLon * dimLat;
+    size_t payloadSize = cells * RDBytesPerPixel(type);
+
+    // product, time and location, then BY with the size of header and payload
+    char header[1100];
+    int headerLength = snprintf(header, sizeof(header), "%.2s%02u%02u%02u%05u%02u%02u",
+                                RDScanTypeToString(type), h->day % 100, h->hour % 100, h->minute % 100,
+                                h->radarLocation % 100000, h->month % 100, h->year % 100);
+    size_t total = headerLength + 9 + length + 1 + payloadSize;
+    headerLength += snprintf(header + headerLength, sizeof(header) - headerLength, "BY%7lu%s",
+                             (unsigned long) (total % 10000000), tags);
+    header[headerLength++] = RD_ETX;
+
+    unsigned char *payload = (unsigned char *) malloc(payloadSize);
+    if (payload == NULL) {
+        fprintf(stderr, "RDWriteScan : ERROR : out of memory\n");
+        return 0;
+    }
+    size_t i;
+    if (RDBytesPerPixel(type) == 1) {
+        for (i = 0; i < cells; i++) {
+            payload[i] = RDEncodeRVP6(type, scan->data[i]);
+        }
+    } else {
+        for (i = 0; i < cells; i++) {
+            unsigned short int word = RDEncodeWord(type, h->precision, scan->data[i]);
+            payload[2 * i] = (unsigned char) (word & 0xff);
+            payload[2 * i + 1] = (unsigned char) (word >> 8);
+        }
+    }
+
+    // "T" writes the file as it is, without gzip wrapper
+    gzFile f = gzopen(filename, compress ? "wb" : "wbT");
+    if (f == NULL) {
+        fprintf(stderr, "RDWriteScan : ERROR : could not open file %s\n", filename);
+        free(payload);
+        return 0;
+    }
+    int ok = gzwrite(f, header, (unsigned int) headerLength) == headerLength
+             && gzwrite(f, payload, (unsigned int) payloadSize) == (int) payloadSize;
+    free(payload);
+    if (gzclose(f) != Z_OK || !ok) {
+        fprintf(stderr, "RDWriteScan : ERROR : could not write file %s\n", filename);
+        return 0;
+    }
+    return 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,606 @@
+/* The MIT License (MIT)
+ *
+ * (c) Jürgen Simon 2014 (juergen.simon@uni-bonn.de)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <radolan/zarr_converter.h>
+#include <radolan/coordinate_system.h>
+#include <radolan/grid_geometry.h>
+#include <radolan/radolan_utils.h>
+#include <radolan/read.h>
+
+namespace Radolan {
+
+    /** Grid and chunking of a store, as found in the metadata */
+    typedef struct {
+        RDScanType scanType;
+        int dimLon;
+        int dimLat;
+        int chunkLon;
+        int chunkLat;
+        /// first time index reserved by the caller
+        size_t first;
+    } RDZarrLayout;
+
+    static std::string joinPath(const std::string &directory, const std::string &name) {
+        return directory + "/" + name;
+    }
+
+    static std::string systemError(const std::string &what, const std::string &path) {
+        return what + " " + path + ": " + strerror(errno);
+    }
+
+    /** Writes a file under a temporary name and renames it, so readers never see it half written */
+    static void writeFile(const std::string &directory, const std::string &name, const void *data, size_t size) {
+        std::string path = joinPath(directory, name);
+        std::string temporary = joinPath(directory, ".tmp." + name + ".XXXXXX");
+        std::vector<char> pattern(temporary.begin(), temporary.end());
+        pattern.push_back('\0');
+
+        int fd = mkstemp(&pattern[0]);
+        if (fd < 0) {
+            throw RDConversionException(systemError("Could not create", path).c_str());
+        }
+        const char *bytes = (const char *) data;
+        size_t written = 0;
+        while (written < size) {
+            ssize_t n = write(fd, bytes + written, size - written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                std::string message = systemError("Could not write", path);
+                close(fd);
+                unlink(&pattern[0]);
+                throw RDConversionException(message.c_str());
+            }
+            written += (size_t) n;
+        }
+        // mkstemp creates the file for the owner only
+        fchmod(fd, 0644);
+        close(fd);
+        if (rename(&pattern[0], path.c_str()) != 0) {
+            std::string message = systemError("Could not rename", path);
+            unlink(&pattern[0]);
+            throw RDConversionException(message.c_str());
+        }
+    }
+
+    static void writeFile(const std::string &directory, const std::string &name, const std::string &text) {
+        writeFile(directory, name, text.data(), text.size());
+    }
+
+    static std::string readFile(const std::string &path) {
+        FILE *file = fopen(path.c_str(), "rb");
+        if (file == NULL) {
+            throw RDConversionException(systemError("Could not read", path).c_str());
+        }
+        std::string text;
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            text.append(buffer, n);
+        }
+        fclose(file);
+        return text;
+    }
+
+    static void makeDirectory(const std::string &path) {
+        if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+            throw RDConversionException(systemError("Could not create directory", path).c_str());
+        }
+    }
+
+    // -------------------------------------
+    // JSON
+    // -------------------------------------
+
+    static std::string jsonString(const std::string &value) {
+        std::string result = "\"";
+        for (size_t i = 0; i < value.size(); i++) {
+            char c = value[i];
+            if (c == '"' || c == '\\') result += '\\';
+            result += c;
+        }
+        return result + "\"";
+    }
+
+    static std::string jsonNumber(double value) {
+        if (isnan(value)) return "\"NaN\"";
+        if (isinf(value)) return value > 0 ? "\"Infinity\"" : "\"-Infinity\"";
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.9g", value);
+        return buffer;
+    }
+
+    static std::string jsonSizes(const std::vector<size_t> &values) {
+        std::string result = "[";
+        for (size_t i = 0; i < values.size(); i++) {
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "%s%zu", i == 0 ? "" : ", ", values[i]);
+            result += buffer;
+        }
+        return result + "]";
+    }
+
+    /** Attributes as pairs of name and JSON value */
+    typedef std::vector<std::pair<std::string, std::string> > RDZarrAttributes;
+
+    static std::string jsonObject(const RDZarrAttributes &attributes) {
+        std::string result = "{";
+        for (size_t i = 0; i < attributes.size(); i++) {
+            result += (i == 0 ? "\n    " : ",\n    ") + jsonString(attributes[i].first) + ": " + attributes[i].second;
+        }
+        return result + "\n}\n";
+    }
+
+    /** Reads an array of sizes, only as far as needed for the metadata written here */
+    static std::vector<size_t> parseSizes(const std::string &json, const char *key) {
+        std::string quoted = jsonString(key);
+        size_t position = json.find(quoted);
+        if (position == std::string::npos || (position = json.find('[', position)) == std::string::npos) {
+            throw RDConversionException((std::string("Zarr metadata without ") + key).c_str());
+        }
+        std::vector<size_t> values;
+        const char *p = json.c_str() + position + 1;
+        while (true) {
+            while (*p == ' ' || *p == '\n' || *p == ',') p++;
+            if (*p == ']') break;
+            char *end;
+            unsigned long long value = strtoull(p, &end, 10);
+            if (end == p) {
+                throw RDConversionException((std::string("Malformed Zarr metadata for ") + key).c_str());
+            }
+            values.push_back((size_t) value);
+            p = end;
+        }
+        return values;
+    }
+
+    static std::string parseString(const std::string &json, const char *key) {
+        std::string quoted = jsonString(key);
+        size_t position = json.find(quoted);
+        if (position == std::string::npos) return "";
+        size_t begin = json.find('"', json.find(':', position + quoted.size()));
+        size_t end = json.find('"', begin + 1);
+        if (begin == std::string::npos || end == std::string::npos) return "";
+        return json.substr(begin + 1, end - begin - 1);
+    }
+
+    // -------------------------------------
+    // Arrays
+    // -------------------------------------
+
+    static bool littleEndian() {
+        uint16_t one = 1;
+        return *(uint8_t *) &one == 1;
+    }
+
+    /** dtype of native floating point numbers of the given size */
+    static std::string floatType(size_t bytes) {
+        return std::string(littleEndian() ? "<f" : ">f") + (bytes == 8 ? "8" : "4");
+    }
+
+    static std::string arrayMetadata(const std::vector<size_t> &shape,
+                                     const std::vector<size_t> &chunks,
+                                     const std::string &dtype,
+                                     const std::string &fillValue,
+                                     int compressionLevel) {
+        char compressor[64];
+        snprintf(compressor, sizeof(compressor), "{\"id\": \"zlib\", \"level\": %d}", compressionLevel);
+        RDZarrAttributes metadata;
+        metadata.push_back(std::make_pair("chunks", jsonSizes(chunks)));
+        metadata.push_back(std::make_pair("compressor", compressor));
+        metadata.push_back(std::make_pair("dtype", jsonString(dtype)));
+        metadata.push_back(std::make_pair("fill_value", fillValue));
+        metadata.push_back(std::make_pair("filters", "null"));
+        metadata.push_back(std::make_pair("order", jsonString("C")));
+        metadata.push_back(std::make_pair("shape", jsonSizes(shape)));
+        metadata.push_back(std::make_pair("zarr_format", "2"));
+        return jsonObject(metadata);
+    }
+
+    static void writeChunk(const std::string &directory, const std::string &key,
+                           const void *data, size_t size, int compressionLevel) {
+        uLongf length = compressBound((uLong) size);
+        std::vector<Bytef> compressed(length);
+        if (compress2(&compressed[0], &length, (const Bytef *) data, (uLong) size, compressionLevel) != Z_OK) {
+            throw RDConversionException("Could not compress Zarr chunk");
+        }
+        writeFile(directory, key, &compressed[0], length);
+    }
+
+    /** Writes a one-dimensional coordinate variable in a single chunk */
+    static void writeCoordinate(const std::string &storePath, const char *name,
+                                const std::vector<double> &values, const RDZarrAttributes &attributes,
+                                int compressionLevel) {
+        std::string directory = joinPath(storePath, name);
+        makeDirectory(directory);
+        std::vector<size_t> shape(1, values.size());
+        writeFile(directory, ".zarray", arrayMetadata(shape, shape, floatType(8), jsonNumber(NAN), compressionLevel));
+        writeFile(directory, ".zattrs", jsonObject(attributes));
+        writeChunk(directory, "0", &values[0], values.size() * sizeof(double), compressionLevel);
+    }
+
+    /** Grows the time axis of the data variable and the time coordinate */
+    static void writeLength(const std::string &storePath, const RDZarrLayout &layout, size_t length,
+                            int compressionLevel) {
+        std::vector<size_t> shape, chunks;
+        shape.push_back(length);
+        shape.push_back((size_t) layout.dimLat);
+        shape.push_back((size_t) layout.dimLon);
+        chunks.push_back(1);
+        chunks.push_back((size_t) layout.chunkLat);
+        chunks.push_back((size_t) layout.chunkLon);
+        RDScanType type = layout.scanType;
+        writeFile(joinPath(storePath, RDScanTypeToString(type)), ".zarray",
+                  arrayMetadata(shape, chunks, floatType(sizeof(RDDataType)), jsonNumber(RDMissingValue(type)),
+                                compressionLevel));
+        writeFile(joinPath(storePath, "time"), ".zarray",
+                  arrayMetadata(std::vector<size_t>(1, length), std::vector<size_t>(1, 1), floatType(8),
+                                jsonNumber(NAN), compressionLevel));
+    }
+
+    /** Writes the metadata and coordinates of a new store for the scan's product and grid */
+    static void createStore(const std::string &storePath, RDScan *scan, const RDZarrOptions &options) {
+        RDScanType type = scan->header.scanType;
+        const char *product = RDScanTypeToString(type);
+
+        RDZarrAttributes global;
+        global.push_back(std::make_pair("Conventions", jsonString("CF-1.6")));
+        global.push_back(std::make_pair("title", jsonString("Radolan composite in Zarr/CF-Metadata form.")));
+        global.push_back(std::make_pair("institution", jsonString("German Weather Forecast Service (DWD)")));
+        global.push_back(std::make_pair("version", jsonString("1.0")));
+        global.push_back(std::make_pair("radolan_product", jsonString(product)));
+
+        RDCoordinateSystem rcs(type);
+
+        // cell centres, as all other exporters
+        const RDGridGeometry *grid = RDGridGeometry::forScan(scan);
+        std::vector<double> x(grid->centreX(), grid->centreX() + scan->dimLon);
+        std::vector<double> y(grid->centreY(), grid->centreY() + scan->dimLat);
+
+        RDZarrAttributes xAttributes;
+        xAttributes.push_back(std::make_pair("_ARRAY_DIMENSIONS", "[\"x\"]"));
+        xAttributes.push_back(std::make_pair("standard_name", jsonString("projection_x_coordinate")));
+        xAttributes.push_back(std::make_pair("units", jsonString("km")));
+        writeCoordinate(storePath, "x", x, xAttributes, options.compressionLevel);
+
+        RDZarrAttributes yAttributes;
+        yAttributes.push_back(std::make_pair("_ARRAY_DIMENSIONS", "[\"y\"]"));
+        yAttributes.push_back(std::make_pair("standard_name", jsonString("projection_y_coordinate")));
+        yAttributes.push_back(std::make_pair("units", jsonString("km")));
+        writeCoordinate(storePath, "y", y, yAttributes, options.compressionLevel);
+
+        // Grid mapping: a scalar that is never written, only its attributes count
+        RDGeographicalPoint origin = rcs.geographicalCoordinate(rdGridPoint(0, 0));
+        std::string crs = joinPath(storePath, "crs");
+        makeDirectory(crs);
+        writeFile(crs, ".zarray", arrayMetadata(std::vector<size_t>(), std::vector<size_t>(), "|i1", "0",
+                                                options.compressionLevel));
+        RDZarrAttributes crsAttributes;
+        crsAttributes.push_back(std::make_pair("_ARRAY_DIMENSIONS", "[]"));
+        crsAttributes.push_back(std::make_pair("grid_mapping_name", jsonString("polar_stereographic")));
+        crsAttributes.push_back(std::make_pair("longitude_of_projection_origin", jsonNumber(origin.longitude)));
+        crsAttributes.push_back(std::make_pair("latitude_of_projection_origin", jsonNumber(origin.latitude)));
+        crsAttributes.push_back(std::make_pair("false_easting", jsonNumber(0.0)));
+        crsAttributes.push_back(std::make_pair("false_northing", jsonNumber(0.0)));
+        crsAttributes.push_back(std::make_pair("scale_factor_at_projection_origin",
+                                               jsonNumber(rcs.polarStereographicScalingFactor(origin.longitude,
+                                                                                              origin.latitude))));
+        crsAttributes.push_back(std::make_pair("units", jsonString("km")));
+        writeFile(crs, ".zattrs", jsonObject(crsAttributes));
+
+        std::string time = joinPath(storePath, "time");
+        makeDirectory(time);
+        RDZarrAttributes timeAttributes;
+        timeAttributes.push_back(std::make_pair("_ARRAY_DIMENSIONS", "[\"time\"]"));
+        timeAttributes.push_back(std::make_pair("units", jsonString("seconds since 1970-01-01 00:00:00.0")));
+        timeAttributes.push_back(std::make_pair("calendar", jsonString("gregorian")));
+        timeAttributes.push_back(std::make_pair("standard_name", jsonString("time")));
+        writeFile(time, ".zattrs", jsonObject(timeAttributes));
+
+        std::string data = joinPath(storePath, product);
+        makeDirectory(data);
+        RDZarrAttributes dataAttributes;
+        dataAttributes.push_back(std::make_pair("_ARRAY_DIMENSIONS", "[\"time\", \"y\", \"x\"]"));
+        dataAttributes.push_back(std::make_pair("grid_mapping", jsonString("crs")));
+        dataAttributes.push_back(std::make_pair("radolan_product", jsonString(product)));
+        dataAttributes.push_back(std::make_pair("standard_name", jsonString(RDStandardName(type))));
+        dataAttributes.push_back(std::make_pair("units", jsonString(RDUnits(type))));
+        dataAttributes.push_back(std::make_pair("valid_min", jsonNumber(RDMinValue(type))));
+        dataAttributes.push_back(std::make_pair("valid_max", jsonNumber(RDMaxValue(type))));
+        writeFile(data, ".zattrs", jsonObject(dataAttributes));
+
+        RDZarrLayout layout;
+        layout.scanType = type;
+        layout.dimLon = scan->dimLon;
+        layout.dimLat = scan->dimLat;
+        layout.chunkLon = std::min(options.chunkLon, scan->dimLon);
+        layout.chunkLat = std::min(options.chunkLat, scan->dimLat);
+        writeLength(storePath, layout, 0, options.compressionLevel);
+
+        // last, as its presence marks a complete store
+        writeFile(storePath, ".zattrs", jsonObject(global));
+    }
+
+    /** Exclusive lock on the store's .zgroup file, which is created with the store */
+    class RDZarrLock {
+    public:
+        explicit RDZarrLock(const std::string &storePath, bool create) : m_fd(-1) {
+            if (create) {
+                makeDirectory(storePath);
+            }
+            std::string path = joinPath(storePath, ".zgroup");
+            m_fd = open(path.c_str(), create ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+            if (m_fd < 0) {
+                throw RDConversionException(systemError("Could not open Zarr store", storePath).c_str());
+            }
+            while (flock(m_fd, LOCK_EX) != 0) {
+                if (errno != EINTR) {
+                    std::string message = systemError("Could not lock Zarr store", storePath);
+                    close(m_fd);
+                    throw RDConversionException(message.c_str());
+                }
+            }
+            // written in place, as replacing the file would lose the lock
+            struct stat status;
+            if (create && fstat(m_fd, &status) == 0 && status.st_size == 0) {
+                const char *group = "{\n    \"zarr_format\": 2\n}\n";
+                if (pwrite(m_fd, group, strlen(group), 0) != (ssize_t) strlen(group)) {
+                    std::string message = systemError("Could not write", path);
+                    close(m_fd);
+                    throw RDConversionException(message.c_str());
+                }
+            }
+        }
+
+        ~RDZarrLock() {
+            // closing releases the lock
+            close(m_fd);
+        }
+
+    private:
+        RDZarrLock(const RDZarrLock &);
+
+        RDZarrLock &operator=(const RDZarrLock &);
+
+        int m_fd;
+    };
+
+    static bool exists(const std::string &path) {
+        struct stat status;
+        return stat(path.c_str(), &status) == 0;
+    }
+
+    /**
+     * Creates the store if needed, checks that it fits the scan and
+     * reserves count time steps from index on, or at the end if index
+     * is negative.
+     */
+    static RDZarrLayout reserve(const std::string &storePath, RDScan *scan, const RDZarrOptions &options,
+                                size_t count, long index) {
+        if (options.chunkLon < 1 || options.chunkLat < 1) {
+            throw RDConversionException("Zarr chunks must have at least one cell");
+        }
+        if (options.compressionLevel < 1 || options.compressionLevel > 9) {
+            throw RDConversionException("zlib compression level must be within 1-9");
+        }
+
+        RDZarrLock lock(storePath, true);
+
+        if (!exists(joinPath(storePath, ".zattrs"))) {
+            createStore(storePath, scan, options);
+        }
+
+        RDScanType type = scan->header.scanType;
+        std::string product = parseString(readFile(joinPath(storePath, ".zattrs")), "radolan_product");
+        if (product != RDScanTypeToString(type)) {
+            std::string message = "Zarr store holds product " + product + ", not " + RDScanTypeToString(type);
+            throw RDConversionException(message.c_str());
+        }
+
+        std::string metadata = readFile(joinPath(joinPath(storePath, product), ".zarray"));
+        std::vector<size_t> shape = parseSizes(metadata, "shape");
+        std::vector<size_t> chunks = parseSizes(metadata, "chunks");
+        if (shape.size() != 3 || chunks.size() != 3) {
+            throw RDConversionException("Zarr store is not a time series of scans");
+        }
+        if (shape[1] != (size_t) scan->dimLat || shape[2] != (size_t) scan->dimLon) {
+            throw RDConversionException("Scan has a different grid than the Zarr store");
+        }
+
+        RDZarrLayout layout;
+        layout.scanType = type;
+        layout.dimLon = scan->dimLon;
+        layout.dimLat = scan->dimLat;
+        layout.chunkLon = (int) chunks[2];
+        layout.chunkLat = (int) chunks[1];
+        layout.first = index < 0 ? shape[0] : (size_t) index;
+
+        size_t length = std::max(shape[0], layout.first + count);
+        if (length != shape[0]) {
+            writeLength(storePath, layout, length, options.compressionLevel);
+        }
+        return layout;
+    }
+
+    /** Writes the chunks and the time of one scan */
+    static void writeChunks(const std::string &storePath, const RDZarrLayout &layout, RDScan *scan, size_t index,
+                            int compressionLevel) {
+        if (scan->header.scanType != layout.scanType || scan->dimLon != layout.dimLon
+            || scan->dimLat != layout.dimLat) {
+            throw RDConversionException("Scan does not fit the Zarr store");
+        }
+
+        std::string directory = joinPath(storePath, RDScanTypeToString(layout.scanType));
+        RDDataType missing = RDMissingValue(layout.scanType);
+
+        // edge chunks are stored in full size, padded with the fill value
+        std::vector<RDDataType> chunk((size_t) layout.chunkLon * layout.chunkLat);
+        for (int y0 = 0; y0 < layout.dimLat; y0 += layout.chunkLat) {
+            int rows = std::min(layout.chunkLat, layout.dimLat - y0);
+            for (int x0 = 0; x0 < layout.dimLon; x0 += layout.chunkLon) {
+                int columns = std::min(layout.chunkLon, layout.dimLon - x0);
+                if (rows < layout.chunkLat || columns < layout.chunkLon) {
+                    std::fill(chunk.begin(), chunk.end(), missing);
+                }
+                for (int y = 0; y < rows; y++) {
+                    memcpy(&chunk[(size_t) y * layout.chunkLon],
+                           scan->data + (size_t) (y0 + y) * layout.dimLon + x0,
+                           columns * sizeof(RDDataType));
+                }
+                char key[64];
+                snprintf(key, sizeof(key), "%zu.%d.%d", index, y0 / layout.chunkLat, x0 / layout.chunkLon);
+                writeChunk(directory, key, &chunk[0], chunk.size() * sizeof(RDDataType), compressionLevel);
+            }
+        }
+
+        double timestamp = (double) RDScanTimeInSecondsSinceEpoch(scan);
+        char key[32];
+        snprintf(key, sizeof(key), "%zu", index);
+        writeChunk(joinPath(storePath, "time"), key, &timestamp, sizeof(timestamp), compressionLevel);
+    }
+
+    size_t
+    Radolan2Zarr::appendScan(RDScan *scan, const char *storePath, const RDZarrOptions &options) {
+        RDZarrLayout layout = reserve(storePath, scan, options, 1, -1);
+        writeChunks(storePath, layout, scan, layout.first, options.compressionLevel);
+        return layout.first;
+    }
+
+    void
+    Radolan2Zarr::writeScan(RDScan *scan, const char *storePath, size_t index, const RDZarrOptions &options) {
+        RDZarrLayout layout = reserve(storePath, scan, options, 1, (long) index);
+        writeChunks(storePath, layout, scan, index, options.compressionLevel);
+    }
+
+    size_t
+    Radolan2Zarr::appendFiles(const std::vector<std::string> &radolanPaths, const char *storePath,
+                              const RDZarrOptions &options, bool omitOutside) {
+        // the headers give the order and the grid for a new store
+        std::vector<std::pair<time_t, std::string> > ordered;
+        RDScan probe;
+        for (size_t i = 0; i < radolanPaths.size(); i++) {
+            if (!RDReadScanHeader(radolanPaths[i].c_str(), &probe.header)) {
+                throw RDConversionException(("Could not read header of " + radolanPaths[i]).c_str());
+            }
+            free(probe.header.radarStations);
+            probe.header.radarStations = NULL;
+            ordered.push_back(std::make_pair(RDScanTimeInSecondsSinceEpoch(&probe), radolanPaths[i]));
+        }
+        if (ordered.empty()) {
+            return length(storePath);
+        }
+        std::sort(ordered.begin(), ordered.end());
+
+        RDScan *first = RDAllocateScan();
+        if (first == NULL) {
+            throw RDConversionException("Could not allocate scan");
+        }
+        first->data = NULL;
+        if (!RDReadScan(ordered[0].second.c_str(), first, omitOutside)) {
+            RDFreeScan(first);
+            throw RDConversionException(("Could not read " + ordered[0].second).c_str());
+        }
+        RDZarrLayout layout;
+        try {
+            layout = reserve(storePath, first, options, ordered.size(), -1);
+            writeChunks(storePath, layout, first, layout.first, options.compressionLevel);
+        } catch (const RDConversionException &) {
+            RDFreeScan(first);
+            throw;
+        }
+        RDFreeScan(first);
+
+        std::atomic<size_t> next(1);
+        std::mutex mutex;
+        std::string failure;
+
+        auto work = [&]() {
+            for (size_t i = next++; i < ordered.size(); i = next++) {
+                RDScan *scan = RDAllocateScan();
+                if (scan == NULL) {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    failure = "Could not allocate scan";
+                    return;
+                }
+                scan->data = NULL;
+                try {
+                    if (!RDReadScan(ordered[i].second.c_str(), scan, omitOutside)) {
+                        throw RDConversionException(("Could not read " + ordered[i].second).c_str());
+                    }
+                    writeChunks(storePath, layout, scan, layout.first + i, options.compressionLevel);
+                } catch (const RDConversionException &e) {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    if (failure.empty()) failure = e.what();
+                }
+                RDFreeScan(scan);
+            }
+        };
+
+        unsigned int threads = options.threads;
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = (unsigned int) std::min((size_t) threads, ordered.size() - 1);
+        if (threads <= 1) {
+            work();
+        } else {
+            std::vector<std::thread> workers;
+            for (unsigned int i = 0; i < threads; i++) {
+                workers.push_back(std::thread(work));
+            }
+            for (size_t i = 0; i < workers.size(); i++) {
+                workers[i].join();
+            }
+        }
+
+        if (!failure.empty()) {
+            throw RDConversionException(failure.c_str());
+        }
+        return layout.first;
+    }
+
+    size_t
+    Radolan2Zarr::length(const char *storePath) {
+        RDZarrLock lock(storePath, false);
+        std::string product = parseString(readFile(joinPath(storePath, ".zattrs")), "radolan_product");
+        std::vector<size_t> shape = parseSizes(readFile(joinPath(joinPath(storePath, product), ".zarray")), "shape");
+        if (shape.empty()) {
+            throw RDConversionException("Zarr store is not a time series of scans");
+        }
+        return shape[0];
+    }
+}
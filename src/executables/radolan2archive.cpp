@@ -0,0 +1,174 @@
+#include <netcdf>
+#include <iostream>
+#include <algorithm>
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <radolan/radolan.h>
+
+using namespace std;
+using namespace Radolan;
+
+using namespace boost;
+
+// parses YYYYMMDDhhmm (UTC)
+static bool parseTime(const string &text, time_t &time) {
+    struct tm t;
+    memset(&t, 0, sizeof(t));
+    if (text.length() != 12 || strptime(text.c_str(), "%Y%m%d%H%M", &t) == NULL) {
+        return false;
+    }
+    time = timegm(&t);
+    return true;
+}
+
+static string timeString(time_t time) {
+    char buffer[32];
+    struct tm tm;
+    gmtime_r(&time, &tm);
+    strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:00Z", &tm);
+    return buffer;
+}
+
+int main(int argc, char **argv) {
+
+    namespace fs = boost::filesystem;
+
+    try {
+        program_options::options_description desc("Options");
+        desc.add_options()
+                ("help,h", "Show this message and exit.")
+                ("version", "Print version information and exit.")
+                ("archive,a", program_options::value<string>(),
+                 "Path of the archive")
+                ("file,f", program_options::value<string>(),
+                 "Radolan filename or directory containing radolan scans to append to the archive")
+                ("tile-size", program_options::value<int>()->default_value(128),
+                 "Edge length of the tiles in cells for products new to the archive")
+                ("keyframes", program_options::value<int>()->default_value(12),
+                 "Store every n-th scan of a product without reference to the scan before")
+                ("level", program_options::value<int>()->default_value(6),
+                 "zlib compression level 1-9")
+                ("list,l", "List the products in the archive")
+                ("product,p", program_options::value<string>(), "Product to print, for example RX")
+                ("time,t", program_options::value<string>(), "Time of the scan to print (YYYYMMDDhhmm, UTC)");
+
+        program_options::variables_map vm;
+        try {
+            program_options::store(program_options::parse_command_line(argc, argv, desc), vm);
+            program_options::notify(vm);
+        } catch (std::exception &e) {
+            cerr << "ERROR:could not parse command line:" << e.what() << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        if (vm.count("version") != 0) {
+            cout << Radolan::VERSION << endl;
+            exit(EXIT_SUCCESS);
+        }
+
+        if (vm.count("help") != 0 || argc < 2 || vm.count("archive") == 0) {
+            cout << desc << "\n";
+            exit(EXIT_SUCCESS);
+        }
+
+        string archivePath = vm["archive"].as<string>();
+
+        if (vm.count("file") != 0) {
+            string infile = vm["file"].as<string>();
+
+            // File or Directory?
+            std::string ending("---bin");
+            fs::path path(infile);
+
+            fs::directory_iterator end_iter;
+            vector<std::string> file_paths;
+
+            if (fs::exists(path)) {
+                if (fs::is_directory(path)) {
+                    for (fs::directory_iterator dir_iter(path); dir_iter != end_iter; ++dir_iter) {
+                        if (fs::is_regular_file(dir_iter->status())) {
+                            std::string fn = dir_iter->path().generic_string();
+                            if (0 == fn.compare(fn.length() - ending.length(), ending.length(), ending)) {
+                                file_paths.push_back(fn);
+                            }
+                        }
+                    }
+                } else {
+                    std::string fn = path.generic_string();
+                    file_paths.push_back(fn);
+                }
+            } else {
+                cerr << "FATAL:File or path does not exist: " << infile << endl;
+                exit(EXIT_FAILURE);
+            }
+
+            // scans must be appended in chronological order
+            vector<pair<time_t, string> > ordered;
+            for (size_t i = 0; i < file_paths.size(); i++) {
+                RDScan probe;
+                if (!RDReadScanHeader(file_paths[i].c_str(), &probe.header)) {
+                    cerr << "ERROR:could not read header of " << file_paths[i] << endl;
+                    continue;
+                }
+                free(probe.header.radarStations);
+                ordered.push_back(make_pair(RDScanTimeInSecondsSinceEpoch(&probe), file_paths[i]));
+            }
+            sort(ordered.begin(), ordered.end());
+
+            RDArchiveOptions options = rdArchiveOptions();
+            options.tileSize = vm["tile-size"].as<int>();
+            options.keyframeInterval = vm["keyframes"].as<int>();
+            options.compressionLevel = vm["level"].as<int>();
+            RDArchiveWriter writer(archivePath.c_str(), options);
+
+            size_t appended = 0;
+            for (size_t i = 0; i < ordered.size(); i++) {
+                try {
+                    writer.appendFile(ordered[i].second.c_str());
+                    appended++;
+                } catch (RDConversionException &e) {
+                    cerr << "ERROR:" << ordered[i].second << ": " << e.what() << endl;
+                }
+            }
+            cout << "Appended " << appended << " of " << ordered.size() << " files to " << archivePath << endl;
+        }
+
+        if (vm.count("list") != 0) {
+            RDArchiveReader reader(archivePath.c_str());
+            vector<RDScanType> products = reader.products();
+            for (size_t i = 0; i < products.size(); i++) {
+                const RDArchiveProduct &product = reader.product(products[i]);
+                cout << RDScanTypeToString(products[i]) << ": " << product.entries.size() << " scans "
+                     << product.dimLon << "x" << product.dimLat << " from "
+                     << timeString(product.entries.front().time) << " to "
+                     << timeString(product.entries.back().time) << endl;
+            }
+        }
+
+        if (vm.count("product") != 0 || vm.count("time") != 0) {
+            time_t time;
+            if (vm.count("product") == 0 || vm.count("time") == 0 || !parseTime(vm["time"].as<string>(), time)) {
+                cerr << "FATAL:Printing a scan needs the product and the time as YYYYMMDDhhmm" << endl;
+                exit(EXIT_FAILURE);
+            }
+            RDScanType type = RDScanTypeFromString(vm["product"].as<string>().c_str());
+            RDArchiveReader reader(archivePath.c_str());
+            long index = reader.find(type, time);
+            if (index < 0) {
+                cerr << "FATAL:No such scan in the archive" << endl;
+                exit(EXIT_FAILURE);
+            }
+            RDScan *scan = reader.scan(type, (size_t) index);
+            RDPrintHeaderInformation(scan);
+            RDPrintScan(scan, 20, 20);
+            RDFreeScan(scan);
+        }
+
+    } catch (const std::exception &e) {
+        cerr << "FATAL:exception: " << e.what() << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,140 @@
+#include <netcdf>
+#include <iostream>
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <radolan/radolan.h>
+
+using namespace std;
+using namespace Radolan;
+
+using namespace boost;
+
+int main(int argc, char **argv) {
+
+    namespace fs = boost::filesystem;
+
+    try {
+        program_options::options_description desc("Options");
+        desc.add_options()
+                ("help,h", "Show this message and exit.")
+                ("version", "Print version information and exit.")
+                ("file,f", program_options::value<string>(),
+                 "Radolan filename or directory containing radolan scans")
+                ("output-dir,o", program_options::value<string>()->default_value("."),
+                 "Output directory to write resulting files to. Defaults to current directory.")
+                ("tile-size", program_options::value<int>()->default_value(256),
+                 "Edge length of the tiles in pixels, a multiple of 16")
+                ("overviews", program_options::value<int>()->default_value(3),
+                 "Number of overviews (3 = 2x, 4x and 8x)")
+                ("level", program_options::value<int>()->default_value(6),
+                 "Deflate compression level 1-9")
+                ("predictor", "Use the floating point predictor")
+                ("threads", program_options::value<unsigned int>()->default_value(0),
+                 "Number of threads compressing tiles, 0 for one per core");
+
+        program_options::variables_map vm;
+        try {
+            program_options::store(program_options::parse_command_line(argc, argv, desc), vm);
+            program_options::notify(vm);
+        } catch (std::exception &e) {
+            cerr << "ERROR:could not parse command line:" << e.what() << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        if (vm.count("version") != 0) {
+            cout << Radolan::VERSION << endl;
+            exit(EXIT_SUCCESS);
+        }
+
+        if (vm.count("help") != 0 || argc < 2 || vm.count("file") == 0) {
+            cout << desc << "\n";
+            exit(EXIT_SUCCESS);
+        }
+
+        RDGeoTIFFOptions options = rdGeoTIFFOptions();
+        options.tileSize = vm["tile-size"].as<int>();
+        options.overviews = vm["overviews"].as<int>();
+        options.compressionLevel = vm["level"].as<int>();
+        options.predictor = vm.count("predictor") > 0;
+        options.threads = vm["threads"].as<unsigned int>();
+
+        string infile = vm["file"].as<string>();
+
+        // File or Directory?
+        std::string ending("---bin");
+        fs::path path(infile);
+
+        fs::directory_iterator end_iter;
+        vector<std::string> file_paths;
+
+        if (fs::exists(path)) {
+            if (fs::is_directory(path)) {
+                for (fs::directory_iterator dir_iter(path); dir_iter != end_iter; ++dir_iter) {
+                    if (fs::is_regular_file(dir_iter->status())) {
+                        std::string fn = dir_iter->path().generic_string();
+                        if (0 == fn.compare(fn.length() - ending.length(), ending.length(), ending)) {
+                            file_paths.push_back(fn);
+                        }
+                    }
+                }
+            } else {
+                std::string fn = path.generic_string();
+                file_paths.push_back(fn);
+            }
+        } else {
+            cerr << "FATAL:File or path does not exist: " << infile << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        boost::filesystem::path outpath(vm["output-dir"].as<std::string>());
+
+        if (!boost::filesystem::exists(outpath) || !boost::filesystem::is_directory(outpath)) {
+            cerr << "FATAL:Can't write to path " << outpath << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        if (file_paths.empty()) {
+            cout << "No RADOLAN files found." << endl;
+            exit(EXIT_SUCCESS);
+        }
+
+        vector<std::string>::iterator fi;
+        for (fi = file_paths.begin(); fi != file_paths.end(); fi++) {
+            std::string fn = *fi;
+
+            RDScan *scan = RDAllocateScan();
+            if (scan == NULL) {
+                cerr << "FATAL:out of memory" << endl;
+                exit(EXIT_FAILURE);
+            }
+            scan->data = NULL;
+            if (!RDReadScan(fn.c_str(), scan, false)) {
+                cerr << "ERROR:could not read RADOLAN file " << fn << endl;
+                RDFreeScan(scan);
+                continue;
+            }
+
+            try {
+                boost::filesystem::path path = outpath;
+                path /= boost::filesystem::path(fn).filename();
+                path += ".tif";
+
+                cout << "Converting " << fn << " to " << path.generic_string() << " ...";
+                Radolan2GeoTIFF::convertScan(scan, path.generic_string().c_str(), options);
+                cout << " done." << endl;
+
+            } catch (RDConversionException &e) {
+                cerr << endl << "ERROR:" << e.what() << endl;
+            }
+
+            RDFreeScan(scan);
+        }
+
+    } catch (const std::exception &e) {
+        cerr << "FATAL:exception: " << e.what() << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
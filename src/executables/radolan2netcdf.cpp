@@ -22,7 +22,13 @@ int main(int argc, char **argv) {
                 ("output-dir,o", program_options::value<string>()->default_value("."),
                  "Path to write the results to. Defaults to current directory.")
                 ("threshold,t", program_options::value<float>(), "Value threshold (depends of product)")
-                ("netcdf,n", "Write scan out in netCDF/CF-Metadata format");
+                ("combine,c", "Group scans by timestamp and write all products of one timestamp into a single file")
+                ("quantize,q", "Bit-round FLOAT data to the product's precision (lossy, much better compression)")
+                ("netcdf,n", "Write scan out in netCDF/CF-Metadata format")
+                ("zarr,z", program_options::value<string>(),
+                 "Append the scans to the given Zarr store instead, creating it if needed")
+                ("jobs,j", program_options::value<unsigned int>()->default_value(1),
+                 "Number of threads reading and converting files, 0 for one per core");
 
         program_options::variables_map vm;
         try {
@@ -50,11 +56,16 @@ int main(int argc, char **argv) {
 
         // check parameters
 
-        bool convert_to_netcdf = (vm.count("netcdf") == 0 && vm.count("vtk") == 0)
+        bool convert_to_zarr = (vm.count("zarr") > 0);
+
+        bool convert_to_netcdf = (vm.count("netcdf") == 0 && vm.count("vtk") == 0 && !convert_to_zarr)
                                  || (vm.count("netcdf") > 0);
 
         bool convert_to_vtk = (vm.count("vtk") > 0);
         bool write_as_rvp6 = (vm.count("rvp6") > 0);
+        bool combine = (vm.count("combine") > 0);
+        bool quantize = (vm.count("quantize") > 0);
+        unsigned int jobs = vm["jobs"].as<unsigned int>();
 
         if (vm.count("file") == 0) {
             cerr << "No input" << endl;
@@ -103,29 +114,38 @@ int main(int argc, char **argv) {
             *threshold = vm["threshold"].as<RDDataType>();
         }
 
-        if (convert_to_netcdf) {
-            vector<std::string>::iterator fi;
-
-            for (fi = file_paths.begin(); fi != file_paths.end(); fi++) {
-                std::string fn = *fi;
-
-                boost::filesystem::path path = outpath;
-                path /= boost::filesystem::path(fn).filename();
-                path += ".nc";
-
-                cout << "Converting " << fn << " to " << path.generic_string() << " ...";
-
-                netCDF::NcFile *file = NULL;
-
-                try {
-                    file = Radolan2NetCDF::convertFile(fn.c_str(), path.generic_string().c_str(),
-                                                       write_as_rvp6, threshold, netCDF::NcFile::replace, false);
-                    cout << " done." << endl;
-                } catch (RDConversionException &e) {
-                    cerr << endl << "ERROR:" << e.what() << endl;
+        if (convert_to_zarr) {
+            string store = vm["zarr"].as<string>();
+            cout << "Appending " << file_paths.size() << " files to " << store << " ..." << endl;
+            try {
+                RDZarrOptions options = rdZarrOptions();
+                if (!vm["jobs"].defaulted()) {
+                    options.threads = jobs;
                 }
+                size_t first = Radolan2Zarr::appendFiles(file_paths, store.c_str(), options);
+                cout << "Wrote time steps " << first << " to " << Radolan2Zarr::length(store.c_str()) - 1 << endl;
+            } catch (RDConversionException &e) {
+                cerr << endl << "ERROR:" << e.what() << endl;
+            }
+        }
 
-                delete file;
+        if (convert_to_netcdf && combine) {
+            cout << "Converting " << file_paths.size() << " files grouped by timestamp ..." << endl;
+            try {
+                vector<std::string> written = Radolan2NetCDF::convertFilesByTimestamp(
+                        file_paths, outpath.generic_string().c_str(), write_as_rvp6, threshold, false, quantize);
+                for (size_t i = 0; i < written.size(); i++) {
+                    cout << "Wrote " << written[i] << endl;
+                }
+            } catch (RDConversionException &e) {
+                cerr << endl << "ERROR:" << e.what() << endl;
+            }
+        } else if (convert_to_netcdf) {
+            cout << "Converting " << file_paths.size() << " files to " << outpath.generic_string() << " ..." << endl;
+            vector<std::string> written = Radolan2NetCDF::convertFiles(
+                    file_paths, outpath.generic_string().c_str(), write_as_rvp6, threshold, false, quantize, jobs);
+            for (size_t i = 0; i < written.size(); i++) {
+                cout << "Wrote " << written[i] << endl;
             }
         }
 
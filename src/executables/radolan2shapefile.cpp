@@ -1,5 +1,7 @@
 #include <netcdf>
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 
 #include <boost/program_options.hpp>
 #include <boost/filesystem.hpp>
@@ -25,7 +27,10 @@ int main(int argc, char **argv) {
                 ("output-dir,o", program_options::value<string>()->default_value("."),
                  "Output directory to write resulting files to. Defaults to current directory.")
                 ("bounds", "Write out a shapefile containing the bounding box")
-                ("points,p", "Convert to SHPT_MULTIPOINTM (or SHPT_POINT if --no-values is given) instead of polygons")
+                ("points,p", "Convert to SHPT_POINTM (or SHPT_POINT if --no-values is given) instead of polygons")
+                ("regions,r", "Merge connected cells of the same value class (see --breaks) into one polygon each")
+                ("breaks,b", program_options::value<string>(),
+                 "Comma separated lower bounds of the value classes for --regions. Defaults depend on the product.")
                 ("geographical,g", "Use lat/lon (geographical) instead of polar-stereographic (cartesian)")
                 ("no-values,n", "Write out simple shapes without values (SHPT_POINT/SHPT_POLYGON)");
 
@@ -56,6 +61,19 @@ int main(int argc, char **argv) {
         // Write as points or polygons?
         bool writePoints = vm.count("points") > 0;
 
+        // Merge cells into regions?
+        bool writeRegions = vm.count("regions") > 0;
+
+        vector<RDDataType> classBreaks;
+        if (vm.count("breaks") > 0) {
+            std::stringstream breaks(vm["breaks"].as<string>());
+            std::string item;
+            while (std::getline(breaks, item, ',')) {
+                classBreaks.push_back((RDDataType) atof(item.c_str()));
+            }
+            std::sort(classBreaks.begin(), classBreaks.end());
+        }
+
         // Write bounding box file?
         bool writeBoundingBox = vm.count("bounds") > 0;
 
@@ -139,7 +157,20 @@ int main(int argc, char **argv) {
                 path += ".shp";
 
                 cout << "Converting " << fn << " to " << path.generic_string() << " ...";
-                if (writePoints) {
+                if (writeRegions) {
+                    vector<RDDataType> breaks = classBreaks;
+                    if (breaks.empty()) {
+                        // dBZ for reflectivity products, mm otherwise
+                        bool isReflectivity = scan->header.scanType == RD_RX || scan->header.scanType == RD_EX;
+                        const RDDataType dbz[] = {5, 15, 25, 35, 45, 55};
+                        const RDDataType mm[] = {0.1f, 0.5f, 1, 2, 5, 10, 20, 50};
+                        breaks = isReflectivity
+                                 ? vector<RDDataType>(dbz, dbz + 6)
+                                 : vector<RDDataType>(mm, mm + 8);
+                    }
+                    Radolan2Shapefile::convertToRegions(scan, path.generic_string().c_str(), breaks,
+                                                        geographical, withValues);
+                } else if (writePoints) {
                     Radolan2Shapefile::convertToPoints(scan, path.generic_string().c_str(), geographical, withValues);
                 } else {
                     Radolan2Shapefile::convertToPolygons(scan, path.generic_string().c_str(), geographical, withValues);
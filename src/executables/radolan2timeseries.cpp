@@ -0,0 +1,183 @@
+#include <netcdf>
+#include <iostream>
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <radolan/radolan.h>
+
+using namespace std;
+using namespace Radolan;
+
+using namespace boost;
+
+// parses YYYYMMDDhhmm (UTC)
+static bool parseTime(const string &text, time_t &time) {
+    struct tm t;
+    memset(&t, 0, sizeof(t));
+    if (text.length() != 12 || strptime(text.c_str(), "%Y%m%d%H%M", &t) == NULL) {
+        return false;
+    }
+    time = timegm(&t);
+    return true;
+}
+
+int main(int argc, char **argv) {
+
+    namespace fs = boost::filesystem;
+
+    try {
+        program_options::options_description desc("Options");
+        desc.add_options()
+                ("help,h", "Show this message and exit.")
+                ("version", "Print version information and exit.")
+                ("store,s", program_options::value<string>(),
+                 "Path of the time series store")
+                ("file,f", program_options::value<string>(),
+                 "Radolan filename or directory containing radolan scans. If given, the store is "
+                 "created from the scans. Otherwise time series are read from the store.")
+                ("tile-size", program_options::value<int>()->default_value(16),
+                 "Edge length of the tiles in cells when creating the store.")
+                ("chunk-length", program_options::value<int>()->default_value(2016),
+                 "Number of scans per chunk when creating the store.")
+                ("memory", program_options::value<size_t>()->default_value(1024),
+                 "Memory for transposing in MB when creating the store.")
+                ("threads,j", program_options::value<unsigned int>()->default_value(0),
+                 "Number of threads reading scans when creating the store. Defaults to one per core.")
+                ("x,x", program_options::value<int>(), "Column of the (first) cell to read")
+                ("y,y", program_options::value<int>(), "Row of the (first) cell to read")
+                ("width", program_options::value<int>()->default_value(1), "Number of columns to read")
+                ("height", program_options::value<int>()->default_value(1), "Number of rows to read")
+                ("from", program_options::value<string>(), "First time to read (YYYYMMDDhhmm, UTC)")
+                ("to", program_options::value<string>(), "Last time to read (YYYYMMDDhhmm, UTC)");
+
+        program_options::variables_map vm;
+        try {
+            program_options::store(program_options::parse_command_line(argc, argv, desc), vm);
+            program_options::notify(vm);
+        } catch (std::exception &e) {
+            cerr << "ERROR:could not parse command line:" << e.what() << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        if (vm.count("version") != 0) {
+            cout << Radolan::VERSION << endl;
+            exit(EXIT_SUCCESS);
+        }
+
+        if (vm.count("help") != 0 || argc < 2 || vm.count("store") == 0) {
+            cout << desc << "\n";
+            exit(EXIT_SUCCESS);
+        }
+
+        string storePath = vm["store"].as<string>();
+
+        if (vm.count("file") != 0) {
+            string infile = vm["file"].as<string>();
+
+            // File or Directory?
+            std::string ending("---bin");
+            fs::path path(infile);
+
+            fs::directory_iterator end_iter;
+            vector<std::string> file_paths;
+
+            if (fs::exists(path)) {
+                if (fs::is_directory(path)) {
+                    for (fs::directory_iterator dir_iter(path); dir_iter != end_iter; ++dir_iter) {
+                        if (fs::is_regular_file(dir_iter->status())) {
+                            std::string fn = dir_iter->path().generic_string();
+                            if (0 == fn.compare(fn.length() - ending.length(), ending.length(), ending)) {
+                                file_paths.push_back(fn);
+                            }
+                        }
+                    }
+                } else {
+                    std::string fn = path.generic_string();
+                    file_paths.push_back(fn);
+                }
+            } else {
+                cerr << "FATAL:File or path does not exist: " << infile << endl;
+                exit(EXIT_FAILURE);
+            }
+
+            if (file_paths.empty()) {
+                cout << "No RADOLAN files found." << endl;
+                exit(EXIT_SUCCESS);
+            }
+
+            RDTransposeOptions options = rdTransposeOptions();
+            options.tileSize = vm["tile-size"].as<int>();
+            options.chunkLength = vm["chunk-length"].as<int>();
+            options.memoryLimit = vm["memory"].as<size_t>() << 20;
+            options.threads = vm["threads"].as<unsigned int>();
+
+            cout << "Transposing " << file_paths.size() << " files into " << storePath << " ...";
+            cout.flush();
+            try {
+                RDTransposeFiles(file_paths, storePath.c_str(), options);
+            } catch (RDConversionException &e) {
+                cerr << endl << "FATAL:" << e.what() << endl;
+                exit(EXIT_FAILURE);
+            }
+            cout << " done." << endl;
+            exit(EXIT_SUCCESS);
+        }
+
+        if (vm.count("x") == 0 || vm.count("y") == 0) {
+            cerr << "FATAL:Cell to read (-x, -y) is missing" << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        RDTransposeStore store(storePath.c_str());
+
+        time_t from = store.size() > 0 ? store.time(0) : 0;
+        time_t to = store.size() > 0 ? store.time(store.size() - 1) : 0;
+        if ((vm.count("from") != 0 && !parseTime(vm["from"].as<string>(), from))
+            || (vm.count("to") != 0 && !parseTime(vm["to"].as<string>(), to))) {
+            cerr << "FATAL:Times must be given as YYYYMMDDhhmm" << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        int x0 = vm["x"].as<int>();
+        int y0 = vm["y"].as<int>();
+        int width = vm["width"].as<int>();
+        int height = vm["height"].as<int>();
+        size_t first, last;
+        store.range(from, to + 1, first, last);
+
+        vector<RDDataType> values;
+        try {
+            store.area(x0, x0 + width, y0, y0 + height, first, last, values);
+        } catch (RDConversionException &e) {
+            cerr << "FATAL:" << e.what() << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        // one line per time and cell
+        size_t length = last - first;
+        cout << "time,x,y,value" << endl;
+        for (size_t t = 0; t < length; t++) {
+            char timeString[32];
+            time_t time = store.time(first + t);
+            struct tm tm;
+            gmtime_r(&time, &tm);
+            strftime(timeString, sizeof(timeString), "%Y-%m-%dT%H:%M:00Z", &tm);
+            for (int y = 0; y < height; y++) {
+                for (int x = 0; x < width; x++) {
+                    RDDataType value = values[((size_t) y * width + x) * length + t];
+                    cout << timeString << "," << x0 + x << "," << y0 + y << ",";
+                    if (RDIsCleanMeasurement(store.scanType(), value)) {
+                        cout << value;
+                    }
+                    cout << '\n';
+                }
+            }
+        }
+
+    } catch (const std::exception &e) {
+        cerr << "FATAL:exception: " << e.what() << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,121 @@
+#include <netcdf>
+#include <iostream>
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <radolan/radolan.h>
+
+using namespace std;
+using namespace Radolan;
+
+using namespace boost;
+
+// parses YYYYMMDDhhmm (UTC)
+static bool parseTime(const string &text, time_t &time) {
+    struct tm t;
+    memset(&t, 0, sizeof(t));
+    if (text.length() != 12 || strptime(text.c_str(), "%Y%m%d%H%M", &t) == NULL) {
+        return false;
+    }
+    time = timegm(&t);
+    return true;
+}
+
+int main(int argc, char **argv) {
+
+    namespace fs = boost::filesystem;
+
+    try {
+        RDSyntheticOptions defaults = rdSyntheticOptions();
+
+        program_options::options_description desc("Options");
+        desc.add_options()
+                ("help,h", "Show this message and exit.")
+                ("version", "Print version information and exit.")
+                ("product,p", program_options::value<string>()->default_value("RX"),
+                 "Product to generate (RX, EX, RZ, RY, RV, RH, RB, RW, RL, RU, RS, RQ, SQ, SH or SF)")
+                ("from", program_options::value<string>(), "Time of the first scan (YYYYMMDDhhmm, UTC)")
+                ("to", program_options::value<string>(), "Time of the last scan (YYYYMMDDhhmm, UTC)")
+                ("output,o", program_options::value<string>()->default_value("."),
+                 "Directory to write the radolan files to")
+                ("interval", program_options::value<int>()->default_value(0),
+                 "Minutes between scans, 0 for the product's interval")
+                ("seed", program_options::value<unsigned int>()->default_value(defaults.seed),
+                 "Seed of the random numbers")
+                ("wet-fraction", program_options::value<double>()->default_value(defaults.wetFraction),
+                 "Fraction of the cells with rain")
+                ("correlation-length", program_options::value<double>()->default_value(defaults.correlationLength),
+                 "Size of the rain cells in grid cells")
+                ("persistence", program_options::value<double>()->default_value(defaults.persistence),
+                 "Correlation of the rain field with itself 5 minutes earlier")
+                ("motion-x", program_options::value<double>()->default_value(defaults.motionX),
+                 "Motion of the rain field to the east in grid cells per hour")
+                ("motion-y", program_options::value<double>()->default_value(defaults.motionY),
+                 "Motion of the rain field to the north in grid cells per hour")
+                ("rain-rate", program_options::value<double>()->default_value(defaults.rainRateScale),
+                 "Scale of the rain rates in mm/h")
+                ("clutter", program_options::value<double>()->default_value(defaults.clutterFraction),
+                 "Fraction of the cells with permanent clutter")
+                ("outage", program_options::value<double>()->default_value(defaults.outageProbability),
+                 "Probability of a radar to fail at each scan")
+                ("gzip,z", "Write gzip compressed files");
+
+        program_options::variables_map vm;
+        try {
+            program_options::store(program_options::parse_command_line(argc, argv, desc), vm);
+            program_options::notify(vm);
+        } catch (std::exception &e) {
+            cerr << "ERROR:could not parse command line:" << e.what() << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        if (vm.count("version") != 0) {
+            cout << Radolan::VERSION << endl;
+            exit(EXIT_SUCCESS);
+        }
+
+        if (vm.count("help") != 0 || argc < 2 || vm.count("from") == 0) {
+            cout << desc << "\n";
+            exit(EXIT_SUCCESS);
+        }
+
+        time_t from, to;
+        if (!parseTime(vm["from"].as<string>(), from)) {
+            cerr << "FATAL:Time of the first scan must be given as YYYYMMDDhhmm" << endl;
+            exit(EXIT_FAILURE);
+        }
+        to = from;
+        if (vm.count("to") != 0 && !parseTime(vm["to"].as<string>(), to)) {
+            cerr << "FATAL:Time of the last scan must be given as YYYYMMDDhhmm" << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        string directory = vm["output"].as<string>();
+        if (!fs::is_directory(fs::path(directory))) {
+            cerr << "FATAL:Output directory does not exist: " << directory << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        RDSyntheticOptions options = rdSyntheticOptions(RDScanTypeFromString(vm["product"].as<string>().c_str()));
+        options.intervalMinutes = vm["interval"].as<int>();
+        options.seed = vm["seed"].as<unsigned int>();
+        options.wetFraction = vm["wet-fraction"].as<double>();
+        options.correlationLength = vm["correlation-length"].as<double>();
+        options.persistence = vm["persistence"].as<double>();
+        options.motionX = vm["motion-x"].as<double>();
+        options.motionY = vm["motion-y"].as<double>();
+        options.rainRateScale = vm["rain-rate"].as<double>();
+        options.clutterFraction = vm["clutter"].as<double>();
+        options.outageProbability = vm["outage"].as<double>();
+
+        RDSyntheticGenerator generator(options);
+        vector<string> paths = generator.writeFiles(directory.c_str(), from, to, vm.count("gzip") != 0);
+        cout << "Wrote " << paths.size() << " files to " << directory << endl;
+
+    } catch (const std::exception &e) {
+        cerr << "FATAL:exception: " << e.what() << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
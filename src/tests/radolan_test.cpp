@@ -3,9 +3,17 @@
 #include <radolan/radolan.h>
 #include <radolan/radolan_utils.h>
 
+#include <algorithm>
+#include <math.h>
 #include <stdlib.h>
 #include <ctime>
+#include <dirent.h>
+#include <signal.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <zlib.h>
 
 using namespace Radolan;
 
@@ -100,6 +108,2349 @@ bool testCoordinateSystem(RDScanType type)
     return !failed;
 }
 
+bool testRegions()
+{
+    bool failed = false;
+    
+    // a 3x3 block of class 0 with a hole in the middle and
+    // a single cell of class 1 in the corner
+    int classes[16] = {
+        0, 0, 0, -1,
+        0, -1, 0, -1,
+        0, 0, 0, -1,
+        -1, -1, -1, 1
+    };
+    
+    RDRegions regions;
+    int count = RDLabelRegions(classes, 4, 4, regions);
+    if (count != 2 || regions.regionSize[0] != 8 || regions.regionSize[1] != 1)
+    {
+        fprintf(stderr, "FAILED:wrong regions\n");
+        failed = true;
+    }
+    
+    std::vector< std::vector<RDRing> > rings;
+    RDTraceRegionBoundaries(regions, rings);
+    if (rings[0].size() != 2 || RDIsHole(rings[0][0]) == RDIsHole(rings[0][1]))
+    {
+        fprintf(stderr, "FAILED:expected outer ring and hole\n");
+        failed = true;
+    }
+    
+    // 4 corners plus closing vertex
+    if (rings[1].size() != 1 || rings[1][0].size() != 5)
+    {
+        fprintf(stderr, "FAILED:expected single square ring\n");
+        failed = true;
+    }
+    
+    return !failed;
+}
+
+bool testScanTime()
+{
+    bool failed = false;
+    
+    // 12 Feb 2009 00:00 UTC, as in raa01-rx_10000-0902120000-dwd---bin
+    RDScan* scan = RDAllocateScan();
+    memset(&scan->header, 0, sizeof(scan->header));
+    scan->data = NULL;
+    scan->header.scanType = RD_RX;
+    scan->header.year = 9;
+    scan->header.month = 2;
+    scan->header.day = 12;
+    
+    time_t time = RDScanTimeInSecondsSinceEpoch(scan);
+    if (time != 1234396800)
+    {
+        fprintf(stderr, "FAILED:scan time is %ld instead of 1234396800\n", (long) time);
+        failed = true;
+    }
+    
+    char* fn = RDGuessFilename(RD_RX, time);
+    if (strcmp(fn, "raa01-rx_10000-0902120000-dwd---bin") != 0)
+    {
+        fprintf(stderr, "FAILED:wrong file name %s\n", fn);
+        failed = true;
+    }
+    free(fn);
+    
+    RDFreeScan(scan);
+    
+    return !failed;
+}
+
+RDScan* makeAccumulationScan(int day, int month, int hour, int minute, float a, float b)
+{
+    RDScan* scan = RDAllocateScan();
+    scan->dimLon = 2;
+    scan->dimLat = 1;
+    scan->header.scanType = RD_RY;
+    scan->header.precision = 0.01f;
+    scan->header.intervalDuration = 5;
+    scan->header.year = 14;
+    scan->header.month = month;
+    scan->header.day = day;
+    scan->header.hour = hour;
+    scan->header.minute = minute;
+    scan->data = (RDDataType*) malloc(2 * sizeof(RDDataType));
+    scan->data[0] = a;
+    scan->data[1] = b;
+    return scan;
+}
+
+bool testAccumulator()
+{
+    bool failed = false;
+    
+    // across a month boundary, with one missing scan (00:00) and
+    // one missing cell
+    RDScan* scans[3] = {
+        makeAccumulationScan(31, 1, 23, 50, 0.01f, 0.5f),
+        makeAccumulationScan(31, 1, 23, 55, 0.02f, RD_ERROR_VALUE),
+        makeAccumulationScan(1, 2, 0, 5, 0.03f, 0.5f)
+    };
+    
+    RDAccumulator zero(RD_SUM_INTEGER, RD_INVALID_AS_ZERO, RD_INVALID_AS_ZERO);
+    RDAccumulator scaled(RD_SUM_FLOAT, RD_INVALID_SCALED, RD_INVALID_SCALED);
+    for (int i = 0; i < 3; i++)
+    {
+        zero.ingest(scans[i]);
+        scaled.ingest(scans[i]);
+    }
+    
+    RDScan* totals = zero.totals();
+    if (zero.expectedScanCount() != 4 || totals->data[0] != 0.06f || totals->data[1] != 1.0f)
+    {
+        fprintf(stderr, "FAILED:wrong totals with RD_INVALID_AS_ZERO\n");
+        failed = true;
+    }
+    RDFreeScan(totals);
+    
+    totals = scaled.totals();
+    if (fabs(totals->data[0] - 0.08f) > 1e-6 || fabs(totals->data[1] - 2.0f) > 1e-6)
+    {
+        fprintf(stderr, "FAILED:wrong totals with RD_INVALID_SCALED\n");
+        failed = true;
+    }
+    RDFreeScan(totals);
+    
+    try
+    {
+        zero.ingest(scans[1]);
+        fprintf(stderr, "FAILED:accepted scan out of order\n");
+        failed = true;
+    }
+    catch (const RDConversionException &)
+    {
+    }
+    
+    for (int i = 0; i < 3; i++)
+    {
+        RDFreeScan(scans[i]);
+    }
+    
+    return !failed;
+}
+
+bool testRainrate()
+{
+    bool failed = false;
+    
+    // Z = 256 mm^6/m^3 is 1 mm/h with the DWD relationship
+    float dbz = 10.0f * log10f(256.0f);
+    if (fabs(RDRainrateFromDezibels(dbz) - 1.0f) > 1e-4)
+    {
+        fprintf(stderr, "FAILED:wrong rain rate from RDRainrateFromDezibels\n");
+        failed = true;
+    }
+    
+    RDDataType values[4] = { 24.0f, RD_DBZ_BASEVALUE, 92.0f, RD_DBZ_OUTSIDEVALUE };
+    RDDataType rates[4];
+    RDRainrateFromReflectivity(values, 4, rdZRRelation(), rates);
+    if (fabs(rates[0] - RDRainrateFromDezibels(24.0f)) > 1e-5 
+        || rates[1] < 0 || rates[2] != RD_CLUTTER_VALUE || rates[3] != RD_ERROR_VALUE)
+    {
+        fprintf(stderr, "FAILED:wrong rain rates from RDRainrateFromReflectivity\n");
+        failed = true;
+    }
+    
+    // 0.5 mm in 5 minutes
+    RDScan* scan = makeAccumulationScan(1, 6, 12, 0, 0.5f, RD_ERROR_VALUE);
+    RDConvertPrecipitation(scan, RD_MM_PER_HOUR, scan->data);
+    if (scan->data[0] != 6.0f || scan->data[1] != RD_ERROR_VALUE)
+    {
+        fprintf(stderr, "FAILED:wrong conversion to mm/h\n");
+        failed = true;
+    }
+    RDFreeScan(scan);
+
+    // per value and grid-wide conversion agree
+    RDScanType types[3] = { RD_RY, RD_RW, RD_SF };
+    for (int t = 0; t < 3; t++)
+    {
+        scan = makeAccumulationScan(1, 6, 12, 0, 0.5f, RD_CLUTTER_VALUE);
+        scan->header.scanType = types[t];
+        scan->header.intervalDuration = RDIntervalDuration(types[t]);
+        RDDataType converted[2];
+        RDConvertPrecipitation(scan, RD_MM_PER_HOUR, converted);
+        for (int i = 0; i < 2; i++)
+        {
+            if (fabs(converted[i] - RDMMPerHour(types[t], scan->data[i])) > 1e-6)
+            {
+                fprintf(stderr, "FAILED:RDMMPerHour differs from RDConvertPrecipitation for %s\n",
+                        RDScanTypeToString(types[t]));
+                failed = true;
+            }
+        }
+        RDFreeScan(scan);
+    }
+
+    return !failed;
+}
+
+bool testStatistics()
+{
+    bool failed = false;
+    
+    // 150 mm lies beyond the fine steps at a resolution of 0.001
+    // and above the histogram
+    RDDataType values[6] = { 0.0f, 0.5f, 2.0f, 150.0f, RD_ERROR_VALUE, RD_CLUTTER_VALUE };
+    RDScan* scan = RDAllocateScan();
+    scan->dimLon = 3;
+    scan->dimLat = 2;
+    scan->header.scanType = RD_RW;
+    scan->header.precision = 0.1f;
+    scan->data = values;
+    
+    RDStatisticsOptions options = rdStatisticsOptions();
+    options.resolution = 0.001;
+    RDScanStatistics s = RDComputeStatistics(scan, options);
+    if (s.validCount != 4 || s.missingCount != 1 || s.clutterCount != 1 || s.aboveHistogram != 1
+        || fabs(s.mean - 38.125) > 1e-6 || s.max != 150.0
+        || fabs(s.quantiles[0] - 0.5) > 1e-6 || s.quantiles[2] != 150.0)
+    {
+        fprintf(stderr, "FAILED:wrong statistics\n");
+        failed = true;
+    }
+    
+    // negative values of signed products are valid
+    values[0] = -1.5f;
+    scan->header.scanType = RD_RD;
+    s = RDComputeStatistics(scan, rdStatisticsOptions());
+    if (s.validCount != 4 || s.missingCount != 1 || fabs(s.min + 1.5) > 1e-6 || s.belowHistogram != 1)
+    {
+        fprintf(stderr, "FAILED:wrong statistics of signed product\n");
+        failed = true;
+    }
+    
+    scan->data = NULL;
+    RDFreeScan(scan);
+    
+    return !failed;
+}
+
+bool testCells()
+{
+    bool failed = false;
+    
+    // two cells touching diagonally, clutter in between
+    RDDataType values[12] = {
+        50, 50, 0, 0,
+        0, 48, 92, 0,
+        0, 0, 47, 55
+    };
+    RDScan* scan = RDAllocateScan();
+    scan->dimLon = 4;
+    scan->dimLat = 3;
+    scan->header.scanType = RD_RX;
+    scan->data = values;
+    
+    RDCellOptions options = rdCellOptions();
+    options.minimumArea = 1;
+    options.connectivity = 4;
+    RDRainCells cells;
+    if (RDLabelCells(scan, options, cells) != 2 || cells.cells[0].area != 3
+        || cells.cells[1].maximum != 55 || cells.cells[1].maximumX != 3)
+    {
+        fprintf(stderr, "FAILED:wrong 4-connected cells\n");
+        failed = true;
+    }
+    
+    options.connectivity = 8;
+    if (RDLabelCells(scan, options, cells) != 1 || cells.cells[0].area != 5
+        || cells.cells[0].maxX != 3 || cells.cells[0].maxY != 2
+        || fabs(cells.cells[0].centroidX - 1.4) > 1e-9 || cells.labels[6] != -1)
+    {
+        fprintf(stderr, "FAILED:wrong 8-connected cells\n");
+        failed = true;
+    }
+    
+    scan->data = NULL;
+    RDFreeScan(scan);
+    
+    return !failed;
+}
+
+bool testScanCube()
+{
+    bool failed = false;
+    
+    RDScan* scans[3] = {
+        makeAccumulationScan(31, 1, 23, 50, 0.01f, 0.5f),
+        makeAccumulationScan(31, 1, 23, 55, 0.02f, RD_ERROR_VALUE),
+        makeAccumulationScan(1, 2, 0, 5, 0.03f, RD_CLUTTER_VALUE)
+    };
+    
+    RDCompactCube cube;
+    for (int i = 0; i < 3; i++)
+    {
+        cube.append(scans[i]);
+    }
+    
+    if (cube.size() != 3 || (size_t) cube.data() % 64 != 0
+        || cube.find(RDScanTimeInSecondsSinceEpoch(scans[2])) != 2 || cube.find(0) != -1)
+    {
+        fprintf(stderr, "FAILED:wrong scan cube index\n");
+        failed = true;
+    }
+    
+    RDCubeView<uint16_t> series = cube.series(1, 0);
+    if (series.times != 3 || series.at(0, 0, 0) != 50 || series.at(1, 0, 0) != RD_CUBE_MISSING
+        || series.at(2, 0, 0) != RD_CUBE_CLUTTER || cube.value(2, 0, 0) != 0.03f
+        || cube.value(2, 1, 0) != RD_CLUTTER_VALUE)
+    {
+        fprintf(stderr, "FAILED:wrong scan cube values\n");
+        failed = true;
+    }
+    
+    for (int i = 0; i < 3; i++)
+    {
+        RDFreeScan(scans[i]);
+    }
+    
+    return !failed;
+}
+
+bool testWriteScan(RDScanType type, bool compress)
+{
+    bool failed = false;
+    
+    RDSyntheticOptions options = rdSyntheticOptions(type);
+    RDSyntheticGenerator generator(options);
+    RDScan* original = generator.generate(1500000000);
+    
+    char filename[] = "/tmp/radolan_test_XXXXXX";
+    int fd = mkstemp(filename);
+    close(fd);
+    
+    RDScan* copy = RDAllocateScan();
+    copy->data = NULL;
+    if (!RDWriteScan(filename, original, compress) || !RDReadScan(filename, copy, false))
+    {
+        fprintf(stderr, "FAILED:could not write and read back scan\n");
+        failed = true;
+    }
+    else
+    {
+        size_t cells = (size_t) original->dimLon * original->dimLat;
+        size_t wrong = 0;
+        for (size_t i = 0; i < cells; i++)
+        {
+            if (fabs(copy->data[i] - original->data[i]) > 1e-4) wrong++;
+        }
+        if (wrong != 0 || copy->header.scanType != type
+            || RDScanTimeInSecondsSinceEpoch(copy) != 1500000000
+            || strcmp(copy->header.radarStations, original->header.radarStations) != 0)
+        {
+            fprintf(stderr, "FAILED:scan read back differs in %zu cells\n", wrong);
+            failed = true;
+        }
+    }
+    unlink(filename);
+    
+    RDFreeScan(copy);
+    RDFreeScan(original);
+    
+    return !failed;
+}
+
+bool testBitRound()
+{
+    bool failed = false;
+    
+    // values on the 0.01 grid of RW, some negative and some tiny
+    const size_t count = 10000;
+    std::vector<RDDataType> values(count);
+    srand(42);
+    for (size_t i = 0; i < count; i++)
+    {
+        values[i] = (rand() % 100000 - 20000) * 0.01f;
+    }
+    values[1] = 0.0001f;
+    values[2] = RDMissingValue(RD_RW);
+    std::vector<RDDataType> rounded(values);
+    
+    if (RDBitRound(&rounded[0], count, 0.01f, RDMissingValue(RD_RW)) <= 0)
+    {
+        fprintf(stderr, "FAILED:RDBitRound kept no bits\n");
+        failed = true;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i == 2) continue;
+        if (fabs(rounded[i] - values[i]) > 0.005 
+            || roundf(rounded[i] / 0.01f) != roundf(values[i] / 0.01f))
+        {
+            fprintf(stderr, "FAILED:RDBitRound changed %f to %f\n", values[i], rounded[i]);
+            failed = true;
+            break;
+        }
+    }
+    if (rounded[2] != RDMissingValue(RD_RW))
+    {
+        fprintf(stderr, "FAILED:RDBitRound changed the missing value\n");
+        failed = true;
+    }
+    
+    return !failed;
+}
+
+bool testCellCentres()
+{
+    bool failed = false;
+    
+    RDSyntheticGenerator generator(rdSyntheticOptions(RD_RX));
+    RDScan* scan = generator.generate(1500000000);
+    const RDGridGeometry* grid = RDGridGeometry::forScan(scan);
+    
+    // the lower left corner of the grid is at (-523.4622, -4658.6447) km
+    if (fabs(grid->cornerX()[0] + 523.4622) > 1e-3 || fabs(grid->cornerY()[0] + 4658.6447) > 1e-3
+        || fabs(grid->centreX()[0] - grid->cornerX()[0] - 0.5) > 1e-9
+        || fabs(grid->centreY()[0] - grid->cornerY()[0] - 0.5) > 1e-9)
+    {
+        fprintf(stderr, "FAILED:wrong cell corner or centre\n");
+        failed = true;
+    }
+    
+    // the NetCDF axes are the cell centres
+    char filename[] = "/tmp/radolan_test_XXXXXX";
+    int fd = mkstemp(filename);
+    close(fd);
+    delete Radolan2NetCDF::convertScan(scan, filename, true, NULL, netCDF::NcFile::replace);
+    
+    netCDF::NcFile file(filename, netCDF::NcFile::read);
+    std::vector<double> x(scan->dimLon), y(scan->dimLat);
+    file.getVar("x").getVar(&x[0]);
+    file.getVar("y").getVar(&y[0]);
+    file.close();
+    unlink(filename);
+    
+    for (int i = 0; i < scan->dimLon; i++)
+    {
+        if (x[i] != grid->centreX()[i])
+        {
+            fprintf(stderr, "FAILED:NetCDF x axis differs from cell centre %d\n", i);
+            failed = true;
+            break;
+        }
+    }
+    for (int i = 0; i < scan->dimLat; i++)
+    {
+        if (y[i] != grid->centreY()[i])
+        {
+            fprintf(stderr, "FAILED:NetCDF y axis differs from cell centre %d\n", i);
+            failed = true;
+            break;
+        }
+    }
+    
+    RDFreeScan(scan);
+    
+    return !failed;
+}
+
+bool testCombineProducts()
+{
+    bool failed = false;
+    
+    char directory[] = "/tmp/radolan_test_XXXXXX";
+    mkdtemp(directory);
+    
+    // RX and RW of the same hour go into one file
+    std::vector<std::string> paths;
+    RDScanType types[2] = { RD_RX, RD_RW };
+    for (int t = 0; t < 2; t++)
+    {
+        RDSyntheticGenerator generator(rdSyntheticOptions(types[t]));
+        std::vector<std::string> written = generator.writeFiles(directory, 1500001200, 1500001200);
+        paths.insert(paths.end(), written.begin(), written.end());
+    }
+    
+    std::vector<std::string> files = Radolan2NetCDF::convertFilesByTimestamp(paths, directory, false, NULL, false);
+    if (files.size() != 1 || files[0] != std::string(directory) + "/radolan-1707140300.nc")
+    {
+        fprintf(stderr, "FAILED:expected one combined file\n");
+        failed = true;
+    }
+    else
+    {
+        netCDF::NcFile file(files[0], netCDF::NcFile::read);
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            RDScan* scan = RDAllocateScan();
+            scan->data = NULL;
+            RDReadScan(paths[i].c_str(), scan, false);
+            
+            netCDF::NcVar var = file.getVar(RDScanTypeToString(scan->header.scanType));
+            std::vector<float> values((size_t) scan->dimLon * scan->dimLat);
+            if (!var.isNull())
+            {
+                var.getVar(&values[0]);
+            }
+            if (var.isNull() || memcmp(&values[0], scan->data, values.size() * sizeof(float)) != 0)
+            {
+                fprintf(stderr, "FAILED:wrong %s variable in combined file\n",
+                        RDScanTypeToString(scan->header.scanType));
+                failed = true;
+            }
+            RDFreeScan(scan);
+        }
+        file.close();
+    }
+    
+    for (size_t i = 0; i < paths.size(); i++) unlink(paths[i].c_str());
+    for (size_t i = 0; i < files.size(); i++) unlink(files[i].c_str());
+    rmdir(directory);
+    
+    return !failed;
+}
+
+bool testGridGeometryCache()
+{
+    bool failed = false;
+    
+    // EZ and EX have the same size, but not the same grid
+    RDScan* scans[2] = { RDAllocateScan(), RDAllocateScan() };
+    scans[0]->header.scanType = RD_EZ;
+    scans[1]->header.scanType = RD_EX;
+    for (int i = 0; i < 2; i++)
+    {
+        scans[i]->data = NULL;
+        RDScanDimensions(scans[i]->header.scanType, &scans[i]->dimLon, &scans[i]->dimLat);
+    }
+    
+    for (int round = 0; round < 4; round++)
+    {
+        RDScan* scan = scans[round % 2];
+        RDCoordinateSystem rcs(scan->header.scanType);
+        RDCartesianPoint lowerLeft = rcs.cartesianCornerCoordinate(rdGridPoint(0, 0));
+        RDCartesianPoint upperRight = rcs.cartesianCornerCoordinate(rdGridPoint(scan->dimLon, scan->dimLat));
+        
+        const RDGridGeometry* grid = RDGridGeometry::forScan(scan);
+        if (grid->cornerX()[0] != lowerLeft.x || grid->cornerY()[0] != lowerLeft.y
+            || grid->cornerX()[scan->dimLon] != upperRight.x || grid->cornerY()[scan->dimLat] != upperRight.y)
+        {
+            fprintf(stderr, "FAILED:wrong corners of the %s grid\n", RDScanTypeToString(scan->header.scanType));
+            failed = true;
+        }
+    }
+    
+    // the lower left corner of the extended grid is at (-673.4622, -5008.6447) km
+    const RDGridGeometry* grid = RDGridGeometry::forScan(scans[1]);
+    if (fabs(grid->cornerX()[0] + 673.4622) > 1e-3 || fabs(grid->cornerY()[0] + 5008.6447) > 1e-3
+        || grid == RDGridGeometry::forScan(scans[0]))
+    {
+        fprintf(stderr, "FAILED:wrong extended grid\n");
+        failed = true;
+    }
+    
+    RDFreeScan(scans[0]);
+    RDFreeScan(scans[1]);
+    
+    return !failed;
+}
+
+uint64_t readLittleEndian(const std::vector<uint8_t> &bytes, size_t position, int size)
+{
+    uint64_t value = 0;
+    for (int i = size - 1; i >= 0; i--)
+    {
+        value = (value << 8) | bytes[position + i];
+    }
+    return value;
+}
+
+double readDouble(const std::vector<uint8_t> &bytes, size_t position)
+{
+    uint64_t bits = readLittleEndian(bytes, position, 8);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+bool testFlatGeobuf()
+{
+    bool failed = false;
+    
+    // 20x10 cells, every seventh one missing
+    RDScan* scan = RDAllocateScan();
+    scan->dimLon = 20;
+    scan->dimLat = 10;
+    scan->header.scanType = RD_RX;
+    scan->data = (RDDataType*) malloc(200 * sizeof(RDDataType));
+    uint64_t expected = 0;
+    for (int i = 0; i < 200; i++)
+    {
+        scan->data[i] = i % 7 == 0 ? 92.5f : i * 0.25f;
+        if (i % 7 != 0) expected++;
+    }
+    
+    char filename[] = "/tmp/radolan_test_XXXXXX";
+    int fd = mkstemp(filename);
+    close(fd);
+    Radolan2FlatGeobuf::convertToPolygons(scan, filename);
+    
+    std::vector<uint8_t> bytes;
+    FILE* file = fopen(filename, "rb");
+    int c;
+    while ((c = fgetc(file)) != EOF) bytes.push_back((uint8_t) c);
+    fclose(file);
+    unlink(filename);
+    
+    // the header is a size prefixed flatbuffer after the magic bytes
+    const uint8_t magic[8] = { 0x66, 0x67, 0x62, 0x03, 0x66, 0x67, 0x62, 0x00 };
+    if (bytes.size() < 12 || memcmp(&bytes[0], magic, 8) != 0)
+    {
+        fprintf(stderr, "FAILED:no FlatGeobuf magic bytes\n");
+        RDFreeScan(scan);
+        return false;
+    }
+    size_t header = 12;
+    size_t table = header + readLittleEndian(bytes, header, 4);
+    size_t vtable = table - (int32_t) readLittleEndian(bytes, table, 4);
+    size_t countField = readLittleEndian(bytes, vtable + 4 + 2 * 8, 2);
+    size_t nodeSizeField = readLittleEndian(bytes, vtable + 4 + 2 * 9, 2);
+    uint64_t count = countField ? readLittleEndian(bytes, table + countField, 8) : 0;
+    uint64_t nodeSize = nodeSizeField ? readLittleEndian(bytes, table + nodeSizeField, 2) : 0;
+    if (count != expected || nodeSize != 16)
+    {
+        fprintf(stderr, "FAILED:wrong FlatGeobuf header\n");
+        failed = true;
+    }
+    
+    // packed R-tree: root first, leaves last
+    uint64_t nodes = count;
+    for (uint64_t n = count; n > 1; )
+    {
+        n = (n + 15) / 16;
+        nodes += n;
+    }
+    size_t index = header + readLittleEndian(bytes, 8, 4);
+    size_t features = index + nodes * 40;
+    double rootMinX = readDouble(bytes, index);
+    double rootMaxY = readDouble(bytes, index + 24);
+    
+    uint64_t offset = 0;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        size_t leaf = index + (nodes - count + i) * 40;
+        size_t feature = features + readLittleEndian(bytes, leaf + 32, 8);
+        if (readLittleEndian(bytes, leaf + 32, 8) != offset || feature + 4 > bytes.size()
+            || readDouble(bytes, leaf) < rootMinX || readDouble(bytes, leaf + 24) > rootMaxY)
+        {
+            fprintf(stderr, "FAILED:wrong FlatGeobuf index entry %lu\n", (unsigned long) i);
+            failed = true;
+            break;
+        }
+        offset += 4 + readLittleEndian(bytes, feature, 4);
+    }
+    if (!failed && features + offset != bytes.size())
+    {
+        fprintf(stderr, "FAILED:FlatGeobuf features don't end with the file\n");
+        failed = true;
+    }
+    
+    RDFreeScan(scan);
+    
+    return !failed;
+}
+
+std::string readTextFile(const char* filename)
+{
+    std::string text;
+    FILE* file = fopen(filename, "r");
+    int c;
+    while (file != NULL && (c = fgetc(file)) != EOF) text += (char) c;
+    if (file != NULL) fclose(file);
+    return text;
+}
+
+bool testTextExport()
+{
+    bool failed = false;
+    
+    RDDataType values[6] = { 0.0f, 1.5f, RD_ERROR_VALUE, 12.3f, 0.1f, RD_CLUTTER_VALUE };
+    RDScan* scan = RDAllocateScan();
+    scan->dimLon = 3;
+    scan->dimLat = 2;
+    scan->header.scanType = RD_RW;
+    scan->header.precision = 0.1f;
+    scan->data = values;
+    
+    char filename[] = "/tmp/radolan_test_XXXXXX";
+    int fd = mkstemp(filename);
+    close(fd);
+    
+    RDTextOptions options = rdTextOptions();
+    options.skipMissing = true;
+    Radolan2Text::convertToCSV(scan, filename, options);
+    if (readTextFile(filename) != 
+        "ix,iy,x,y,value\n"
+        "0,0,-522.962,-4658.145,0.0\n"
+        "1,0,-521.962,-4658.145,1.5\n"
+        "0,1,-522.962,-4657.145,12.3\n"
+        "1,1,-521.962,-4657.145,0.1\n")
+    {
+        fprintf(stderr, "FAILED:wrong CSV output\n");
+        failed = true;
+    }
+    
+    options.skipMissing = false;
+    options.geographic = true;
+    options.separator = '\t';
+    Radolan2Text::convertToXYZ(scan, filename, options);
+    std::string lines = "3.594321\t46.957191\t0.0\n"
+                        "3.606468\t46.958121\t1.5\n";
+    if (readTextFile(filename).compare(0, lines.size(), lines) != 0)
+    {
+        fprintf(stderr, "FAILED:wrong XYZ output\n");
+        failed = true;
+    }
+    
+    // rows run from north to south
+    Radolan2Text::convertToASCIIGrid(scan, filename);
+    if (readTextFile(filename) != 
+        "ncols 3\n"
+        "nrows 2\n"
+        "xllcorner -523.462167\n"
+        "yllcorner -4658.644750\n"
+        "cellsize 1.000000\n"
+        "NODATA_value -9999\n"
+        "12.3 0.1 -9999\n"
+        "0.0 1.5 -9999\n")
+    {
+        fprintf(stderr, "FAILED:wrong ASCII grid output\n");
+        failed = true;
+    }
+    unlink(filename);
+    
+    scan->data = NULL;
+    RDFreeScan(scan);
+    
+    return !failed;
+}
+
+bool testSlidingWindow()
+{
+    bool failed = false;
+    
+    // 5 minute scans of two cells with a gap of one scan, a gap of four
+    // scans and missing cells, checked against sums and maxima over the
+    // raw values of the last scans
+    std::vector<int> windows;
+    windows.push_back(15);
+    windows.push_back(60);
+    RDSlidingWindow zero(windows, 5, true, RD_INVALID_AS_ZERO);
+    RDSlidingWindow missing(windows, 5, false, RD_INVALID_AS_MISSING);
+    RDDataType missingValue = RDMissingValue(RD_RY);
+    
+    std::vector<int> history[2];
+    unsigned int seed = 7;
+    for (int slot = 0; slot < 60 && !failed; slot++)
+    {
+        if (slot == 10 || (slot >= 30 && slot < 34))
+        {
+            history[0].push_back(-1);
+            history[1].push_back(-1);
+            continue;
+        }
+        
+        float values[2];
+        for (int c = 0; c < 2; c++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            int raw = (int) ((seed >> 16) % 500);
+            if (raw < 25) raw = -1;
+            history[c].push_back(raw);
+            values[c] = raw < 0 ? RD_ERROR_VALUE : raw * 0.01f;
+        }
+        RDScan* scan = makeAccumulationScan(1, 3, slot * 5 / 60, slot * 5 % 60, values[0], values[1]);
+        zero.ingest(scan);
+        missing.ingest(scan);
+        RDFreeScan(scan);
+        
+        for (size_t w = 0; w < windows.size() && !failed; w++)
+        {
+            int length = windows[w] / 5;
+            RDScan* total = zero.total(w);
+            RDScan* maximum = zero.maximum(w);
+            RDScan* strict = missing.total(w);
+            
+            for (int c = 0; c < 2; c++)
+            {
+                int sum = 0;
+                int max = -1;
+                bool incomplete = false;
+                for (int s = slot - length + 1; s <= slot; s++)
+                {
+                    if (s < 0 || history[c][s] < 0)
+                    {
+                        incomplete = true;
+                        continue;
+                    }
+                    sum += history[c][s];
+                    if (history[c][s] > max) max = history[c][s];
+                }
+                
+                if (fabs(total->data[c] - sum * 0.01) > 1e-3)
+                {
+                    fprintf(stderr, "FAILED:total of %d min at slot %d cell %d is %f, expected %f\n",
+                            windows[w], slot, c, total->data[c], sum * 0.01);
+                    failed = true;
+                }
+                
+                RDDataType expectedMaximum = max < 0 ? missingValue : max * 0.01f;
+                if (fabs(maximum->data[c] - expectedMaximum) > 1e-4)
+                {
+                    fprintf(stderr, "FAILED:maximum of %d min at slot %d cell %d is %f, expected %f\n",
+                            windows[w], slot, c, maximum->data[c], expectedMaximum);
+                    failed = true;
+                }
+                
+                RDDataType expectedStrict = incomplete ? missingValue : (RDDataType) (sum * 0.01);
+                if (fabs(strict->data[c] - expectedStrict) > 1e-3)
+                {
+                    fprintf(stderr, "FAILED:strict total of %d min at slot %d cell %d is %f, expected %f\n",
+                            windows[w], slot, c, strict->data[c], expectedStrict);
+                    failed = true;
+                }
+            }
+            
+            RDFreeScan(total);
+            RDFreeScan(maximum);
+            RDFreeScan(strict);
+        }
+    }
+    
+    return !failed;
+}
+
+// compares all results of two climatologies, cell by cell
+bool sameClimatology(const RDClimatology& a, const RDClimatology& b, const char* what)
+{
+    bool failed = a.scanCount() != b.scanCount() || a.firstTime() != b.firstTime() || a.lastTime() != b.lastTime();
+    
+    size_t layers = 4 + a.thresholds().size();
+    for (size_t l = 0; l < layers && !failed; l++)
+    {
+        RDScan* x;
+        RDScan* y;
+        switch (l)
+        {
+            case 0: x = a.mean(); y = b.mean(); break;
+            case 1: x = a.maximum(); y = b.maximum(); break;
+            case 2: x = a.wetFraction(); y = b.wetFraction(); break;
+            case 3: x = a.validCount(); y = b.validCount(); break;
+            default: x = a.exceedanceCount(l - 4); y = b.exceedanceCount(l - 4); break;
+        }
+        for (int i = 0; i < x->dimLon * x->dimLat; i++)
+        {
+            if (fabs(x->data[i] - y->data[i]) > 1e-5) failed = true;
+        }
+        RDFreeScan(x);
+        RDFreeScan(y);
+    }
+    
+    if (failed)
+    {
+        fprintf(stderr, "FAILED:%s differs\n", what);
+    }
+    return !failed;
+}
+
+bool testClimatology()
+{
+    bool failed = false;
+    
+    std::vector<double> thresholds;
+    thresholds.push_back(0.1);
+    thresholds.push_back(1.0);
+    
+    // six scans of two cells, one of them missing twice
+    float values[6][2] = {
+        { 0.0f, 2.5f }, { 0.2f, RD_ERROR_VALUE }, { 1.5f, 0.05f },
+        { 0.04f, 3.0f }, { 0.8f, RD_ERROR_VALUE }, { 2.0f, 0.0f }
+    };
+    RDClimatology all(thresholds, 0.05);
+    RDClimatology first(thresholds, 0.05);
+    RDClimatology second(thresholds, 0.05, 1);
+    for (int s = 0; s < 6; s++)
+    {
+        RDScan* scan = makeAccumulationScan(1, 6, 12, s * 5, values[s][0], values[s][1]);
+        all.ingest(scan);
+        (s < 3 ? first : second).ingest(scan);
+        RDFreeScan(scan);
+    }
+    
+    // cell 0: mean 4.54 / 6, maximum 2.0, wet 4 of 6, above 1.0 twice
+    RDScan* mean = all.mean();
+    RDScan* wet = all.wetFraction();
+    RDScan* above = all.exceedanceCount(1);
+    RDScan* count = all.validCount();
+    if (fabs(mean->data[0] - 4.54 / 6) > 1e-5 || fabs(wet->data[0] - 4.0 / 6) > 1e-5
+        || above->data[0] != 2 || count->data[0] != 6 || count->data[1] != 4)
+    {
+        fprintf(stderr, "FAILED:wrong climatology of the test scans\n");
+        failed = true;
+    }
+    RDFreeScan(mean);
+    RDFreeScan(wet);
+    RDFreeScan(above);
+    RDFreeScan(count);
+    
+    // merging the two halves gives the climatology of all scans
+    first.merge(second);
+    failed = !sameClimatology(first, all, "merged climatology") || failed;
+    
+    char directory[] = "/tmp/radolan_test_XXXXXX";
+    mkdtemp(directory);
+    std::string checkpoint = std::string(directory) + "/climatology.ckpt";
+    
+    // a checkpoint loads into an empty climatology unchanged
+    all.save(checkpoint.c_str());
+    RDClimatology loaded(thresholds, 0.05);
+    loaded.load(checkpoint.c_str());
+    failed = !sameClimatology(loaded, all, "loaded checkpoint") || failed;
+    
+    // checkpoints whose size does not match the header are rejected
+    FILE* f = fopen(checkpoint.c_str(), "rb");
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    for (int c = 0; c < 2; c++)
+    {
+        if (c == 0)
+        {
+            truncate(checkpoint.c_str(), size - 4);
+        }
+        else
+        {
+            truncate(checkpoint.c_str(), size + 4);
+        }
+        RDClimatology rejecting(thresholds, 0.05);
+        try
+        {
+            rejecting.load(checkpoint.c_str());
+            fprintf(stderr, "FAILED:checkpoint of the wrong size was loaded\n");
+            failed = true;
+        }
+        catch (const RDConversionException&)
+        {
+        }
+        if (rejecting.scanCount() != 0)
+        {
+            fprintf(stderr, "FAILED:rejected checkpoint changed the climatology\n");
+            failed = true;
+        }
+    }
+    unlink(checkpoint.c_str());
+    
+    // the NetCDF file holds the same layers
+    std::string netcdfPath = std::string(directory) + "/climatology.nc";
+    netCDF::NcFile* file = Radolan2NetCDF::convertClimatology(all, netcdfPath.c_str());
+    file->close();
+    delete file;
+    
+    netCDF::NcFile reread(netcdfPath, netCDF::NcFile::read);
+    const char* names[3] = { "mean", "valid_count", "exceedance_count" };
+    for (int n = 0; n < 3; n++)
+    {
+        netCDF::NcVar var = reread.getVar(names[n]);
+        std::vector<float> stored(n == 2 ? 4 : 2);
+        if (!var.isNull())
+        {
+            var.getVar(&stored[0]);
+        }
+        for (size_t k = 0; k < stored.size() / 2 && !var.isNull(); k++)
+        {
+            RDScan* layer = n == 0 ? all.mean() : (n == 1 ? all.validCount() : all.exceedanceCount(k));
+            if (fabs(stored[2 * k] - layer->data[0]) > 1e-5 || fabs(stored[2 * k + 1] - layer->data[1]) > 1e-5)
+            {
+                fprintf(stderr, "FAILED:wrong %s in the NetCDF file\n", names[n]);
+                failed = true;
+            }
+            RDFreeScan(layer);
+        }
+        if (var.isNull())
+        {
+            fprintf(stderr, "FAILED:no %s in the NetCDF file\n", names[n]);
+            failed = true;
+        }
+    }
+    
+    double bounds[2] = { 0, 0 };
+    netCDF::NcVar boundsVar = reread.getVar("climatology_bounds");
+    if (!boundsVar.isNull())
+    {
+        boundsVar.getVar(bounds);
+    }
+    if (bounds[0] != (double) all.firstTime() || bounds[1] != (double) all.lastTime())
+    {
+        fprintf(stderr, "FAILED:wrong climatology bounds in the NetCDF file\n");
+        failed = true;
+    }
+    reread.close();
+    
+    unlink(netcdfPath.c_str());
+    rmdir(directory);
+    
+    return !failed;
+}
+
+bool testQuantileSketch()
+{
+    bool failed = false;
+    
+    // 1000 RY scans of 600 cells (more than one block per thread), a
+    // third of the values dry and the rest exponentially distributed
+    const int cells = 600;
+    const int scans = 1000;
+    std::vector<float> values((size_t) scans * cells);
+    unsigned int seed = 11;
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        double u = ((seed >> 8) + 0.5) / 16777216.0;
+        values[i] = u < 1.0 / 3 ? 0.0f : (float) (floor(-200.0 * log(1.5 * (1.0 - u)) + 0.5) * 0.01);
+    }
+    
+    // two halves merged, once on one thread and once on four
+    RDQuantileSketch single(50.0, 64, 1);
+    RDQuantileSketch singleRest(50.0, 64, 1);
+    RDQuantileSketch threaded(50.0, 64, 4);
+    RDQuantileSketch threadedRest(50.0, 64, 4);
+    RDScan* scan = makeAccumulationScan(1, 7, 0, 0, 0, 0);
+    free(scan->data);
+    scan->dimLon = cells;
+    for (int s = 0; s < scans; s++)
+    {
+        scan->data = &values[(size_t) s * cells];
+        (s < scans / 2 ? single : singleRest).ingest(scan);
+        (s < scans / 2 ? threaded : threadedRest).ingest(scan);
+    }
+    scan->data = NULL;
+    RDFreeScan(scan);
+    single.merge(singleRest);
+    threaded.merge(threadedRest);
+    
+    double levels[2] = { 0.5, 0.99 };
+    for (int l = 0; l < 2; l++)
+    {
+        RDScan* estimate = single.quantile(levels[l]);
+        RDScan* other = threaded.quantile(levels[l]);
+        if (memcmp(estimate->data, other->data, cells * sizeof(RDDataType)) != 0)
+        {
+            fprintf(stderr, "FAILED:p%g depends on the number of threads\n", levels[l] * 100);
+            failed = true;
+        }
+        
+        // the estimate must lie within 1% of the level in rank
+        int worst = -1;
+        for (int c = 0; c < cells; c++)
+        {
+            int below = 0;
+            int atOrBelow = 0;
+            for (int s = 0; s < scans; s++)
+            {
+                float v = values[(size_t) s * cells + c];
+                if (v < estimate->data[c]) below++;
+                if (v <= estimate->data[c]) atOrBelow++;
+            }
+            if (below > (levels[l] + 0.01) * scans || atOrBelow < (levels[l] - 0.01) * scans)
+            {
+                worst = c;
+            }
+        }
+        if (worst >= 0)
+        {
+            fprintf(stderr, "FAILED:p%g of cell %d is %f, off by more than 1%% in rank\n",
+                    levels[l] * 100, worst, estimate->data[worst]);
+            failed = true;
+        }
+        RDFreeScan(estimate);
+        RDFreeScan(other);
+    }
+    
+    return !failed;
+}
+
+// 256x256 RY scan of Gaussian blobs, shifted by (shiftX, shiftY) cells
+RDScan* makeBlobScan(int minute, int shiftX, int shiftY)
+{
+    RDScan* scan = makeAccumulationScan(1, 8, 12, minute, 0, 0);
+    free(scan->data);
+    scan->dimLon = 256;
+    scan->dimLat = 256;
+    scan->data = (RDDataType*) calloc(256 * 256, sizeof(RDDataType));
+    
+    unsigned int seed = 5;
+    for (int b = 0; b < 60; b++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        double cx = (seed >> 16) % 256 + shiftX;
+        seed = seed * 1103515245u + 12345u;
+        double cy = (seed >> 16) % 256 + shiftY;
+        for (int iy = 0; iy < 256; iy++)
+        {
+            for (int ix = 0; ix < 256; ix++)
+            {
+                double r2 = (ix - cx) * (ix - cx) + (iy - cy) * (iy - cy);
+                scan->data[iy * 256 + ix] += (RDDataType) (5.0 * exp(-r2 / 32.0));
+            }
+        }
+    }
+    return scan;
+}
+
+bool testMotion()
+{
+    bool failed = false;
+    
+    // a shift of (3,-2) cells in 5 minutes on the 1 km grid is 36 km/h
+    // along x and -24 km/h along y
+    RDScan* previous = makeBlobScan(0, 0, 0);
+    RDScan* current = makeBlobScan(5, 3, -2);
+    RDMotionOptions options = rdMotionOptions();
+    options.threads = 2;
+    RDMotionField field = RDEstimateMotion(previous, current, options);
+    
+    // blocks that can not be moved by the shift without leaving the grid
+    // (first row, last column) keep some of the window's bias
+    int checked = 0;
+    for (int row = 1; row < field.rows; row++)
+    {
+        for (int column = 0; column < field.columns - 1; column++)
+        {
+            const RDMotionVector& vector = field.vectors[(size_t) row * field.columns + column];
+            if (!vector.estimated) continue;
+            checked++;
+            if (fabs(vector.u - 36.0) > 0.5 || fabs(vector.v + 24.0) > 0.5)
+            {
+                fprintf(stderr, "FAILED:motion of block (%d,%d) is (%f, %f) km/h, expected (36, -24)\n",
+                        column, row, vector.u, vector.v);
+                failed = true;
+            }
+        }
+    }
+    if (checked < (field.rows - 1) * (field.columns - 1) / 2)
+    {
+        fprintf(stderr, "FAILED:only %d motion vectors estimated\n", checked);
+        failed = true;
+    }
+    
+    RDFreeScan(previous);
+    RDFreeScan(current);
+    
+    return !failed;
+}
+
+// value of a Gaussian blob centred on (x, 32) at a cell of a 64x64 grid
+double blobValue(double x, int ix, int iy)
+{
+    double r2 = (ix - x) * (ix - x) + (iy - 32.0) * (iy - 32.0);
+    return 4.0 * exp(-r2 / 18.0);
+}
+
+bool testAdvection()
+{
+    bool failed = false;
+    
+    // a blob moving 10 cells along x in 5 minutes, 120 km/h on the 1 km grid
+    RDScan* scans[2];
+    for (int s = 0; s < 2; s++)
+    {
+        scans[s] = makeAccumulationScan(1, 9, 6, s * 5, 0, 0);
+        free(scans[s]->data);
+        scans[s]->dimLon = 64;
+        scans[s]->dimLat = 64;
+        scans[s]->data = (RDDataType*) malloc(64 * 64 * sizeof(RDDataType));
+        for (int i = 0; i < 64 * 64; i++)
+        {
+            scans[s]->data[i] = (RDDataType) blobValue(20 + 10 * s, i % 64, i / 64);
+        }
+    }
+    
+    RDMotionField motion;
+    motion.columns = 1;
+    motion.rows = 1;
+    motion.originX = motion.originY = 32;
+    motion.step = 64;
+    motion.cellSizeX = motion.cellSizeY = 1.0;
+    RDMotionVector vector = { 120.0f, 0.0f, 1.0f, true };
+    motion.vectors.assign(1, vector);
+    
+    RDAdvectionOptions options = rdAdvectionOptions();
+    options.threads = 2;
+    RDAdvectionCorrector corrector(options);
+    RDFreeScan(corrector.ingest(scans[0], &motion));
+    RDScan* corrected = corrector.ingest(scans[1], &motion);
+    
+    // the 1 minute steps sample the blob at 21, 23, ..., 29 cells, where
+    // both scans traced along the motion agree, so the result is the mean
+    // of these blobs and holds the mass of one blob
+    double total = 0.0;
+    double expectedTotal = 0.0;
+    double worst = 0.0;
+    for (int i = 0; i < 64 * 64; i++)
+    {
+        double expected = 0.0;
+        for (int k = 0; k < 5; k++)
+        {
+            expected += blobValue(21 + 2 * k, i % 64, i / 64) / 5;
+        }
+        if (fabs(corrected->data[i] - expected) > worst)
+        {
+            worst = fabs(corrected->data[i] - expected);
+        }
+        total += corrected->data[i];
+        expectedTotal += scans[1]->data[i];
+    }
+    if (worst > 1e-4)
+    {
+        fprintf(stderr, "FAILED:advected field differs by %f from the moving blob\n", worst);
+        failed = true;
+    }
+    if (fabs(total - expectedTotal) > 1e-3 * expectedTotal)
+    {
+        fprintf(stderr, "FAILED:advected total %f, expected %f\n", total, expectedTotal);
+        failed = true;
+    }
+    
+    RDFreeScan(corrected);
+    RDFreeScan(scans[0]);
+    RDFreeScan(scans[1]);
+    
+    return !failed;
+}
+
+bool testNeighbourhood()
+{
+    bool failed = false;
+    
+    // summed-area table of an odd sized random grid against brute force sums
+    const int dimLon = 37;
+    const int dimLat = 23;
+    std::vector<float> values(dimLon * dimLat);
+    unsigned int seed = 3;
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        values[i] = ((seed >> 16) % 1000) * 0.01f;
+    }
+    RDSummedAreaTable table;
+    table.build(&values[0], dimLon, dimLat);
+    
+    for (int b = 0; b < 200 && !failed; b++)
+    {
+        // boxes reaching up to 3 cells beyond the grid, which are clipped
+        seed = seed * 1103515245u + 12345u;
+        int x0 = (int) ((seed >> 16) % (dimLon + 6)) - 3;
+        seed = seed * 1103515245u + 12345u;
+        int y0 = (int) ((seed >> 16) % (dimLat + 6)) - 3;
+        seed = seed * 1103515245u + 12345u;
+        int x1 = x0 + (int) ((seed >> 16) % 15);
+        seed = seed * 1103515245u + 12345u;
+        int y1 = y0 + (int) ((seed >> 16) % 15);
+        
+        double expected = 0.0;
+        for (int iy = y0 < 0 ? 0 : y0; iy <= y1 && iy < dimLat; iy++)
+        {
+            for (int ix = x0 < 0 ? 0 : x0; ix <= x1 && ix < dimLon; ix++)
+            {
+                expected += values[iy * dimLon + ix];
+            }
+        }
+        if (fabs(table.boxSum(x0, y0, x1, y1) - expected) > 1e-6)
+        {
+            fprintf(stderr, "FAILED:sum over (%d,%d)-(%d,%d) is %f, expected %f\n",
+                    x0, y0, x1, y1, table.boxSum(x0, y0, x1, y1), expected);
+            failed = true;
+        }
+    }
+    
+    std::vector<double> sums(dimLon * dimLat);
+    table.windowSums(5, &sums[0]);
+    for (int i = 0; i < dimLon * dimLat && !failed; i++)
+    {
+        int ix = i % dimLon;
+        int iy = i / dimLon;
+        if (fabs(sums[i] - table.boxSum(ix - 2, iy - 2, ix + 2, iy + 2)) > 1e-6)
+        {
+            fprintf(stderr, "FAILED:window sum of cell (%d,%d) is %f\n", ix, iy, sums[i]);
+            failed = true;
+        }
+    }
+    
+    // fractions skill score of identical and of disjoint fields. The rain
+    // areas of the disjoint fields are further apart than any window.
+    RDScan* scans[3];
+    for (int s = 0; s < 3; s++)
+    {
+        scans[s] = makeAccumulationScan(1, 10, 0, 0, 0, 0);
+        free(scans[s]->data);
+        scans[s]->dimLon = 40;
+        scans[s]->dimLat = 40;
+        scans[s]->data = (RDDataType*) malloc(40 * 40 * sizeof(RDDataType));
+        for (int i = 0; i < 40 * 40; i++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            RDDataType rain = ((seed >> 16) % 500) * 0.01f;
+            int ix = i % 40;
+            bool wet = s == 0 || (s == 1 && ix < 10) || (s == 2 && ix >= 30);
+            scans[s]->data[i] = wet ? rain : 0.0f;
+        }
+    }
+    
+    std::vector<RDDataType> thresholds;
+    thresholds.push_back(0.5f);
+    thresholds.push_back(2.0f);
+    std::vector<int> windows;
+    windows.push_back(1);
+    windows.push_back(5);
+    windows.push_back(9);
+    
+    std::vector<RDFractionsSkillScore> identical = RDComputeFSS(scans[0], scans[0], thresholds, windows, 2);
+    std::vector<RDFractionsSkillScore> disjoint = RDComputeFSS(scans[1], scans[2], thresholds, windows, 2);
+    for (size_t k = 0; k < identical.size(); k++)
+    {
+        if (fabs(identical[k].fss - 1.0) > 1e-9)
+        {
+            fprintf(stderr, "FAILED:FSS of identical fields is %f for threshold %g and window %d\n",
+                    identical[k].fss, identical[k].threshold, identical[k].window);
+            failed = true;
+        }
+    }
+    for (size_t k = 0; k < disjoint.size(); k++)
+    {
+        if (fabs(disjoint[k].fss) > 1e-9)
+        {
+            fprintf(stderr, "FAILED:FSS of disjoint fields is %f for threshold %g and window %d\n",
+                    disjoint[k].fss, disjoint[k].threshold, disjoint[k].window);
+            failed = true;
+        }
+    }
+    if (identical.size() != 6 || disjoint.size() != 6)
+    {
+        fprintf(stderr, "FAILED:expected one score per threshold and window\n");
+        failed = true;
+    }
+    
+    for (int s = 0; s < 3; s++)
+    {
+        RDFreeScan(scans[s]);
+    }
+    
+    return !failed;
+}
+
+// 30x20 RY scan of random values, with missing and clutter cells
+RDScan* makeFilterScan()
+{
+    RDScan* scan = makeAccumulationScan(1, 11, 0, 0, 0, 0);
+    free(scan->data);
+    scan->dimLon = 30;
+    scan->dimLat = 20;
+    scan->data = (RDDataType*) malloc(30 * 20 * sizeof(RDDataType));
+    unsigned int seed = 13;
+    for (int i = 0; i < 30 * 20; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        int r = (seed >> 16) % 1000;
+        scan->data[i] = r < 40 ? RD_ERROR_VALUE : (r < 70 ? RD_CLUTTER_VALUE : r * 0.01f);
+    }
+    return scan;
+}
+
+bool testFilters()
+{
+    bool failed = false;
+    
+    // bands of 4 rows over 3 threads
+    RDScanFilter filter(3, 4);
+    const char* names[3] = { "gaussian", "maximum", "median" };
+    for (int f = 0; f < 3; f++)
+    {
+        RDScan* source = makeFilterScan();
+        RDScan* target = makeFilterScan();
+        RDScan* inPlace = makeFilterScan();
+        switch (f)
+        {
+            case 0:
+                filter.gaussian(source, target, 1.5f);
+                filter.gaussian(inPlace, 1.5f);
+                break;
+            case 1:
+                filter.maximum(source, target, 5);
+                filter.maximum(inPlace, 5);
+                break;
+            default:
+                filter.median(source, target, 3);
+                filter.median(inPlace, 3);
+                break;
+        }
+        
+        if (memcmp(target->data, inPlace->data, 30 * 20 * sizeof(RDDataType)) != 0)
+        {
+            fprintf(stderr, "FAILED:%s filter in place differs from out of place\n", names[f]);
+            failed = true;
+        }
+        
+        for (int i = 0; i < 30 * 20; i++)
+        {
+            RDDataType v = source->data[i];
+            bool marker = v == RD_ERROR_VALUE || v == RD_CLUTTER_VALUE;
+            if (marker ? target->data[i] != v : !RDIsCleanMeasurement(RD_RY, target->data[i]))
+            {
+                fprintf(stderr, "FAILED:%s filter turned %f into %f at cell %d\n", names[f], v, target->data[i], i);
+                failed = true;
+                break;
+            }
+            
+            // the maximum of the clean values in the window, clipped to the grid
+            if (f == 1 && !marker)
+            {
+                int ix = i % 30;
+                int iy = i / 30;
+                RDDataType expected = v;
+                for (int y = iy - 2; y <= iy + 2; y++)
+                {
+                    for (int x = ix - 2; x <= ix + 2; x++)
+                    {
+                        if (x < 0 || x >= 30 || y < 0 || y >= 20) continue;
+                        RDDataType n = source->data[y * 30 + x];
+                        if (RDIsCleanMeasurement(RD_RY, n) && n > expected) expected = n;
+                    }
+                }
+                if (target->data[i] != expected)
+                {
+                    fprintf(stderr, "FAILED:maximum at cell %d is %f, expected %f\n", i, target->data[i], expected);
+                    failed = true;
+                    break;
+                }
+            }
+        }
+        
+        RDFreeScan(source);
+        RDFreeScan(target);
+        RDFreeScan(inPlace);
+    }
+    
+    return !failed;
+}
+
+bool testGaugeAdjustment()
+{
+    bool failed = false;
+    
+    // 60x60 RY scan with a few missing cells in the first row
+    RDScan* radar = makeAccumulationScan(1, 12, 0, 0, 0, 0);
+    free(radar->data);
+    radar->dimLon = 60;
+    radar->dimLat = 60;
+    radar->data = (RDDataType*) malloc(60 * 60 * sizeof(RDDataType));
+    unsigned int seed = 17;
+    for (int i = 0; i < 60 * 60; i++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        radar->data[i] = i < 60 && i % 3 == 0 ? RD_ERROR_VALUE : ((seed >> 16) % 500) * 0.01f;
+    }
+    
+    const RDGridGeometry* geometry = RDGridGeometry::forScan(radar);
+    RDCoordinateSystem rcs = geometry->coordinateSystem();
+    const double* centreX = geometry->centreX();
+    const double* centreY = geometry->centreY();
+    
+    // 20 gauges on cell centres, 20 anywhere on the grid, one without a
+    // measurement and one outside the grid
+    std::vector<RDGauge> gauges;
+    std::vector<int> gaugeCells;
+    for (int g = 0; g < 42; g++)
+    {
+        RDCartesianPoint p;
+        if (g < 20)
+        {
+            int cell = 60 + (g * 7919) % 3540;
+            gaugeCells.push_back(cell);
+            p = rdCartesianPoint(centreX[cell % 60], centreY[cell / 60]);
+        }
+        else
+        {
+            seed = seed * 1103515245u + 12345u;
+            double fx = ((seed >> 16) % 10000) / 10000.0;
+            seed = seed * 1103515245u + 12345u;
+            double fy = ((seed >> 16) % 10000) / 10000.0;
+            p = rdCartesianPoint(centreX[0] + fx * 59, centreY[0] + fy * 59 + (g == 41 ? 100 : 0));
+        }
+        RDGeographicalPoint geo = rcs.geographicalCoordinate(p);
+        seed = seed * 1103515245u + 12345u;
+        RDGauge gauge = { geo.longitude, geo.latitude, g == 40 ? -1.0f : ((seed >> 16) % 800) * 0.01f };
+        gauges.push_back(gauge);
+    }
+    
+    RDGaugeAdjustmentOptions options = rdGaugeAdjustmentOptions();
+    options.neighbours = 4;
+    options.maximumDistance = 20.0;
+    options.threads = 3;
+    
+    for (int method = 0; method < 2; method++)
+    {
+        options.interpolation = method == 0 ? RD_INTERPOLATION_IDW : RD_INTERPOLATION_KRIGING;
+        std::vector<RDGaugeResidual> residuals;
+        RDScan* adjusted = RDAdjustWithGauges(radar, gauges, options, &residuals);
+        
+        // both interpolations reproduce the gauges on cell centres
+        for (int g = 0; g < 20; g++)
+        {
+            if (fabs(adjusted->data[gaugeCells[g]] - gauges[g].value) > 1e-3)
+            {
+                fprintf(stderr, "FAILED:%s gives %f at gauge %d, which measured %f\n",
+                        method == 0 ? "IDW" : "kriging", adjusted->data[gaugeCells[g]], g, gauges[g].value);
+                failed = true;
+            }
+        }
+        for (size_t r = 0; r < residuals.size(); r++)
+        {
+            if (residuals[r].gauge >= 40)
+            {
+                fprintf(stderr, "FAILED:gauge %d should have been skipped\n", (int) residuals[r].gauge);
+                failed = true;
+            }
+        }
+        
+        // IDW from the nearest gauges in reach, found by brute force
+        for (int i = 0; i < 60 * 60 && method == 0 && !failed; i++)
+        {
+            RDDataType value = radar->data[i];
+            if (!RDIsCleanMeasurement(RD_RY, value))
+            {
+                if (adjusted->data[i] != value)
+                {
+                    fprintf(stderr, "FAILED:marker at cell %d was adjusted\n", i);
+                    failed = true;
+                }
+                continue;
+            }
+            
+            std::vector< std::pair<double, double> > neighbours;
+            for (size_t r = 0; r < residuals.size(); r++)
+            {
+                const RDGauge& gauge = gauges[residuals[r].gauge];
+                RDCartesianPoint p = rcs.cartesianCoordinate(rdGeographicalPoint(gauge.longitude, gauge.latitude));
+                double dx = p.x - centreX[i % 60];
+                double dy = p.y - centreY[i / 60];
+                double d2 = dx * dx + dy * dy;
+                if (d2 <= options.maximumDistance * options.maximumDistance)
+                {
+                    neighbours.push_back(std::make_pair(d2, residuals[r].residual));
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+            if (neighbours.size() > (size_t) options.neighbours)
+            {
+                // gauges on cell centres can be equally far away, which
+                // leaves the choice of the last neighbour open
+                if (neighbours[options.neighbours].first - neighbours[options.neighbours - 1].first < 1e-9)
+                {
+                    continue;
+                }
+                neighbours.resize(options.neighbours);
+            }
+            double residual = 0.0;
+            if (!neighbours.empty() && neighbours[0].first < 1e-12)
+            {
+                residual = neighbours[0].second;
+            }
+            else if (!neighbours.empty())
+            {
+                double weights = 0.0;
+                for (size_t n = 0; n < neighbours.size(); n++)
+                {
+                    residual += neighbours[n].second / neighbours[n].first;
+                    weights += 1.0 / neighbours[n].first;
+                }
+                residual /= weights;
+            }
+            double expected = value + residual < 0 ? 0.0 : value + residual;
+            if (fabs(adjusted->data[i] - expected) > 1e-4)
+            {
+                fprintf(stderr, "FAILED:IDW at cell %d is %f, expected %f\n", i, adjusted->data[i], expected);
+                failed = true;
+            }
+        }
+        
+        RDFreeScan(adjusted);
+    }
+    
+    RDFreeScan(radar);
+    
+    return !failed;
+}
+
+bool testTransposeStore()
+{
+    bool failed = false;
+    
+    char directory[] = "/tmp/radolan_test_XXXXXX";
+    mkdtemp(directory);
+    
+    // ten RY scans, given newest first, in chunks of four scans (the last
+    // one partial) and bands of a few tile rows
+    RDSyntheticGenerator generator(rdSyntheticOptions(RD_RY));
+    std::vector<std::string> paths = generator.writeFiles(directory, 1500000000, 1500000000 + 9 * 300);
+    std::vector<std::string> reversed(paths.rbegin(), paths.rend());
+    std::string storePath = std::string(directory) + "/store";
+    
+    RDTransposeOptions options = rdTransposeOptions();
+    options.chunkLength = 4;
+    options.memoryLimit = 4 * 900 * 16 * 4 * sizeof(uint16_t);
+    options.threads = 3;
+    RDTransposeFiles(reversed, storePath.c_str(), options);
+    
+    std::vector<RDScan*> scans;
+    for (size_t t = 0; t < paths.size(); t++)
+    {
+        RDScan* scan = RDAllocateScan();
+        scan->data = NULL;
+        RDReadScan(paths[t].c_str(), scan, false);
+        scans.push_back(scan);
+    }
+    
+    RDTransposeStore store(storePath.c_str());
+    if (store.size() != 10 || store.dimLon() != 900 || store.dimLat() != 900 || store.scanType() != RD_RY)
+    {
+        fprintf(stderr, "FAILED:wrong size of the store\n");
+        failed = true;
+    }
+    for (size_t t = 0; t < store.size() && t < scans.size(); t++)
+    {
+        if (store.time(t) != RDScanTimeInSecondsSinceEpoch(scans[t]))
+        {
+            fprintf(stderr, "FAILED:scan %d of the store has the wrong time\n", (int) t);
+            failed = true;
+        }
+    }
+    size_t first, last;
+    store.range(1500000000 + 300, 1500000000 + 1500, first, last);
+    if (first != 1 || last != 5)
+    {
+        fprintf(stderr, "FAILED:range gives scans [%d, %d), expected [1, 5)\n", (int) first, (int) last);
+        failed = true;
+    }
+    
+    // series of single cells and of blocks across tile and chunk borders
+    // match the scans within half a step of the stored values
+    float tolerance = store.precision() / 2 + 1e-6f;
+    int cells[4][2] = { { 0, 0 }, { 15, 16 }, { 450, 451 }, { 899, 899 } };
+    std::vector<RDDataType> values;
+    for (int c = 0; c < 4 && !failed; c++)
+    {
+        store.series(cells[c][0], cells[c][1], 2, 9, values);
+        for (size_t t = 2; t < 9; t++)
+        {
+            RDDataType expected = scans[t]->data[cells[c][1] * 900 + cells[c][0]];
+            if (fabs(values[t - 2] - expected) > tolerance)
+            {
+                fprintf(stderr, "FAILED:series of cell (%d,%d) holds %f at scan %d, expected %f\n",
+                        cells[c][0], cells[c][1], values[t - 2], (int) t, expected);
+                failed = true;
+                break;
+            }
+        }
+    }
+    
+    int blocks[2][4] = { { 10, 40, 5, 37 }, { 870, 900, 880, 900 } };
+    for (int b = 0; b < 2 && !failed; b++)
+    {
+        int x0 = blocks[b][0], x1 = blocks[b][1], y0 = blocks[b][2], y1 = blocks[b][3];
+        store.area(x0, x1, y0, y1, 0, 10, values);
+        for (int y = y0; y < y1 && !failed; y++)
+        {
+            for (int x = x0; x < x1 && !failed; x++)
+            {
+                for (size_t t = 0; t < 10; t++)
+                {
+                    RDDataType stored = values[((size_t) (y - y0) * (x1 - x0) + (x - x0)) * 10 + t];
+                    RDDataType expected = scans[t]->data[y * 900 + x];
+                    if (fabs(stored - expected) > tolerance)
+                    {
+                        fprintf(stderr, "FAILED:area holds %f at cell (%d,%d) scan %d, expected %f\n",
+                                stored, x, y, (int) t, expected);
+                        failed = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    
+    for (size_t t = 0; t < scans.size(); t++)
+    {
+        RDFreeScan(scans[t]);
+        unlink(paths[t].c_str());
+    }
+    unlink(storePath.c_str());
+    rmdir(directory);
+    
+    return !failed;
+}
+
+// 37x23 RD scan at a precision of 0.1 covering -409.5 to 409.5 as the
+// reader produces it, with missing and clutter cells
+RDScan* makeSignedScan(int hour, int seed)
+{
+    RDScan* scan = makeAccumulationScan(2, 12, hour, 50, 0, 0);
+    free(scan->data);
+    scan->header.scanType = RD_RD;
+    scan->header.precision = 0.1f;
+    scan->header.intervalDuration = 60;
+    scan->dimLon = 37;
+    scan->dimLat = 23;
+    scan->data = (RDDataType*) malloc(37 * 23 * sizeof(RDDataType));
+    for (int i = 0; i < 37 * 23; i++)
+    {
+        int step = (i * 4096 / (37 * 23) + seed * 13) % 4096;
+        RDDataType value = 0.1f * (float) (step < 4095 ? step : 4095);
+        scan->data[i] = i % 29 == 3 ? RD_ERROR_VALUE : (i % 31 == 7 ? RD_CLUTTER_VALUE : (i % 2 ? -value : value));
+    }
+    return scan;
+}
+
+// checks that the archive holds the given scans of a product, bit for bit
+bool archiveHolds(const RDArchiveReader& reader, RDScanType type, const std::vector<RDScan*>& scans)
+{
+    const RDArchiveProduct& product = reader.product(type);
+    if (product.entries.size() != scans.size())
+    {
+        fprintf(stderr, "FAILED:archive holds %d %s scans, expected %d\n",
+                (int) product.entries.size(), RDScanTypeToString(type), (int) scans.size());
+        return false;
+    }
+    bool same = true;
+    std::vector<RDScan*> decoded = reader.scans(type, 0, scans.size());
+    for (size_t t = 0; t < scans.size(); t++)
+    {
+        size_t count = (size_t) scans[t]->dimLon * scans[t]->dimLat;
+        if (decoded[t]->dimLon != scans[t]->dimLon || decoded[t]->dimLat != scans[t]->dimLat
+            || memcmp(decoded[t]->data, scans[t]->data, count * sizeof(RDDataType)) != 0
+            || product.entries[t].time != RDScanTimeInSecondsSinceEpoch(scans[t]))
+        {
+            fprintf(stderr, "FAILED:%s scan %d differs in the archive\n", RDScanTypeToString(type), (int) t);
+            same = false;
+        }
+        RDFreeScan(decoded[t]);
+    }
+    return same;
+}
+
+long fileSize(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+bool testArchive()
+{
+    bool failed = false;
+    
+    char directory[] = "/tmp/radolan_test_XXXXXX";
+    mkdtemp(directory);
+    std::string path = std::string(directory) + "/archive";
+    
+    // three RY scans as read from files, and three RD scans
+    RDSyntheticGenerator generator(rdSyntheticOptions(RD_RY));
+    std::vector<std::string> files = generator.writeFiles(directory, 1500000000, 1500000900);
+    std::vector<RDScan*> ry;
+    std::vector<RDScan*> rd;
+    for (int t = 0; t < 3; t++)
+    {
+        RDScan* scan = RDAllocateScan();
+        scan->data = NULL;
+        RDReadScan(files[t].c_str(), scan, false);
+        ry.push_back(scan);
+        rd.push_back(makeSignedScan(t, t));
+    }
+    
+    // two scans of each product mixed, then one more of each after reopening
+    RDArchiveOptions options = rdArchiveOptions();
+    options.tileSize = 16;
+    options.keyframeInterval = 2;
+    {
+        RDArchiveWriter writer(path.c_str(), options);
+        for (int t = 0; t < 2; t++)
+        {
+            writer.append(ry[t]);
+            writer.append(rd[t]);
+        }
+    }
+    {
+        RDArchiveWriter writer(path.c_str(), options);
+        writer.append(ry[2]);
+        writer.append(rd[2]);
+    }
+    long complete = fileSize(path.c_str());
+    {
+        RDArchiveReader reader(path.c_str());
+        failed = !archiveHolds(reader, RD_RY, ry) || failed;
+        failed = !archiveHolds(reader, RD_RD, rd) || failed;
+        if ((long) reader.endOfRecords() != complete)
+        {
+            fprintf(stderr, "FAILED:records end before the end of the archive\n");
+            failed = true;
+        }
+    }
+    
+    // a record cut short is not read, and cut off when appending again
+    truncate(path.c_str(), complete - 10);
+    {
+        RDArchiveReader reader(path.c_str());
+        std::vector<RDScan*> first(rd.begin(), rd.begin() + 2);
+        failed = !archiveHolds(reader, RD_RY, ry) || failed;
+        failed = !archiveHolds(reader, RD_RD, first) || failed;
+    }
+    {
+        RDArchiveWriter writer(path.c_str(), options);
+        writer.append(rd[2]);
+    }
+    {
+        RDArchiveReader reader(path.c_str());
+        failed = !archiveHolds(reader, RD_RD, rd) || failed;
+    }
+    if (fileSize(path.c_str()) != complete)
+    {
+        fprintf(stderr, "FAILED:archive has %ld bytes after appending again, expected %ld\n",
+                fileSize(path.c_str()), complete);
+        failed = true;
+    }
+    
+    // a record that hits the file size limit is cut off again, and the
+    // next one starts where it did
+    RDScan* last = RDAllocateScan();
+    last->data = NULL;
+    RDReadScan(files[3].c_str(), last, false);
+    {
+        RDArchiveWriter writer(path.c_str(), options);
+        struct rlimit limit;
+        getrlimit(RLIMIT_FSIZE, &limit);
+        struct rlimit small = limit;
+        small.rlim_cur = complete + 100;
+        signal(SIGXFSZ, SIG_IGN);
+        setrlimit(RLIMIT_FSIZE, &small);
+        try
+        {
+            writer.append(last);
+            fprintf(stderr, "FAILED:record beyond the file size limit was written\n");
+            failed = true;
+        }
+        catch (const RDConversionException&)
+        {
+        }
+        setrlimit(RLIMIT_FSIZE, &limit);
+        if (fileSize(path.c_str()) != complete)
+        {
+            fprintf(stderr, "FAILED:partial record was left in the archive\n");
+            failed = true;
+        }
+        writer.append(last);
+    }
+    {
+        RDArchiveReader reader(path.c_str());
+        ry.push_back(last);
+        failed = !archiveHolds(reader, RD_RY, ry) || failed;
+        failed = !archiveHolds(reader, RD_RD, rd) || failed;
+    }
+    
+    // a record with a tile size of 0 is corrupt
+    FILE* f = fopen(path.c_str(), "r+b");
+    int32_t zero = 0;
+    fseek(f, 16 + 36, SEEK_SET);
+    fwrite(&zero, sizeof(zero), 1, f);
+    fclose(f);
+    try
+    {
+        RDArchiveReader reader(path.c_str());
+        fprintf(stderr, "FAILED:archive with a tile size of 0 was read\n");
+        failed = true;
+    }
+    catch (const RDConversionException&)
+    {
+    }
+    
+    for (int t = 0; t < 3; t++)
+    {
+        RDFreeScan(rd[t]);
+    }
+    for (int t = 0; t < 4; t++)
+    {
+        RDFreeScan(ry[t]);
+        unlink(files[t].c_str());
+    }
+    unlink(path.c_str());
+    rmdir(directory);
+    
+    return !failed;
+}
+
+// removes a directory with the files and directories in it
+void removeTree(const std::string& path)
+{
+    DIR* directory = opendir(path.c_str());
+    if (directory == NULL)
+    {
+        unlink(path.c_str());
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL)
+    {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..") removeTree(path + "/" + name);
+    }
+    closedir(directory);
+    rmdir(path.c_str());
+}
+
+// decompresses a Zarr chunk, empty if it can't be read
+std::vector<unsigned char> readZarrChunk(const std::string& path, size_t size)
+{
+    std::string compressed = readTextFile(path.c_str());
+    std::vector<unsigned char> chunk(size);
+    uLongf length = (uLongf) size;
+    if (compressed.empty()
+        || uncompress(&chunk[0], &length, (const Bytef*) compressed.data(), (uLong) compressed.size()) != Z_OK
+        || length != size)
+    {
+        chunk.clear();
+    }
+    return chunk;
+}
+
+// checks that the Zarr chunks of time step index hold the scan, with padded edge chunks
+bool zarrHolds(const std::string& store, size_t index, RDScan* scan, int chunkLon, int chunkLat)
+{
+    bool same = true;
+    RDDataType missing = RDMissingValue(scan->header.scanType);
+    std::string directory = store + "/" + RDScanTypeToString(scan->header.scanType);
+    for (int y0 = 0; y0 < scan->dimLat; y0 += chunkLat)
+    {
+        for (int x0 = 0; x0 < scan->dimLon; x0 += chunkLon)
+        {
+            char key[64];
+            snprintf(key, sizeof(key), "/%d.%d.%d", (int) index, y0 / chunkLat, x0 / chunkLon);
+            std::vector<unsigned char> bytes = readZarrChunk(directory + key, 
+                                                             (size_t) chunkLon * chunkLat * sizeof(RDDataType));
+            if (bytes.empty())
+            {
+                fprintf(stderr, "FAILED:could not read Zarr chunk %s\n", key + 1);
+                same = false;
+                continue;
+            }
+            for (int y = 0; y < chunkLat; y++)
+            {
+                for (int x = 0; x < chunkLon; x++)
+                {
+                    RDDataType value;
+                    memcpy(&value, &bytes[((size_t) y * chunkLon + x) * sizeof(RDDataType)], sizeof(value));
+                    bool inside = y0 + y < scan->dimLat && x0 + x < scan->dimLon;
+                    RDDataType expected = inside ? scan->data[(y0 + y) * scan->dimLon + x0 + x] : missing;
+                    if (memcmp(&value, &expected, sizeof(value)) != 0)
+                    {
+                        fprintf(stderr, "FAILED:Zarr chunk %s holds %f at %d,%d, expected %f\n",
+                                key + 1, value, x, y, expected);
+                        same = false;
+                        y = chunkLat;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    
+    double timestamp = 0;
+    char key[32];
+    snprintf(key, sizeof(key), "/time/%d", (int) index);
+    std::vector<unsigned char> bytes = readZarrChunk(store + key, sizeof(timestamp));
+    if (!bytes.empty()) memcpy(&timestamp, &bytes[0], sizeof(timestamp));
+    if (timestamp != (double) RDScanTimeInSecondsSinceEpoch(scan))
+    {
+        fprintf(stderr, "FAILED:Zarr time %d is %f\n", (int) index, timestamp);
+        same = false;
+    }
+    return same;
+}
+
+bool testZarr()
+{
+    bool failed = false;
+    
+    char directory[] = "/tmp/radolan_test_XXXXXX";
+    if (mkdtemp(directory) == NULL)
+    {
+        fprintf(stderr, "FAILED:could not create a temporary directory\n");
+        return false;
+    }
+    std::string store = std::string(directory) + "/store.zarr";
+    
+    // 37x23 cells in 16x10 chunks leave padded edge chunks on both axes
+    RDZarrOptions options = rdZarrOptions();
+    options.chunkLon = 16;
+    options.chunkLat = 10;
+    RDScan* scans[3] = { makeSignedScan(10, 0), makeSignedScan(11, 1), makeSignedScan(14, 2) };
+    
+    if (Radolan2Zarr::appendScan(scans[0], store.c_str(), options) != 0
+        || Radolan2Zarr::appendScan(scans[1], store.c_str(), options) != 1)
+    {
+        fprintf(stderr, "FAILED:appended scans have the wrong index\n");
+        failed = true;
+    }
+    std::string metadata = readTextFile((store + "/RD/.zarray").c_str());
+    if (metadata.find("\"shape\": [2, 23, 37]") == std::string::npos
+        || metadata.find("\"chunks\": [1, 10, 16]") == std::string::npos
+        || Radolan2Zarr::length(store.c_str()) != 2)
+    {
+        fprintf(stderr, "FAILED:Zarr metadata after appending:\n%s", metadata.c_str());
+        failed = true;
+    }
+    
+    // writing past the end grows the store and leaves the steps between missing
+    Radolan2Zarr::writeScan(scans[2], store.c_str(), 4, options);
+    metadata = readTextFile((store + "/RD/.zarray").c_str());
+    if (metadata.find("\"shape\": [5, 23, 37]") == std::string::npos
+        || readTextFile((store + "/time/.zarray").c_str()).find("\"shape\": [5]") == std::string::npos
+        || Radolan2Zarr::length(store.c_str()) != 5)
+    {
+        fprintf(stderr, "FAILED:Zarr metadata after writing index 4:\n%s", metadata.c_str());
+        failed = true;
+    }
+    if (access((store + "/RD/2.0.0").c_str(), F_OK) == 0 || access((store + "/time/3").c_str(), F_OK) == 0)
+    {
+        fprintf(stderr, "FAILED:skipped time steps have chunks\n");
+        failed = true;
+    }
+    
+    failed = !zarrHolds(store, 0, scans[0], 16, 10) || failed;
+    failed = !zarrHolds(store, 1, scans[1], 16, 10) || failed;
+    failed = !zarrHolds(store, 4, scans[2], 16, 10) || failed;
+    
+    // appending continues after the written index
+    if (Radolan2Zarr::appendScan(scans[0], store.c_str(), options) != 5)
+    {
+        fprintf(stderr, "FAILED:append after writeScan has the wrong index\n");
+        failed = true;
+    }
+    failed = !zarrHolds(store, 5, scans[0], 16, 10) || failed;
+    
+    for (int t = 0; t < 3; t++)
+    {
+        RDFreeScan(scans[t]);
+    }
+    removeTree(directory);
+    
+    return !failed;
+}
+
+// the SHORT or LONG values of a field in the TIFF IFD at position, empty if it is missing
+std::vector<uint32_t> tiffValues(const std::vector<uint8_t>& bytes, size_t position, uint16_t code)
+{
+    std::vector<uint32_t> values;
+    size_t count = readLittleEndian(bytes, position, 2);
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t entry = position + 2 + 12 * i;
+        if (readLittleEndian(bytes, entry, 2) != code) continue;
+        int size = readLittleEndian(bytes, entry + 2, 2) == 3 ? 2 : 4;
+        size_t n = readLittleEndian(bytes, entry + 4, 4);
+        size_t value = n * size <= 4 ? entry + 8 : readLittleEndian(bytes, entry + 8, 4);
+        for (size_t j = 0; j < n && value + (j + 1) * size <= bytes.size(); j++)
+        {
+            values.push_back((uint32_t) readLittleEndian(bytes, value + j * size, size));
+        }
+    }
+    return values;
+}
+
+bool testGeoTIFF()
+{
+    bool failed = false;
+    
+    // the file is written in native byte order, the parser below reads little endian
+    if (!isLittleEndian()) return true;
+    
+    // 37x23 cells in 16x16 tiles, with overviews of 19x12 and 10x6 pixels
+    RDScan* scan = makeSignedScan(9, 5);
+    RDGeoTIFFOptions options = rdGeoTIFFOptions();
+    options.tileSize = 16;
+    options.overviews = 2;
+    options.threads = 3;
+    
+    char filename[] = "/tmp/radolan_test_XXXXXX";
+    int fd = mkstemp(filename);
+    close(fd);
+    Radolan2GeoTIFF::convertScan(scan, filename, options);
+    
+    std::vector<uint8_t> bytes;
+    FILE* file = fopen(filename, "rb");
+    int c;
+    while ((c = fgetc(file)) != EOF) bytes.push_back((uint8_t) c);
+    fclose(file);
+    unlink(filename);
+    
+    if (bytes.size() < 8 || memcmp(&bytes[0], "II", 2) != 0 || readLittleEndian(bytes, 2, 2) != 42)
+    {
+        fprintf(stderr, "FAILED:no little endian TIFF header\n");
+        RDFreeScan(scan);
+        return false;
+    }
+    
+    // the IFDs are chained from the header, full resolution first
+    std::vector<size_t> directories;
+    size_t position = readLittleEndian(bytes, 4, 4);
+    while (position != 0 && position + 2 <= bytes.size() && directories.size() < 8)
+    {
+        directories.push_back(position);
+        size_t next = position + 2 + 12 * readLittleEndian(bytes, position, 2);
+        position = next + 4 <= bytes.size() ? readLittleEndian(bytes, next, 4) : 0;
+    }
+    if (directories.size() != 3)
+    {
+        fprintf(stderr, "FAILED:GeoTIFF has %d IFDs, expected 3\n", (int) directories.size());
+        RDFreeScan(scan);
+        return false;
+    }
+    
+    // full resolution image, north up
+    RDDataType missing = RDMissingValue(RD_RD);
+    RDDataType clutter = RDClutterValue(RD_RD);
+    std::vector<float> full((size_t) 37 * 23);
+    for (int y = 0; y < 23; y++)
+    {
+        memcpy(&full[y * 37], scan->data + (22 - y) * 37, 37 * sizeof(float));
+    }
+    
+    const int widths[3] = { 37, 19, 10 };
+    const int heights[3] = { 23, 12, 6 };
+    std::vector<uint32_t> offsets[3], counts[3];
+    for (int level = 0; level < 3; level++)
+    {
+        size_t ifd = directories[level];
+        int width = widths[level], height = heights[level], factor = 1 << level;
+        int across = (width + 15) / 16, down = (height + 15) / 16;
+        offsets[level] = tiffValues(bytes, ifd, 324);
+        counts[level] = tiffValues(bytes, ifd, 325);
+        if (tiffValues(bytes, ifd, 254) != std::vector<uint32_t>(1, level == 0 ? 0 : 1)
+            || tiffValues(bytes, ifd, 256) != std::vector<uint32_t>(1, width)
+            || tiffValues(bytes, ifd, 257) != std::vector<uint32_t>(1, height)
+            || tiffValues(bytes, ifd, 322) != std::vector<uint32_t>(1, 16)
+            || tiffValues(bytes, ifd, 323) != std::vector<uint32_t>(1, 16)
+            || tiffValues(bytes, ifd, 259) != std::vector<uint32_t>(1, 8)
+            || tiffValues(bytes, ifd, 339) != std::vector<uint32_t>(1, 3)
+            || offsets[level].size() != (size_t) (across * down) || counts[level].size() != offsets[level].size()
+            || tiffValues(bytes, ifd, 34735).empty() != (level != 0))
+        {
+            fprintf(stderr, "FAILED:GeoTIFF IFD %d does not describe a %dx%d image\n", level, width, height);
+            failed = true;
+            continue;
+        }
+        
+        // overviews average the valid pixels of the full resolution image
+        std::vector<float> image = full;
+        if (level > 0) image.assign((size_t) width * height, missing);
+        for (int oy = 0; oy < height && level > 0; oy++)
+        {
+            for (int ox = 0; ox < width; ox++)
+            {
+                double sum = 0;
+                int n = 0;
+                for (int y = oy * factor; y < std::min(23, (oy + 1) * factor); y++)
+                {
+                    for (int x = ox * factor; x < std::min(37, (ox + 1) * factor); x++)
+                    {
+                        float v = full[y * 37 + x];
+                        if (v != missing && v != clutter)
+                        {
+                            sum += v;
+                            n++;
+                        }
+                    }
+                }
+                if (n > 0) image[oy * width + ox] = (float) (sum / n);
+            }
+        }
+        
+        // edge tiles are padded with the missing value
+        for (int t = 0; t < across * down; t++)
+        {
+            std::vector<float> tile(16 * 16);
+            uLongf length = (uLongf) (tile.size() * sizeof(float));
+            if (offsets[level][t] + (size_t) counts[level][t] > bytes.size()
+                || uncompress((Bytef*) &tile[0], &length, &bytes[offsets[level][t]], counts[level][t]) != Z_OK
+                || length != tile.size() * sizeof(float))
+            {
+                fprintf(stderr, "FAILED:could not decompress GeoTIFF tile %d of IFD %d\n", t, level);
+                failed = true;
+                continue;
+            }
+            int x0 = (t % across) * 16, y0 = (t / across) * 16;
+            for (int i = 0; i < 16 * 16; i++)
+            {
+                int x = x0 + i % 16, y = y0 + i / 16;
+                float expected = x < width && y < height ? image[y * width + x] : missing;
+                if (fabs(tile[i] - expected) > 1e-4)
+                {
+                    fprintf(stderr, "FAILED:GeoTIFF IFD %d pixel %d,%d is %f, expected %f\n",
+                            level, x, y, tile[i], expected);
+                    failed = true;
+                    break;
+                }
+            }
+        }
+    }
+    
+    // the tiles follow the IFDs, from the smallest overview to the full resolution
+    size_t end = directories.back();
+    for (int level = 2; level >= 0 && !failed; level--)
+    {
+        for (size_t t = 0; t < offsets[level].size(); t++)
+        {
+            if ((level < 2 || t > 0) && offsets[level][t] != end)
+            {
+                fprintf(stderr, "FAILED:GeoTIFF tile %d of IFD %d is at %u, expected %u\n",
+                        (int) t, level, offsets[level][t], (unsigned) end);
+                failed = true;
+            }
+            if (offsets[level][t] < end)
+            {
+                fprintf(stderr, "FAILED:GeoTIFF tile %d of IFD %d overlaps the IFDs\n", (int) t, level);
+                failed = true;
+            }
+            end = offsets[level][t] + counts[level][t];
+        }
+    }
+    if (!failed && end != bytes.size())
+    {
+        fprintf(stderr, "FAILED:GeoTIFF tiles end at %u, the file at %u\n", (unsigned) end, (unsigned) bytes.size());
+        failed = true;
+    }
+    
+    RDFreeScan(scan);
+    
+    return !failed;
+}
+
+// checks that two NetCDF files hold the same variables, with the same dimensions and values
+bool sameNetCDF(const std::string& a, const std::string& b)
+{
+    netCDF::NcFile fileA(a, netCDF::NcFile::read);
+    netCDF::NcFile fileB(b, netCDF::NcFile::read);
+    std::multimap<std::string, netCDF::NcVar> vars = fileA.getVars();
+    bool same = vars.size() == fileB.getVars().size();
+    std::multimap<std::string, netCDF::NcVar>::iterator it;
+    for (it = vars.begin(); it != vars.end() && same; ++it)
+    {
+        netCDF::NcVar varA = it->second;
+        netCDF::NcVar varB = fileB.getVar(it->first);
+        same = !varB.isNull() && varA.getType().getId() == varB.getType().getId()
+            && varA.getDimCount() == varB.getDimCount();
+        size_t count = 1;
+        for (int d = 0; d < varA.getDimCount() && same; d++)
+        {
+            same = varA.getDim(d).getSize() == varB.getDim(d).getSize();
+            count *= varA.getDim(d).getSize();
+        }
+        if (same && varA.getDimCount() > 0)
+        {
+            std::vector<double> valuesA(count), valuesB(count);
+            varA.getVar(&valuesA[0]);
+            varB.getVar(&valuesB[0]);
+            same = memcmp(&valuesA[0], &valuesB[0], count * sizeof(double)) == 0;
+        }
+        if (!same)
+        {
+            fprintf(stderr, "FAILED:variable %s differs between %s and %s\n", it->first.c_str(), a.c_str(), b.c_str());
+        }
+    }
+    fileA.close();
+    fileB.close();
+    return same;
+}
+
+bool testParallelNetCDF()
+{
+    bool failed = false;
+    
+    char directory[] = "/tmp/radolan_test_XXXXXX";
+    char serial[] = "/tmp/radolan_test_XXXXXX";
+    char parallel[] = "/tmp/radolan_test_XXXXXX";
+    mkdtemp(directory);
+    mkdtemp(serial);
+    mkdtemp(parallel);
+    
+    // four RX scans, written as bytes, and one RW scan
+    std::vector<std::string> paths;
+    RDScanType types[2] = { RD_RX, RD_RW };
+    for (int t = 0; t < 2; t++)
+    {
+        RDSyntheticGenerator generator(rdSyntheticOptions(types[t]));
+        std::vector<std::string> written = generator.writeFiles(directory, 1500001200, 1500001200 + 15 * 60);
+        paths.insert(paths.end(), written.begin(), written.end());
+    }
+    
+    std::vector<std::string> one = Radolan2NetCDF::convertFiles(paths, serial, true, NULL, false, false, 1);
+    std::vector<std::string> four = Radolan2NetCDF::convertFiles(paths, parallel, true, NULL, false, false, 4);
+    if (one.size() != paths.size() || four.size() != paths.size())
+    {
+        fprintf(stderr, "FAILED:converted %d and %d of %d files\n", (int) one.size(), (int) four.size(),
+                (int) paths.size());
+        failed = true;
+    }
+    for (size_t i = 0; i < one.size() && i < four.size(); i++)
+    {
+        std::string name = paths[i].substr(paths[i].rfind('/')) + ".nc";
+        if (one[i] != serial + name || four[i] != parallel + name)
+        {
+            fprintf(stderr, "FAILED:file %d was written as %s and %s\n", (int) i, one[i].c_str(), four[i].c_str());
+            failed = true;
+        }
+        else
+        {
+            failed = !sameNetCDF(one[i], four[i]) || failed;
+        }
+    }
+    
+    for (size_t i = 0; i < paths.size(); i++) unlink(paths[i].c_str());
+    for (size_t i = 0; i < one.size(); i++) unlink(one[i].c_str());
+    for (size_t i = 0; i < four.size(); i++) unlink(four[i].c_str());
+    rmdir(directory);
+    rmdir(serial);
+    rmdir(parallel);
+    
+    return !failed;
+}
+
 int main(int argc, char** argv) 
 {
     printf("\nendianess = %s\n", isLittleEndian() ? "LITTLE":"BIG" );
@@ -108,6 +2459,60 @@ int main(int argc, char** argv)
     
     printf( "RDCoordinateSystem test: %s\n", coordTest ? "OK" : "FAILED" );
 
+    printf( "RDRegions test: %s\n", testRegions() ? "OK" : "FAILED" );
+
+    printf( "Scan time test: %s\n", testScanTime() ? "OK" : "FAILED" );
+
+    printf( "RDAccumulator test: %s\n", testAccumulator() ? "OK" : "FAILED" );
+
+    printf( "Rain rate test: %s\n", testRainrate() ? "OK" : "FAILED" );
+
+    printf( "Statistics test: %s\n", testStatistics() ? "OK" : "FAILED" );
+
+    printf( "Rain cell test: %s\n", testCells() ? "OK" : "FAILED" );
+
+    printf( "RDScanCube test: %s\n", testScanCube() ? "OK" : "FAILED" );
+
+    printf( "RDBitRound test: %s\n", testBitRound() ? "OK" : "FAILED" );
+
+    printf( "RDWriteScan test: %s\n", testWriteScan(RD_RX, false) && testWriteScan(RD_RW, true) ? "OK" : "FAILED" );
+
+    printf( "Cell centre test: %s\n", testCellCentres() ? "OK" : "FAILED" );
+
+    printf( "Grid geometry cache test: %s\n", testGridGeometryCache() ? "OK" : "FAILED" );
+
+    printf( "FlatGeobuf test: %s\n", testFlatGeobuf() ? "OK" : "FAILED" );
+
+    printf( "Text export test: %s\n", testTextExport() ? "OK" : "FAILED" );
+
+    printf( "RDSlidingWindow test: %s\n", testSlidingWindow() ? "OK" : "FAILED" );
+
+    printf( "RDClimatology test: %s\n", testClimatology() ? "OK" : "FAILED" );
+
+    printf( "RDQuantileSketch test: %s\n", testQuantileSketch() ? "OK" : "FAILED" );
+
+    printf( "Motion test: %s\n", testMotion() ? "OK" : "FAILED" );
+
+    printf( "Advection test: %s\n", testAdvection() ? "OK" : "FAILED" );
+
+    printf( "Neighbourhood test: %s\n", testNeighbourhood() ? "OK" : "FAILED" );
+
+    printf( "RDScanFilter test: %s\n", testFilters() ? "OK" : "FAILED" );
+
+    printf( "Gauge adjustment test: %s\n", testGaugeAdjustment() ? "OK" : "FAILED" );
+
+    printf( "RDTransposeStore test: %s\n", testTransposeStore() ? "OK" : "FAILED" );
+
+    printf( "RDArchive test: %s\n", testArchive() ? "OK" : "FAILED" );
+
+    printf( "Zarr test: %s\n", testZarr() ? "OK" : "FAILED" );
+
+    printf( "GeoTIFF test: %s\n", testGeoTIFF() ? "OK" : "FAILED" );
+
+    printf( "Combined NetCDF test: %s\n", testCombineProducts() ? "OK" : "FAILED" );
+
+    printf( "Parallel NetCDF test: %s\n", testParallelNetCDF() ? "OK" : "FAILED" );
+
     printf( "RDReadScan test:\n" );
 	
     RDScan* scan = RDAllocateScan();